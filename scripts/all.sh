@@ -20,6 +20,7 @@ fi
 
 glslc ./shaders/shader.vert -o ./compiled_shaders/vertex.spv;
 glslc ./shaders/shader.frag -o ./compiled_shaders/fragment.spv;
+glslc ./shaders/cull.comp -o ./compiled_shaders/cull.spv;
 
 echo "compiled shaders!"
 
@@ -4,4 +4,5 @@ if [ ! -d "compiled_shaders" ]; then
 fi
 
 glslc ./shaders/shader.vert -o ./compiled_shaders/vertex.spv;
-glslc ./shaders/shader.frag -o ./compiled_shaders/fragment.spv;
\ No newline at end of file
+glslc ./shaders/shader.frag -o ./compiled_shaders/fragment.spv;
+glslc ./shaders/cull.comp -o ./compiled_shaders/cull.spv;
\ No newline at end of file
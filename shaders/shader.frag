@@ -5,6 +5,8 @@ layout(binding = 1) uniform sampler2D texSampler;
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
+// the material of the instance, every instance uses texSampler until there is a material table
+layout(location = 2) flat in uint fragMaterialIndex;
 
 layout (location = 0) out vec4 outColor;
 
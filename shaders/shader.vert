@@ -19,13 +19,19 @@ layout(binding = 0) uniform CameraUBO {
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec2 inTexCoord;
 
+// per instance, see InstanceData
+layout(location = 4) in mat4 instanceModel;
+layout(location = 8) in uint instanceMaterialIndex;
+
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragMaterialIndex;
 
 void main() {
-  gl_Position = u_Camera3D.projection * u_Camera3D.view * u_Camera3D.model * vec4(position, 1.0);
+  gl_Position = u_Camera3D.projection * u_Camera3D.view * u_Camera3D.model * instanceModel * vec4(position, 1.0);
   // gl_Position = vec4(position, 1.0);
 
   fragColor = vec3(1.0, 1.0, 1.0);
   fragTexCoord = inTexCoord;
+  fragMaterialIndex = instanceMaterialIndex;
 }
\ No newline at end of file
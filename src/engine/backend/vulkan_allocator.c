@@ -0,0 +1,849 @@
+#include <assert.h>
+#include <engine/backend/vulkan_helpers.h>
+#include <stdlib.h>
+
+// each power of two size class is split into 2^TLSF_SL_LOG2 linear classes
+#define TLSF_SL_LOG2  4
+#define TLSF_SL_COUNT (1u << TLSF_SL_LOG2)
+// sizes below 2^TLSF_FL_SHIFT all share the first class
+#define TLSF_FL_SHIFT 8
+#define TLSF_FL_COUNT 32
+// leftovers smaller than this stay with the allocation instead of becoming a free node
+#define TLSF_MIN_SPLIT_SIZE (1ull << TLSF_FL_SHIFT)
+
+typedef struct VulkanMemoryBlock
+{
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    void* mapped;
+    uint32_t allocation_count;
+    struct VulkanMemoryNode* first_node;
+    struct VulkanMemoryPool* pool;
+    struct VulkanMemoryBlock* next;
+} VulkanMemoryBlock;
+
+typedef struct VulkanMemoryNode
+{
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    VulkanMemoryBlock* block;
+    // neighbours in the block, ordered by offset
+    struct VulkanMemoryNode* prev_physical;
+    struct VulkanMemoryNode* next_physical;
+    // neighbours in the free list of the size class, only valid while free
+    struct VulkanMemoryNode* prev_free;
+    struct VulkanMemoryNode* next_free;
+    bool free;
+} VulkanMemoryNode;
+
+typedef struct VulkanMemoryPool
+{
+    uint32_t memory_type_index;
+    VkDeviceSize block_size;
+    VulkanMemoryBlock* blocks;
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmaps[TLSF_FL_COUNT];
+    VulkanMemoryNode* free_lists[TLSF_FL_COUNT][TLSF_SL_COUNT];
+} VulkanMemoryPool;
+
+static inline void Mapping(const VkDeviceSize size, uint32_t fl[static 1], uint32_t sl[static 1])
+{
+    if (size < TLSF_MIN_SPLIT_SIZE)
+    {
+        *fl = 0;
+        *sl = (uint32_t)(size / (TLSF_MIN_SPLIT_SIZE / TLSF_SL_COUNT));
+        return;
+    }
+    const uint32_t log2 = 63 - (uint32_t)__builtin_clzll(size);
+    *fl                 = log2 - TLSF_FL_SHIFT + 1;
+    *sl                 = (uint32_t)(size >> (log2 - TLSF_SL_LOG2)) - TLSF_SL_COUNT;
+}
+
+static inline VkDeviceSize RoundUp(const VkDeviceSize x, const VkDeviceSize alignment)
+{
+    return (x + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * Counts a VkDeviceMemory of size bytes against its heap. A negative size is a free.
+ */
+static void TrackDeviceMemory(VulkanAllocator allocator[static 1], const uint32_t memory_type_index, const int64_t size)
+{
+    VulkanMemoryHeapBudget* const heap = &allocator->heaps[allocator->memory_properties.memoryTypes[memory_type_index].heapIndex];
+    heap->allocated_bytes += (VkDeviceSize)size;
+    heap->usage += (VkDeviceSize)size;
+    if (heap->allocated_bytes > heap->peak_bytes)
+    {
+        heap->peak_bytes = heap->allocated_bytes;
+    }
+}
+
+static void InsertFreeNode(VulkanMemoryPool pool[static 1], VulkanMemoryNode node[static 1])
+{
+    uint32_t fl, sl;
+    Mapping(node->size, &fl, &sl);
+
+    node->free      = true;
+    node->prev_free = NULL;
+    node->next_free = pool->free_lists[fl][sl];
+    if (node->next_free != NULL)
+    {
+        node->next_free->prev_free = node;
+    }
+    pool->free_lists[fl][sl] = node;
+    pool->sl_bitmaps[fl] |= 1u << sl;
+    pool->fl_bitmap |= 1u << fl;
+}
+
+static void RemoveFreeNode(VulkanMemoryPool pool[static 1], VulkanMemoryNode node[static 1])
+{
+    uint32_t fl, sl;
+    Mapping(node->size, &fl, &sl);
+
+    if (node->prev_free != NULL)
+    {
+        node->prev_free->next_free = node->next_free;
+    }
+    else
+    {
+        pool->free_lists[fl][sl] = node->next_free;
+        if (pool->free_lists[fl][sl] == NULL)
+        {
+            pool->sl_bitmaps[fl] &= ~(1u << sl);
+            if (pool->sl_bitmaps[fl] == 0)
+            {
+                pool->fl_bitmap &= ~(1u << fl);
+            }
+        }
+    }
+    if (node->next_free != NULL)
+    {
+        node->next_free->prev_free = node->prev_free;
+    }
+    node->free = false;
+}
+
+/**
+ * @return A free node of at least size bytes, or NULL if the pool has none.
+ */
+static VulkanMemoryNode* FindFreeNode(const VulkanMemoryPool pool[static 1], VkDeviceSize size)
+{
+    // round up to the next class so that any node of the class found is large enough
+    if (size >= TLSF_MIN_SPLIT_SIZE)
+    {
+        const uint32_t log2 = 63 - (uint32_t)__builtin_clzll(size);
+        size += (1ull << (log2 - TLSF_SL_LOG2)) - 1;
+    }
+    else
+    {
+        size += TLSF_MIN_SPLIT_SIZE / TLSF_SL_COUNT - 1;
+    }
+    uint32_t fl, sl;
+    Mapping(size, &fl, &sl);
+    if (fl >= TLSF_FL_COUNT)
+    {
+        return NULL;
+    }
+
+    uint32_t sl_bitmap = pool->sl_bitmaps[fl] & (~0u << sl);
+    if (sl_bitmap == 0)
+    {
+        const uint32_t fl_bitmap = fl + 1 < TLSF_FL_COUNT ? pool->fl_bitmap & (~0u << (fl + 1)) : 0;
+        if (fl_bitmap == 0)
+        {
+            return NULL;
+        }
+        fl        = (uint32_t)__builtin_ctz(fl_bitmap);
+        sl_bitmap = pool->sl_bitmaps[fl];
+    }
+    sl = (uint32_t)__builtin_ctz(sl_bitmap);
+    return pool->free_lists[fl][sl];
+}
+
+static inline bool NodeFits(const VulkanMemoryNode node[static 1], const VkDeviceSize size, const VkDeviceSize alignment)
+{
+    return RoundUp(node->offset, alignment) + size <= node->offset + node->size;
+}
+
+static bool AddBlock(VulkanAllocator allocator[static 1], VulkanMemoryPool pool[static 1], const VkDeviceSize min_size)
+{
+    VulkanMemoryBlock* const block = malloc(sizeof(VulkanMemoryBlock));
+    VulkanMemoryNode* const node   = malloc(sizeof(VulkanMemoryNode));
+    if (block == NULL || node == NULL)
+    {
+        free(block);
+        free(node);
+        return true;
+    }
+
+    // fall back to smaller blocks when the heap is nearly full
+    VkResult result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    for (VkDeviceSize size = pool->block_size; size >= min_size && result != VK_SUCCESS; size /= 2)
+    {
+        const VkMemoryAllocateInfo allocate_info = {
+            .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .pNext           = NULL,
+            .allocationSize  = size,
+            .memoryTypeIndex = pool->memory_type_index,
+        };
+        result      = vkAllocateMemory(allocator->device, &allocate_info, NULL, &block->memory);
+        block->size = size;
+    }
+    VK_ERROR_HANDLE(result, {
+        free(block);
+        free(node);
+        return true;
+    });
+
+    block->mapped = NULL;
+    if (allocator->memory_properties.memoryTypes[pool->memory_type_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        VK_ERROR_HANDLE(vkMapMemory(allocator->device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped), {
+            vkFreeMemory(allocator->device, block->memory, NULL);
+            free(block);
+            free(node);
+            return true;
+        });
+    }
+
+    *node = (VulkanMemoryNode){
+        .offset        = 0,
+        .size          = block->size,
+        .block         = block,
+        .prev_physical = NULL,
+        .next_physical = NULL,
+        .prev_free     = NULL,
+        .next_free     = NULL,
+        .free          = false,
+    };
+    block->allocation_count = 0;
+    block->first_node       = node;
+    block->pool             = pool;
+    block->next             = pool->blocks;
+    pool->blocks            = block;
+    InsertFreeNode(pool, node);
+
+    allocator->stats.device_memory_count++;
+    allocator->stats.block_count++;
+    allocator->stats.block_bytes += block->size;
+    TrackDeviceMemory(allocator, pool->memory_type_index, (int64_t)block->size);
+    return false;
+}
+
+static void FreeBlock(VulkanAllocator allocator[static 1], VulkanMemoryPool pool[static 1], VulkanMemoryBlock* const block)
+{
+    for (VulkanMemoryBlock** it = &pool->blocks; *it != NULL; it = &(*it)->next)
+    {
+        if (*it == block)
+        {
+            *it = block->next;
+            break;
+        }
+    }
+
+    for (VulkanMemoryNode* node = block->first_node; node != NULL;)
+    {
+        VulkanMemoryNode* const next = node->next_physical;
+        if (node->free)
+        {
+            RemoveFreeNode(pool, node);
+        }
+        free(node);
+        node = next;
+    }
+
+    // vkFreeMemory unmaps implicitly
+    vkFreeMemory(allocator->device, block->memory, NULL);
+    allocator->stats.device_memory_count--;
+    allocator->stats.block_count--;
+    allocator->stats.block_bytes -= block->size;
+    TrackDeviceMemory(allocator, pool->memory_type_index, -(int64_t)block->size);
+    free(block);
+}
+
+/**
+ * Takes size bytes at alignment out of a free node, returning what is left on either side to the pool.
+ */
+static VulkanMemoryNode* SplitNode(VulkanMemoryPool pool[static 1], VulkanMemoryNode node[static 1], const VkDeviceSize size, const VkDeviceSize alignment)
+{
+    RemoveFreeNode(pool, node);
+
+    // the node keeps the padding in front, so the first node of a block never changes
+    const VkDeviceSize padding = RoundUp(node->offset, alignment) - node->offset;
+    if (padding >= TLSF_MIN_SPLIT_SIZE)
+    {
+        VulkanMemoryNode* const used = malloc(sizeof(VulkanMemoryNode));
+        if (used != NULL)
+        {
+            *used = (VulkanMemoryNode){
+                .offset        = node->offset + padding,
+                .size          = node->size - padding,
+                .block         = node->block,
+                .prev_physical = node,
+                .next_physical = node->next_physical,
+                .prev_free     = NULL,
+                .next_free     = NULL,
+                .free          = false,
+            };
+            if (used->next_physical != NULL)
+            {
+                used->next_physical->prev_physical = used;
+            }
+            node->next_physical = used;
+            node->size          = padding;
+            InsertFreeNode(pool, node);
+            node = used;
+        }
+    }
+
+    const VkDeviceSize used_size = RoundUp(node->offset, alignment) - node->offset + size;
+    if (node->size - used_size >= TLSF_MIN_SPLIT_SIZE)
+    {
+        VulkanMemoryNode* const rest = malloc(sizeof(VulkanMemoryNode));
+        if (rest != NULL)
+        {
+            *rest = (VulkanMemoryNode){
+                .offset        = node->offset + used_size,
+                .size          = node->size - used_size,
+                .block         = node->block,
+                .prev_physical = node,
+                .next_physical = node->next_physical,
+                .prev_free     = NULL,
+                .next_free     = NULL,
+                .free          = false,
+            };
+            if (rest->next_physical != NULL)
+            {
+                rest->next_physical->prev_physical = rest;
+            }
+            node->next_physical = rest;
+            node->size          = used_size;
+            InsertFreeNode(pool, rest);
+        }
+    }
+
+    return node;
+}
+
+static VulkanMemoryPool* GetPool(VulkanAllocator allocator[static 1], const uint32_t memory_type_index, VulkanAllocationKind kind)
+{
+    // without a granularity restriction linear and optimal resources can share blocks
+    if (allocator->buffer_image_granularity <= 1)
+    {
+        kind = VULKAN_ALLOCATION_KIND_LINEAR;
+    }
+
+    VulkanMemoryPool* pool = allocator->pools[memory_type_index][kind];
+    if (pool != NULL)
+    {
+        return pool;
+    }
+
+    pool = calloc(1, sizeof(VulkanMemoryPool));
+    if (pool == NULL)
+    {
+        return NULL;
+    }
+
+    // an eighth of the heap, so small heaps are not taken by a single block
+    const uint32_t heap_index    = allocator->memory_properties.memoryTypes[memory_type_index].heapIndex;
+    const VkDeviceSize heap_size = allocator->memory_properties.memoryHeaps[heap_index].size;
+    VkDeviceSize block_size      = heap_size / 8;
+    block_size                   = block_size < VULKAN_ALLOCATOR_MIN_BLOCK_SIZE ? VULKAN_ALLOCATOR_MIN_BLOCK_SIZE : block_size;
+    block_size                   = block_size > VULKAN_ALLOCATOR_MAX_BLOCK_SIZE ? VULKAN_ALLOCATOR_MAX_BLOCK_SIZE : block_size;
+
+    pool->memory_type_index                   = memory_type_index;
+    pool->block_size                          = block_size;
+    allocator->pools[memory_type_index][kind] = pool;
+    return pool;
+}
+
+static bool AllocateDedicated(VulkanAllocator allocator[static 1], const VkMemoryRequirements requirements[static 1], const uint32_t memory_type_index,
+                              const VkMemoryDedicatedAllocateInfo* const dedicated_info, VulkanAllocation allocation[static 1])
+{
+    if (allocator->stats.device_memory_count >= allocator->max_memory_allocation_count)
+    {
+        ROSINA_LOG_ERROR("Out of device memory allocations (%u)", allocator->max_memory_allocation_count);
+        return true;
+    }
+
+    const VkMemoryAllocateInfo allocate_info = {
+        .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext           = dedicated_info,
+        .allocationSize  = requirements->size,
+        .memoryTypeIndex = memory_type_index,
+    };
+    VK_ERROR_RETURN(vkAllocateMemory(allocator->device, &allocate_info, NULL, &allocation->memory), true);
+
+    allocation->offset = 0;
+    allocation->size   = requirements->size;
+    allocation->mapped = NULL;
+    allocation->node   = NULL;
+    if (allocator->memory_properties.memoryTypes[memory_type_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        VK_ERROR_HANDLE(vkMapMemory(allocator->device, allocation->memory, 0, VK_WHOLE_SIZE, 0, &allocation->mapped), {
+            vkFreeMemory(allocator->device, allocation->memory, NULL);
+            allocation->memory = VK_NULL_HANDLE;
+            return true;
+        });
+    }
+
+    allocator->stats.device_memory_count++;
+    allocator->stats.dedicated_count++;
+    allocator->stats.dedicated_bytes += requirements->size;
+    TrackDeviceMemory(allocator, memory_type_index, (int64_t)requirements->size);
+    return false;
+}
+
+/**
+ * @return The best memory type whose heap has room for the requirements within its budget, the best one if every heap
+ * is over budget, or UINT32_MAX.
+ */
+static uint32_t FindMemoryTypeIndex(const VulkanAllocator allocator[static 1], const VkMemoryRequirements requirements[static 1],
+                                    const VkMemoryPropertyFlags properties, const VkMemoryPropertyFlags preferred)
+{
+    uint32_t within_budget = 0;
+    for (uint32_t i = 0; i < allocator->memory_properties.memoryTypeCount; i++)
+    {
+        const VulkanMemoryHeapBudget* const heap = &allocator->heaps[allocator->memory_properties.memoryTypes[i].heapIndex];
+        if (heap->usage + requirements->size <= heap->budget)
+        {
+            within_budget |= 1u << i;
+        }
+    }
+
+    const uint32_t index = FindMemoryType(&allocator->memory_properties, requirements->memoryTypeBits & within_budget, properties, preferred);
+    return index != UINT32_MAX ? index : FindMemoryType(&allocator->memory_properties, requirements->memoryTypeBits, properties, preferred);
+}
+
+static void TrackCategory(VulkanAllocator allocator[static 1], const VulkanAllocation allocation[static 1])
+{
+    VulkanMemoryCategoryStats* const category = &allocator->categories[allocation->category];
+    category->allocation_count++;
+    category->bytes += allocation->size;
+    if (category->bytes > category->peak_bytes)
+    {
+        category->peak_bytes = category->bytes;
+    }
+}
+
+static bool Allocate(VulkanAllocator allocator[static 1], const VkMemoryRequirements requirements[static 1], const VkMemoryPropertyFlags properties,
+                     const VkMemoryPropertyFlags preferred, const VulkanAllocationKind kind, const VulkanMemoryCategory category,
+                     const VkMemoryDedicatedAllocateInfo* const dedicated_info, VulkanAllocation allocation[static 1])
+{
+    *allocation = (VulkanAllocation){
+        .memory            = VK_NULL_HANDLE,
+        .offset            = 0,
+        .size              = 0,
+        .mapped            = NULL,
+        .node              = NULL,
+        .memory_type_index = UINT32_MAX,
+        .category          = category,
+    };
+
+    const uint32_t memory_type_index = FindMemoryTypeIndex(allocator, requirements, properties, preferred);
+    if (memory_type_index == UINT32_MAX)
+    {
+        ROSINA_LOG_ERROR("No memory type with properties 0x%x", (unsigned)properties);
+        return true;
+    }
+    allocation->memory_type_index = memory_type_index;
+
+    VulkanMemoryPool* const pool = GetPool(allocator, memory_type_index, kind);
+    if (pool == NULL)
+    {
+        return true;
+    }
+
+    if (dedicated_info != NULL || requirements->size > pool->block_size / 2)
+    {
+        if (AllocateDedicated(allocator, requirements, memory_type_index, dedicated_info, allocation))
+        {
+            return true;
+        }
+        TrackCategory(allocator, allocation);
+        return false;
+    }
+
+    const VkDeviceSize alignment = requirements->alignment > 0 ? requirements->alignment : 1;
+
+    // the first node of the best class usually fits. Otherwise ask for enough room to align any node.
+    VulkanMemoryNode* node = FindFreeNode(pool, requirements->size);
+    if (node == NULL || !NodeFits(node, requirements->size, alignment))
+    {
+        node = FindFreeNode(pool, requirements->size + alignment - 1);
+    }
+    if (node == NULL)
+    {
+        if (allocator->stats.device_memory_count >= allocator->max_memory_allocation_count ||
+            AddBlock(allocator, pool, RoundUp(requirements->size, VULKAN_ALLOCATOR_MIN_BLOCK_SIZE)))
+        {
+            // a block does not fit, the allocation alone might
+            if (AllocateDedicated(allocator, requirements, memory_type_index, NULL, allocation))
+            {
+                return true;
+            }
+            TrackCategory(allocator, allocation);
+            return false;
+        }
+        node = pool->blocks->first_node;
+    }
+
+    node = SplitNode(pool, node, requirements->size, alignment);
+    node->block->allocation_count++;
+
+    allocation->memory = node->block->memory;
+    allocation->offset = RoundUp(node->offset, alignment);
+    allocation->size   = requirements->size;
+    allocation->mapped = node->block->mapped != NULL ? (uint8_t*)node->block->mapped + allocation->offset : NULL;
+    allocation->node   = node;
+
+    allocator->stats.allocation_count++;
+    allocator->stats.allocated_bytes += node->size;
+    TrackCategory(allocator, allocation);
+    return false;
+}
+
+bool VulkanAllocator_Allocate(VulkanAllocator allocator[static 1], const VkMemoryRequirements requirements[static 1], const VkMemoryPropertyFlags properties,
+                              const VkMemoryPropertyFlags preferred, const VulkanAllocationKind kind, const VulkanMemoryCategory category,
+                              VulkanAllocation allocation[static 1])
+{
+    return Allocate(allocator, requirements, properties, preferred, kind, category, NULL, allocation);
+}
+
+bool VulkanAllocator_AllocateBuffer(VulkanAllocator allocator[static 1], const VkBuffer buffer, const VkMemoryPropertyFlags properties,
+                                    const VkMemoryPropertyFlags preferred, const VulkanMemoryCategory category, VulkanAllocation allocation[static 1])
+{
+    const VkBufferMemoryRequirementsInfo2 requirements_info = {
+        .sType  = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2,
+        .pNext  = NULL,
+        .buffer = buffer,
+    };
+    VkMemoryDedicatedRequirements dedicated_requirements = {
+        .sType                       = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS,
+        .pNext                       = NULL,
+        .prefersDedicatedAllocation  = VK_FALSE,
+        .requiresDedicatedAllocation = VK_FALSE,
+    };
+    VkMemoryRequirements2 requirements = {
+        .sType              = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2,
+        .pNext              = &dedicated_requirements,
+        .memoryRequirements = {},
+    };
+    vkGetBufferMemoryRequirements2(allocator->device, &requirements_info, &requirements);
+
+    const VkMemoryDedicatedAllocateInfo dedicated_info = {
+        .sType  = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
+        .pNext  = NULL,
+        .image  = VK_NULL_HANDLE,
+        .buffer = buffer,
+    };
+    const bool dedicated = dedicated_requirements.prefersDedicatedAllocation || dedicated_requirements.requiresDedicatedAllocation;
+    if (Allocate(allocator, &requirements.memoryRequirements, properties, preferred, VULKAN_ALLOCATION_KIND_LINEAR, category, dedicated ? &dedicated_info : NULL,
+                 allocation))
+    {
+        return true;
+    }
+
+    VK_ERROR_HANDLE(vkBindBufferMemory(allocator->device, buffer, allocation->memory, allocation->offset), {
+        VulkanAllocator_Free(allocator, allocation);
+        return true;
+    });
+    return false;
+}
+
+bool VulkanAllocator_AllocateImage(VulkanAllocator allocator[static 1], const VkImage image, const VkMemoryPropertyFlags properties,
+                                   const VkMemoryPropertyFlags preferred, const VulkanMemoryCategory category, VulkanAllocation allocation[static 1])
+{
+    const VkImageMemoryRequirementsInfo2 requirements_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2,
+        .pNext = NULL,
+        .image = image,
+    };
+    VkMemoryDedicatedRequirements dedicated_requirements = {
+        .sType                       = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS,
+        .pNext                       = NULL,
+        .prefersDedicatedAllocation  = VK_FALSE,
+        .requiresDedicatedAllocation = VK_FALSE,
+    };
+    VkMemoryRequirements2 requirements = {
+        .sType              = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2,
+        .pNext              = &dedicated_requirements,
+        .memoryRequirements = {},
+    };
+    vkGetImageMemoryRequirements2(allocator->device, &requirements_info, &requirements);
+
+    const VkMemoryDedicatedAllocateInfo dedicated_info = {
+        .sType  = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
+        .pNext  = NULL,
+        .image  = image,
+        .buffer = VK_NULL_HANDLE,
+    };
+    const bool dedicated = dedicated_requirements.prefersDedicatedAllocation || dedicated_requirements.requiresDedicatedAllocation;
+    if (Allocate(allocator, &requirements.memoryRequirements, properties, preferred, VULKAN_ALLOCATION_KIND_OPTIMAL, category, dedicated ? &dedicated_info : NULL,
+                 allocation))
+    {
+        return true;
+    }
+
+    VK_ERROR_HANDLE(vkBindImageMemory(allocator->device, image, allocation->memory, allocation->offset), {
+        VulkanAllocator_Free(allocator, allocation);
+        return true;
+    });
+    return false;
+}
+
+void VulkanAllocator_Free(VulkanAllocator allocator[static 1], VulkanAllocation allocation[static 1])
+{
+    if (allocation->memory == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    allocator->categories[allocation->category].allocation_count--;
+    allocator->categories[allocation->category].bytes -= allocation->size;
+
+    if (allocation->node == NULL)
+    {
+        vkFreeMemory(allocator->device, allocation->memory, NULL);
+        allocator->stats.device_memory_count--;
+        allocator->stats.dedicated_count--;
+        allocator->stats.dedicated_bytes -= allocation->size;
+        TrackDeviceMemory(allocator, allocation->memory_type_index, -(int64_t)allocation->size);
+    }
+    else
+    {
+        VulkanMemoryNode* node         = allocation->node;
+        VulkanMemoryBlock* const block = node->block;
+        VulkanMemoryPool* const pool   = block->pool;
+        assert(!node->free);
+
+        allocator->stats.allocation_count--;
+        allocator->stats.allocated_bytes -= node->size;
+
+        // merge with free neighbours so no two free nodes are ever adjacent
+        VulkanMemoryNode* const next = node->next_physical;
+        if (next != NULL && next->free)
+        {
+            RemoveFreeNode(pool, next);
+            node->size += next->size;
+            node->next_physical = next->next_physical;
+            if (node->next_physical != NULL)
+            {
+                node->next_physical->prev_physical = node;
+            }
+            free(next);
+        }
+        VulkanMemoryNode* const prev = node->prev_physical;
+        if (prev != NULL && prev->free)
+        {
+            RemoveFreeNode(pool, prev);
+            prev->size += node->size;
+            prev->next_physical = node->next_physical;
+            if (prev->next_physical != NULL)
+            {
+                prev->next_physical->prev_physical = prev;
+            }
+            free(node);
+            node = prev;
+        }
+        InsertFreeNode(pool, node);
+
+        // keep one empty block around so a pool that empties and refills does not reallocate
+        if (--block->allocation_count == 0 && (pool->blocks != block || block->next != NULL))
+        {
+            FreeBlock(allocator, pool, block);
+        }
+    }
+
+    allocation->memory            = VK_NULL_HANDLE;
+    allocation->offset            = 0;
+    allocation->size              = 0;
+    allocation->mapped            = NULL;
+    allocation->node              = NULL;
+    allocation->memory_type_index = UINT32_MAX;
+}
+
+void VulkanAllocator_LogStats(const VulkanAllocator allocator[static 1])
+{
+    const VulkanAllocatorStats* const stats = &allocator->stats;
+    ROSINA_LOG_INFO("GPU memory: %u allocations in %u blocks (%llu of %llu MiB used), %u dedicated (%llu MiB), %u of %u device allocations",
+                    stats->allocation_count, stats->block_count, (unsigned long long)(stats->allocated_bytes >> 20), (unsigned long long)(stats->block_bytes >> 20),
+                    stats->dedicated_count, (unsigned long long)(stats->dedicated_bytes >> 20), stats->device_memory_count, allocator->max_memory_allocation_count);
+}
+
+void VulkanAllocator_Cleanup(VulkanAllocator allocator[static 1])
+{
+    if (allocator->stats.allocation_count > 0 || allocator->stats.dedicated_count > 0)
+    {
+        ROSINA_LOG_ERROR("Destroying GPU allocator with %u allocations and %u dedicated allocations alive", allocator->stats.allocation_count,
+                         allocator->stats.dedicated_count);
+    }
+
+    for (uint32_t type = 0; type < VK_MAX_MEMORY_TYPES; type++)
+    {
+        for (uint32_t kind = 0; kind < VULKAN_ALLOCATION_KIND_COUNT; kind++)
+        {
+            VulkanMemoryPool* const pool = allocator->pools[type][kind];
+            if (pool == NULL)
+            {
+                continue;
+            }
+            while (pool->blocks != NULL)
+            {
+                FreeBlock(allocator, pool, pool->blocks);
+            }
+            free(pool);
+            allocator->pools[type][kind] = NULL;
+        }
+    }
+}
+
+bool VulkanAllocator_Create(const VulkanDevice device[static 1], VulkanAllocator allocator[static 1])
+{
+    *allocator = (VulkanAllocator){
+        .device                      = device->handle,
+        .physical_device             = device->physical_device,
+        .memory_budget_supported     = device->memory_budget_supported,
+        .memory_properties           = {},
+        .mappable_device_local_size  = 0,
+        .buffer_image_granularity    = 1,
+        .max_memory_allocation_count = 0,
+        .pools                       = {},
+        .stats                       = {},
+        .heaps                       = {},
+        .categories                  = {},
+    };
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device->physical_device, &properties);
+    vkGetPhysicalDeviceMemoryProperties(device->physical_device, &allocator->memory_properties);
+
+    allocator->buffer_image_granularity    = properties.limits.bufferImageGranularity;
+    allocator->max_memory_allocation_count = properties.limits.maxMemoryAllocationCount;
+
+    const VkMemoryPropertyFlags mappable_device_local = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    for (uint32_t i = 0; i < allocator->memory_properties.memoryTypeCount; i++)
+    {
+        const VkMemoryType* const type = &allocator->memory_properties.memoryTypes[i];
+        const VkDeviceSize heap_size   = allocator->memory_properties.memoryHeaps[type->heapIndex].size;
+        if ((type->propertyFlags & mappable_device_local) == mappable_device_local && heap_size > allocator->mappable_device_local_size)
+        {
+            allocator->mappable_device_local_size = heap_size;
+        }
+    }
+    if (allocator->mappable_device_local_size > 0)
+    {
+        ROSINA_LOG_INFO("%llu MiB of video memory can be mapped%s", (unsigned long long)(allocator->mappable_device_local_size >> 20),
+                        VulkanAllocator_HasResizableBar(allocator) ? " (resizable BAR)" : "");
+    }
+
+    for (uint32_t i = 0; i < allocator->memory_properties.memoryHeapCount; i++)
+    {
+        allocator->heaps[i].budget = allocator->memory_properties.memoryHeaps[i].size / 100 * VULKAN_ALLOCATOR_ESTIMATED_BUDGET_PERCENT;
+    }
+    VulkanAllocator_UpdateBudget(allocator);
+    return false;
+}
+
+void VulkanAllocator_UpdateBudget(VulkanAllocator allocator[static 1])
+{
+    if (!allocator->memory_budget_supported)
+    {
+        return;
+    }
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties = {
+        .sType      = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT,
+        .pNext      = NULL,
+        .heapBudget = {},
+        .heapUsage  = {},
+    };
+    VkPhysicalDeviceMemoryProperties2 memory_properties = {
+        .sType            = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+        .pNext            = &budget_properties,
+        .memoryProperties = {},
+    };
+    vkGetPhysicalDeviceMemoryProperties2(allocator->physical_device, &memory_properties);
+
+    for (uint32_t i = 0; i < allocator->memory_properties.memoryHeapCount; i++)
+    {
+        allocator->heaps[i].usage  = budget_properties.heapUsage[i];
+        allocator->heaps[i].budget = budget_properties.heapBudget[i];
+    }
+}
+
+uint32_t VulkanAllocator_GetTightestHeap(const VulkanAllocator allocator[static 1], double pressure[static 1])
+{
+    uint32_t tightest = 0;
+    *pressure         = 0.0;
+    for (uint32_t i = 0; i < allocator->memory_properties.memoryHeapCount; i++)
+    {
+        const VulkanMemoryHeapBudget* const heap = &allocator->heaps[i];
+        const double heap_pressure               = heap->budget > 0 ? (double)heap->usage / (double)heap->budget : 1.0;
+        if (heap_pressure > *pressure)
+        {
+            tightest  = i;
+            *pressure = heap_pressure;
+        }
+    }
+    return tightest;
+}
+
+static const char* const category_names[VULKAN_MEMORY_CATEGORY_COUNT] = {
+    [VULKAN_MEMORY_CATEGORY_TEXTURE]    = "textures",
+    [VULKAN_MEMORY_CATEGORY_MESH]       = "meshes",
+    [VULKAN_MEMORY_CATEGORY_STAGING]    = "staging",
+    [VULKAN_MEMORY_CATEGORY_UNIFORM]    = "uniforms",
+    [VULKAN_MEMORY_CATEGORY_ATTACHMENT] = "attachments",
+    [VULKAN_MEMORY_CATEGORY_SCENE]      = "scene",
+};
+
+void VulkanAllocator_LogBudget(const VulkanAllocator allocator[static 1])
+{
+    for (uint32_t i = 0; i < allocator->memory_properties.memoryHeapCount; i++)
+    {
+        const VulkanMemoryHeapBudget* const heap = &allocator->heaps[i];
+        const bool device_local                  = allocator->memory_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+        ROSINA_LOG_INFO("Heap %u (%s, %llu MiB): %llu of %llu MiB budget used, %llu MiB ours, %llu MiB at most%s", i, device_local ? "device" : "host",
+                        (unsigned long long)(allocator->memory_properties.memoryHeaps[i].size >> 20), (unsigned long long)(heap->usage >> 20),
+                        (unsigned long long)(heap->budget >> 20), (unsigned long long)(heap->allocated_bytes >> 20), (unsigned long long)(heap->peak_bytes >> 20),
+                        allocator->memory_budget_supported ? "" : " (estimated)");
+    }
+    for (uint32_t i = 0; i < VULKAN_MEMORY_CATEGORY_COUNT; i++)
+    {
+        const VulkanMemoryCategoryStats* const category = &allocator->categories[i];
+        ROSINA_LOG_INFO("GPU %s: %u allocations, %llu KiB, %llu KiB at most", category_names[i], category->allocation_count,
+                        (unsigned long long)(category->bytes >> 10), (unsigned long long)(category->peak_bytes >> 10));
+    }
+}
+
+void VulkanAllocator_WriteCsvHeader(const VulkanAllocator allocator[static 1], FILE file[static 1])
+{
+    fprintf(file, "frame");
+    for (uint32_t i = 0; i < allocator->memory_properties.memoryHeapCount; i++)
+    {
+        fprintf(file, ",heap%u_usage,heap%u_budget,heap%u_allocated,heap%u_peak", i, i, i, i);
+    }
+    for (uint32_t i = 0; i < VULKAN_MEMORY_CATEGORY_COUNT; i++)
+    {
+        fprintf(file, ",%s,%s_peak", category_names[i], category_names[i]);
+    }
+    fprintf(file, "\n");
+}
+
+void VulkanAllocator_WriteCsvRow(const VulkanAllocator allocator[static 1], FILE file[static 1], const uint64_t frame_number)
+{
+    fprintf(file, "%llu", (unsigned long long)frame_number);
+    for (uint32_t i = 0; i < allocator->memory_properties.memoryHeapCount; i++)
+    {
+        const VulkanMemoryHeapBudget* const heap = &allocator->heaps[i];
+        fprintf(file, ",%llu,%llu,%llu,%llu", (unsigned long long)heap->usage, (unsigned long long)heap->budget, (unsigned long long)heap->allocated_bytes,
+                (unsigned long long)heap->peak_bytes);
+    }
+    for (uint32_t i = 0; i < VULKAN_MEMORY_CATEGORY_COUNT; i++)
+    {
+        fprintf(file, ",%llu,%llu", (unsigned long long)allocator->categories[i].bytes, (unsigned long long)allocator->categories[i].peak_bytes);
+    }
+    fprintf(file, "\n");
+}
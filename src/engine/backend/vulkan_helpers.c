@@ -102,20 +102,29 @@ const char* string_VkResult(VkResult input_value)
     }
 }
 
-uint32_t FindMemoryType(const VkPhysicalDevice physical_device, const uint32_t type_filter, const VkMemoryPropertyFlags properties)
+uint32_t FindMemoryType(const VkPhysicalDeviceMemoryProperties memory_properties[static 1], const uint32_t type_filter, const VkMemoryPropertyFlags required,
+                        const VkMemoryPropertyFlags preferred)
 {
-    VkPhysicalDeviceMemoryProperties memory_properties;
-    vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
-
-    for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
+    uint32_t best_index = UINT32_MAX;
+    int best_score      = 0;
+    for (uint32_t i = 0; i < memory_properties->memoryTypeCount; i++)
     {
-        if ((type_filter & (1 << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+        const VkMemoryPropertyFlags flags = memory_properties->memoryTypes[i].propertyFlags;
+        if (!(type_filter & (1u << i)) || (flags & required) != required)
+        {
+            continue;
+        }
+
+        // one preferred property outweighs all unwanted ones
+        const int score = __builtin_popcount(flags & preferred) * 32 - __builtin_popcount(flags & ~(required | preferred));
+        if (best_index == UINT32_MAX || score > best_score)
         {
-            return i;
+            best_index = i;
+            best_score = score;
         }
     }
 
-    return UINT32_MAX;
+    return best_index;
 }
 
 uint32_t FindQueueFamilyIndex(const VulkanDevice device[static 1], const FindQueueFamilyIndexInfo info[static 1])
@@ -128,7 +137,7 @@ uint32_t FindQueueFamilyIndex(const VulkanDevice device[static 1], const FindQue
 
     for (uint32_t i = 0; i < queue_family_property_count; i++)
     {
-        if ((info->flags & QUEUE_CAPABILITY_FLAG_GRAPHICS_BIT) && !queue_family_properties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+        if ((info->flags & QUEUE_CAPABILITY_FLAG_GRAPHICS_BIT) && !(queue_family_properties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
         {
             continue;
         }
@@ -143,6 +152,12 @@ uint32_t FindQueueFamilyIndex(const VulkanDevice device[static 1], const FindQue
             continue;
         }
 
+        if (((info->excluded_flags & QUEUE_CAPABILITY_FLAG_GRAPHICS_BIT) && (queue_family_properties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)) ||
+            ((info->excluded_flags & QUEUE_CAPABILITY_FLAG_COMPUTE_BIT) && (queue_family_properties[i].queueFlags & VK_QUEUE_COMPUTE_BIT)))
+        {
+            continue;
+        }
+
         VkBool32 surface_supported = VK_FALSE;
         VK_ERROR_HANDLE(vkGetPhysicalDeviceSurfaceSupportKHR(device->physical_device, i, info->surface, &surface_supported), { return UINT32_MAX; });
         if ((info->flags & QUEUE_CAPABILITY_FLAG_PRESENT_BIT) && surface_supported != VK_TRUE)
@@ -241,11 +256,35 @@ bool CalculateVkDeviceQueueCreateInfo(const float* const priority, uint32_t queu
     return true;
 }
 
-static inline bool CreateVkDevice(const VkPhysicalDevice physical_device, uint32_t queue_index_count, uint32_t* queue_indices, VkDevice device[static 1])
+static bool IsDeviceExtensionSupported(const VkPhysicalDevice physical_device, const char* const name)
+{
+    uint32_t extension_count = 0;
+    VK_ERROR_RETURN(vkEnumerateDeviceExtensionProperties(physical_device, NULL, &extension_count, NULL), false);
+    VkExtensionProperties* const extensions = calloc(extension_count, sizeof(VkExtensionProperties));
+    if (extensions == NULL)
+    {
+        return false;
+    }
+    VK_ERROR_HANDLE(vkEnumerateDeviceExtensionProperties(physical_device, NULL, &extension_count, extensions), {
+        free(extensions);
+        return false;
+    });
+
+    bool supported = false;
+    for (uint32_t i = 0; i < extension_count && !supported; i++)
+    {
+        supported = strcmp(extensions[i].extensionName, name) == 0;
+    }
+    free(extensions);
+    return supported;
+}
+
+static inline bool CreateVkDevice(const VkPhysicalDevice physical_device, uint32_t queue_index_count, uint32_t* queue_indices, const bool memory_budget,
+                                  VkDevice device[static 1])
 {
     uint32_t byte_count = 0;
     byte_count += (sizeof(VkDeviceQueueCreateInfo) * queue_index_count);  // queue_create_infos
-    byte_count += (sizeof(char*) * 1);                                    // VK_KHR_SWAPCHAIN_EXTENSION_NAME
+    byte_count += (sizeof(char*) * 2);                                    // VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME
 
     void* const bytes = calloc(byte_count, 1);
     byte_count        = 0;
@@ -264,22 +303,29 @@ static inline bool CreateVkDevice(const VkPhysicalDevice physical_device, uint32
         queue_create_infos[i]                     = create_info;
     }
 
-    VkPhysicalDeviceFeatures2 physical_device_features = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = NULL, .features = {}};
+    // everything supported is enabled, timeline semaphores are the part of 1.2 the renderer relies on
+    VkPhysicalDeviceVulkan12Features vulkan_12_features = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, .pNext = NULL};
+    VkPhysicalDeviceFeatures2 physical_device_features  = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &vulkan_12_features, .features = {}};
     vkGetPhysicalDeviceFeatures2(physical_device, &physical_device_features);
     const char** enabled_extensions = bytes + byte_count;
-    byte_count += (sizeof(char*) * 1);
-    enabled_extensions[0] = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+    byte_count += (sizeof(char*) * 2);
+    uint32_t enabled_extension_count              = 0;
+    enabled_extensions[enabled_extension_count++] = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+    if (memory_budget)
+    {
+        enabled_extensions[enabled_extension_count++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+    }
 
     const VkDeviceCreateInfo create_info = {.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-                                            .pNext                   = NULL,
+                                            .pNext                   = &physical_device_features,
                                             .flags                   = 0,
                                             .queueCreateInfoCount    = queue_index_count,
                                             .pQueueCreateInfos       = queue_create_infos,
                                             .enabledLayerCount       = 0,
                                             .ppEnabledLayerNames     = NULL,
-                                            .enabledExtensionCount   = 1,
+                                            .enabledExtensionCount   = enabled_extension_count,
                                             .ppEnabledExtensionNames = enabled_extensions,
-                                            .pEnabledFeatures        = &physical_device_features.features};
+                                            .pEnabledFeatures        = NULL};
 
     VK_ERROR_HANDLE(vkCreateDevice(physical_device, &create_info, NULL, device), {
         free(bytes);
@@ -313,7 +359,10 @@ bool CreateVulkanDevice(const VulkanDeviceCreateInfo create_info[static 1], Vulk
     uint32_t queue_family_index_count    = 0;
     uint32_t* const queue_family_indices = calloc(3, sizeof(uint32_t));
     {
-        FindQueueFamilyIndexInfo find_info = {.flags = QUEUE_CAPABILITY_FLAG_GRAPHICS_BIT, .queue_count = 1, .surface = create_info->surface};
+        // a family with graphics always has compute too, so compute work can be recorded into the frame
+        FindQueueFamilyIndexInfo find_info = {.flags       = QUEUE_CAPABILITY_FLAG_GRAPHICS_BIT | (create_info->queue_capabilities & QUEUE_CAPABILITY_FLAG_COMPUTE_BIT),
+                                              .queue_count = 1,
+                                              .surface     = create_info->surface};
 
         device->graphics_queue.family_index = FindQueueFamilyIndex(device, &find_info);
         if (device->graphics_queue.family_index == UINT32_MAX)
@@ -324,12 +373,14 @@ bool CreateVulkanDevice(const VulkanDeviceCreateInfo create_info[static 1], Vulk
         device->graphics_queue.queue_index               = 0;
         queue_family_indices[queue_family_index_count++] = device->graphics_queue.family_index;
 
+        // a family that can only copy is a DMA engine that runs next to the graphics work
         find_info.flags                     = QUEUE_CAPABILITY_FLAG_TRANSFER_BIT;
+        find_info.excluded_flags            = QUEUE_CAPABILITY_FLAG_GRAPHICS_BIT | QUEUE_CAPABILITY_FLAG_COMPUTE_BIT;
         device->transfer_queue.family_index = FindQueueFamilyIndex(device, &find_info);
+        find_info.excluded_flags            = 0;
         if (device->transfer_queue.family_index == UINT32_MAX)
         {
-            free(queue_family_indices);
-            return true;
+            device->transfer_queue.family_index = device->graphics_queue.family_index;
         }
         device->transfer_queue.queue_index               = 0;
         queue_family_indices[queue_family_index_count++] = device->transfer_queue.family_index;
@@ -363,7 +414,15 @@ bool CreateVulkanDevice(const VulkanDeviceCreateInfo create_info[static 1], Vulk
         }
     }
 
-    if (CreateVkDevice(device->physical_device, queue_family_index_count, queue_family_indices, &device->handle))
+    device->memory_budget_supported = IsDeviceExtensionSupported(device->physical_device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    {
+        // CreateVkDevice enables every supported feature, so this is only whether there is one
+        VkPhysicalDeviceVulkan12Features vulkan_12_features = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, .pNext = NULL};
+        VkPhysicalDeviceFeatures2 features                  = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &vulkan_12_features, .features = {}};
+        vkGetPhysicalDeviceFeatures2(device->physical_device, &features);
+        device->draw_indirect_count_supported = vulkan_12_features.drawIndirectCount == VK_TRUE;
+    }
+    if (CreateVkDevice(device->physical_device, queue_family_index_count, queue_family_indices, device->memory_budget_supported, &device->handle))
     {
         ROSINA_LOG_ERROR("Could not create VkDevice");
         free(queue_family_indices);
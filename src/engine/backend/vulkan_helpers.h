@@ -2,6 +2,7 @@
 #define ROSINA_ENGINE_VULKAN_HELPERS_H
 
 #include <stdbool.h>
+#include <stdio.h>
 #include <utility/log.h>
 #include <vulkan/vulkan.h>
 
@@ -28,7 +29,15 @@ const char* string_VkResult(VkResult input_value);
         }                                                                  \
     }
 
-uint32_t FindMemoryType(const VkPhysicalDevice physical_device, const uint32_t type_filter, const VkMemoryPropertyFlags properties);
+/**
+ * Ranks the memory types in type_filter that have the required properties. Types with more of the preferred properties
+ * come first, then types with fewer properties nobody asked for, so that for example plain device local memory is not
+ * taken from the host visible part of video memory.
+ *
+ * @return The best memory type, or UINT32_MAX if none has the required properties.
+ */
+uint32_t FindMemoryType(const VkPhysicalDeviceMemoryProperties memory_properties[static 1], const uint32_t type_filter, const VkMemoryPropertyFlags required,
+                        const VkMemoryPropertyFlags preferred);
 
 enum QueueCapabilityFlagBits
 {
@@ -53,6 +62,10 @@ typedef struct VulkanDevice
     VulkanQueue graphics_queue;
     VulkanQueue transfer_queue;
     VulkanQueue present_queue;
+    // whether VK_EXT_memory_budget is enabled
+    bool memory_budget_supported;
+    // whether vkCmdDrawIndexedIndirectCount can be used, an optional Vulkan 1.2 feature
+    bool draw_indirect_count_supported;
 } VulkanDevice;
 
 void VulkanDevice_Cleanup(VulkanDevice device[static 1]);
@@ -60,6 +73,8 @@ void VulkanDevice_Cleanup(VulkanDevice device[static 1]);
 typedef struct FindQueueFamilyIndexInfo
 {
     QueueCapabilityFlags flags;
+    // families with any of these capabilities are skipped
+    QueueCapabilityFlags excluded_flags;
     uint32_t queue_count;
     VkSurfaceKHR surface;
 } FindQueueFamilyIndexInfo;
@@ -71,6 +86,7 @@ uint32_t FindQueueFamilyIndex(const VulkanDevice device[static 1], const FindQue
 
 typedef struct VulkanDeviceCreateInfo
 {
+    // what the graphics queue must be able to do besides graphics, only QUEUE_CAPABILITY_FLAG_COMPUTE_BIT is looked at
     QueueCapabilityFlags queue_capabilities;
     VkInstance instance;
     VkSurfaceKHR surface;
@@ -104,6 +120,30 @@ typedef struct VulkanGraphicsPipeline
 
 void DestroyVulkanGraphicsPipeline(const VulkanDevice device[static 1], VulkanGraphicsPipeline pipeline[static 1]);
 
+typedef struct VulkanComputePipeline
+{
+    VkPipelineLayout layout;
+    VkPipeline handle;
+} VulkanComputePipeline;
+
+typedef struct VulkanComputePipelineCreateInfo
+{
+    VkShaderModule shader_module;
+    VkDescriptorSetLayout descriptor_set_layout;
+    // bytes of push constants the shader reads, 0 for none
+    uint32_t push_constant_size;
+    // VK_NULL_HANDLE to compile without one
+    VkPipelineCache cache;
+} VulkanComputePipelineCreateInfo;
+
+/**
+ * @return true on error.
+ */
+bool VulkanComputePipeline_Create(const VulkanDevice device[static 1], const VulkanComputePipelineCreateInfo create_info[static 1],
+                                  VulkanComputePipeline pipeline[static 1]);
+
+void VulkanComputePipeline_Cleanup(const VulkanDevice device[static 1], VulkanComputePipeline pipeline[static 1]);
+
 typedef struct InputDescription
 {
     VkFormat format;
@@ -116,10 +156,40 @@ typedef struct VulkanGraphicsPipelineCreateInfo
     VkShaderModule vertex_shader_module;
     VkShaderModule fragment_shader_module;
     VkDescriptorSetLayout shader_layout;
+    uint32_t vertex_binding_count;
+    const VkVertexInputBindingDescription* vertex_bindings;
+    uint32_t vertex_attribute_count;
+    const VkVertexInputAttributeDescription* vertex_attributes;
     uint32_t width;
     uint32_t height;
+    // VK_NULL_HANDLE to compile without one
+    VkPipelineCache cache;
 } VulkanGraphicsPipelineCreateInfo;
 
+/**
+ * Creates a pipeline cache holding the data file_name was saved with, if it exists and its header matches the driver and
+ * device. Otherwise the cache starts empty.
+ *
+ * @return true on error. A missing or mismatching file is not one.
+ */
+bool VulkanPipelineCache_Create(const VulkanDevice device[static 1], const char* const file_name, VkPipelineCache cache[static 1]);
+
+/**
+ * Writes the data of cache to a temporary file and renames it to file_name, so an interrupted save leaves the old file.
+ *
+ * @return true on error.
+ */
+bool VulkanPipelineCache_Save(const VulkanDevice device[static 1], const VkPipelineCache cache, const char* const file_name);
+
+void VulkanPipelineCache_Cleanup(const VulkanDevice device[static 1], VkPipelineCache cache[static 1]);
+
+/**
+ * Logs whether a pipeline was found in its cache and how long creating it and each of its stages took.
+ *
+ * @param feedback The feedback chained into the create info of the pipeline, after it was created.
+ */
+void VulkanPipelineFeedback_Log(const char* const name, const VkPipelineCreationFeedbackCreateInfo feedback[static 1]);
+
 
 typedef struct VulkanSwapchain
 {
@@ -142,4 +212,164 @@ typedef struct VulkanSwapchainCreateInfo
 
 bool VulkanSwapchain_Create(const VulkanDevice device[static 1], const VulkanSwapchainCreateInfo create_info[static 1], VulkanSwapchain swapchain[static 1]);
 
+// resources in a block of device memory are sub-allocated with a two level segregated fit (TLSF) allocator
+#define VULKAN_ALLOCATOR_MIN_BLOCK_SIZE (64ull * 1024 * 1024)
+#define VULKAN_ALLOCATOR_MAX_BLOCK_SIZE (256ull * 1024 * 1024)
+
+typedef enum VulkanAllocationKind
+{
+    // buffers and linear images
+    VULKAN_ALLOCATION_KIND_LINEAR,
+    // optimally tiled images. Kept in separate blocks from linear resources so bufferImageGranularity never applies.
+    VULKAN_ALLOCATION_KIND_OPTIMAL,
+    VULKAN_ALLOCATION_KIND_COUNT
+} VulkanAllocationKind;
+
+// what allocations are used for, to see what the memory goes to
+typedef enum VulkanMemoryCategory
+{
+    VULKAN_MEMORY_CATEGORY_TEXTURE,
+    VULKAN_MEMORY_CATEGORY_MESH,
+    VULKAN_MEMORY_CATEGORY_STAGING,
+    VULKAN_MEMORY_CATEGORY_UNIFORM,
+    VULKAN_MEMORY_CATEGORY_ATTACHMENT,
+    // instances, meshes and draws the GPU culls and draws on its own
+    VULKAN_MEMORY_CATEGORY_SCENE,
+    VULKAN_MEMORY_CATEGORY_COUNT
+} VulkanMemoryCategory;
+
+typedef struct VulkanMemoryCategoryStats
+{
+    uint32_t allocation_count;
+    // requested bytes, without block overhead
+    VkDeviceSize bytes;
+    VkDeviceSize peak_bytes;
+} VulkanMemoryCategoryStats;
+
+typedef struct VulkanMemoryHeapBudget
+{
+    // bytes of VkDeviceMemory this allocator has in the heap, and the most it ever had
+    VkDeviceSize allocated_bytes;
+    VkDeviceSize peak_bytes;
+    // what the whole process uses of the heap and how much it can use before the driver starts paging. From
+    // VK_EXT_memory_budget when it is supported, with the allocations since the last update added. Otherwise usage is
+    // allocated_bytes and budget is VULKAN_ALLOCATOR_ESTIMATED_BUDGET_PERCENT of the heap.
+    VkDeviceSize usage;
+    VkDeviceSize budget;
+} VulkanMemoryHeapBudget;
+
+#define VULKAN_ALLOCATOR_ESTIMATED_BUDGET_PERCENT 80
+// without resizable BAR only this much of video memory can be mapped
+#define VULKAN_ALLOCATOR_BAR_SIZE (256ull * 1024 * 1024)
+
+typedef struct VulkanAllocatorStats
+{
+    // number of live VkDeviceMemory objects, blocks and dedicated allocations together
+    uint32_t device_memory_count;
+    uint32_t block_count;
+    uint32_t dedicated_count;
+    uint32_t allocation_count;
+    VkDeviceSize block_bytes;
+    VkDeviceSize dedicated_bytes;
+    // bytes of blocks handed out to allocations, including alignment padding
+    VkDeviceSize allocated_bytes;
+} VulkanAllocatorStats;
+
+typedef struct VulkanAllocator
+{
+    VkDevice device;
+    VkPhysicalDevice physical_device;
+    bool memory_budget_supported;
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    // the size of the largest heap with device local memory the host can map
+    VkDeviceSize mappable_device_local_size;
+    VkDeviceSize buffer_image_granularity;
+    uint32_t max_memory_allocation_count;
+    struct VulkanMemoryPool* pools[VK_MAX_MEMORY_TYPES][VULKAN_ALLOCATION_KIND_COUNT];
+    VulkanAllocatorStats stats;
+    VulkanMemoryHeapBudget heaps[VK_MAX_MEMORY_HEAPS];
+    VulkanMemoryCategoryStats categories[VULKAN_MEMORY_CATEGORY_COUNT];
+} VulkanAllocator;
+
+typedef struct VulkanAllocation
+{
+    VkDeviceMemory memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    // points at offset when the memory is host visible, NULL otherwise. Host visible memory stays mapped.
+    void* mapped;
+    // NULL for dedicated allocations
+    struct VulkanMemoryNode* node;
+    uint32_t memory_type_index;
+    VulkanMemoryCategory category;
+} VulkanAllocation;
+
+void VulkanAllocator_Cleanup(VulkanAllocator allocator[static 1]);
+
+bool VulkanAllocator_Create(const VulkanDevice device[static 1], VulkanAllocator allocator[static 1]);
+
+/**
+ * Sub-allocates memory of a type that has the properties, preferring types whose heap is within budget and then the ones
+ * FindMemoryType ranks first. Requirements larger than half a block get their own VkDeviceMemory.
+ *
+ * @return true on error.
+ */
+bool VulkanAllocator_Allocate(VulkanAllocator allocator[static 1], const VkMemoryRequirements requirements[static 1], const VkMemoryPropertyFlags properties,
+                              const VkMemoryPropertyFlags preferred, const VulkanAllocationKind kind, const VulkanMemoryCategory category, VulkanAllocation allocation[static 1]);
+
+/**
+ * Allocates memory for the buffer and binds it. Uses a dedicated allocation when the driver prefers one.
+ *
+ * @return true on error.
+ */
+bool VulkanAllocator_AllocateBuffer(VulkanAllocator allocator[static 1], const VkBuffer buffer, const VkMemoryPropertyFlags properties,
+                                    const VkMemoryPropertyFlags preferred, const VulkanMemoryCategory category, VulkanAllocation allocation[static 1]);
+
+/**
+ * Allocates memory for the optimally tiled image and binds it. Uses a dedicated allocation when the driver prefers one.
+ *
+ * @return true on error.
+ */
+bool VulkanAllocator_AllocateImage(VulkanAllocator allocator[static 1], const VkImage image, const VkMemoryPropertyFlags properties,
+                                   const VkMemoryPropertyFlags preferred, const VulkanMemoryCategory category, VulkanAllocation allocation[static 1]);
+
+/**
+ * Frees the allocation. Freeing an allocation whose memory is VK_NULL_HANDLE does nothing.
+ */
+void VulkanAllocator_Free(VulkanAllocator allocator[static 1], VulkanAllocation allocation[static 1]);
+
+void VulkanAllocator_LogStats(const VulkanAllocator allocator[static 1]);
+
+/**
+ * @return Whether all of video memory can be mapped, so buffers the CPU writes often can live there.
+ */
+static inline bool VulkanAllocator_HasResizableBar(const VulkanAllocator allocator[static 1])
+{
+    return allocator->mappable_device_local_size > VULKAN_ALLOCATOR_BAR_SIZE;
+}
+
+/**
+ * Asks the driver for the usage and budget of every heap. Without VK_EXT_memory_budget nothing changes. The query is
+ * not free, call it about once per frame.
+ */
+void VulkanAllocator_UpdateBudget(VulkanAllocator allocator[static 1]);
+
+/**
+ * @param pressure Set to the usage of the heap as a fraction of its budget.
+ * @return The heap whose usage is the largest fraction of its budget.
+ */
+uint32_t VulkanAllocator_GetTightestHeap(const VulkanAllocator allocator[static 1], double pressure[static 1]);
+
+/**
+ * Logs usage, budget and high water mark of every heap and the bytes of every category.
+ */
+void VulkanAllocator_LogBudget(const VulkanAllocator allocator[static 1]);
+
+void VulkanAllocator_WriteCsvHeader(const VulkanAllocator allocator[static 1], FILE file[static 1]);
+
+/**
+ * Appends one row of heap usage, budgets and category bytes.
+ */
+void VulkanAllocator_WriteCsvRow(const VulkanAllocator allocator[static 1], FILE file[static 1], const uint64_t frame_number);
+
 #endif
\ No newline at end of file
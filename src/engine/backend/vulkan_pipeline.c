@@ -1,7 +1,12 @@
 #include <assert.h>
 #include <engine/backend/vulkan_helpers.h>
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include <utility/load_file.h>
+#include <utility/log.h>
+
+#define VULKAN_PIPELINE_CACHE_TEMPORARY_SUFFIX ".tmp"
 
 void DestroyVulkanGraphicsPipeline(const VulkanDevice device[static 1], VulkanGraphicsPipeline pipeline[static 1])
 {
@@ -11,3 +16,215 @@ void DestroyVulkanGraphicsPipeline(const VulkanDevice device[static 1], VulkanGr
     pipeline->layout = VK_NULL_HANDLE;
 }
 
+bool VulkanComputePipeline_Create(const VulkanDevice device[static 1], const VulkanComputePipelineCreateInfo create_info[static 1],
+                                  VulkanComputePipeline pipeline[static 1])
+{
+    // layout
+    {
+        const VkPushConstantRange push_constant_range = {.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = create_info->push_constant_size};
+        const VkPipelineLayoutCreateInfo layout_create_info = {
+            .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+            .pNext                  = NULL,
+            .flags                  = 0,
+            .setLayoutCount         = 1,
+            .pSetLayouts            = &create_info->descriptor_set_layout,
+            .pushConstantRangeCount = create_info->push_constant_size > 0 ? 1 : 0,
+            .pPushConstantRanges    = &push_constant_range,
+        };
+        VK_ERROR_HANDLE(vkCreatePipelineLayout(device->handle, &layout_create_info, NULL, &pipeline->layout), {
+            pipeline->layout = VK_NULL_HANDLE;
+            return true;
+        });
+    }
+
+    // pipeline
+    {
+        VkPipelineCreationFeedback pipeline_feedback        = {};
+        VkPipelineCreationFeedback stage_feedback           = {};
+        const VkPipelineCreationFeedbackCreateInfo feedback = {
+            .sType                              = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+            .pNext                              = NULL,
+            .pPipelineCreationFeedback          = &pipeline_feedback,
+            .pipelineStageCreationFeedbackCount = 1,
+            .pPipelineStageCreationFeedbacks    = &stage_feedback,
+        };
+        const VkComputePipelineCreateInfo pipeline_create_info = {
+            .sType              = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+            .pNext              = &feedback,
+            .flags              = 0,
+            .stage              = {
+                .sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .pNext               = NULL,
+                .flags               = 0,
+                .stage               = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module              = create_info->shader_module,
+                .pName               = "main",
+                .pSpecializationInfo = NULL
+            },
+            .layout             = pipeline->layout,
+            .basePipelineHandle = VK_NULL_HANDLE,
+            .basePipelineIndex  = 0
+        };
+        VK_ERROR_HANDLE(vkCreateComputePipelines(device->handle, create_info->cache, 1, &pipeline_create_info, NULL, &pipeline->handle), {
+            vkDestroyPipelineLayout(device->handle, pipeline->layout, NULL);
+            pipeline->layout = VK_NULL_HANDLE;
+            pipeline->handle = VK_NULL_HANDLE;
+            return true;
+        });
+        VulkanPipelineFeedback_Log("compute", &feedback);
+    }
+
+    return false;
+}
+
+void VulkanComputePipeline_Cleanup(const VulkanDevice device[static 1], VulkanComputePipeline pipeline[static 1])
+{
+    vkDestroyPipeline(device->handle, pipeline->handle, NULL);
+    pipeline->handle = VK_NULL_HANDLE;
+    vkDestroyPipelineLayout(device->handle, pipeline->layout, NULL);
+    pipeline->layout = VK_NULL_HANDLE;
+}
+
+/**
+ * The fields of the cache header are written least significant byte first, whatever the host.
+ */
+static inline uint32_t ReadLittleEndian32(const uint8_t bytes[static 4])
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static bool IsPipelineCacheCompatible(const VulkanDevice device[static 1], const uint8_t* const data, const size_t data_size)
+{
+    if (data_size < sizeof(VkPipelineCacheHeaderVersionOne))
+    {
+        return false;
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device->physical_device, &properties);
+
+    VkPipelineCacheHeaderVersionOne header = {
+        .headerSize        = ReadLittleEndian32(data + offsetof(VkPipelineCacheHeaderVersionOne, headerSize)),
+        .headerVersion     = (VkPipelineCacheHeaderVersion)ReadLittleEndian32(data + offsetof(VkPipelineCacheHeaderVersionOne, headerVersion)),
+        .vendorID          = ReadLittleEndian32(data + offsetof(VkPipelineCacheHeaderVersionOne, vendorID)),
+        .deviceID          = ReadLittleEndian32(data + offsetof(VkPipelineCacheHeaderVersionOne, deviceID)),
+        .pipelineCacheUUID = {},
+    };
+    memcpy(header.pipelineCacheUUID, data + offsetof(VkPipelineCacheHeaderVersionOne, pipelineCacheUUID), VK_UUID_SIZE);
+
+    return header.headerSize >= sizeof(VkPipelineCacheHeaderVersionOne) && header.headerSize <= data_size &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && header.vendorID == properties.vendorID &&
+           header.deviceID == properties.deviceID && memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+bool VulkanPipelineCache_Create(const VulkanDevice device[static 1], const char* const file_name, VkPipelineCache cache[static 1])
+{
+    uint8_t* data    = NULL;
+    size_t data_size = 0;
+    if (LoadFile(NULL, &data_size, file_name))
+    {
+        ROSINA_LOG_INFO("No pipeline cache at %s, pipelines will be compiled", file_name);
+        data_size = 0;
+    }
+    else if (data_size > 0)
+    {
+        data = malloc(data_size);
+        if (data == NULL)
+        {
+            ROSINA_LOG_ERROR("Failed to allocate %zu bytes for pipeline cache %s", data_size, file_name);
+            return true;
+        }
+        if (LoadFile(data, &data_size, file_name) || !IsPipelineCacheCompatible(device, data, data_size))
+        {
+            // a driver update or another GPU, the driver would ignore the data anyway
+            ROSINA_LOG_INFO("Pipeline cache %s is unreadable or for another driver or device, pipelines will be compiled", file_name);
+            free(data);
+            data      = NULL;
+            data_size = 0;
+        }
+    }
+
+    const VkPipelineCacheCreateInfo create_info = {
+        .sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .pNext           = NULL,
+        .flags           = 0,
+        .initialDataSize = data_size,
+        .pInitialData    = data,
+    };
+    VK_ERROR_HANDLE(vkCreatePipelineCache(device->handle, &create_info, NULL, cache), {
+        free(data);
+        *cache = VK_NULL_HANDLE;
+        return true;
+    });
+
+    free(data);
+    return false;
+}
+
+bool VulkanPipelineCache_Save(const VulkanDevice device[static 1], const VkPipelineCache cache, const char* const file_name)
+{
+    size_t data_size = 0;
+    VK_ERROR_RETURN(vkGetPipelineCacheData(device->handle, cache, &data_size, NULL), true);
+
+    const size_t name_size = strlen(file_name) + sizeof(VULKAN_PIPELINE_CACHE_TEMPORARY_SUFFIX);
+    uint8_t* const data    = malloc(data_size + name_size);
+    if (data == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate %zu bytes for pipeline cache %s", data_size, file_name);
+        return true;
+    }
+    char* const temporary_name = (char*)data + data_size;
+    snprintf(temporary_name, name_size, "%s" VULKAN_PIPELINE_CACHE_TEMPORARY_SUFFIX, file_name);
+
+    VK_ERROR_HANDLE(vkGetPipelineCacheData(device->handle, cache, &data_size, data), {
+        free(data);
+        return true;
+    });
+
+    FILE* const file = fopen(temporary_name, "wb");
+    if (file == NULL)
+    {
+        ROSINA_LOG_ERROR("Could not open %s", temporary_name);
+        free(data);
+        return true;
+    }
+    const bool written = fwrite(data, 1, data_size, file) == data_size;
+    if (fclose(file) != 0 || !written || rename(temporary_name, file_name) != 0)
+    {
+        ROSINA_LOG_ERROR("Could not write pipeline cache %s", file_name);
+        remove(temporary_name);
+        free(data);
+        return true;
+    }
+
+    free(data);
+    return false;
+}
+
+void VulkanPipelineCache_Cleanup(const VulkanDevice device[static 1], VkPipelineCache cache[static 1])
+{
+    vkDestroyPipelineCache(device->handle, *cache, NULL);
+    *cache = VK_NULL_HANDLE;
+}
+
+void VulkanPipelineFeedback_Log(const char* const name, const VkPipelineCreationFeedbackCreateInfo feedback[static 1])
+{
+    const VkPipelineCreationFeedback* const pipeline = feedback->pPipelineCreationFeedback;
+    if ((pipeline->flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) == 0)
+    {
+        return;
+    }
+
+    // a hit means the driver found the whole pipeline in the cache, and did not compile anything
+    const bool hit = (pipeline->flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT) != 0;
+    ROSINA_LOG_INFO("Created %s pipeline in %.3f ms, pipeline cache %s", name, (double)pipeline->duration / 1e6, hit ? "hit" : "miss");
+    for (uint32_t i = 0; i < feedback->pipelineStageCreationFeedbackCount; i++)
+    {
+        const VkPipelineCreationFeedback* const stage = &feedback->pPipelineStageCreationFeedbacks[i];
+        if ((stage->flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) != 0)
+        {
+            ROSINA_LOG_INFO("    stage %u in %.3f ms, pipeline cache %s", i, (double)stage->duration / 1e6,
+                            (stage->flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT) != 0 ? "hit" : "miss");
+        }
+    }
+}
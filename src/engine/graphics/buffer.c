@@ -1,75 +1,26 @@
 #include <engine/graphics/buffer.h>
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
-StagingBuffer StagingBuffer_Create(const Renderer renderer[static 1], const uint64_t size)
-{
-    StagingBuffer buffer = {.handle = VK_NULL_HANDLE, .memory = VK_NULL_HANDLE};
-
-    {
-        const VkBufferCreateInfo buffer_create_info = {.sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-                                                       .pNext                 = NULL,
-                                                       .flags                 = 0,
-                                                       .size                  = size,
-                                                       .usage                 = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                                       .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
-                                                       .queueFamilyIndexCount = 0,
-                                                       .pQueueFamilyIndices   = NULL};
-
-        VK_ERROR_RETURN(vkCreateBuffer(renderer->device.handle, &buffer_create_info, NULL, &buffer.handle), buffer);
-    }
-
-    {
-        VkMemoryRequirements mem_requirements;
-        vkGetBufferMemoryRequirements(renderer->device.handle, buffer.handle, &mem_requirements);
-
-        const VkMemoryAllocateInfo buffer_alloc_info = {
-            .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .pNext           = NULL,
-            .allocationSize  = (VkDeviceSize)size,
-            .memoryTypeIndex = FindMemoryType(renderer->device.physical_device, mem_requirements.memoryTypeBits,
-                                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)};
-
-        if (buffer_alloc_info.memoryTypeIndex == UINT32_MAX)
-        {
-            vkDestroyBuffer(renderer->device.handle, buffer.handle, NULL);
-            buffer.handle = VK_NULL_HANDLE;
-            return buffer;
-        }
-
-        VK_ERROR_HANDLE(vkAllocateMemory(renderer->device.handle, &buffer_alloc_info, NULL, &buffer.memory), {
-            vkDestroyBuffer(renderer->device.handle, buffer.handle, NULL);
-            buffer.handle = VK_NULL_HANDLE;
-            return buffer;
-        });
-
-        VK_ERROR_HANDLE(vkBindBufferMemory(renderer->device.handle, buffer.handle, buffer.memory, 0), {
-            vkDestroyBuffer(renderer->device.handle, buffer.handle, NULL);
-            buffer.handle = VK_NULL_HANDLE;
-            vkFreeMemory(renderer->device.handle, buffer.memory, NULL);
-            buffer.memory = VK_NULL_HANDLE;
-            return buffer;
-        });
-    }
-
-    return buffer;
-}
-
-void StagingBuffer_Cleanup(const Renderer renderer[static 1], StagingBuffer buffer[static 1])
-{
-    vkDestroyBuffer(renderer->device.handle, buffer->handle, NULL);
-    buffer->handle = VK_NULL_HANDLE;
-    vkFreeMemory(renderer->device.handle, buffer->memory, NULL);
-    buffer->memory = VK_NULL_HANDLE;
-}
-
 void BufferMemory_Cleanup(const Renderer renderer[static 1], BufferMemory memory[static 1])
 {
     while (memory->component_count > 0)
     {
         switch (memory->components[--memory->component_count])
         {
+            case BUFFER_MEMORY_ALLOCATORS_COMPONENT:
+                BufferMemory_LogStats(memory);
+                OffsetAllocator_Cleanup(&memory->vertex_allocator);
+                OffsetAllocator_Cleanup(&memory->index_allocator);
+                OffsetAllocator_Cleanup(&memory->uniform_allocator);
+                free(memory->vertex_owners);
+                memory->vertex_owners = NULL;
+                free(memory->index_owners);
+                memory->index_owners = NULL;
+                memory->move_count    = 0;
+                break;
             case BUFFER_MEMORY_VERTEX_BUFFER_COMPONENT:
                 vkDestroyBuffer(renderer->device.handle, memory->vertex_buffer, NULL);
                 memory->vertex_buffer = VK_NULL_HANDLE;
@@ -83,8 +34,7 @@ void BufferMemory_Cleanup(const Renderer renderer[static 1], BufferMemory memory
                 memory->uniform_buffer = VK_NULL_HANDLE;
                 break;
             case BUFFER_MEMORY_HANDLE_COMPONENT:
-                vkFreeMemory(renderer->device.handle, memory->handle, NULL);
-                memory->handle = VK_NULL_HANDLE;
+                VulkanAllocator_Free(renderer->allocator, &memory->allocation);
                 break;
             default:
                 assert(false);
@@ -102,12 +52,54 @@ VkDeviceSize VkDeviceSize_RoundUpTo(const VkDeviceSize x, const VkDeviceSize y)
 
 BufferMemory BufferMemory_Create(const Renderer renderer[static 1], BufferMemoryCreateInfo buffer_memory_create_info[static 1])
 {
-    BufferMemory memory = {.component_count = 0,
-                           .components      = {},
-                           .handle          = VK_NULL_HANDLE,
-                           .vertex_buffer   = VK_NULL_HANDLE,
-                           .index_buffer    = VK_NULL_HANDLE,
-                           .uniform_buffer  = VK_NULL_HANDLE};
+    BufferMemory memory = {.component_count   = 0,
+                           .components        = {},
+                           .allocation        = {.memory = VK_NULL_HANDLE},
+                           .vertex_buffer     = VK_NULL_HANDLE,
+                           .vertex_allocator  = {.nodes = NULL},
+                           .index_buffer      = VK_NULL_HANDLE,
+                           .index_allocator   = {.nodes = NULL},
+                           .uniform_buffer    = VK_NULL_HANDLE,
+                           .uniform_allocator = {.nodes = NULL},
+                           .uniform_alignment = 1,
+                           .vertex_mapped     = NULL,
+                           .index_mapped      = NULL,
+                           .uniform_mapped    = NULL,
+                           .direct_writes     = false,
+                           .vertex_owners     = NULL,
+                           .index_owners      = NULL,
+                           .move_count        = 0,
+                           .moves             = {},
+                           .defragment_budget = buffer_memory_create_info->defragment_budget};
+
+    // allocators
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(renderer->device.physical_device, &properties);
+        if (properties.limits.minUniformBufferOffsetAlignment > memory.uniform_alignment)
+        {
+            memory.uniform_alignment = properties.limits.minUniformBufferOffsetAlignment;
+        }
+
+        // capacities that are not a multiple of the alignment lose the last partial unit
+        memory.vertex_allocator  = OffsetAllocator_Create((uint32_t)(buffer_memory_create_info->vertex_buffer_capacity / BUFFER_MEMORY_VERTEX_ALIGNMENT),
+                                                          buffer_memory_create_info->max_object_count);
+        memory.index_allocator   = OffsetAllocator_Create((uint32_t)(buffer_memory_create_info->index_buffer_capacity / BUFFER_MEMORY_INDEX_ALIGNMENT),
+                                                          buffer_memory_create_info->max_object_count);
+        memory.uniform_allocator = OffsetAllocator_Create((uint32_t)(buffer_memory_create_info->uniform_buffer_capacity / memory.uniform_alignment),
+                                                          buffer_memory_create_info->max_object_count);
+        // indexed by allocator node
+        memory.vertex_owners = calloc(OFFSET_ALLOCATOR_NODE_COUNT(buffer_memory_create_info->max_object_count), sizeof(BufferObject*));
+        memory.index_owners  = calloc(OFFSET_ALLOCATOR_NODE_COUNT(buffer_memory_create_info->max_object_count), sizeof(BufferObject*));
+        memory.components[memory.component_count++] = BUFFER_MEMORY_ALLOCATORS_COMPONENT;
+        if (memory.vertex_allocator.nodes == NULL || memory.index_allocator.nodes == NULL || memory.uniform_allocator.nodes == NULL ||
+            memory.vertex_owners == NULL || memory.index_owners == NULL)
+        {
+            ROSINA_LOG_ERROR("Failed to create buffer allocators");
+            BufferMemory_Cleanup(renderer, &memory);
+            return memory;
+        }
+    }
 
     // create buffers
     {
@@ -115,7 +107,7 @@ BufferMemory BufferMemory_Create(const Renderer renderer[static 1], BufferMemory
                                                  .pNext                 = NULL,
                                                  .flags                 = 0,
                                                  .size                  = buffer_memory_create_info->vertex_buffer_capacity,
-                                                 .usage                 = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                                 .usage                 = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
                                                  .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
                                                  .queueFamilyIndexCount = 0,
                                                  .pQueueFamilyIndices   = NULL};
@@ -131,7 +123,7 @@ BufferMemory BufferMemory_Create(const Renderer renderer[static 1], BufferMemory
         if (buffer_memory_create_info->index_buffer_capacity > 0)
         {
             buffer_create_info.size  = buffer_memory_create_info->index_buffer_capacity;
-            buffer_create_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+            buffer_create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
 
             VK_ERROR_HANDLE(vkCreateBuffer(renderer->device.handle, &buffer_create_info, NULL, &memory.index_buffer), {
                 BufferMemory_Cleanup(renderer, &memory);
@@ -155,50 +147,56 @@ BufferMemory BufferMemory_Create(const Renderer renderer[static 1], BufferMemory
 
     // allocate memory
     {
-        uint32_t memory_type_bits = 0;
+        // the buffers share one allocation, so it has to suit all of them
+        VkMemoryRequirements requirements = {.size = 0, .alignment = 1, .memoryTypeBits = UINT32_MAX};
         VkMemoryRequirements reqs;
         VkDeviceSize offset = 0;
-        VkDeviceSize size = 0;
 
         if (buffer_memory_create_info->vertex_buffer_capacity > 0)
         {
             vkGetBufferMemoryRequirements(renderer->device.handle, memory.vertex_buffer, &reqs);
-            memory_type_bits |= reqs.memoryTypeBits;
-            offset = VkDeviceSize_RoundUpTo(size, reqs.alignment);
-            size = offset + reqs.size;
+            requirements.memoryTypeBits &= reqs.memoryTypeBits;
+            requirements.alignment = reqs.alignment > requirements.alignment ? reqs.alignment : requirements.alignment;
+            offset = VkDeviceSize_RoundUpTo(requirements.size, reqs.alignment);
+            requirements.size = offset + reqs.size;
         }
 
         if (buffer_memory_create_info->index_buffer_capacity > 0)
         {
             vkGetBufferMemoryRequirements(renderer->device.handle, memory.index_buffer, &reqs);
-            memory_type_bits |= reqs.memoryTypeBits;
-            offset = VkDeviceSize_RoundUpTo(size, reqs.alignment);
-            size = offset + reqs.size;
+            requirements.memoryTypeBits &= reqs.memoryTypeBits;
+            requirements.alignment = reqs.alignment > requirements.alignment ? reqs.alignment : requirements.alignment;
+            offset = VkDeviceSize_RoundUpTo(requirements.size, reqs.alignment);
+            requirements.size = offset + reqs.size;
         }
 
         if (buffer_memory_create_info->uniform_buffer_capacity > 0)
         {
             vkGetBufferMemoryRequirements(renderer->device.handle, memory.uniform_buffer, &reqs);
-            memory_type_bits |= reqs.memoryTypeBits;
-            offset = VkDeviceSize_RoundUpTo(size, reqs.alignment);
-            size = offset + reqs.size;
+            requirements.memoryTypeBits &= reqs.memoryTypeBits;
+            requirements.alignment = reqs.alignment > requirements.alignment ? reqs.alignment : requirements.alignment;
+            offset = VkDeviceSize_RoundUpTo(requirements.size, reqs.alignment);
+            requirements.size = offset + reqs.size;
         }
 
-        const VkMemoryAllocateInfo buffer_alloc_info = {
-            .sType          = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .pNext          = NULL,
-            .allocationSize = size,
-            .memoryTypeIndex = FindMemoryType(renderer->device.physical_device, memory_type_bits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-        };
-
-        VK_ERROR_HANDLE(vkAllocateMemory(renderer->device.handle, &buffer_alloc_info, NULL, &memory.handle), {
+        // without resizable BAR the mappable part of video memory is too small to spend on this
+        const VkMemoryPropertyFlags preferred = buffer_memory_create_info->host_writable && VulkanAllocator_HasResizableBar(renderer->allocator)
+                                                  ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                                                  : 0;
+        if (VulkanAllocator_Allocate(renderer->allocator, &requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, preferred, VULKAN_ALLOCATION_KIND_LINEAR,
+                                     VULKAN_MEMORY_CATEGORY_MESH, &memory.allocation))
+        {
             BufferMemory_Cleanup(renderer, &memory);
             return memory;
-        });
+        }
 
         memory.components[memory.component_count++] = BUFFER_MEMORY_HANDLE_COMPONENT;
     }
 
+    // writes through the mapping need no flush only when the memory is coherent
+    const VkMemoryPropertyFlags memory_flags = renderer->allocator->memory_properties.memoryTypes[memory.allocation.memory_type_index].propertyFlags;
+    uint8_t* const mapped                    = (memory_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) ? memory.allocation.mapped : NULL;
+
     // bind offsets
     {
         VkMemoryRequirements reqs;
@@ -210,10 +208,11 @@ BufferMemory BufferMemory_Create(const Renderer renderer[static 1], BufferMemory
             vkGetBufferMemoryRequirements(renderer->device.handle, memory.vertex_buffer, &reqs);
             offset = VkDeviceSize_RoundUpTo(size, reqs.alignment);
             size = offset + reqs.size;
-            VK_ERROR_HANDLE(vkBindBufferMemory(renderer->device.handle, memory.vertex_buffer, memory.handle, offset), {
+            VK_ERROR_HANDLE(vkBindBufferMemory(renderer->device.handle, memory.vertex_buffer, memory.allocation.memory, memory.allocation.offset + offset), {
                 BufferMemory_Cleanup(renderer, &memory);
                 return memory;
             });
+            memory.vertex_mapped = mapped != NULL ? mapped + offset : NULL;
         }
 
         if (buffer_memory_create_info->index_buffer_capacity > 0)
@@ -221,10 +220,11 @@ BufferMemory BufferMemory_Create(const Renderer renderer[static 1], BufferMemory
             vkGetBufferMemoryRequirements(renderer->device.handle, memory.index_buffer, &reqs);
             offset = VkDeviceSize_RoundUpTo(size, reqs.alignment);
             size = offset + reqs.size;
-            VK_ERROR_HANDLE(vkBindBufferMemory(renderer->device.handle, memory.index_buffer, memory.handle, offset), {
+            VK_ERROR_HANDLE(vkBindBufferMemory(renderer->device.handle, memory.index_buffer, memory.allocation.memory, memory.allocation.offset + offset), {
                 BufferMemory_Cleanup(renderer, &memory);
                 return memory;
             });
+            memory.index_mapped = mapped != NULL ? mapped + offset : NULL;
         }
 
         if (buffer_memory_create_info->uniform_buffer_capacity > 0)
@@ -232,13 +232,410 @@ BufferMemory BufferMemory_Create(const Renderer renderer[static 1], BufferMemory
             vkGetBufferMemoryRequirements(renderer->device.handle, memory.uniform_buffer, &reqs);
             offset = VkDeviceSize_RoundUpTo(size, reqs.alignment);
             size = offset + reqs.size;
-            VK_ERROR_HANDLE(vkBindBufferMemory(renderer->device.handle, memory.uniform_buffer, memory.handle, offset), {
+            VK_ERROR_HANDLE(vkBindBufferMemory(renderer->device.handle, memory.uniform_buffer, memory.allocation.memory, memory.allocation.offset + offset), {
                 BufferMemory_Cleanup(renderer, &memory);
                 return memory;
             });
+            memory.uniform_mapped = mapped != NULL ? mapped + offset : NULL;
         }
     }
 
+    memory.direct_writes = mapped != NULL && getenv(BUFFER_MEMORY_STAGED_WRITES_VARIABLE) == NULL;
+    if (buffer_memory_create_info->host_writable)
+    {
+        ROSINA_LOG_INFO("Buffer memory is written %s", memory.direct_writes ? "directly" : "through staging");
+    }
+
     return memory;
 }
 
+
+static void LogAllocatorStats(const char* const name, const OffsetAllocator allocator[static 1], const VkDeviceSize alignment)
+{
+    if (allocator->size == 0)
+    {
+        return;
+    }
+
+    const OffsetAllocatorStats stats = OffsetAllocator_GetStats(allocator);
+    // the share of free space that is not in the largest free range
+    const double fragmentation = stats.free_size > 0 ? 1.0 - (double)stats.largest_free_size / (double)stats.free_size : 0.0;
+    ROSINA_LOG_INFO("%s buffer: %u objects, %llu of %llu KiB free in %u ranges, %.0f%% fragmented", name, stats.allocation_count,
+                    (unsigned long long)(stats.free_size * alignment >> 10), (unsigned long long)(allocator->size * alignment >> 10), stats.free_range_count,
+                    fragmentation * 100.0);
+}
+
+void BufferMemory_LogStats(const BufferMemory memory[static 1])
+{
+    LogAllocatorStats("Vertex", &memory->vertex_allocator, BUFFER_MEMORY_VERTEX_ALIGNMENT);
+    LogAllocatorStats("Index", &memory->index_allocator, BUFFER_MEMORY_INDEX_ALIGNMENT);
+    LogAllocatorStats("Uniform", &memory->uniform_allocator, memory->uniform_alignment);
+}
+
+/**
+ * The vertex or index buffer with what is needed to move its objects.
+ */
+typedef struct MovableBuffer
+{
+    VkBuffer buffer;
+    OffsetAllocator* allocator;
+    VkDeviceSize alignment;
+    BufferObject** owners;
+} MovableBuffer;
+
+static inline MovableBuffer GetVertexBuffer(BufferMemory memory[static 1])
+{
+    return (MovableBuffer){
+        .buffer    = memory->vertex_buffer,
+        .allocator = &memory->vertex_allocator,
+        .alignment = BUFFER_MEMORY_VERTEX_ALIGNMENT,
+        .owners    = memory->vertex_owners,
+    };
+}
+
+static inline MovableBuffer GetIndexBuffer(BufferMemory memory[static 1])
+{
+    return (MovableBuffer){
+        .buffer    = memory->index_buffer,
+        .allocator = &memory->index_allocator,
+        .alignment = BUFFER_MEMORY_INDEX_ALIGNMENT,
+        .owners    = memory->index_owners,
+    };
+}
+
+/**
+ * @return Whether the object is being copied and still uses its old offset.
+ */
+static bool IsBeingCopied(const BufferMemory memory[static 1], const BufferObject object[static 1])
+{
+    for (uint32_t i = 0; i < memory->move_count; i++)
+    {
+        if (memory->moves[i].object == object && !memory->moves[i].copied)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void CleanupObject(BufferMemory memory[static 1], const MovableBuffer movable, BufferObject object[static 1])
+{
+    if (object->offset == UINT64_MAX)
+    {
+        return;
+    }
+
+    if (movable.owners[object->node] == object)
+    {
+        movable.owners[object->node] = NULL;
+        // the destination of a copy is freed once the copy has finished
+        for (uint32_t i = 0; i < memory->move_count; i++)
+        {
+            if (memory->moves[i].object == object && !memory->moves[i].copied)
+            {
+                memory->moves[i].object = NULL;
+            }
+        }
+    }
+    BufferObject_Free(movable.allocator, movable.alignment, object);
+}
+
+void VertexBufferObject_Cleanup(BufferMemory memory[static 1], VertexBufferObject vbo[static 1])
+{
+    CleanupObject(memory, GetVertexBuffer(memory), vbo);
+}
+
+void IndexBufferObject_Cleanup(BufferMemory memory[static 1], IndexBufferObject ibo[static 1])
+{
+    CleanupObject(memory, GetIndexBuffer(memory), ibo);
+}
+
+void VertexBufferObject_SetMovable(BufferMemory memory[static 1], VertexBufferObject vbo[static 1])
+{
+    assert(vbo->offset != UINT64_MAX);
+    memory->vertex_owners[vbo->node] = vbo;
+}
+
+void IndexBufferObject_SetMovable(BufferMemory memory[static 1], IndexBufferObject ibo[static 1])
+{
+    assert(ibo->offset != UINT64_MAX);
+    memory->index_owners[ibo->node] = ibo;
+}
+
+/**
+ * @param completed_value The value graphics_semaphore has reached.
+ * @param frame_value The value the frame being recorded signals.
+ */
+static void RetireMoves(BufferMemory memory[static 1], const uint64_t completed_value, const uint64_t frame_value)
+{
+    for (uint32_t i = 0; i < memory->move_count;)
+    {
+        BufferMove* const move = &memory->moves[i];
+        if (move->value > completed_value)
+        {
+            i++;
+            continue;
+        }
+
+        const MovableBuffer movable = move->buffer == memory->vertex_buffer ? GetVertexBuffer(memory) : GetIndexBuffer(memory);
+        if (!move->copied && move->object != NULL)
+        {
+            // frames recorded from here on bind the destination, but the ones in flight may still bind the source
+            movable.owners[move->source.node]      = NULL;
+            movable.owners[move->destination.node] = move->object;
+            move->object->offset                   = move->destination.offset;
+            move->object->node                     = move->destination.node;
+            move->copied                           = true;
+            move->value                            = frame_value;
+            i++;
+            continue;
+        }
+
+        // an object cleaned up during the copy has already freed its source
+        BufferObject_Free(movable.allocator, movable.alignment, move->copied ? &move->source : &move->destination);
+        memory->moves[i] = memory->moves[--memory->move_count];
+    }
+}
+
+/**
+ * Moves the objects closest to the end of the buffer into free ranges below them, starting the uploader of the frame on
+ * the first move.
+ *
+ * @return true on error.
+ */
+static bool DefragmentBuffer(Renderer renderer[static 1], BufferMemory memory[static 1], const MovableBuffer movable, VkDeviceSize budget[static 1],
+                             VkCommandBuffer command_buffer[static 1])
+{
+    VkDeviceSize below = UINT64_MAX;
+    for (uint32_t attempt = 0; attempt < BUFFER_MEMORY_DEFRAGMENT_ATTEMPTS && memory->move_count < BUFFER_MEMORY_MOVE_CAPACITY; attempt++)
+    {
+        // the movable object with the highest offset that has not been looked at yet
+        BufferObject* object = NULL;
+        for (uint32_t node = 0; node < movable.allocator->node_count; node++)
+        {
+            BufferObject* const owner = movable.owners[node];
+            if (owner != NULL && owner->offset < below && (object == NULL || owner->offset > object->offset) && !IsBeingCopied(memory, owner))
+            {
+                object = owner;
+            }
+        }
+        if (object == NULL)
+        {
+            break;
+        }
+        below = object->offset;
+        if (object->size > *budget)
+        {
+            continue;
+        }
+
+        // the best fitting free range, which only helps when it is below the object
+        BufferObject destination = BufferObject_Allocate(movable.allocator, movable.alignment, object->size);
+        if (destination.offset == UINT64_MAX)
+        {
+            break;
+        }
+        if (destination.offset > object->offset)
+        {
+            BufferObject_Free(movable.allocator, movable.alignment, &destination);
+            continue;
+        }
+
+        if (*command_buffer == VK_NULL_HANDLE)
+        {
+            if (Renderer_BeginUpload(renderer) == VK_NULL_HANDLE)
+            {
+                BufferObject_Free(movable.allocator, movable.alignment, &destination);
+                return true;
+            }
+            *command_buffer = renderer->uploader.graphics_command_buffers[renderer->uploader.frame_index];
+
+            // free ranges can still be read by frames in flight that bound an object freed since
+            const VkMemoryBarrier barrier = {
+                .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                .pNext         = NULL,
+                .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+            };
+            vkCmdPipelineBarrier(*command_buffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                                 &barrier, 0, NULL, 0, NULL);
+        }
+
+        const VkBufferCopy2 region = {
+            .sType     = VK_STRUCTURE_TYPE_BUFFER_COPY_2,
+            .pNext     = NULL,
+            .srcOffset = object->offset,
+            .dstOffset = destination.offset,
+            .size      = object->size,
+        };
+        const VkCopyBufferInfo2 copy_info = {
+            .sType       = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2,
+            .pNext       = NULL,
+            .srcBuffer   = movable.buffer,
+            .dstBuffer   = movable.buffer,
+            .regionCount = 1,
+            .pRegions    = &region,
+        };
+        vkCmdCopyBuffer2(*command_buffer, &copy_info);
+
+        memory->moves[memory->move_count++] = (BufferMove){
+            .object      = object,
+            .buffer      = movable.buffer,
+            .source      = *object,
+            .destination = destination,
+            .value       = renderer->frame_number + 1,
+            .copied      = false,
+        };
+        *budget -= object->size;
+    }
+    return false;
+}
+
+bool BufferMemory_Defragment(Renderer renderer[static 1], BufferMemory memory[static 1])
+{
+    uint64_t completed_value;
+    VK_ERROR_RETURN(vkGetSemaphoreCounterValue(renderer->device.handle, renderer->uploader.graphics_semaphore, &completed_value), true);
+    RetireMoves(memory, completed_value, renderer->frame_number + 1);
+    if (memory->defragment_budget == 0)
+    {
+        return false;
+    }
+
+    VkDeviceSize budget            = memory->defragment_budget;
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    if (memory->vertex_buffer != VK_NULL_HANDLE && DefragmentBuffer(renderer, memory, GetVertexBuffer(memory), &budget, &command_buffer))
+    {
+        return true;
+    }
+    if (memory->index_buffer != VK_NULL_HANDLE && DefragmentBuffer(renderer, memory, GetIndexBuffer(memory), &budget, &command_buffer))
+    {
+        return true;
+    }
+
+    if (command_buffer != VK_NULL_HANDLE)
+    {
+        const VkMemoryBarrier barrier = {
+            .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .pNext         = NULL,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT,
+        };
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+    }
+    return false;
+}
+
+/**
+ * Records the copy of the whole object from staging memory.
+ *
+ * @return true on error.
+ */
+static bool RecordObjectCopy(Renderer renderer[static 1], const VkBuffer buffer, const BufferObject object[static 1], const StagingAllocation staging[static 1],
+                             const VkPipelineStageFlags dst_stage, const VkAccessFlags dst_access)
+{
+    assert(object->offset != UINT64_MAX);
+    const VkCommandBuffer command_buffer = Renderer_BeginUpload(renderer);
+    if (command_buffer == VK_NULL_HANDLE)
+    {
+        ROSINA_LOG_ERROR("Failed to begin upload");
+        return true;
+    }
+
+    const VkBufferCopy2 region = {
+        .sType     = VK_STRUCTURE_TYPE_BUFFER_COPY_2,
+        .pNext     = NULL,
+        .srcOffset = staging->offset,
+        .dstOffset = object->offset,
+        .size      = object->size,
+    };
+    const VkCopyBufferInfo2 copy_info = {
+        .sType       = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2,
+        .pNext       = NULL,
+        .srcBuffer   = staging->buffer,
+        .dstBuffer   = buffer,
+        .regionCount = 1,
+        .pRegions    = &region,
+    };
+    vkCmdCopyBuffer2(command_buffer, &copy_info);
+    Uploader_TransferBuffer(&renderer->uploader, buffer, object->offset, object->size, dst_stage, dst_access);
+    return false;
+}
+
+/**
+ * @return The mapped object when writes go straight to the buffer, otherwise staging memory whose copy into the
+ * object is recorded. NULL on error.
+ */
+static uint8_t* MapObject(Renderer renderer[static 1], const BufferMemory memory[static 1], const VkBuffer buffer, uint8_t* const mapped,
+                          const BufferObject object[static 1], const VkPipelineStageFlags dst_stage, const VkAccessFlags dst_access)
+{
+    assert(object->offset != UINT64_MAX);
+    if (mapped != NULL && memory->direct_writes)
+    {
+        // host writes to coherent memory are visible to every submission made after them
+        return mapped + object->offset;
+    }
+
+    // released by the renderer once the frame being recorded is done
+    StagingAllocation staging;
+    if (Renderer_AllocateStaging(renderer, object->size, 16, &staging))
+    {
+        ROSINA_LOG_ERROR("Failed to allocate staging memory");
+        return NULL;
+    }
+
+    // the copy only runs once the frame is submitted, so the caller can still fill the staging memory
+    return RecordObjectCopy(renderer, buffer, object, &staging, dst_stage, dst_access) ? NULL : staging.mapped;
+}
+
+bool VertexBufferObject_CopyStaging(Renderer renderer[static 1], BufferMemory memory[static 1], const VertexBufferObject vbo[static 1],
+                                    const StagingAllocation staging[static 1])
+{
+    return RecordObjectCopy(renderer, memory->vertex_buffer, vbo, staging, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+}
+
+bool IndexBufferObject_CopyStaging(Renderer renderer[static 1], BufferMemory memory[static 1], const IndexBufferObject ibo[static 1],
+                                   const StagingAllocation staging[static 1])
+{
+    return RecordObjectCopy(renderer, memory->index_buffer, ibo, staging, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+}
+
+void* VertexBufferObject_Map(Renderer renderer[static 1], BufferMemory memory[static 1], const VertexBufferObject vbo[static 1])
+{
+    return MapObject(renderer, memory, memory->vertex_buffer, memory->vertex_mapped, vbo, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                     VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+}
+
+void* IndexBufferObject_Map(Renderer renderer[static 1], BufferMemory memory[static 1], const IndexBufferObject ibo[static 1])
+{
+    return MapObject(renderer, memory, memory->index_buffer, memory->index_mapped, ibo, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+}
+
+void* UniformBufferObject_Map(Renderer renderer[static 1], BufferMemory memory[static 1], const UniformBufferObject ubo[static 1])
+{
+    return MapObject(renderer, memory, memory->uniform_buffer, memory->uniform_mapped, ubo,
+                     VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_UNIFORM_READ_BIT);
+}
+
+bool VertexBufferObject_Write(Renderer renderer[static 1], BufferMemory memory[static 1], const VertexBufferObject vbo[static 1], const void* data)
+{
+    void* const dest = VertexBufferObject_Map(renderer, memory, vbo);
+    if (dest == NULL) return true;
+    memcpy(dest, data, vbo->size);
+    return false;
+}
+
+bool IndexBufferObject_Write(Renderer renderer[static 1], BufferMemory memory[static 1], const IndexBufferObject ibo[static 1], const void* data)
+{
+    void* const dest = IndexBufferObject_Map(renderer, memory, ibo);
+    if (dest == NULL) return true;
+    memcpy(dest, data, ibo->size);
+    return false;
+}
+
+bool UniformBufferObject_Write(Renderer renderer[static 1], BufferMemory memory[static 1], const UniformBufferObject ubo[static 1], const void* data)
+{
+    void* const dest = UniformBufferObject_Map(renderer, memory, ubo);
+    if (dest == NULL) return true;
+    memcpy(dest, data, ubo->size);
+    return false;
+}
@@ -1,27 +1,37 @@
 #ifndef BUFFER_MEMORY_H
 #define BUFFER_MEMORY_H
 
-#include <engine/graphics/renderer.h>
-
-typedef struct StagingBuffer
-{
-    VkDeviceMemory memory;
-    VkBuffer handle;
-} StagingBuffer;
+#include <assert.h>
 
-void StagingBuffer_Cleanup(const Renderer renderer[static 1], StagingBuffer buffer[static 1]);
+#include <engine/graphics/renderer.h>
+#include <utility/offset_allocator.h>
 
-StagingBuffer StagingBuffer_Create(const Renderer renderer[static 1], const uint64_t size);
+// offsets into each buffer are multiples of these, uniform offsets of minUniformBufferOffsetAlignment
+#define BUFFER_MEMORY_VERTEX_ALIGNMENT 16
+#define BUFFER_MEMORY_INDEX_ALIGNMENT  4
+// the number of objects that can be on their way to a new offset at once
+#define BUFFER_MEMORY_MOVE_CAPACITY 64
+// the number of objects BufferMemory_Defragment looks at per buffer and frame
+#define BUFFER_MEMORY_DEFRAGMENT_ATTEMPTS 16
+// set to anything to write host writable buffer memory through staging anyway, to compare both paths
+#define BUFFER_MEMORY_STAGED_WRITES_VARIABLE "ROSINA_STAGED_WRITES"
 
 typedef struct BufferMemoryCreateInfo
 {
     VkDeviceSize vertex_buffer_capacity;
     VkDeviceSize index_buffer_capacity;
     VkDeviceSize uniform_buffer_capacity;
+    // the number of objects each buffer can hold at once
+    uint32_t max_object_count;
+    // the number of bytes BufferMemory_Defragment may copy per frame, 0 to disable it
+    VkDeviceSize defragment_budget;
+    // puts the buffers in video memory the CPU can map when the device has resizable BAR, so writes skip staging
+    bool host_writable;
 } BufferMemoryCreateInfo;
 
 typedef enum BufferMemoryComponent
 {
+    BUFFER_MEMORY_ALLOCATORS_COMPONENT,
     BUFFER_MEMORY_VERTEX_BUFFER_COMPONENT,
     BUFFER_MEMORY_INDEX_BUFFER_COMPONENT,
     BUFFER_MEMORY_UNIFORM_BUFFER_COMPONENT,
@@ -29,65 +39,244 @@ typedef enum BufferMemoryComponent
     BUFFER_MEMORY_COMPONENT_COUNT
 } BufferMemoryComponent;
 
+typedef struct BufferObject
+{
+    VkDeviceSize size;
+    // UINT64_MAX when the object could not be allocated
+    VkDeviceSize offset;
+    uint32_t node;
+} BufferObject;
+
+/**
+ * An object being moved to a lower offset of its buffer. The copy is made in the frame that signals value. Once it has
+ * finished, the object is patched to the destination and value becomes the last frame that can still use the source.
+ */
+typedef struct BufferMove
+{
+    // NULL when the object was cleaned up while it was being copied
+    BufferObject* object;
+    VkBuffer buffer;
+    BufferObject source;
+    BufferObject destination;
+    uint64_t value;
+    bool copied;
+} BufferMove;
+
+/**
+ * One vertex, one index and one uniform buffer in a single allocation. Objects are sub-allocated from each buffer with
+ * an OffsetAllocator, so they can be created and destroyed in any order. Vertex and index objects that were made movable
+ * are compacted a few at a time by BufferMemory_Defragment.
+ */
 typedef struct BufferMemory
 {
     uint32_t component_count;
     BufferMemoryComponent components[BUFFER_MEMORY_COMPONENT_COUNT];
-    VkDeviceSize vertex_buffer_size;
     VkBuffer vertex_buffer;
-    VkDeviceSize index_buffer_size;
+    OffsetAllocator vertex_allocator;
     VkBuffer index_buffer;
-    VkDeviceSize uniform_buffer_size;
+    OffsetAllocator index_allocator;
     VkBuffer uniform_buffer;
-    VkDeviceMemory handle;
+    OffsetAllocator uniform_allocator;
+    VkDeviceSize uniform_alignment;
+    VulkanAllocation allocation;
+
+    // the start of each buffer in host coherent memory, NULL when it has to be written through staging
+    uint8_t* vertex_mapped;
+    uint8_t* index_mapped;
+    uint8_t* uniform_mapped;
+    // whether writes to mapped buffers go straight to them, can be changed at any time
+    bool direct_writes;
+
+    // the movable objects, indexed by the allocator node they occupy
+    BufferObject** vertex_owners;
+    BufferObject** index_owners;
+    uint32_t move_count;
+    BufferMove moves[BUFFER_MEMORY_MOVE_CAPACITY];
+    VkDeviceSize defragment_budget;
 } BufferMemory;
 
 void BufferMemory_Cleanup(const Renderer renderer[static 1], BufferMemory memory[static 1]);
 
 /**
- * Each buffer referenced in the BufferInfo struct must have the size field be > 0 and the offset field be UINT64_MAX.
+ * Buffers with a capacity of 0 are not created.
+ *
+ * @return The created buffer memory. On error, the allocation.memory field will be VK_NULL_HANDLE.
  */
 BufferMemory BufferMemory_Create(const Renderer renderer[static 1], BufferMemoryCreateInfo create_info[static 1]);
 
-typedef struct BufferObject
+/**
+ * Logs how full and how fragmented each buffer is.
+ */
+void BufferMemory_LogStats(const BufferMemory memory[static 1]);
+
+/**
+ * Moves movable vertex and index objects into free ranges below them, copying at most memory->defragment_budget bytes
+ * on the graphics command buffer of the uploader. An object keeps its old offset until the copy has finished, and the
+ * old range is freed once no frame in flight can bind it anymore. Call once per frame before recording the scene.
+ *
+ * @return true on error.
+ */
+bool BufferMemory_Defragment(Renderer renderer[static 1], BufferMemory memory[static 1]);
+
+/**
+ * @param alignment The size of a unit of allocator.
+ */
+static inline BufferObject BufferObject_Allocate(OffsetAllocator allocator[static 1], const VkDeviceSize alignment, const VkDeviceSize size)
 {
-    VkDeviceSize size;
-    VkDeviceSize offset;
-} BufferObject;
+    BufferObject object      = {.size = size, .offset = UINT64_MAX, .node = OFFSET_ALLOCATOR_NONE};
+    const VkDeviceSize units = (size + alignment - 1) / alignment;
+    if (units > UINT32_MAX)
+    {
+        return object;
+    }
+
+    const OffsetAllocation allocation = OffsetAllocator_Allocate(allocator, (uint32_t)units);
+    if (allocation.node != OFFSET_ALLOCATOR_NONE)
+    {
+        object.offset = (VkDeviceSize)allocation.offset * alignment;
+        object.node   = allocation.node;
+    }
+    return object;
+}
+
+static inline void BufferObject_Free(OffsetAllocator allocator[static 1], const VkDeviceSize alignment, BufferObject object[static 1])
+{
+    if (object->offset == UINT64_MAX)
+    {
+        return;
+    }
+    OffsetAllocator_Free(allocator, (OffsetAllocation){.offset = (uint32_t)(object->offset / alignment), .node = object->node});
+    object->offset = UINT64_MAX;
+    object->node   = OFFSET_ALLOCATOR_NONE;
+}
 
 typedef BufferObject VertexBufferObject;
 typedef BufferObject IndexBufferObject;
 typedef BufferObject UniformBufferObject;
 
+/**
+ * @return The object. On error, the offset field will be UINT64_MAX.
+ */
 static inline VertexBufferObject VertexBufferObject_Create(const VkDeviceSize size, BufferMemory memory[static 1])
 {
-    const VertexBufferObject vbo = {.size = size, .offset = memory->vertex_buffer_size};
-    memory->vertex_buffer_size += size;
-    return vbo;
+    return BufferObject_Allocate(&memory->vertex_allocator, BUFFER_MEMORY_VERTEX_ALIGNMENT, size);
 }
 
+void VertexBufferObject_Cleanup(BufferMemory memory[static 1], VertexBufferObject vbo[static 1]);
+
+/**
+ * Lets BufferMemory_Defragment move the object. Its address must not change and its contents must not be written
+ * again until it is cleaned up.
+ */
+void VertexBufferObject_SetMovable(BufferMemory memory[static 1], VertexBufferObject vbo[static 1]);
+
+/**
+ * @return The object. On error, the offset field will be UINT64_MAX.
+ */
 static inline IndexBufferObject IndexBufferObject_Create(const VkDeviceSize size, BufferMemory memory[static 1])
 {
-    const IndexBufferObject ibo = {.size = size, .offset = memory->index_buffer_size};
-    memory->index_buffer_size += size;
-    return ibo;
+    return BufferObject_Allocate(&memory->index_allocator, BUFFER_MEMORY_INDEX_ALIGNMENT, size);
 }
 
+void IndexBufferObject_Cleanup(BufferMemory memory[static 1], IndexBufferObject ibo[static 1]);
+
+/**
+ * Lets BufferMemory_Defragment move the object. Its address must not change and its contents must not be written
+ * again until it is cleaned up.
+ */
+void IndexBufferObject_SetMovable(BufferMemory memory[static 1], IndexBufferObject ibo[static 1]);
+
+/**
+ * @return The object. On error, the offset field will be UINT64_MAX.
+ */
 static inline UniformBufferObject UniformBufferObject_Create(const VkDeviceSize size, BufferMemory memory[static 1])
 {
-    const UniformBufferObject ubo = {.size = size, .offset = memory->uniform_buffer_size};
-    memory->uniform_buffer_size += size;
-    return ubo;
+    return BufferObject_Allocate(&memory->uniform_allocator, memory->uniform_alignment, size);
 }
 
-static inline void VertexBufferObject_Bind(const Renderer renderer[static 1], const BufferMemory memory[static 1], const VertexBufferObject vbo[static 1])
+static inline void UniformBufferObject_Cleanup(BufferMemory memory[static 1], UniformBufferObject ubo[static 1])
 {
-    vkCmdBindVertexBuffers(renderer->primary_command_buffers[renderer->frame_index], 0, 1, &memory->vertex_buffer, &vbo->offset);
+    BufferObject_Free(&memory->uniform_allocator, memory->uniform_alignment, ubo);
 }
 
-static inline void IndexBufferObject_Bind(const Renderer renderer[static 1], const BufferMemory memory[static 1], const IndexBufferObject ibo[static 1])
+/**
+ * Returns memory for the whole object that the caller fills before the frame being recorded is submitted: the object
+ * itself when the buffer is mapped and memory->direct_writes is set, otherwise staging memory whose copy into the object
+ * is recorded with Renderer_BeginUpload. Lets data be read from disk straight into place. No frame in flight may read
+ * the object.
+ *
+ * @return NULL on error.
+ */
+void* VertexBufferObject_Map(Renderer renderer[static 1], BufferMemory memory[static 1], const VertexBufferObject vbo[static 1]);
+
+/**
+ * Like VertexBufferObject_Map.
+ *
+ * @return NULL on error.
+ */
+void* IndexBufferObject_Map(Renderer renderer[static 1], BufferMemory memory[static 1], const IndexBufferObject ibo[static 1]);
+
+/**
+ * Like VertexBufferObject_Map.
+ *
+ * @return NULL on error.
+ */
+void* UniformBufferObject_Map(Renderer renderer[static 1], BufferMemory memory[static 1], const UniformBufferObject ubo[static 1]);
+
+/**
+ * Records the copy of the whole object from staging memory the caller already filled, which VertexBufferObject_Map
+ * records before the memory is written. Nothing is recorded for data that fails to load, so the object can be freed
+ * right away. Subject to the same rules as VertexBufferObject_Map.
+ *
+ * @param staging Object size bytes from Renderer_AllocateStaging.
+ * @return true on error.
+ */
+bool VertexBufferObject_CopyStaging(Renderer renderer[static 1], BufferMemory memory[static 1], const VertexBufferObject vbo[static 1],
+                                    const StagingAllocation staging[static 1]);
+
+/**
+ * Like VertexBufferObject_CopyStaging.
+ *
+ * @return true on error.
+ */
+bool IndexBufferObject_CopyStaging(Renderer renderer[static 1], BufferMemory memory[static 1], const IndexBufferObject ibo[static 1],
+                                   const StagingAllocation staging[static 1]);
+
+/**
+ * Copies data into the memory returned by VertexBufferObject_Map.
+ *
+ * @return true on error.
+ */
+bool VertexBufferObject_Write(Renderer renderer[static 1], BufferMemory memory[static 1], const VertexBufferObject vbo[static 1], const void* data);
+
+/**
+ * Like VertexBufferObject_Write.
+ *
+ * @return true on error.
+ */
+bool IndexBufferObject_Write(Renderer renderer[static 1], BufferMemory memory[static 1], const IndexBufferObject ibo[static 1], const void* data);
+
+/**
+ * Like VertexBufferObject_Write.
+ *
+ * @return true on error.
+ */
+bool UniformBufferObject_Write(Renderer renderer[static 1], BufferMemory memory[static 1], const UniformBufferObject ubo[static 1], const void* data);
+
+static inline void VertexBufferObject_Bind(CommandRecorder recorder[static 1], const BufferMemory memory[static 1], const VertexBufferObject vbo[static 1])
+{
+    assert(vbo->offset != UINT64_MAX);
+    CommandRecorder_BindVertexBuffers(recorder, 0, 1, &memory->vertex_buffer, &vbo->offset);
+}
+
+/**
+ * @param index_type The type the indices were written as, see VertexFormat_GetIndexType.
+ */
+static inline void IndexBufferObject_Bind(CommandRecorder recorder[static 1], const BufferMemory memory[static 1], const IndexBufferObject ibo[static 1],
+                                          const VkIndexType index_type)
 {
-    vkCmdBindIndexBuffer(renderer->primary_command_buffers[renderer->frame_index], memory->index_buffer, ibo->offset, VK_INDEX_TYPE_UINT32);
+    assert(ibo->offset != UINT64_MAX);
+    CommandRecorder_BindIndexBuffer(recorder, memory->index_buffer, ibo->offset, index_type);
 }
 
 
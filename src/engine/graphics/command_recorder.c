@@ -0,0 +1,172 @@
+#include <engine/graphics/command_recorder.h>
+
+#include <assert.h>
+
+#include <utility/log.h>
+
+static inline uint32_t GetBindPointIndex(const VkPipelineBindPoint bind_point)
+{
+    assert(bind_point == VK_PIPELINE_BIND_POINT_GRAPHICS || bind_point == VK_PIPELINE_BIND_POINT_COMPUTE);
+    return bind_point == VK_PIPELINE_BIND_POINT_COMPUTE ? 1 : 0;
+}
+
+void CommandRecorder_BindPipeline(CommandRecorder recorder[static 1], const VkPipelineBindPoint bind_point, const VkPipeline pipeline)
+{
+    VkPipeline* const bound = &recorder->pipelines[GetBindPointIndex(bind_point)];
+    if (*bound == pipeline)
+    {
+        recorder->stats.skipped[COMMAND_RECORDER_PIPELINE]++;
+        return;
+    }
+
+    vkCmdBindPipeline(recorder->command_buffer, bind_point, pipeline);
+    *bound = pipeline;
+    recorder->stats.issued[COMMAND_RECORDER_PIPELINE]++;
+}
+
+static bool IsSameDescriptorSets(const CommandRecorderDescriptorSets a[static 1], const CommandRecorderDescriptorSets b[static 1])
+{
+    return a->layout == b->layout && a->first_set == b->first_set && a->set_count == b->set_count &&
+           a->dynamic_offset_count == b->dynamic_offset_count && memcmp(a->sets, b->sets, sizeof(VkDescriptorSet) * a->set_count) == 0 &&
+           memcmp(a->dynamic_offsets, b->dynamic_offsets, sizeof(uint32_t) * a->dynamic_offset_count) == 0;
+}
+
+void CommandRecorder_BindDescriptorSets(CommandRecorder recorder[static 1], const VkPipelineBindPoint bind_point, const VkPipelineLayout layout,
+                                        const uint32_t first_set, const uint32_t set_count, const VkDescriptorSet* const sets,
+                                        const uint32_t dynamic_offset_count, const uint32_t* const dynamic_offsets)
+{
+    assert(first_set + set_count <= COMMAND_RECORDER_MAX_DESCRIPTOR_SETS);
+    assert(dynamic_offset_count <= COMMAND_RECORDER_MAX_DYNAMIC_OFFSETS);
+
+    CommandRecorderDescriptorSets call = {
+        .layout               = layout,
+        .first_set            = first_set,
+        .set_count            = set_count,
+        .sets                 = {},
+        .dynamic_offset_count = dynamic_offset_count,
+        .dynamic_offsets      = {},
+    };
+    memcpy(call.sets, sets, sizeof(VkDescriptorSet) * set_count);
+    if (dynamic_offset_count > 0)
+    {
+        memcpy(call.dynamic_offsets, dynamic_offsets, sizeof(uint32_t) * dynamic_offset_count);
+    }
+
+    CommandRecorderDescriptorSets* const bound = recorder->descriptor_sets[GetBindPointIndex(bind_point)];
+    bool same                                  = true;
+    for (uint32_t i = first_set; i < first_set + set_count && same; i++)
+    {
+        same = IsSameDescriptorSets(&bound[i], &call);
+    }
+    if (same)
+    {
+        recorder->stats.skipped[COMMAND_RECORDER_DESCRIPTOR_SETS]++;
+        return;
+    }
+
+    vkCmdBindDescriptorSets(recorder->command_buffer, bind_point, layout, first_set, set_count, sets, dynamic_offset_count, dynamic_offsets);
+    recorder->stats.issued[COMMAND_RECORDER_DESCRIPTOR_SETS]++;
+
+    for (uint32_t i = 0; i < COMMAND_RECORDER_MAX_DESCRIPTOR_SETS; i++)
+    {
+        if (i >= first_set && i < first_set + set_count)
+        {
+            bound[i] = call;
+        }
+        else if (bound[i].layout != layout)
+        {
+            // sets bound with another layout may have been disturbed
+            bound[i] = (CommandRecorderDescriptorSets){};
+        }
+    }
+}
+
+void CommandRecorder_BindVertexBuffers(CommandRecorder recorder[static 1], const uint32_t first_binding, const uint32_t binding_count,
+                                       const VkBuffer* const buffers, const VkDeviceSize* const offsets)
+{
+    assert(first_binding + binding_count <= COMMAND_RECORDER_MAX_VERTEX_BINDINGS);
+
+    uint32_t first = UINT32_MAX;
+    uint32_t last  = 0;
+    for (uint32_t i = 0; i < binding_count; i++)
+    {
+        const uint32_t binding = first_binding + i;
+        if (recorder->vertex_buffers[binding] != buffers[i] || recorder->vertex_offsets[binding] != offsets[i])
+        {
+            first = first == UINT32_MAX ? i : first;
+            last  = i;
+        }
+    }
+    if (first == UINT32_MAX)
+    {
+        recorder->stats.skipped[COMMAND_RECORDER_VERTEX_BUFFERS]++;
+        return;
+    }
+
+    vkCmdBindVertexBuffers(recorder->command_buffer, first_binding + first, last - first + 1, buffers + first, offsets + first);
+    memcpy(recorder->vertex_buffers + first_binding + first, buffers + first, sizeof(VkBuffer) * (last - first + 1));
+    memcpy(recorder->vertex_offsets + first_binding + first, offsets + first, sizeof(VkDeviceSize) * (last - first + 1));
+    recorder->stats.issued[COMMAND_RECORDER_VERTEX_BUFFERS]++;
+}
+
+void CommandRecorder_BindIndexBuffer(CommandRecorder recorder[static 1], const VkBuffer buffer, const VkDeviceSize offset, const VkIndexType index_type)
+{
+    if (recorder->index_buffer == buffer && recorder->index_offset == offset && recorder->index_type == index_type)
+    {
+        recorder->stats.skipped[COMMAND_RECORDER_INDEX_BUFFER]++;
+        return;
+    }
+
+    vkCmdBindIndexBuffer(recorder->command_buffer, buffer, offset, index_type);
+    recorder->index_buffer = buffer;
+    recorder->index_offset = offset;
+    recorder->index_type   = index_type;
+    recorder->stats.issued[COMMAND_RECORDER_INDEX_BUFFER]++;
+}
+
+void CommandRecorder_SetViewport(CommandRecorder recorder[static 1], const VkViewport viewport[static 1])
+{
+    if (recorder->viewport_set && memcmp(&recorder->viewport, viewport, sizeof(VkViewport)) == 0)
+    {
+        recorder->stats.skipped[COMMAND_RECORDER_VIEWPORT]++;
+        return;
+    }
+
+    vkCmdSetViewport(recorder->command_buffer, 0, 1, viewport);
+    recorder->viewport_set = true;
+    recorder->viewport     = *viewport;
+    recorder->stats.issued[COMMAND_RECORDER_VIEWPORT]++;
+}
+
+void CommandRecorder_SetScissor(CommandRecorder recorder[static 1], const VkRect2D scissor[static 1])
+{
+    if (recorder->scissor_set && memcmp(&recorder->scissor, scissor, sizeof(VkRect2D)) == 0)
+    {
+        recorder->stats.skipped[COMMAND_RECORDER_SCISSOR]++;
+        return;
+    }
+
+    vkCmdSetScissor(recorder->command_buffer, 0, 1, scissor);
+    recorder->scissor_set = true;
+    recorder->scissor     = *scissor;
+    recorder->stats.issued[COMMAND_RECORDER_SCISSOR]++;
+}
+
+static const char* const state_names[COMMAND_RECORDER_STATE_COUNT] = {
+    [COMMAND_RECORDER_PIPELINE]        = "pipeline",
+    [COMMAND_RECORDER_DESCRIPTOR_SETS] = "descriptor sets",
+    [COMMAND_RECORDER_VERTEX_BUFFERS]  = "vertex buffers",
+    [COMMAND_RECORDER_INDEX_BUFFER]    = "index buffer",
+    [COMMAND_RECORDER_VIEWPORT]        = "viewport",
+    [COMMAND_RECORDER_SCISSOR]         = "scissor",
+};
+
+void CommandRecorderStats_Log(const CommandRecorderStats stats[static 1])
+{
+    for (uint32_t i = 0; i < COMMAND_RECORDER_STATE_COUNT; i++)
+    {
+        const uint64_t total = stats->issued[i] + stats->skipped[i];
+        ROSINA_LOG_INFO("Binds of %s: %llu issued, %llu skipped (%.1f%%)", state_names[i], (unsigned long long)stats->issued[i],
+                        (unsigned long long)stats->skipped[i], total > 0 ? 100.0 * (double)stats->skipped[i] / (double)total : 0.0);
+    }
+}
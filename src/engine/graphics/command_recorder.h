@@ -0,0 +1,123 @@
+#ifndef ROSINA_ENGINE_COMMAND_RECORDER_H
+#define ROSINA_ENGINE_COMMAND_RECORDER_H
+
+#include <string.h>
+
+#include <engine/backend/vulkan_helpers.h>
+
+#define COMMAND_RECORDER_MAX_DESCRIPTOR_SETS 4
+#define COMMAND_RECORDER_MAX_DYNAMIC_OFFSETS 4
+#define COMMAND_RECORDER_MAX_VERTEX_BINDINGS 4
+
+typedef enum CommandRecorderState
+{
+    COMMAND_RECORDER_PIPELINE,
+    COMMAND_RECORDER_DESCRIPTOR_SETS,
+    COMMAND_RECORDER_VERTEX_BUFFERS,
+    COMMAND_RECORDER_INDEX_BUFFER,
+    COMMAND_RECORDER_VIEWPORT,
+    COMMAND_RECORDER_SCISSOR,
+    COMMAND_RECORDER_STATE_COUNT
+} CommandRecorderState;
+
+typedef struct CommandRecorderStats
+{
+    // the calls made into Vulkan, and the ones left out because they would have bound what already was
+    uint64_t issued[COMMAND_RECORDER_STATE_COUNT];
+    uint64_t skipped[COMMAND_RECORDER_STATE_COUNT];
+} CommandRecorderStats;
+
+/**
+ * The vkCmdBindDescriptorSets call that bound a set, kept for every set it bound.
+ */
+typedef struct CommandRecorderDescriptorSets
+{
+    VkPipelineLayout layout;
+    uint32_t first_set;
+    uint32_t set_count;
+    VkDescriptorSet sets[COMMAND_RECORDER_MAX_DESCRIPTOR_SETS];
+    uint32_t dynamic_offset_count;
+    uint32_t dynamic_offsets[COMMAND_RECORDER_MAX_DYNAMIC_OFFSETS];
+} CommandRecorderDescriptorSets;
+
+/**
+ * Tracks what is bound in one command buffer and leaves out binds that would not change it. Made per command buffer
+ * when it begins, since nothing is bound then, and only used by the thread recording it.
+ */
+typedef struct CommandRecorder
+{
+    VkCommandBuffer command_buffer;
+    // indexed by GetBindPointIndex, graphics then compute
+    VkPipeline pipelines[2];
+    CommandRecorderDescriptorSets descriptor_sets[2][COMMAND_RECORDER_MAX_DESCRIPTOR_SETS];
+    VkBuffer vertex_buffers[COMMAND_RECORDER_MAX_VERTEX_BINDINGS];
+    VkDeviceSize vertex_offsets[COMMAND_RECORDER_MAX_VERTEX_BINDINGS];
+    VkBuffer index_buffer;
+    VkDeviceSize index_offset;
+    VkIndexType index_type;
+    bool viewport_set;
+    VkViewport viewport;
+    bool scissor_set;
+    VkRect2D scissor;
+    CommandRecorderStats stats;
+} CommandRecorder;
+
+/**
+ * @param command_buffer A command buffer that was just begun.
+ */
+static inline CommandRecorder CommandRecorder_Create(const VkCommandBuffer command_buffer)
+{
+    return (CommandRecorder){
+        .command_buffer  = command_buffer,
+        .pipelines       = {VK_NULL_HANDLE, VK_NULL_HANDLE},
+        .descriptor_sets = {},
+        .vertex_buffers  = {},
+        .vertex_offsets  = {},
+        .index_buffer    = VK_NULL_HANDLE,
+        .index_offset    = 0,
+        .index_type      = VK_INDEX_TYPE_UINT32,
+        .viewport_set    = false,
+        .viewport        = {},
+        .scissor_set     = false,
+        .scissor         = {},
+        .stats           = {},
+    };
+}
+
+void CommandRecorder_BindPipeline(CommandRecorder recorder[static 1], const VkPipelineBindPoint bind_point, const VkPipeline pipeline);
+
+/**
+ * Like vkCmdBindDescriptorSets. Skipped when the sets were bound by the same call, with the same layout and dynamic
+ * offsets.
+ */
+void CommandRecorder_BindDescriptorSets(CommandRecorder recorder[static 1], const VkPipelineBindPoint bind_point, const VkPipelineLayout layout,
+                                        const uint32_t first_set, const uint32_t set_count, const VkDescriptorSet* const sets,
+                                        const uint32_t dynamic_offset_count, const uint32_t* const dynamic_offsets);
+
+/**
+ * Like vkCmdBindVertexBuffers, only binding the range of bindings that changed.
+ */
+void CommandRecorder_BindVertexBuffers(CommandRecorder recorder[static 1], const uint32_t first_binding, const uint32_t binding_count,
+                                       const VkBuffer* const buffers, const VkDeviceSize* const offsets);
+
+void CommandRecorder_BindIndexBuffer(CommandRecorder recorder[static 1], const VkBuffer buffer, const VkDeviceSize offset, const VkIndexType index_type);
+
+void CommandRecorder_SetViewport(CommandRecorder recorder[static 1], const VkViewport viewport[static 1]);
+
+void CommandRecorder_SetScissor(CommandRecorder recorder[static 1], const VkRect2D scissor[static 1]);
+
+static inline void CommandRecorderStats_Add(CommandRecorderStats dest[static 1], const CommandRecorderStats stats[static 1])
+{
+    for (uint32_t i = 0; i < COMMAND_RECORDER_STATE_COUNT; i++)
+    {
+        dest->issued[i] += stats->issued[i];
+        dest->skipped[i] += stats->skipped[i];
+    }
+}
+
+/**
+ * Logs how many binds of each kind were issued and skipped.
+ */
+void CommandRecorderStats_Log(const CommandRecorderStats stats[static 1]);
+
+#endif
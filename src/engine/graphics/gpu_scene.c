@@ -0,0 +1,441 @@
+#include <engine/graphics/gpu_scene.h>
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <utility/load_file.h>
+#include <utility/log.h>
+
+_Static_assert(sizeof(GpuMesh) == 160, "GpuMesh must match the Mesh struct of shaders/cull.comp");
+_Static_assert(sizeof(GpuCullConstants) <= 128, "push constants beyond 128 bytes are not guaranteed");
+_Static_assert(sizeof(VkDrawIndexedIndirectCommand) == 20, "the draws of shaders/cull.comp are 5 words");
+_Static_assert(GPU_SCENE_DRAWS_OFFSET % 16 == 0, "the draws must stay 16 byte aligned");
+
+/**
+ * @return true on error.
+ */
+static bool CreateBuffer(const Renderer renderer[static 1], const VkDeviceSize size, const VkBufferUsageFlags usage, VkBuffer buffer[static 1],
+                         VulkanAllocation allocation[static 1])
+{
+    const VkBufferCreateInfo buffer_create_info = {
+        .sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext                 = NULL,
+        .flags                 = 0,
+        .size                  = size,
+        .usage                 = usage,
+        .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices   = NULL,
+    };
+    VK_ERROR_RETURN(vkCreateBuffer(renderer->device.handle, &buffer_create_info, NULL, buffer), true);
+
+    if (VulkanAllocator_AllocateBuffer(renderer->allocator, *buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, VULKAN_MEMORY_CATEGORY_SCENE, allocation))
+    {
+        vkDestroyBuffer(renderer->device.handle, *buffer, NULL);
+        *buffer = VK_NULL_HANDLE;
+        return true;
+    }
+    return false;
+}
+
+GpuScene GpuScene_Create(Renderer renderer[static 1], const GpuSceneCreateInfo create_info[static 1])
+{
+    assert(create_info->shader_path != NULL);
+    assert(create_info->pipeline_count > 0 && create_info->pipeline_count <= GPU_SCENE_MAX_PIPELINE_COUNT);
+
+    GpuScene scene = {
+        .component_count   = 0,
+        .components        = {},
+        .instance_capacity = create_info->instance_capacity > 0 ? create_info->instance_capacity : 1,
+        .instance_count    = 0,
+        .mesh_capacity     = create_info->mesh_capacity > 0 ? create_info->mesh_capacity : 1,
+        .mesh_count        = 0,
+        .pipeline_count    = create_info->pipeline_count,
+    };
+
+    if (!renderer->device.draw_indirect_count_supported)
+    {
+        ROSINA_LOG_ERROR("The device does not support drawIndirectCount");
+        return scene;
+    }
+
+    // buffers
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(renderer->device.physical_device, &properties);
+        const VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment > 0 ? properties.limits.minStorageBufferOffsetAlignment : 1;
+
+        const VkDeviceSize draw_size = sizeof(VkDrawIndexedIndirectCommand) * scene.instance_capacity * scene.pipeline_count;
+        scene.frame_size             = (GPU_SCENE_DRAWS_OFFSET + draw_size + alignment - 1) / alignment * alignment;
+
+        if (CreateBuffer(renderer, sizeof(InstanceData) * scene.instance_capacity,
+                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, &scene.instance_buffer,
+                         &scene.instance_allocation))
+        {
+            ROSINA_LOG_ERROR("Failed to create instance buffer of %u instances", scene.instance_capacity);
+            GpuScene_Cleanup(renderer, &scene);
+            return scene;
+        }
+        scene.components[scene.component_count++] = GPU_SCENE_INSTANCE_BUFFER_COMPONENT;
+
+        if (CreateBuffer(renderer, sizeof(GpuMesh) * scene.mesh_capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                         &scene.mesh_buffer, &scene.mesh_allocation))
+        {
+            ROSINA_LOG_ERROR("Failed to create mesh buffer of %u meshes", scene.mesh_capacity);
+            GpuScene_Cleanup(renderer, &scene);
+            return scene;
+        }
+        scene.components[scene.component_count++] = GPU_SCENE_MESH_BUFFER_COMPONENT;
+
+        if (CreateBuffer(renderer, scene.frame_size * renderer->frame_count,
+                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, &scene.draw_buffer,
+                         &scene.draw_allocation))
+        {
+            ROSINA_LOG_ERROR("Failed to create draw buffer");
+            GpuScene_Cleanup(renderer, &scene);
+            return scene;
+        }
+        scene.components[scene.component_count++] = GPU_SCENE_DRAW_BUFFER_COMPONENT;
+    }
+
+    // layout
+    {
+        const VkDescriptorSetLayoutBinding bindings[] = {{
+            .binding            = 0,
+            .descriptorType     = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount    = 1,
+            .stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL
+        }, {
+            .binding            = 1,
+            .descriptorType     = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount    = 1,
+            .stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL
+        }, {
+            .binding            = 2,
+            .descriptorType     = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+            .descriptorCount    = 1,
+            .stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL
+        }};
+        const VkDescriptorSetLayoutCreateInfo layout_create_info = {
+            .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+            .pNext        = NULL,
+            .flags        = 0,
+            .bindingCount = sizeof(bindings) / sizeof(VkDescriptorSetLayoutBinding),
+            .pBindings    = bindings
+        };
+        VK_ERROR_HANDLE(vkCreateDescriptorSetLayout(renderer->device.handle, &layout_create_info, NULL, &scene.descriptor_set_layout), {
+            GpuScene_Cleanup(renderer, &scene);
+            return scene;
+        });
+        scene.components[scene.component_count++] = GPU_SCENE_DESCRIPTOR_SET_LAYOUT_COMPONENT;
+    }
+
+    // pool and set
+    {
+        const VkDescriptorPoolSize pool_sizes[] = {
+            {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 2},
+            {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, .descriptorCount = 1}
+        };
+        const VkDescriptorPoolCreateInfo pool_create_info = {
+            .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .pNext         = NULL,
+            .flags         = 0,
+            .maxSets       = 1,
+            .poolSizeCount = sizeof(pool_sizes) / sizeof(VkDescriptorPoolSize),
+            .pPoolSizes    = pool_sizes
+        };
+        VK_ERROR_HANDLE(vkCreateDescriptorPool(renderer->device.handle, &pool_create_info, NULL, &scene.descriptor_pool), {
+            GpuScene_Cleanup(renderer, &scene);
+            return scene;
+        });
+        scene.components[scene.component_count++] = GPU_SCENE_DESCRIPTOR_POOL_COMPONENT;
+
+        // freed with the pool
+        const VkDescriptorSetAllocateInfo alloc_info = {
+            .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext              = NULL,
+            .descriptorPool     = scene.descriptor_pool,
+            .descriptorSetCount = 1,
+            .pSetLayouts        = &scene.descriptor_set_layout
+        };
+        VK_ERROR_HANDLE(vkAllocateDescriptorSets(renderer->device.handle, &alloc_info, &scene.descriptor_set), {
+            GpuScene_Cleanup(renderer, &scene);
+            return scene;
+        });
+
+        const VkDescriptorBufferInfo buffer_infos[] = {
+            {.buffer = scene.instance_buffer, .offset = 0, .range = VK_WHOLE_SIZE},
+            {.buffer = scene.mesh_buffer, .offset = 0, .range = VK_WHOLE_SIZE},
+            // the region of the frame is picked with the dynamic offset
+            {.buffer = scene.draw_buffer, .offset = 0, .range = scene.frame_size},
+        };
+        VkWriteDescriptorSet descriptor_writes[3];
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            descriptor_writes[i] = (VkWriteDescriptorSet){
+                .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext            = NULL,
+                .dstSet           = scene.descriptor_set,
+                .dstBinding       = i,
+                .dstArrayElement  = 0,
+                .descriptorCount  = 1,
+                .descriptorType   = i == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pImageInfo       = NULL,
+                .pBufferInfo      = &buffer_infos[i],
+                .pTexelBufferView = NULL
+            };
+        }
+        vkUpdateDescriptorSets(renderer->device.handle, 3, descriptor_writes, 0, NULL);
+    }
+
+    // module
+    {
+        VkShaderModuleCreateInfo module_create_info = {
+            .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO, .pNext = NULL, .flags = 0, .codeSize = 0, .pCode = NULL};
+        if (LoadFile(NULL, &module_create_info.codeSize, create_info->shader_path))
+        {
+            ROSINA_LOG_ERROR("Could not get size of culling shader.");
+            GpuScene_Cleanup(renderer, &scene);
+            return scene;
+        }
+
+        MemoryArena arena = MemoryArena_Create(module_create_info.codeSize);
+        void* const code  = MemoryArena_Allocate(&arena, module_create_info.codeSize);
+        if (LoadFile(code, &module_create_info.codeSize, create_info->shader_path))
+        {
+            ROSINA_LOG_ERROR("Could not load culling shader.");
+            MemoryArena_Free(&arena);
+            GpuScene_Cleanup(renderer, &scene);
+            return scene;
+        }
+        module_create_info.pCode = code;
+
+        VK_ERROR_HANDLE(vkCreateShaderModule(renderer->device.handle, &module_create_info, NULL, &scene.shader_module), {
+            MemoryArena_Free(&arena);
+            GpuScene_Cleanup(renderer, &scene);
+            return scene;
+        });
+        MemoryArena_Free(&arena);
+        scene.components[scene.component_count++] = GPU_SCENE_SHADER_MODULE_COMPONENT;
+    }
+
+    // pipeline
+    {
+        const VulkanComputePipelineCreateInfo pipeline_create_info = {
+            .shader_module         = scene.shader_module,
+            .descriptor_set_layout = scene.descriptor_set_layout,
+            .push_constant_size    = sizeof(GpuCullConstants),
+            .cache                 = renderer->pipeline_cache,
+        };
+        if (VulkanComputePipeline_Create(&renderer->device, &pipeline_create_info, &scene.pipeline))
+        {
+            ROSINA_LOG_ERROR("Failed to create culling pipeline");
+            GpuScene_Cleanup(renderer, &scene);
+            return scene;
+        }
+        scene.components[scene.component_count++] = GPU_SCENE_PIPELINE_COMPONENT;
+    }
+
+    return scene;
+}
+
+void GpuScene_Cleanup(const Renderer renderer[static 1], GpuScene scene[static 1])
+{
+    vkDeviceWaitIdle(renderer->device.handle);
+
+    while (scene->component_count > 0)
+    {
+        switch (scene->components[--scene->component_count])
+        {
+            case GPU_SCENE_INSTANCE_BUFFER_COMPONENT:
+                vkDestroyBuffer(renderer->device.handle, scene->instance_buffer, NULL);
+                scene->instance_buffer = VK_NULL_HANDLE;
+                VulkanAllocator_Free(renderer->allocator, &scene->instance_allocation);
+                break;
+            case GPU_SCENE_MESH_BUFFER_COMPONENT:
+                vkDestroyBuffer(renderer->device.handle, scene->mesh_buffer, NULL);
+                scene->mesh_buffer = VK_NULL_HANDLE;
+                VulkanAllocator_Free(renderer->allocator, &scene->mesh_allocation);
+                break;
+            case GPU_SCENE_DRAW_BUFFER_COMPONENT:
+                vkDestroyBuffer(renderer->device.handle, scene->draw_buffer, NULL);
+                scene->draw_buffer = VK_NULL_HANDLE;
+                VulkanAllocator_Free(renderer->allocator, &scene->draw_allocation);
+                break;
+            case GPU_SCENE_DESCRIPTOR_SET_LAYOUT_COMPONENT:
+                vkDestroyDescriptorSetLayout(renderer->device.handle, scene->descriptor_set_layout, NULL);
+                scene->descriptor_set_layout = VK_NULL_HANDLE;
+                break;
+            case GPU_SCENE_DESCRIPTOR_POOL_COMPONENT:
+                vkDestroyDescriptorPool(renderer->device.handle, scene->descriptor_pool, NULL);
+                scene->descriptor_pool = VK_NULL_HANDLE;
+                scene->descriptor_set  = VK_NULL_HANDLE;
+                break;
+            case GPU_SCENE_SHADER_MODULE_COMPONENT:
+                vkDestroyShaderModule(renderer->device.handle, scene->shader_module, NULL);
+                scene->shader_module = VK_NULL_HANDLE;
+                break;
+            case GPU_SCENE_PIPELINE_COMPONENT:
+                VulkanComputePipeline_Cleanup(&renderer->device, &scene->pipeline);
+                break;
+            default:
+                ROSINA_LOG_ERROR("INVALID GPU SCENE COMPONENT");
+                assert(false);
+        }
+    }
+}
+
+GpuMesh GpuMesh_Create(const MeshBounds bounds[static 1], const MeshLod* const lods, const uint32_t lod_count, const int32_t vertex_offset)
+{
+    assert(lod_count > 0 && lod_count <= MESH_LOD_MAX_COUNT);
+
+    GpuMesh mesh = {
+        .sphere        = {{bounds->center.data[0], bounds->center.data[1], bounds->center.data[2], bounds->radius}},
+        .lod_count     = lod_count,
+        .vertex_offset = vertex_offset,
+        .padding       = {},
+        .lods          = {},
+    };
+    for (uint32_t i = 0; i < lod_count; i++)
+    {
+        mesh.lods[i] = (GpuMeshLod){.first_index = lods[i].first_index, .index_count = lods[i].index_count, .error = lods[i].error, .padding = 0};
+    }
+    return mesh;
+}
+
+/**
+ * Records the copy of size bytes of staging memory to offset in buffer.
+ *
+ * @return The staging memory, or NULL on error.
+ */
+static void* MapRange(Renderer renderer[static 1], const VkBuffer buffer, const VkDeviceSize offset, const VkDeviceSize size,
+                      const VkPipelineStageFlags dst_stage, const VkAccessFlags dst_access)
+{
+    StagingAllocation staging;
+    if (Renderer_AllocateStaging(renderer, size, 16, &staging))
+    {
+        ROSINA_LOG_ERROR("Failed to allocate staging memory");
+        return NULL;
+    }
+
+    const VkCommandBuffer command_buffer = Renderer_BeginUpload(renderer);
+    if (command_buffer == VK_NULL_HANDLE)
+    {
+        ROSINA_LOG_ERROR("Failed to begin upload");
+        return NULL;
+    }
+
+    const VkBufferCopy2 region = {
+        .sType     = VK_STRUCTURE_TYPE_BUFFER_COPY_2,
+        .pNext     = NULL,
+        .srcOffset = staging.offset,
+        .dstOffset = offset,
+        .size      = size,
+    };
+    const VkCopyBufferInfo2 copy_info = {
+        .sType       = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2,
+        .pNext       = NULL,
+        .srcBuffer   = staging.buffer,
+        .dstBuffer   = buffer,
+        .regionCount = 1,
+        .pRegions    = &region,
+    };
+    vkCmdCopyBuffer2(command_buffer, &copy_info);
+    Uploader_TransferBuffer(&renderer->uploader, buffer, offset, size, dst_stage, dst_access);
+    return staging.mapped;
+}
+
+InstanceData* GpuScene_MapInstances(Renderer renderer[static 1], GpuScene scene[static 1], const uint32_t first, const uint32_t count)
+{
+    if (count == 0 || first > scene->instance_capacity || count > scene->instance_capacity - first)
+    {
+        ROSINA_LOG_ERROR("Instances %u to %u are out of range", first, first + count);
+        return NULL;
+    }
+
+    // read by the culling shader and then as per instance vertex attributes
+    InstanceData* const instances =
+        MapRange(renderer, scene->instance_buffer, sizeof(InstanceData) * first, sizeof(InstanceData) * count,
+                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+    if (instances != NULL && first + count > scene->instance_count)
+    {
+        scene->instance_count = first + count;
+    }
+    return instances;
+}
+
+GpuMesh* GpuScene_MapMeshes(Renderer renderer[static 1], GpuScene scene[static 1], const uint32_t first, const uint32_t count)
+{
+    if (count == 0 || first > scene->mesh_capacity || count > scene->mesh_capacity - first)
+    {
+        ROSINA_LOG_ERROR("Meshes %u to %u are out of range", first, first + count);
+        return NULL;
+    }
+
+    GpuMesh* const meshes = MapRange(renderer, scene->mesh_buffer, sizeof(GpuMesh) * first, sizeof(GpuMesh) * count, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                     VK_ACCESS_SHADER_READ_BIT);
+    if (meshes != NULL && first + count > scene->mesh_count)
+    {
+        scene->mesh_count = first + count;
+    }
+    return meshes;
+}
+
+void GpuScene_Cull(const Renderer renderer[static 1], const GpuScene scene[static 1], GpuCullConstants constants[static 1])
+{
+    const VkCommandBuffer command_buffer = renderer->primary_command_buffers[renderer->frame_index];
+    const VkDeviceSize frame_offset      = scene->frame_size * renderer->frame_index;
+
+    // the last frame that used the region has finished, so only the counts need resetting
+    vkCmdFillBuffer(command_buffer, scene->draw_buffer, frame_offset, GPU_SCENE_DRAWS_OFFSET, 0);
+    const VkBufferMemoryBarrier clear_barrier = {
+        .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .pNext               = NULL,
+        .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask       = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer              = scene->draw_buffer,
+        .offset              = frame_offset,
+        .size                = GPU_SCENE_DRAWS_OFFSET,
+    };
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 1, &clear_barrier, 0, NULL);
+
+    constants->instance_count = scene->instance_count;
+    constants->draw_capacity  = scene->instance_capacity;
+
+    const uint32_t dynamic_offset = (uint32_t)frame_offset;
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, scene->pipeline.handle);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, scene->pipeline.layout, 0, 1, &scene->descriptor_set, 1, &dynamic_offset);
+    vkCmdPushConstants(command_buffer, scene->pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GpuCullConstants), constants);
+    vkCmdDispatch(command_buffer, (scene->instance_count + GPU_SCENE_WORKGROUP_SIZE - 1) / GPU_SCENE_WORKGROUP_SIZE, 1, 1);
+
+    const VkBufferMemoryBarrier draw_barrier = {
+        .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .pNext               = NULL,
+        .srcAccessMask       = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask       = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer              = scene->draw_buffer,
+        .offset              = frame_offset,
+        .size                = scene->frame_size,
+    };
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 0, NULL, 1, &draw_barrier, 0, NULL);
+}
+
+void GpuScene_Draw(const Renderer renderer[static 1], const GpuScene scene[static 1], CommandRecorder recorder[static 1], const uint32_t pipeline)
+{
+    assert(pipeline < scene->pipeline_count);
+
+    const VkDeviceSize instance_offset = 0;
+    CommandRecorder_BindVertexBuffers(recorder, INSTANCE_BINDING, 1, &scene->instance_buffer, &instance_offset);
+
+    const VkDeviceSize frame_offset = scene->frame_size * renderer->frame_index;
+    const VkDeviceSize draw_offset  = frame_offset + GPU_SCENE_DRAWS_OFFSET + (sizeof(VkDrawIndexedIndirectCommand) * scene->instance_capacity * pipeline);
+    vkCmdDrawIndexedIndirectCount(recorder->command_buffer, scene->draw_buffer, draw_offset, scene->draw_buffer, frame_offset + (sizeof(uint32_t) * pipeline),
+                                  scene->instance_capacity, sizeof(VkDrawIndexedIndirectCommand));
+}
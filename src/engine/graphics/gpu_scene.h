@@ -0,0 +1,154 @@
+#ifndef ROSINA_ENGINE_GPU_SCENE_H
+#define ROSINA_ENGINE_GPU_SCENE_H
+
+#include <engine/graphics/instancing.h>
+#include <engine/graphics/renderer.h>
+#include <utility/mesh.h>
+#include <utility/mesh_lod.h>
+
+// the local_size_x of the culling shader, shaders/cull.comp
+#define GPU_SCENE_WORKGROUP_SIZE 64
+// the pipelines instances can be drawn with, each gets its own draw count
+#define GPU_SCENE_MAX_PIPELINE_COUNT 16
+// where the draws start in the region of a frame, after the draw counts
+#define GPU_SCENE_DRAWS_OFFSET (sizeof(uint32_t) * GPU_SCENE_MAX_PIPELINE_COUNT)
+
+typedef struct GpuMeshLod
+{
+    uint32_t first_index;
+    uint32_t index_count;
+    float error;
+    uint32_t padding;
+} GpuMeshLod;
+
+/**
+ * What the culling shader knows about a mesh, laid out as std430.
+ */
+typedef struct GpuMesh
+{
+    // the bounding sphere, its center in xyz and its radius in w
+    Vec4f sphere;
+    uint32_t lod_count;
+    // added to the indices of every level, so meshes can share one vertex buffer
+    int32_t vertex_offset;
+    uint32_t padding[2];
+    GpuMeshLod lods[MESH_LOD_MAX_COUNT];
+} GpuMesh;
+
+/**
+ * The push constants of the culling shader.
+ */
+typedef struct GpuCullConstants
+{
+    // in the space of the instance models, see Mat4f_GetFrustumPlanes
+    Vec4f frustum_planes[6];
+    // the camera position in the space of the instance models in xyz, the error scale of MeshLod_GetErrorScale in w
+    Vec4f camera;
+    uint32_t instance_count;
+    // the draws each pipeline has room for
+    uint32_t draw_capacity;
+    // the pixels of error a level may project to, see MeshLod_Select
+    float threshold;
+    uint32_t padding;
+} GpuCullConstants;
+
+typedef enum GpuSceneComponent
+{
+    GPU_SCENE_INSTANCE_BUFFER_COMPONENT,
+    GPU_SCENE_MESH_BUFFER_COMPONENT,
+    GPU_SCENE_DRAW_BUFFER_COMPONENT,
+    GPU_SCENE_DESCRIPTOR_SET_LAYOUT_COMPONENT,
+    GPU_SCENE_DESCRIPTOR_POOL_COMPONENT,
+    GPU_SCENE_SHADER_MODULE_COMPONENT,
+    GPU_SCENE_PIPELINE_COMPONENT,
+    GPU_SCENE_COMPONENT_CAPACITY
+} GpuSceneComponent;
+
+/**
+ * Instances and meshes that stay in device local buffers. Every frame a compute shader culls the instances against the
+ * frustum, picks the level of detail of the ones left and appends a draw for each to the draws of its pipeline, which are
+ * then drawn with one vkCmdDrawIndexedIndirectCount per pipeline. Nothing the CPU does per frame depends on the number of
+ * instances.
+ *
+ * The draw buffer has a region per frame in flight: GPU_SCENE_MAX_PIPELINE_COUNT draw counts, then instance_capacity
+ * draws per pipeline. The instance buffer doubles as the instance vertex buffer, the draws point into it with firstInstance.
+ */
+typedef struct GpuScene
+{
+    uint32_t component_count;
+    GpuSceneComponent components[GPU_SCENE_COMPONENT_CAPACITY];
+    VkBuffer instance_buffer;
+    VulkanAllocation instance_allocation;
+    VkBuffer mesh_buffer;
+    VulkanAllocation mesh_allocation;
+    VkBuffer draw_buffer;
+    VulkanAllocation draw_allocation;
+    VkDescriptorSetLayout descriptor_set_layout;
+    VkDescriptorPool descriptor_pool;
+    VkDescriptorSet descriptor_set;
+    VkShaderModule shader_module;
+    VulkanComputePipeline pipeline;
+
+    uint32_t instance_capacity;
+    uint32_t instance_count;
+    uint32_t mesh_capacity;
+    uint32_t mesh_count;
+    uint32_t pipeline_count;
+    // the size of the region of a frame, a multiple of minStorageBufferOffsetAlignment
+    VkDeviceSize frame_size;
+} GpuScene;
+
+typedef struct GpuSceneCreateInfo
+{
+    // the compiled shaders/cull.comp
+    const char* shader_path;
+    uint32_t instance_capacity;
+    uint32_t mesh_capacity;
+    // at most GPU_SCENE_MAX_PIPELINE_COUNT
+    uint32_t pipeline_count;
+} GpuSceneCreateInfo;
+
+void GpuScene_Cleanup(const Renderer renderer[static 1], GpuScene scene[static 1]);
+
+/**
+ * Fails when the device does not support drawIndirectCount.
+ *
+ * @return The created scene. On error, the component_count field will be 0.
+ */
+GpuScene GpuScene_Create(Renderer renderer[static 1], const GpuSceneCreateInfo create_info[static 1]);
+
+/**
+ * @param bounds The bounds of the full mesh.
+ * @param lods At least one level, the first being the full mesh.
+ */
+GpuMesh GpuMesh_Create(const MeshBounds bounds[static 1], const MeshLod* const lods, const uint32_t lod_count, const int32_t vertex_offset);
+
+/**
+ * Returns staging memory for instances first to first + count - 1 that the caller fills before the frame being recorded
+ * is submitted, like VertexBufferObject_Map. Instances up to first + count are culled from then on. No frame in flight
+ * may read the instances.
+ *
+ * @return NULL on error.
+ */
+InstanceData* GpuScene_MapInstances(Renderer renderer[static 1], GpuScene scene[static 1], const uint32_t first, const uint32_t count);
+
+/**
+ * Like GpuScene_MapInstances, for meshes.
+ *
+ * @return NULL on error.
+ */
+GpuMesh* GpuScene_MapMeshes(Renderer renderer[static 1], GpuScene scene[static 1], const uint32_t first, const uint32_t count);
+
+/**
+ * Records the culling of the frame into the primary command buffer. Call between Renderer_StartFrame and
+ * Renderer_StartRenderPass. The instance_count and draw_capacity of constants are filled in.
+ */
+void GpuScene_Cull(const Renderer renderer[static 1], const GpuScene scene[static 1], GpuCullConstants constants[static 1]);
+
+/**
+ * Binds the instances and draws what the culling of the frame left of a pipeline. The pipeline, the vertex and index
+ * buffers and the descriptor sets of the graphics pipeline must already be bound.
+ */
+void GpuScene_Draw(const Renderer renderer[static 1], const GpuScene scene[static 1], CommandRecorder recorder[static 1], const uint32_t pipeline);
+
+#endif
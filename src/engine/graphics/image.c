@@ -1,30 +1,91 @@
 #include <engine/graphics/image.h>
 
+#include <utility/ktx2.h>
+#include <utility/load_file.h>
+#include <utility/pixel_convert.h>
+
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-void LoadImageIntoBuffer(const char* const path, void* const buffer, uint64_t size [static 1])
+// stb_image sources are decoded into one of these
+static VkFormat GetDecodedFormat(const char* const path)
 {
-    assert(size != NULL);
+    return stbi_is_hdr(path) || stbi_is_16_bit(path) ? VK_FORMAT_R16G16B16A16_SFLOAT : VK_FORMAT_R8G8B8A8_SRGB;
+}
 
+static void DecodeImage(const char* const path, void* const buffer, uint64_t size [static 1], const bool premultiply_alpha)
+{
     int w = 0, h = 0, d = 0;
+    if (!stbi_info(path, &w, &h, &d))
+    {
+        ROSINA_LOG_ERROR("Failed to get image image info!");
+        *size = 0;
+        return;
+    }
 
+    const VkFormat format = GetDecodedFormat(path);
+    const uint64_t pixel_count = (uint64_t)w * (uint64_t)h;
     if (buffer == NULL)
     {
-        if (!stbi_info(path, &w, &h, &d))
+        *size = Image_CalculateLevelSize(format, (uint32_t)w, (uint32_t)h);
+        return;
+    }
+
+    if (*size != Image_CalculateLevelSize(format, (uint32_t)w, (uint32_t)h))
+    {
+        ROSINA_LOG_ERROR("Size mismatch");
+        *size = 0;
+        return;
+    }
+
+    if (stbi_is_hdr(path))
+    {
+        float* const f = stbi_loadf(path, &w, &h, &d, 4);
+        if (f == NULL)
         {
-            ROSINA_LOG_ERROR("Failed to get image image info!");
+            ROSINA_LOG_ERROR("Failed to load image.");
             *size = 0;
             return;
         }
+        if (premultiply_alpha)
+        {
+            PixelConvert_PremultiplyAlphaF32(f, f, pixel_count);
+        }
+        PixelConvert_F32ToF16(buffer, f, pixel_count * 4);
+        stbi_image_free(f);
+        return;
+    }
 
-        *size = w * h * 4;  // VK_FORMAT_R8G8B8A8_SRGB == 4 bytes
+    if (stbi_is_16_bit(path))
+    {
+        // 16 bit sources are mostly data like height maps, so they are treated as linear
+        stbi_us* const s = stbi_load_16(path, &w, &h, &d, 4);
+        if (s == NULL)
+        {
+            ROSINA_LOG_ERROR("Failed to load image.");
+            *size = 0;
+            return;
+        }
+        if (premultiply_alpha)
+        {
+            PixelConvert_PremultiplyAlphaUnorm16(s, s, pixel_count);
+        }
+        PixelConvert_Unorm16ToF16(buffer, s, pixel_count * 4);
+        stbi_image_free(s);
         return;
     }
 
-    unsigned char* b = stbi_load(path, &w, &h, &d, 4);
+    // stb expands RGB to RGBA one byte at a time, so RGB images are loaded as they are and expanded here
+    const int channels = d == 3 ? 3 : 4;
+    unsigned char* b = stbi_load(path, &w, &h, &d, channels);
     if (b == NULL)
     {
         ROSINA_LOG_ERROR("Failed to load image.");
@@ -32,16 +93,249 @@ void LoadImageIntoBuffer(const char* const path, void* const buffer, uint64_t si
         return;
     }
 
-    if (*size != w * h * 4)
+    if (channels == 3)
+    {
+        // opaque, so premultiplying would not change anything
+        PixelConvert_Rgb8ToRgba8(buffer, b, pixel_count);
+    }
+    else if (premultiply_alpha)
+    {
+        PixelConvert_PremultiplyAlpha(buffer, b, pixel_count, true);
+    }
+    else
+    {
+        memcpy(buffer, b, *size);
+    }
+    stbi_image_free(b);
+}
+
+static void LoadKtx2Levels(const char* const path, const uint32_t first_level, void* const buffer, uint64_t size [static 1])
+{
+    Ktx2Info info;
+    if (Ktx2File_ReadInfo(path, &info))
+    {
+        ROSINA_LOG_ERROR("Failed to read KTX2 header of %s", path);
+        *size = 0;
+        return;
+    }
+
+    if (buffer == NULL)
+    {
+        *size = Ktx2Info_CalculatePayloadSize(&info, first_level);
+        return;
+    }
+
+    if (*size != Ktx2Info_CalculatePayloadSize(&info, first_level))
     {
         ROSINA_LOG_ERROR("Size mismatch");
         *size = 0;
-        stbi_image_free(b);
         return;
     }
 
-    memcpy(buffer, b, *size);
-    stbi_image_free(b);
+    if (Ktx2File_ReadPayload(path, &info, first_level, buffer))
+    {
+        ROSINA_LOG_ERROR("Failed to read KTX2 levels of %s", path);
+        *size = 0;
+    }
+}
+
+void LoadImageIntoBuffer(const char* const path, void* const buffer, uint64_t size [static 1])
+{
+    assert(size != NULL);
+
+    if (Ktx2File_Is(path))
+    {
+        LoadKtx2Levels(path, 0, buffer, size);
+        return;
+    }
+
+    DecodeImage(path, buffer, size, false);
+}
+
+// the formats BoxFilterLevel can filter
+static inline bool IsCpuFilterable(const VkFormat format)
+{
+    return format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R16G16B16A16_SFLOAT;
+}
+
+static void DecodeRow(float* const dest, const uint8_t* const source, const uint32_t width, const VkFormat format)
+{
+    if (format == VK_FORMAT_R16G16B16A16_SFLOAT)
+    {
+        PixelConvert_F16ToF32(dest, (const uint16_t*)source, (uint64_t)width * 4);
+        return;
+    }
+    PixelConvert_Rgba8ToRgba32f(dest, source, width, format == VK_FORMAT_R8G8B8A8_SRGB);
+}
+
+static void EncodeRow(uint8_t* const dest, const float* const source, const uint32_t width, const VkFormat format)
+{
+    if (format == VK_FORMAT_R16G16B16A16_SFLOAT)
+    {
+        PixelConvert_F32ToF16((uint16_t*)dest, source, (uint64_t)width * 4);
+        return;
+    }
+    PixelConvert_Rgba32fToRgba8(dest, source, width, format == VK_FORMAT_R8G8B8A8_SRGB);
+}
+
+/**
+ * 2x2 box filter of one level into the next. Color is averaged in linear space for sRGB formats, odd edges are clamped.
+ *
+ * @return true on error.
+ */
+static bool BoxFilterLevel(const uint8_t* const source, const uint32_t source_width, const uint32_t source_height, uint8_t* const dest, const VkFormat format)
+{
+    assert(IsCpuFilterable(format));
+    const uint32_t width = source_width > 1 ? source_width / 2 : 1;
+    const uint32_t height = source_height > 1 ? source_height / 2 : 1;
+    const uint64_t source_row_size = Image_CalculateLevelSize(format, source_width, 1);
+    const uint64_t row_size = Image_CalculateLevelSize(format, width, 1);
+
+    // two decoded source rows and one filtered row
+    float* const rows = malloc(sizeof(float) * 4 * (((size_t)source_width * 2) + width));
+    if (rows == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate rows to filter a %ux%u level", source_width, source_height);
+        return true;
+    }
+    float* const row0 = rows;
+    float* const row1 = rows + ((size_t)source_width * 4);
+    float* const filtered = rows + ((size_t)source_width * 8);
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const uint32_t y0 = y * 2 < source_height ? y * 2 : source_height - 1;
+        const uint32_t y1 = (y * 2) + 1 < source_height ? (y * 2) + 1 : y0;
+        DecodeRow(row0, source + (y0 * source_row_size), source_width, format);
+        DecodeRow(row1, source + (y1 * source_row_size), source_width, format);
+
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const uint32_t x0 = x * 2 < source_width ? x * 2 : source_width - 1;
+            const uint32_t x1 = (x * 2) + 1 < source_width ? (x * 2) + 1 : x0;
+#if defined(__SSE2__)
+            __m128 sum = _mm_add_ps(_mm_loadu_ps(row0 + (x0 * 4)), _mm_loadu_ps(row0 + (x1 * 4)));
+            sum = _mm_add_ps(sum, _mm_add_ps(_mm_loadu_ps(row1 + (x0 * 4)), _mm_loadu_ps(row1 + (x1 * 4))));
+            _mm_storeu_ps(filtered + (x * 4), _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                filtered[(x * 4) + c] = (row0[(x0 * 4) + c] + row0[(x1 * 4) + c] + row1[(x0 * 4) + c] + row1[(x1 * 4) + c]) * 0.25f;
+            }
+#endif
+        }
+
+        EncodeRow(dest + (y * row_size), filtered, width, format);
+    }
+
+    free(rows);
+    return false;
+}
+
+static bool DecodeStagingData(const Image image [static 1], const char* const path, void* const data)
+{
+    if (Ktx2File_Is(path))
+    {
+        uint64_t size = Image_CalculateSize(image);
+        LoadKtx2Levels(path, image->source_base_mip_level, data, &size);
+        return size == 0;
+    }
+
+    if (image->mip_generation != IMAGE_MIP_GENERATION_CPU)
+    {
+        uint64_t size = Image_CalculateSize(image);
+        DecodeImage(path, data, &size, image->premultiplied_alpha);
+        return size == 0;
+    }
+
+    // decode level 0 into the end of the buffer, then filter each level into the space in front of it
+    const uint64_t size = Image_CalculateSize(image);
+    uint64_t level_size = Image_CalculateLevelSize(image->format, image->width, image->height);
+    uint8_t* level = (uint8_t*)data + size - level_size;
+    DecodeImage(path, level, &level_size, image->premultiplied_alpha);
+    if (level_size == 0)
+    {
+        return true;
+    }
+
+    for (uint32_t i = 1; i < image->mip_levels; i++)
+    {
+        const uint32_t width = image->width >> (i - 1) > 0 ? image->width >> (i - 1) : 1;
+        const uint32_t height = image->height >> (i - 1) > 0 ? image->height >> (i - 1) : 1;
+        const uint32_t next_width = width > 1 ? width / 2 : 1;
+        const uint32_t next_height = height > 1 ? height / 2 : 1;
+
+        uint8_t* const next_level = level - Image_CalculateLevelSize(image->format, next_width, next_height);
+        if (BoxFilterLevel(level, width, height, next_level, image->format))
+        {
+            return true;
+        }
+        level = next_level;
+    }
+
+    return false;
+}
+
+bool Image_LoadStagingData(const Image image [static 1], const char* const path, AssetCache* const cache, void* const data)
+{
+    // KTX2 levels are copied straight from the file, there is nothing to save by caching them
+    if (cache == NULL || Ktx2File_Is(path))
+    {
+        return DecodeStagingData(image, path, data);
+    }
+
+    uint64_t key = 0;
+    {
+        size_t source_size = 0;
+        if (LoadFile(NULL, &source_size, path))
+        {
+            ROSINA_LOG_ERROR("Failed to read %s", path);
+            return true;
+        }
+        void* const source = malloc(source_size);
+        if (source == NULL || LoadFile(source, &source_size, path))
+        {
+            ROSINA_LOG_ERROR("Failed to read %s", path);
+            free(source);
+            return true;
+        }
+
+        const struct {
+            VkFormat format;
+            uint32_t width;
+            uint32_t height;
+            uint32_t mip_levels;
+            ImageMipGeneration mip_generation;
+            uint32_t premultiplied_alpha;
+        } parameters = {image->format, image->width, image->height, image->mip_levels, image->mip_generation, image->premultiplied_alpha};
+        key = AssetCache_ComputeKey(source, source_size, &parameters, sizeof(parameters));
+        free(source);
+    }
+
+    const uint64_t size = Image_CalculateSize(image);
+    AssetCacheEntry entry;
+    if (!AssetCache_Load(cache, key, &entry))
+    {
+        const bool matches = entry.size == size;
+        if (matches)
+        {
+            memcpy(data, entry.data, size);
+        }
+        AssetCacheEntry_Release(&entry);
+        if (matches)
+        {
+            return false;
+        }
+    }
+
+    if (DecodeStagingData(image, path, data))
+    {
+        return true;
+    }
+
+    // a failed store only costs the next run a decode
+    AssetCache_Store(cache, key, data, size);
+    return false;
 }
 
 void Image_Cleanup(Renderer renderer[static 1], Image image [static 1])
@@ -50,10 +344,7 @@ void Image_Cleanup(Renderer renderer[static 1], Image image [static 1])
     image->sampler = VK_NULL_HANDLE;
     vkDestroyImageView(renderer->device.handle, image->view, NULL);
     image->view = VK_NULL_HANDLE;
-    vkDestroyBuffer(renderer->device.handle, image->buffer, NULL);
-    image->buffer = VK_NULL_HANDLE;
-    vkFreeMemory(renderer->device.handle, image->memory, NULL);
-    image->memory = VK_NULL_HANDLE;
+    VulkanAllocator_Free(renderer->allocator, &image->allocation);
     vkDestroyImage(renderer->device.handle, image->handle, NULL);
     image->handle = VK_NULL_HANDLE;
 }
@@ -62,14 +353,48 @@ Image Image_Create(Renderer renderer[static 1], const ImageCreateInfo create_inf
 {
     Image image = {
         .handle = VK_NULL_HANDLE,
-        .memory = VK_NULL_HANDLE,
+        .allocation = {.memory = VK_NULL_HANDLE},
         .view = VK_NULL_HANDLE,
         .sampler = VK_NULL_HANDLE,
         .format = VK_FORMAT_UNDEFINED,
         .width = 0,
         .height = 0,
+        .mip_levels = 0,
+        .mip_generation = IMAGE_MIP_GENERATION_NONE,
+        .premultiplied_alpha = false,
+        .source_base_mip_level = 0,
     };
 
+    if (Ktx2File_Is(create_info->path))
+    {
+        // KTX2 files are already in their GPU format, so the levels are copied as they are.
+        Ktx2Info info;
+        if (Ktx2File_ReadInfo(create_info->path, &info))
+        {
+            ROSINA_LOG_ERROR("Failed to load image!");
+            return image;
+        }
+        // the levels above base_mip_level are left out, level 0 of the image is base_mip_level of the file
+        const uint32_t base = create_info->base_mip_level < info.level_count ? create_info->base_mip_level : info.level_count - 1;
+        image.format = (VkFormat)info.vk_format;
+        image.width = info.width >> base > 0 ? info.width >> base : 1;
+        image.height = info.height >> base > 0 ? info.height >> base : 1;
+        image.mip_levels = info.level_count - base;
+        image.source_base_mip_level = base;
+
+        for (uint32_t i = 0; i < image.mip_levels; i++)
+        {
+            const uint32_t width = image.width >> i > 0 ? image.width >> i : 1;
+            const uint32_t height = image.height >> i > 0 ? image.height >> i : 1;
+            const uint64_t level_size = Image_CalculateLevelSize(image.format, width, height);
+            if (level_size == 0 || level_size != info.levels[base + i].byte_length)
+            {
+                ROSINA_LOG_ERROR("Unexpected size of level %u in %s", i, create_info->path);
+                return image;
+            }
+        }
+    }
+    else
     {
         int h;
         int w;
@@ -81,10 +406,43 @@ Image Image_Create(Renderer renderer[static 1], const ImageCreateInfo create_inf
         }
         image.width = (uint32_t)w;
         image.height = (uint32_t)h;
+
+        image.format = GetDecodedFormat(create_info->path);
+        image.premultiplied_alpha = create_info->premultiply_alpha;
+
+        // full chain down to 1x1
+        image.mip_levels = 1;
+        while (image.mip_levels < IMAGE_MAX_MIP_LEVELS && (image.width >> image.mip_levels > 0 || image.height >> image.mip_levels > 0))
+        {
+            image.mip_levels++;
+        }
+        image.mip_generation = IMAGE_MIP_GENERATION_BLIT;
     }
 
-    // TODO: find a way to determine this?
-    image.format = VK_FORMAT_R8G8B8A8_SRGB;
+    {
+        VkFormatProperties format_properties;
+        vkGetPhysicalDeviceFormatProperties(renderer->device.physical_device, image.format, &format_properties);
+        if ((format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0)
+        {
+            ROSINA_LOG_ERROR("Image format %d of %s can not be sampled on this device", image.format, create_info->path);
+            return image;
+        }
+
+        const VkFormatFeatureFlags blit_features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        if (image.mip_generation == IMAGE_MIP_GENERATION_BLIT && (format_properties.optimalTilingFeatures & blit_features) != blit_features)
+        {
+            if (IsCpuFilterable(image.format))
+            {
+                image.mip_generation = IMAGE_MIP_GENERATION_CPU;
+            }
+            else
+            {
+                ROSINA_LOG_WARNING("Image format %d of %s can not be blitted or filtered on the CPU, it gets no mips", image.format, create_info->path);
+                image.mip_generation = IMAGE_MIP_GENERATION_NONE;
+                image.mip_levels = 1;
+            }
+        }
+    }
 
     // create image
     {
@@ -93,13 +451,13 @@ Image Image_Create(Renderer renderer[static 1], const ImageCreateInfo create_inf
             .pNext = NULL,
             .flags = 0,
             .imageType = VK_IMAGE_TYPE_2D,
-            .format = VK_FORMAT_R8G8B8A8_SRGB,
+            .format = image.format,
             .extent = {.width = image.width, .height = image.height, .depth = 1},
-            .mipLevels = 1,
+            .mipLevels = image.mip_levels,
             .arrayLayers = 1,
             .samples = VK_SAMPLE_COUNT_1_BIT,
             .tiling = VK_IMAGE_TILING_OPTIMAL,
-            .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            .usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
             .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
             .queueFamilyIndexCount = 0,
             .pQueueFamilyIndices = NULL,
@@ -111,86 +469,12 @@ Image Image_Create(Renderer renderer[static 1], const ImageCreateInfo create_inf
         });
     }
 
-    // allocate memory
-    {
-        VkMemoryRequirements reqs;
-        vkGetImageMemoryRequirements(renderer->device.handle, image.handle, &reqs);
-
-        const VkMemoryAllocateInfo alloc_info = {
-            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .pNext = NULL,
-            .allocationSize = reqs.size,
-            .memoryTypeIndex = FindMemoryType(renderer->device.physical_device, reqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-        };
-        VK_ERROR_HANDLE(vkAllocateMemory(renderer->device.handle, &alloc_info, NULL, &image.memory), {
-            vkDestroyImage(renderer->device.handle, image.handle, NULL);
-            image.handle = VK_NULL_HANDLE;
-            return image;
-        });
-    }
-
-    // create buffer
+    // allocate and bind memory
+    if (VulkanAllocator_AllocateImage(renderer->allocator, image.handle, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, VULKAN_MEMORY_CATEGORY_TEXTURE, &image.allocation))
     {
-        const  VkBufferCreateInfo buffer_create_info = {
-            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-            .pNext = NULL,
-            .flags = 0,
-            .size = Image_CalculateSize(&image),
-            .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-            .queueFamilyIndexCount = 0,
-            .pQueueFamilyIndices = NULL
-        };
-        VK_ERROR_HANDLE(vkCreateBuffer(renderer->device.handle, &buffer_create_info, NULL, &image.buffer), {
-            vkFreeMemory(renderer->device.handle, image.memory, NULL);
-            image.memory = VK_NULL_HANDLE;
-            vkDestroyImage(renderer->device.handle, image.handle, NULL);
-            image.handle = VK_NULL_HANDLE;
-            return image;
-        });
-    }
-
-    // bind image to memory
-    {
-        VkBindImageMemoryInfo bind_infos [] = {
-            {
-                .sType = VK_STRUCTURE_TYPE_BIND_IMAGE_MEMORY_INFO,
-                .pNext = NULL,
-                .image = image.handle,
-                .memory = image.memory,
-                .memoryOffset = 0
-            }};
-        VK_ERROR_HANDLE(vkBindImageMemory2(renderer->device.handle, sizeof(bind_infos)/ sizeof(VkBindImageMemoryInfo), bind_infos), {
-            vkDestroyBuffer(renderer->device.handle, image.buffer, NULL);
-            image.buffer = VK_NULL_HANDLE;
-            vkFreeMemory(renderer->device.handle, image.memory, NULL);
-            image.memory = VK_NULL_HANDLE;
-            vkDestroyImage(renderer->device.handle, image.handle, NULL);
-            image.handle = VK_NULL_HANDLE;
-            return image;
-        });
-    }
-
-    // bind buffer to memory
-    {
-        {
-            const VkBindBufferMemoryInfo bind_infos [] = {{
-                .sType = VK_STRUCTURE_TYPE_BIND_BUFFER_MEMORY_INFO,
-                .pNext = NULL,
-                .buffer = image.buffer,
-                .memory = image.memory,
-                .memoryOffset = 0
-            }};
-            VK_ERROR_HANDLE(vkBindBufferMemory2(renderer->device.handle, sizeof(bind_infos) / sizeof(VkBindBufferMemoryInfo), bind_infos), {
-                vkDestroyBuffer(renderer->device.handle, image.buffer, NULL);
-                image.buffer = VK_NULL_HANDLE;
-                vkFreeMemory(renderer->device.handle, image.memory, NULL);
-                image.memory = VK_NULL_HANDLE;
-                vkDestroyImage(renderer->device.handle, image.handle, NULL);
-                image.handle = VK_NULL_HANDLE;
-                return image;
-            });
-        }
+        vkDestroyImage(renderer->device.handle, image.handle, NULL);
+        image.handle = VK_NULL_HANDLE;
+        return image;
     }
 
     {
@@ -200,7 +484,7 @@ Image Image_Create(Renderer renderer[static 1], const ImageCreateInfo create_inf
             .flags = 0,
             .image = image.handle,
             .viewType = VK_IMAGE_VIEW_TYPE_2D,
-            .format = VK_FORMAT_R8G8B8A8_SRGB,
+            .format = image.format,
             .components = {
                 .r = VK_COMPONENT_SWIZZLE_R,
                 .g = VK_COMPONENT_SWIZZLE_G,
@@ -210,17 +494,14 @@ Image Image_Create(Renderer renderer[static 1], const ImageCreateInfo create_inf
             .subresourceRange = {
                 .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
                 .baseMipLevel = 0,
-                .levelCount = 1,
+                .levelCount = image.mip_levels,
                 .baseArrayLayer = 0,
                 .layerCount = 1,
             }
         };
 
         VK_ERROR_HANDLE(vkCreateImageView(renderer->device.handle, &image_view_create_info, NULL, &image.view), {
-            vkDestroyBuffer(renderer->device.handle, image.buffer, NULL);
-            image.buffer = VK_NULL_HANDLE;
-            vkFreeMemory(renderer->device.handle, image.memory, NULL);
-            image.memory = VK_NULL_HANDLE;
+            VulkanAllocator_Free(renderer->allocator, &image.allocation);
             vkDestroyImage(renderer->device.handle, image.handle, NULL);
             image.handle = VK_NULL_HANDLE;
         });
@@ -246,17 +527,14 @@ Image Image_Create(Renderer renderer[static 1], const ImageCreateInfo create_inf
             .compareEnable = VK_FALSE,
             .compareOp = VK_COMPARE_OP_ALWAYS,
             .minLod = 0.0f,
-            .maxLod = 0.0f,
+            .maxLod = (float)(image.mip_levels - 1),
             .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
             .unnormalizedCoordinates = VK_FALSE,
         };
         VK_ERROR_HANDLE(vkCreateSampler(renderer->device.handle, &sampler_create_info, NULL, &image.sampler), {
             vkDestroyImageView(renderer->device.handle, image.view, NULL);
             image.view = VK_NULL_HANDLE;
-            vkDestroyBuffer(renderer->device.handle, image.buffer, NULL);
-            image.buffer = VK_NULL_HANDLE;
-            vkFreeMemory(renderer->device.handle, image.memory, NULL);
-            image.memory = VK_NULL_HANDLE;
+            VulkanAllocator_Free(renderer->allocator, &image.allocation);
             vkDestroyImage(renderer->device.handle, image.handle, NULL);
             image.handle = VK_NULL_HANDLE;
         });
@@ -265,7 +543,7 @@ Image Image_Create(Renderer renderer[static 1], const ImageCreateInfo create_inf
     return image;
 }
 
-void Image_TransitionLayout(Renderer renderer[static 1], const Image image [static 1], const VkFormat format, const VkImageLayout old_layout, const VkImageLayout new_layout)
+static void RecordTransition(const VkCommandBuffer command_buffer, const Image image [static 1], const VkImageLayout old_layout, const VkImageLayout new_layout, const uint32_t base_mip_level, const uint32_t level_count)
 {
     VkImageMemoryBarrier barrier = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
@@ -279,8 +557,8 @@ void Image_TransitionLayout(Renderer renderer[static 1], const Image image [stat
         .image = image->handle,
         .subresourceRange = {
             .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .baseMipLevel = 0,
-            .levelCount = 1,
+            .baseMipLevel = base_mip_level,
+            .levelCount = level_count,
             .baseArrayLayer = 0,
             .layerCount = 1
         }
@@ -299,6 +577,26 @@ void Image_TransitionLayout(Renderer renderer[static 1], const Image image [stat
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
+        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    } else if (old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && new_layout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+        // the level was just written and the next blit reads it
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    } else if (old_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && new_layout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+        // frames submitted before may still be sampling it
+        barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        sourceStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    } else if (old_layout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL && new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
         sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
     } else {
@@ -307,11 +605,262 @@ void Image_TransitionLayout(Renderer renderer[static 1], const Image image [stat
     }
 
     vkCmdPipelineBarrier(
-        renderer->primary_command_buffers[renderer->frame_index],
+        command_buffer,
         sourceStage, destinationStage,
         0,
         0, NULL,
         0, NULL  ,
         1, &barrier
     );
-}
\ No newline at end of file
+}
+
+void Image_TransitionLayout(Renderer renderer[static 1], const Image image [static 1], const VkImageLayout old_layout, const VkImageLayout new_layout, const uint32_t base_mip_level, const uint32_t level_count)
+{
+    RecordTransition(renderer->primary_command_buffers[renderer->frame_index], image, old_layout, new_layout, base_mip_level, level_count);
+}
+
+/**
+ * Copies the largest copy_level_count levels from the staging buffer into the image and leaves all of its levels in
+ * VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL.
+ */
+static void RecordCopy(const VkCommandBuffer command_buffer, const Image image [static 1], const uint32_t copy_level_count, const VkBuffer buffer,
+                       const VkDeviceSize offset)
+{
+    VkBufferImageCopy2 regions[IMAGE_MAX_MIP_LEVELS];
+    assert(image->mip_levels <= IMAGE_MAX_MIP_LEVELS);
+    assert(copy_level_count <= image->mip_levels);
+
+    // levels are packed smallest first, so the offset of a level is the size of every level below it
+    VkDeviceSize level_offset = offset;
+    for (uint32_t i = copy_level_count; i-- > 0;)
+    {
+        const uint32_t width = image->width >> i > 0 ? image->width >> i : 1;
+        const uint32_t height = image->height >> i > 0 ? image->height >> i : 1;
+        regions[i] = (VkBufferImageCopy2){
+            .sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2,
+            .pNext = NULL,
+            .bufferOffset = level_offset,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = i,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .imageOffset = {0, 0, 0},
+            .imageExtent = {width, height, 1},
+        };
+        level_offset += Image_CalculateLevelSize(image->format, width, height);
+    }
+
+    RecordTransition(command_buffer, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, image->mip_levels);
+    if (copy_level_count == 0)
+    {
+        return;
+    }
+    const VkCopyBufferToImageInfo2 copy_info = {
+        .sType = VK_STRUCTURE_TYPE_COPY_BUFFER_TO_IMAGE_INFO_2,
+        .pNext = NULL,
+        .srcBuffer = buffer,
+        .dstImage = image->handle,
+        .dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .regionCount = copy_level_count,
+        .pRegions = regions
+    };
+    vkCmdCopyBufferToImage2(command_buffer, &copy_info);
+}
+
+/**
+ * Blits the levels that were not copied and moves every level to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL. Needs a
+ * graphics queue.
+ */
+static void RecordFinish(const VkCommandBuffer command_buffer, const Image image [static 1])
+{
+    if (image->mip_generation != IMAGE_MIP_GENERATION_BLIT)
+    {
+        RecordTransition(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, image->mip_levels);
+        return;
+    }
+
+    // each level is read once by the blit into the next one and can be handed to the shader right after
+    for (uint32_t i = 1; i < image->mip_levels; i++)
+    {
+        const int32_t src_width = image->width >> (i - 1) > 0 ? (int32_t)(image->width >> (i - 1)) : 1;
+        const int32_t src_height = image->height >> (i - 1) > 0 ? (int32_t)(image->height >> (i - 1)) : 1;
+        const int32_t dst_width = src_width > 1 ? src_width / 2 : 1;
+        const int32_t dst_height = src_height > 1 ? src_height / 2 : 1;
+
+        RecordTransition(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, i - 1, 1);
+
+        const VkImageBlit2 blit_regions[] = {{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_BLIT_2,
+            .pNext = NULL,
+            .srcSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = i - 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .srcOffsets = {{0, 0, 0}, {src_width, src_height, 1}},
+            .dstSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = i,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .dstOffsets = {{0, 0, 0}, {dst_width, dst_height, 1}},
+        }};
+        const VkBlitImageInfo2 blit_info = {
+            .sType = VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2,
+            .pNext = NULL,
+            .srcImage = image->handle,
+            .srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .dstImage = image->handle,
+            .dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .regionCount = sizeof(blit_regions) / sizeof(VkImageBlit2),
+            .pRegions = blit_regions,
+            .filter = VK_FILTER_LINEAR,
+        };
+        vkCmdBlitImage2(command_buffer, &blit_info);
+
+        RecordTransition(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, i - 1, 1);
+    }
+    RecordTransition(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, image->mip_levels - 1, 1);
+}
+
+static inline uint32_t GetStagedLevelCount(const Image image [static 1])
+{
+    return image->mip_generation == IMAGE_MIP_GENERATION_BLIT ? 1 : image->mip_levels;
+}
+
+void Image_RecordUpload(const VkCommandBuffer command_buffer, const Image image [static 1], const VkBuffer buffer, const VkDeviceSize offset)
+{
+    RecordCopy(command_buffer, image, GetStagedLevelCount(image), buffer, offset);
+    RecordFinish(command_buffer, image);
+}
+
+bool Image_Upload(Renderer renderer [static 1], const Image image [static 1], const VkBuffer buffer, const VkDeviceSize offset)
+{
+    const VkCommandBuffer command_buffer = Renderer_BeginUpload(renderer);
+    if (command_buffer == VK_NULL_HANDLE)
+    {
+        return true;
+    }
+
+    RecordCopy(command_buffer, image, GetStagedLevelCount(image), buffer, offset);
+
+    const VkImageSubresourceRange range = {
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .baseMipLevel = 0,
+        .levelCount = image->mip_levels,
+        .baseArrayLayer = 0,
+        .layerCount = 1
+    };
+    Uploader_TransferImage(&renderer->uploader, image->handle, &range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    // blits need a graphics queue, so the rest happens there
+    RecordFinish(renderer->uploader.graphics_command_buffers[renderer->uploader.frame_index], image);
+    return false;
+}
+
+bool Image_LoadStagingLevels(const Image image [static 1], const char* const path, const uint32_t level_count, void* const data)
+{
+    Ktx2Info info;
+    if (!Ktx2File_Is(path) || Ktx2File_ReadInfo(path, &info))
+    {
+        ROSINA_LOG_ERROR("Failed to read KTX2 header of %s", path);
+        return true;
+    }
+    if (Ktx2Info_CalculateLevelsSize(&info, image->source_base_mip_level, level_count) != Image_CalculateLevelsSize(image, level_count))
+    {
+        ROSINA_LOG_ERROR("Size mismatch");
+        return true;
+    }
+    if (Ktx2File_ReadLevels(path, &info, image->source_base_mip_level, level_count, data))
+    {
+        ROSINA_LOG_ERROR("Failed to read KTX2 levels of %s", path);
+        return true;
+    }
+    return false;
+}
+
+bool Image_UploadFrom(Renderer renderer [static 1], const Image image [static 1], const uint32_t level_count, const VkBuffer buffer, const VkDeviceSize offset,
+                      const Image source [static 1])
+{
+    assert(image->mip_generation == IMAGE_MIP_GENERATION_NONE && source->format == image->format);
+    assert(level_count <= image->mip_levels);
+
+    // level level_count of the image is this level of source, and both end with the smallest level of the file
+    const uint32_t copied_count = image->mip_levels - level_count;
+    const uint32_t source_level = image->source_base_mip_level + level_count - source->source_base_mip_level;
+    assert(image->source_base_mip_level + level_count >= source->source_base_mip_level);
+    assert(copied_count == 0 || source_level + copied_count == source->mip_levels);
+
+    const VkCommandBuffer command_buffer = Renderer_BeginUpload(renderer);
+    if (command_buffer == VK_NULL_HANDLE)
+    {
+        return true;
+    }
+
+    RecordCopy(command_buffer, image, level_count, buffer, offset);
+
+    const VkImageSubresourceRange range = {
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .baseMipLevel = 0,
+        .levelCount = image->mip_levels,
+        .baseArrayLayer = 0,
+        .layerCount = 1
+    };
+    Uploader_TransferImage(&renderer->uploader, image->handle, &range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    // source belongs to the graphics queue, so the copy out of it happens there
+    const VkCommandBuffer graphics_command_buffer = renderer->uploader.graphics_command_buffers[renderer->uploader.frame_index];
+    if (copied_count > 0)
+    {
+        VkImageCopy2 regions[IMAGE_MAX_MIP_LEVELS];
+        for (uint32_t i = 0; i < copied_count; i++)
+        {
+            const uint32_t level  = level_count + i;
+            const uint32_t width  = image->width >> level > 0 ? image->width >> level : 1;
+            const uint32_t height = image->height >> level > 0 ? image->height >> level : 1;
+            regions[i] = (VkImageCopy2){
+                .sType = VK_STRUCTURE_TYPE_IMAGE_COPY_2,
+                .pNext = NULL,
+                .srcSubresource = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel = source_level + i,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                },
+                .srcOffset = {0, 0, 0},
+                .dstSubresource = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel = level,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                },
+                .dstOffset = {0, 0, 0},
+                .extent = {width, height, 1},
+            };
+        }
+
+        RecordTransition(graphics_command_buffer, source, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, source_level, copied_count);
+        const VkCopyImageInfo2 copy_info = {
+            .sType = VK_STRUCTURE_TYPE_COPY_IMAGE_INFO_2,
+            .pNext = NULL,
+            .srcImage = source->handle,
+            .srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .dstImage = image->handle,
+            .dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .regionCount = copied_count,
+            .pRegions = regions,
+        };
+        vkCmdCopyImage2(graphics_command_buffer, &copy_info);
+        RecordTransition(graphics_command_buffer, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, source_level, copied_count);
+    }
+    RecordTransition(graphics_command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, image->mip_levels);
+    return false;
+}
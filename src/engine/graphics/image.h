@@ -2,8 +2,10 @@
 #define IMAGE_H
 
 #include <engine/graphics/renderer.h>
+#include <utility/asset_cache.h>
 
 /**
+ * KTX2 files are read without decoding, with every mip level packed smallest first. Other images are decoded by stb_image into RGBA8.
  *
  * @param path The path of the image.
  * @param buffer The buffer that the image contents will be loaded into. If NULL, only the size will be set.
@@ -12,39 +14,160 @@
  */
 void LoadImageIntoBuffer(const char* const path, void* const buffer, uint64_t size [static 1]);
 
+#define IMAGE_MAX_MIP_LEVELS 16
+// buffer offsets of image copies must be a multiple of the texel block size, which is at most 16 bytes for the formats used
+#define IMAGE_STAGING_ALIGNMENT 16
+
+typedef enum ImageMipGeneration
+{
+    // every level comes from the source file
+    IMAGE_MIP_GENERATION_NONE,
+    // level 0 is uploaded and the rest are blitted from it on the GPU
+    IMAGE_MIP_GENERATION_BLIT,
+    // the format can not be blitted with a linear filter, so the chain is box filtered on the CPU and uploaded. Only
+    // RGBA8 and RGBA16F, the formats stb_image sources are decoded into, can be filtered this way
+    IMAGE_MIP_GENERATION_CPU,
+} ImageMipGeneration;
+
 typedef struct Image
 {
     VkImage handle;
     VkImageView view;
-    VkDeviceMemory memory;
-    VkBuffer buffer;
+    VulkanAllocation allocation;
     VkSampler sampler;
     VkFormat format;
     uint32_t width;
     uint32_t height;
+    uint32_t mip_levels;
+    ImageMipGeneration mip_generation;
+    bool premultiplied_alpha;
+    // the level of the source file that is level 0 of the image
+    uint32_t source_base_mip_level;
 } Image;
 
 void Image_Cleanup(Renderer renderer[static 1], Image image [static 1]);
 
-static inline uint64_t Image_CalculateSize(const Image image [static 1])
+static inline uint64_t Image_CalculateLevelSize(const VkFormat format, const uint32_t width, const uint32_t height)
 {
-    const uint64_t size = (uint64_t)image->width * (uint64_t)image->height;
-    switch (image->format)
+    const uint64_t size   = (uint64_t)width * (uint64_t)height;
+    const uint64_t blocks = (uint64_t)((width + 3) / 4) * (uint64_t)((height + 3) / 4);
+    switch (format)
     {
-        case VK_FORMAT_R8G8B8A8_SRGB: return size * 4;
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_R8G8B8A8_UNORM: return size * 4;
+        case VK_FORMAT_R16G16B16A16_SFLOAT: return size * 8;
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: return blocks * 8;
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK: return blocks * 16;
         default:
             ROSINA_LOG_ERROR("Invalid image format");
         return 0;
     }
 }
 
+/**
+ * @return The number of bytes Image_RecordUpload reads from the staging buffer.
+ */
+static inline uint64_t Image_CalculateSize(const Image image [static 1])
+{
+    const uint32_t level_count = image->mip_generation == IMAGE_MIP_GENERATION_BLIT ? 1 : image->mip_levels;
+
+    uint64_t size = 0;
+    for (uint32_t i = 0; i < level_count; i++)
+    {
+        const uint32_t width  = image->width >> i > 0 ? image->width >> i : 1;
+        const uint32_t height = image->height >> i > 0 ? image->height >> i : 1;
+        size += Image_CalculateLevelSize(image->format, width, height);
+    }
+    return size;
+}
+
 typedef struct ImageCreateInfo
 {
     const char* path;
+    // multiply color by alpha while loading. Ignored for KTX2 files, which are uploaded as baked.
+    bool premultiply_alpha;
+    // skip the largest levels of a KTX2 file. Ignored for other files.
+    uint32_t base_mip_level;
 } ImageCreateInfo;
 
 Image Image_Create(Renderer renderer[static 1], const ImageCreateInfo create_info [static 1]);
 
-void Image_TransitionLayout(Renderer renderer[static 1], const Image image [static 1], const VkFormat format, const VkImageLayout old_layout, const VkImageLayout new_layout);
+/**
+ * @param base_mip_level The first mip level to transition.
+ * @param level_count The number of mip levels to transition, or VK_REMAINING_MIP_LEVELS.
+ */
+void Image_TransitionLayout(Renderer renderer[static 1], const Image image [static 1], const VkImageLayout old_layout, const VkImageLayout new_layout, const uint32_t base_mip_level, const uint32_t level_count);
+
+/**
+ * Writes what Image_RecordUpload expects to find in the staging buffer: every level packed smallest first, or only
+ * level 0 when the rest of the chain is blitted.
+ *
+ * @param image The image the contents are for.
+ * @param path The path the image was created from.
+ * @param cache Where decoded images are kept between runs. May be NULL.
+ * @param data Destination of Image_CalculateSize(image) bytes.
+ * @return true on error.
+ */
+bool Image_LoadStagingData(const Image image [static 1], const char* const path, AssetCache* const cache, void* const data);
+
+/**
+ * Records the copy of the staged levels into the image, blits the remaining levels if needed and leaves the whole
+ * image in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+ *
+ * @param command_buffer A command buffer in the recording state.
+ * @param image The image to upload to.
+ * @param buffer A buffer holding the contents written by Image_LoadStagingData.
+ * @param offset The offset of those contents in buffer.
+ */
+void Image_RecordUpload(const VkCommandBuffer command_buffer, const Image image [static 1], const VkBuffer buffer, const VkDeviceSize offset);
+
+/**
+ * Uploads like Image_RecordUpload, with the copy recorded on the renderer's transfer queue through Renderer_BeginUpload.
+ * The image can be sampled by the frame being recorded.
+ *
+ * @return true on error.
+ */
+bool Image_Upload(Renderer renderer [static 1], const Image image [static 1], const VkBuffer buffer, const VkDeviceSize offset);
+
+/**
+ * @return The number of bytes of the largest level_count levels of image.
+ */
+static inline uint64_t Image_CalculateLevelsSize(const Image image [static 1], const uint32_t level_count)
+{
+    uint64_t size = 0;
+    for (uint32_t i = 0; i < level_count && i < image->mip_levels; i++)
+    {
+        const uint32_t width  = image->width >> i > 0 ? image->width >> i : 1;
+        const uint32_t height = image->height >> i > 0 ? image->height >> i : 1;
+        size += Image_CalculateLevelSize(image->format, width, height);
+    }
+    return size;
+}
+
+/**
+ * Writes what Image_UploadFrom expects to find in the staging buffer: the largest level_count levels of a KTX2 image,
+ * packed smallest first.
+ *
+ * @param data Destination of Image_CalculateLevelsSize(image, level_count) bytes.
+ * @return true on error.
+ */
+bool Image_LoadStagingLevels(const Image image [static 1], const char* const path, const uint32_t level_count, void* const data);
+
+/**
+ * Uploads an image made from the same KTX2 file as source, like Image_Upload, but only its largest level_count levels
+ * come from the staging buffer. The others are held by source and copied from it on the graphics queue, so changing
+ * which levels of a file are resident only reads the levels that were not. source has to be in
+ * VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL and stays there, and has to stay alive until the frame being recorded has
+ * finished.
+ *
+ * @param level_count The number of levels staged by Image_LoadStagingLevels. May be 0.
+ * @return true on error.
+ */
+bool Image_UploadFrom(Renderer renderer [static 1], const Image image [static 1], const uint32_t level_count, const VkBuffer buffer, const VkDeviceSize offset,
+                      const Image source [static 1]);
 
 #endif
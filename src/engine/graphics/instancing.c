@@ -0,0 +1,114 @@
+#include <engine/graphics/instancing.h>
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include <utility/log.h>
+
+_Static_assert(sizeof(InstanceData) % 16 == 0, "instances must stay 16 byte aligned");
+
+InstanceBatcher InstanceBatcher_Create(const uint32_t capacity)
+{
+    InstanceBatcher batcher = {
+        .capacity     = capacity,
+        .object_count = 0,
+        .objects      = malloc(sizeof(InstanceObject) * (capacity > 0 ? capacity : 1)),
+        .group_count  = 0,
+        .groups       = malloc(sizeof(InstanceGroup) * (capacity > 0 ? capacity : 1)),
+    };
+    if (batcher.objects == NULL || batcher.groups == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate instance batcher of %u objects", capacity);
+        InstanceBatcher_Cleanup(&batcher);
+    }
+    return batcher;
+}
+
+void InstanceBatcher_Cleanup(InstanceBatcher batcher[static 1])
+{
+    free(batcher->objects);
+    free(batcher->groups);
+    batcher->objects      = NULL;
+    batcher->groups       = NULL;
+    batcher->capacity     = 0;
+    batcher->object_count = 0;
+    batcher->group_count  = 0;
+}
+
+bool InstanceBatcher_Add(InstanceBatcher batcher[static 1], const uint32_t mesh, const uint32_t pipeline, const Mat4f model[static 1],
+                         const uint32_t material_index)
+{
+    if (batcher->object_count >= batcher->capacity)
+    {
+        return true;
+    }
+
+    batcher->objects[batcher->object_count] = (InstanceObject){
+        .key            = ((uint64_t)pipeline << 32) | mesh,
+        .order          = batcher->object_count,
+        .material_index = material_index,
+        .model          = *model,
+    };
+    batcher->object_count++;
+    return false;
+}
+
+static int CompareObjects(const void* const a, const void* const b)
+{
+    const InstanceObject* const object_a = a;
+    const InstanceObject* const object_b = b;
+    if (object_a->key != object_b->key)
+    {
+        return object_a->key < object_b->key ? -1 : 1;
+    }
+    return (object_a->order > object_b->order) - (object_a->order < object_b->order);
+}
+
+uint32_t InstanceBatcher_Build(InstanceBatcher batcher[static 1], InstanceData* const dest)
+{
+    qsort(batcher->objects, batcher->object_count, sizeof(InstanceObject), CompareObjects);
+
+    batcher->group_count = 0;
+    for (uint32_t i = 0; i < batcher->object_count; i++)
+    {
+        const InstanceObject* const object = &batcher->objects[i];
+        if (i == 0 || object->key != batcher->objects[i - 1].key)
+        {
+            batcher->groups[batcher->group_count++] = (InstanceGroup){
+                .mesh           = (uint32_t)object->key,
+                .pipeline       = (uint32_t)(object->key >> 32),
+                .first_instance = i,
+                .instance_count = 0,
+            };
+        }
+        batcher->groups[batcher->group_count - 1].instance_count++;
+
+        dest[i] = (InstanceData){
+            .model          = object->model,
+            .material_index = object->material_index,
+            .mesh           = (uint32_t)object->key,
+            .pipeline       = (uint32_t)(object->key >> 32),
+            .padding        = 0,
+        };
+    }
+    return batcher->group_count;
+}
+
+void Instancing_GetVkVertexInputAttributeDescriptions(VkVertexInputAttributeDescription dest[static INSTANCE_ATTRIBUTE_COUNT])
+{
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        dest[i] = (VkVertexInputAttributeDescription){
+            .location = INSTANCE_MODEL_LOCATION + i,
+            .binding  = INSTANCE_BINDING,
+            .format   = VK_FORMAT_R32G32B32A32_SFLOAT,
+            .offset   = (uint32_t)(offsetof(InstanceData, model) + (sizeof(Vec4f) * i)),
+        };
+    }
+    dest[4] = (VkVertexInputAttributeDescription){
+        .location = INSTANCE_MATERIAL_LOCATION,
+        .binding  = INSTANCE_BINDING,
+        .format   = VK_FORMAT_R32_UINT,
+        .offset   = (uint32_t)offsetof(InstanceData, material_index),
+    };
+}
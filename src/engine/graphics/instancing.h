@@ -0,0 +1,117 @@
+#ifndef ROSINA_ENGINE_INSTANCING_H
+#define ROSINA_ENGINE_INSTANCING_H
+
+#include <engine/graphics/renderer.h>
+#include <engine/graphics/vertex_format.h>
+#include <utility/math.h>
+
+// the vertex buffer binding instance data is read from, the vertices being binding 0
+#define INSTANCE_BINDING 1
+// the shader locations of the columns of the model matrix, then of the material index, after the vertex attributes
+#define INSTANCE_MODEL_LOCATION VERTEX_ATTRIBUTE_COUNT
+#define INSTANCE_MATERIAL_LOCATION (INSTANCE_MODEL_LOCATION + 4)
+#define INSTANCE_ATTRIBUTE_COUNT 5
+
+/**
+ * What the vertex shader reads per instance, one after another in a vertex buffer bound at INSTANCE_BINDING. The mesh
+ * and pipeline are only read by the culling shader of a GpuScene.
+ */
+typedef struct InstanceData
+{
+    Mat4f model;
+    uint32_t material_index;
+    uint32_t mesh;
+    uint32_t pipeline;
+    uint32_t padding;
+} InstanceData;
+
+/**
+ * Objects drawn with the same mesh and pipeline, whose instance data is contiguous.
+ */
+typedef struct InstanceGroup
+{
+    uint32_t mesh;
+    uint32_t pipeline;
+    // relative to the start of the instance data written by InstanceBatcher_Build
+    uint32_t first_instance;
+    uint32_t instance_count;
+} InstanceGroup;
+
+typedef struct InstanceObject
+{
+    uint64_t key;
+    // the order objects were added in, so groups come out the same every frame
+    uint32_t order;
+    uint32_t material_index;
+    Mat4f model;
+} InstanceObject;
+
+/**
+ * Collects the objects of a frame and sorts them into one group per mesh and pipeline, so each group is one instanced
+ * draw. The mesh and pipeline are whatever indices the caller gives them.
+ */
+typedef struct InstanceBatcher
+{
+    uint32_t capacity;
+    uint32_t object_count;
+    InstanceObject* objects;
+    uint32_t group_count;
+    InstanceGroup* groups;
+} InstanceBatcher;
+
+/**
+ * @param capacity The most objects a frame can add.
+ * @return The created batcher. On error, the objects field will be NULL.
+ */
+InstanceBatcher InstanceBatcher_Create(const uint32_t capacity);
+
+void InstanceBatcher_Cleanup(InstanceBatcher batcher[static 1]);
+
+static inline void InstanceBatcher_Clear(InstanceBatcher batcher[static 1])
+{
+    batcher->object_count = 0;
+    batcher->group_count  = 0;
+}
+
+/**
+ * @return true when the batcher is full.
+ */
+bool InstanceBatcher_Add(InstanceBatcher batcher[static 1], const uint32_t mesh, const uint32_t pipeline, const Mat4f model[static 1],
+                         const uint32_t material_index);
+
+/**
+ * Groups the objects added since the last clear, ordered by pipeline then mesh, and writes their instance data group
+ * after group into dest.
+ *
+ * @param dest Room for batcher->object_count instances.
+ * @return The number of groups, in batcher->groups.
+ */
+uint32_t InstanceBatcher_Build(InstanceBatcher batcher[static 1], InstanceData* const dest);
+
+static inline VkVertexInputBindingDescription Instancing_GetVkVertexInputBindingDescription(void)
+{
+    return (VkVertexInputBindingDescription){.binding = INSTANCE_BINDING, .stride = sizeof(InstanceData), .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE};
+}
+
+void Instancing_GetVkVertexInputAttributeDescriptions(VkVertexInputAttributeDescription dest[static INSTANCE_ATTRIBUTE_COUNT]);
+
+/**
+ * Allocates instance data for the frame being recorded from the uniform ring, so it is written once and never copied.
+ *
+ * @return true when it does not fit in what is left of RENDERER_UNIFORM_RING_FRAME_SIZE.
+ */
+static inline bool Instancing_Allocate(Renderer renderer[static 1], const uint32_t instance_count, UniformAllocation allocation[static 1])
+{
+    return UniformRing_Allocate(&renderer->uniform_ring, sizeof(InstanceData) * instance_count, allocation);
+}
+
+/**
+ * @param offset The offset of an allocation returned by Instancing_Allocate.
+ */
+static inline void Instancing_Bind(const Renderer renderer[static 1], CommandRecorder recorder[static 1], const uint32_t offset)
+{
+    const VkDeviceSize buffer_offset = offset;
+    CommandRecorder_BindVertexBuffers(recorder, INSTANCE_BINDING, 1, &renderer->uniform_ring.buffer, &buffer_offset);
+}
+
+#endif
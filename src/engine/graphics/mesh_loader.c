@@ -0,0 +1,77 @@
+#include <engine/graphics/mesh_loader.h>
+
+bool MeshLoader_ReadInfo(const char* const path, MeshFileInfo info[static 1], VertexFormat vertex_format[static 1], VkIndexType index_type[static 1])
+{
+    if (MeshFile_ReadInfo(path, info))
+    {
+        return true;
+    }
+
+    VertexEncoding encodings[VERTEX_ATTRIBUTE_COUNT];
+    for (uint32_t i = 0; i < VERTEX_ATTRIBUTE_COUNT; i++)
+    {
+        if (info->vertex_encodings[i] >= VERTEX_ENCODING_COUNT)
+        {
+            ROSINA_LOG_ERROR("\"%s\": unknown vertex encoding (%u)", path, info->vertex_encodings[i]);
+            return true;
+        }
+        encodings[i] = (VertexEncoding)info->vertex_encodings[i];
+    }
+
+    *vertex_format = VertexFormat_Create(encodings);
+    if (vertex_format->stride != info->vertex_stride)
+    {
+        ROSINA_LOG_ERROR("\"%s\": vertex stride %u does not match its encodings", path, info->vertex_stride);
+        return true;
+    }
+    *index_type = info->index_size == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    return false;
+}
+
+bool MeshLoader_Upload(Renderer renderer[static 1], BufferMemory memory[static 1], const char* const path, const MeshFileInfo info[static 1],
+                       VertexBufferObject vbo[static 1], IndexBufferObject ibo[static 1])
+{
+    *vbo = VertexBufferObject_Create(info->vertex_data_size, memory);
+    *ibo = IndexBufferObject_Create((VkDeviceSize)info->index_size * info->index_count, memory);
+    if (vbo->offset == UINT64_MAX || ibo->offset == UINT64_MAX)
+    {
+        ROSINA_LOG_ERROR("Out of buffer memory for \"%s\"", path);
+        VertexBufferObject_Cleanup(memory, vbo);
+        IndexBufferObject_Cleanup(memory, ibo);
+        return true;
+    }
+
+    // writes that go straight into the buffers record nothing, so the objects can be freed if a read fails
+    if (memory->direct_writes && memory->vertex_mapped != NULL && memory->index_mapped != NULL)
+    {
+        void* const vertices = VertexBufferObject_Map(renderer, memory, vbo);
+        void* const indices  = vertices == NULL ? NULL : IndexBufferObject_Map(renderer, memory, ibo);
+        if (indices == NULL || MeshFile_ReadVertices(path, info, vertices) || MeshFile_ReadIndices(path, info, indices))
+        {
+            ROSINA_LOG_ERROR("Failed to upload \"%s\"", path);
+            VertexBufferObject_Cleanup(memory, vbo);
+            IndexBufferObject_Cleanup(memory, ibo);
+            return true;
+        }
+        return false;
+    }
+
+    // otherwise the streams are read into staging first and the copies are only recorded once both reads succeeded, as
+    // a recorded copy would still write into the objects after they are freed and handed out again
+    StagingAllocation vertex_staging;
+    StagingAllocation index_staging;
+    if (Renderer_AllocateStaging(renderer, vbo->size, 16, &vertex_staging) || Renderer_AllocateStaging(renderer, ibo->size, 16, &index_staging) ||
+        MeshFile_ReadVertices(path, info, vertex_staging.mapped) || MeshFile_ReadIndices(path, info, index_staging.mapped) ||
+        Renderer_BeginUpload(renderer) == VK_NULL_HANDLE)
+    {
+        ROSINA_LOG_ERROR("Failed to upload \"%s\"", path);
+        VertexBufferObject_Cleanup(memory, vbo);
+        IndexBufferObject_Cleanup(memory, ibo);
+        return true;
+    }
+
+    // the upload has begun, so recording the copies cannot fail
+    VertexBufferObject_CopyStaging(renderer, memory, vbo, &vertex_staging);
+    IndexBufferObject_CopyStaging(renderer, memory, ibo, &index_staging);
+    return false;
+}
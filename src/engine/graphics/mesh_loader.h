@@ -0,0 +1,27 @@
+#ifndef ROSINA_ENGINE_MESH_LOADER_H
+#define ROSINA_ENGINE_MESH_LOADER_H
+
+#include <engine/graphics/buffer.h>
+#include <engine/graphics/vertex_format.h>
+#include <utility/mesh_file.h>
+
+/**
+ * Reads the header of a mesh file written by mesh_baker and the layout of its streams.
+ *
+ * @param vertex_format Set to the format the vertices are encoded with.
+ * @param index_type Set to the type of the indices.
+ * @return true on error, or when the file's vertex encodings are not a valid VertexFormat.
+ */
+bool MeshLoader_ReadInfo(const char* const path, MeshFileInfo info[static 1], VertexFormat vertex_format[static 1], VkIndexType index_type[static 1]);
+
+/**
+ * Creates the buffer objects of a mesh file and reads its streams straight into the memory returned by
+ * VertexBufferObject_Map and IndexBufferObject_Map, without parsing or an intermediate copy.
+ *
+ * @param info The info returned by MeshLoader_ReadInfo.
+ * @return true on error.
+ */
+bool MeshLoader_Upload(Renderer renderer[static 1], BufferMemory memory[static 1], const char* const path, const MeshFileInfo info[static 1],
+                       VertexBufferObject vbo[static 1], IndexBufferObject ibo[static 1]);
+
+#endif
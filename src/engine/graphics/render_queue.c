@@ -0,0 +1,129 @@
+#include <engine/graphics/render_queue.h>
+
+#include <assert.h>
+#include <string.h>
+
+#include <utility/log.h>
+#include <utility/radix_sort.h>
+
+_Static_assert(RENDER_QUEUE_PASS_BITS + RENDER_QUEUE_PIPELINE_BITS + RENDER_QUEUE_MATERIAL_BITS + RENDER_QUEUE_MESH_BITS + RENDER_QUEUE_DEPTH_BITS == 64,
+               "the fields must fill a key");
+
+RenderQueue RenderQueue_Create(const uint32_t capacity)
+{
+    const uint32_t room = capacity > 0 ? capacity : 1;
+
+    // the 8 byte arrays first, so everything after them stays aligned
+    RenderQueue queue = {
+        .arena    = MemoryArena_Create((sizeof(uint64_t) * 2 + sizeof(uint32_t) * 2 + sizeof(RenderQueueDraw)) * (uint64_t)room),
+        .capacity = capacity,
+        .count    = 0,
+    };
+    if (queue.arena.memory == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate render queue of %u draws", capacity);
+        return queue;
+    }
+    queue.keys          = MemoryArena_Allocate(&queue.arena, sizeof(uint64_t) * room);
+    queue.key_scratch   = MemoryArena_Allocate(&queue.arena, sizeof(uint64_t) * room);
+    queue.indices       = MemoryArena_Allocate(&queue.arena, sizeof(uint32_t) * room);
+    queue.index_scratch = MemoryArena_Allocate(&queue.arena, sizeof(uint32_t) * room);
+    queue.draws         = MemoryArena_Allocate(&queue.arena, sizeof(RenderQueueDraw) * room);
+    return queue;
+}
+
+void RenderQueue_Cleanup(RenderQueue queue[static 1])
+{
+    MemoryArena_Free(&queue->arena);
+    queue->keys          = NULL;
+    queue->indices       = NULL;
+    queue->key_scratch   = NULL;
+    queue->index_scratch = NULL;
+    queue->draws         = NULL;
+    queue->capacity      = 0;
+    queue->count         = 0;
+}
+
+/**
+ * The top bits of a non negative float, whose bit patterns are in the same order as the floats themselves.
+ */
+static inline uint64_t QuantizeDepth(const float depth)
+{
+    if (!(depth > 0.0f))
+    {
+        return 0;
+    }
+
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    return bits >> (31 - RENDER_QUEUE_DEPTH_BITS);
+}
+
+uint64_t RenderQueue_MakeKey(const uint32_t pass, const bool transparent, const RenderQueueDraw draw[static 1], const float depth)
+{
+    assert(pass < RENDER_QUEUE_MAX_PASS_COUNT);
+    assert(draw->pipeline < RENDER_QUEUE_MAX_PIPELINE_COUNT);
+    assert(draw->material < RENDER_QUEUE_MAX_MATERIAL_COUNT);
+    assert(draw->mesh < RENDER_QUEUE_MAX_MESH_COUNT);
+
+    const uint64_t state = ((uint64_t)draw->pipeline << (RENDER_QUEUE_MATERIAL_BITS + RENDER_QUEUE_MESH_BITS)) |
+                           ((uint64_t)draw->material << RENDER_QUEUE_MESH_BITS) | draw->mesh;
+    const uint64_t key = (uint64_t)pass << (64 - RENDER_QUEUE_PASS_BITS);
+    if (transparent)
+    {
+        // back to front, with the state only breaking ties
+        const uint64_t far_first = ((1ull << RENDER_QUEUE_DEPTH_BITS) - 1) - QuantizeDepth(depth);
+        return key | (far_first << (64 - RENDER_QUEUE_PASS_BITS - RENDER_QUEUE_DEPTH_BITS)) | state;
+    }
+    return key | (state << RENDER_QUEUE_DEPTH_BITS) | QuantizeDepth(depth);
+}
+
+bool RenderQueue_Add(RenderQueue queue[static 1], const uint64_t key, const RenderQueueDraw draw[static 1])
+{
+    if (queue->count >= queue->capacity)
+    {
+        return true;
+    }
+
+    queue->keys[queue->count]    = key;
+    queue->indices[queue->count] = queue->count;
+    queue->draws[queue->count]   = *draw;
+    queue->count++;
+    return false;
+}
+
+void RenderQueue_Sort(RenderQueue queue[static 1], WorkerPool* const workers)
+{
+    RadixSort64(queue->keys, queue->indices, queue->key_scratch, queue->index_scratch, queue->count, workers);
+}
+
+void RenderQueue_Record(const RenderQueue queue[static 1], CommandRecorder recorder[static 1], const uint32_t first, const uint32_t draw_count,
+                        const RenderQueueBindings bindings[static 1])
+{
+    assert(first + draw_count <= queue->count);
+
+    uint32_t pipeline = UINT32_MAX;
+    uint32_t material = UINT32_MAX;
+    uint32_t mesh     = UINT32_MAX;
+    for (uint32_t i = first; i < first + draw_count; i++)
+    {
+        const RenderQueueDraw* const draw = &queue->draws[queue->indices[i]];
+        if (draw->pipeline != pipeline)
+        {
+            bindings->bind_pipeline(recorder, draw->pipeline, bindings->user_data);
+            pipeline = draw->pipeline;
+            material = UINT32_MAX;
+        }
+        if (draw->material != material)
+        {
+            bindings->bind_material(recorder, draw->pipeline, draw->material, bindings->user_data);
+            material = draw->material;
+        }
+        if (draw->mesh != mesh)
+        {
+            bindings->bind_mesh(recorder, draw->mesh, bindings->user_data);
+            mesh = draw->mesh;
+        }
+        vkCmdDrawIndexed(recorder->command_buffer, draw->index_count, draw->instance_count, draw->first_index, draw->vertex_offset, draw->first_instance);
+    }
+}
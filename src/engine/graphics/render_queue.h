@@ -0,0 +1,105 @@
+#ifndef ROSINA_ENGINE_RENDER_QUEUE_H
+#define ROSINA_ENGINE_RENDER_QUEUE_H
+
+#include <engine/graphics/command_recorder.h>
+#include <utility/memory_arena.h>
+#include <utility/worker_pool.h>
+
+// the bits of each field of a sort key, from the most significant
+#define RENDER_QUEUE_PASS_BITS 4
+#define RENDER_QUEUE_PIPELINE_BITS 10
+#define RENDER_QUEUE_MATERIAL_BITS 14
+#define RENDER_QUEUE_MESH_BITS 16
+#define RENDER_QUEUE_DEPTH_BITS 20
+
+#define RENDER_QUEUE_MAX_PASS_COUNT (1u << RENDER_QUEUE_PASS_BITS)
+#define RENDER_QUEUE_MAX_PIPELINE_COUNT (1u << RENDER_QUEUE_PIPELINE_BITS)
+#define RENDER_QUEUE_MAX_MATERIAL_COUNT (1u << RENDER_QUEUE_MATERIAL_BITS)
+#define RENDER_QUEUE_MAX_MESH_COUNT (1u << RENDER_QUEUE_MESH_BITS)
+
+/**
+ * A draw and the state it needs. The pipeline, material and mesh are whatever indices the caller gives them, bound by
+ * the functions of RenderQueueBindings.
+ */
+typedef struct RenderQueueDraw
+{
+    uint32_t pipeline;
+    uint32_t material;
+    uint32_t mesh;
+    uint32_t index_count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t vertex_offset;
+    uint32_t first_instance;
+} RenderQueueDraw;
+
+/**
+ * Called by RenderQueue_Record when the next draw needs other state than the one before it. A new pipeline is always
+ * followed by its material, since the descriptor sets may have been disturbed.
+ */
+typedef struct RenderQueueBindings
+{
+    void (*bind_pipeline)(CommandRecorder recorder[static 1], const uint32_t pipeline, void* const user_data);
+    void (*bind_material)(CommandRecorder recorder[static 1], const uint32_t pipeline, const uint32_t material, void* const user_data);
+    void (*bind_mesh)(CommandRecorder recorder[static 1], const uint32_t mesh, void* const user_data);
+    void* user_data;
+} RenderQueueBindings;
+
+/**
+ * The draws of a frame, each with a 64 bit key that orders them by pass, then pipeline, material and mesh, and then
+ * front to back. In transparent passes the depth comes right after the pass and orders them back to front instead. The
+ * draws themselves stay where they were added, only the keys and the indices of the draws are sorted.
+ */
+typedef struct RenderQueue
+{
+    // holds every array below
+    MemoryArena arena;
+    uint32_t capacity;
+    uint32_t count;
+    uint64_t* keys;
+    uint32_t* indices;
+    uint64_t* key_scratch;
+    uint32_t* index_scratch;
+    RenderQueueDraw* draws;
+} RenderQueue;
+
+/**
+ * @param capacity The most draws a frame can add.
+ * @return The created queue. On error, the keys field will be NULL.
+ */
+RenderQueue RenderQueue_Create(const uint32_t capacity);
+
+void RenderQueue_Cleanup(RenderQueue queue[static 1]);
+
+static inline void RenderQueue_Clear(RenderQueue queue[static 1])
+{
+    queue->count = 0;
+}
+
+/**
+ * @param pass Passes are drawn in increasing order, at most RENDER_QUEUE_MAX_PASS_COUNT.
+ * @param transparent Whether the draws of the pass blend, which the whole pass must agree on.
+ * @param depth The distance from the camera to the draw, anything below 0 counting as 0.
+ */
+uint64_t RenderQueue_MakeKey(const uint32_t pass, const bool transparent, const RenderQueueDraw draw[static 1], const float depth);
+
+/**
+ * @return true when the queue is full.
+ */
+bool RenderQueue_Add(RenderQueue queue[static 1], const uint64_t key, const RenderQueueDraw draw[static 1]);
+
+/**
+ * Sorts the draws added since the last clear by their keys.
+ *
+ * @param workers NULL to sort on the calling thread.
+ */
+void RenderQueue_Sort(RenderQueue queue[static 1], WorkerPool* const workers);
+
+/**
+ * Records sorted draws first to first + draw_count - 1, binding only the state that differs from the draw before.
+ * The first draw binds all of it. Can be called from several threads at once for different ranges.
+ */
+void RenderQueue_Record(const RenderQueue queue[static 1], CommandRecorder recorder[static 1], const uint32_t first, const uint32_t draw_count,
+                        const RenderQueueBindings bindings[static 1]);
+
+#endif
@@ -23,6 +23,10 @@ void Renderer_Cleanup(Renderer renderer[static 1])
             case RENDERER_DEVICE_COMPONENT:
                 VulkanDevice_Cleanup(&renderer->device);
                 break;
+            case RENDERER_PIPELINE_CACHE_COMPONENT:
+                VulkanPipelineCache_Save(&renderer->device, renderer->pipeline_cache, RENDERER_PIPELINE_CACHE_FILE);
+                VulkanPipelineCache_Cleanup(&renderer->device, &renderer->pipeline_cache);
+                break;
             case RENDERER_RENDER_PASS_COMPONENT:
                 VulkanRenderPass_Cleanup(&renderer->device, &renderer->render_pass);
                 break;
@@ -32,6 +36,25 @@ void Renderer_Cleanup(Renderer renderer[static 1])
             case RENDERER_MEMORY_COMPONENT:
                 MemoryArena_Free(&renderer->memory);
                 break;
+            case RENDERER_STAGING_RING_COMPONENT:
+                StagingRing_Cleanup(&renderer->staging_ring);
+                break;
+            case RENDERER_UNIFORM_RING_COMPONENT:
+                UniformRing_Cleanup(&renderer->uniform_ring);
+                break;
+            case RENDERER_UPLOADER_COMPONENT:
+                Uploader_Cleanup(&renderer->uploader);
+                break;
+            case RENDERER_ALLOCATOR_COMPONENT:
+                VulkanAllocator_LogStats(renderer->allocator);
+                VulkanAllocator_LogBudget(renderer->allocator);
+                VulkanAllocator_Cleanup(renderer->allocator);
+                renderer->allocator = NULL;
+                break;
+            case RENDERER_MEMORY_REPORT_COMPONENT:
+                fclose(renderer->memory_report);
+                renderer->memory_report = NULL;
+                break;
             case RENDERER_SWAPCHAIN_IMAGES_COMPONENT:
                 for (uint32_t i = 0; i < renderer->image_count; i++)
                 {
@@ -46,8 +69,10 @@ void Renderer_Cleanup(Renderer renderer[static 1])
                 }
                 break;
             case RENDERER_DEPTH_IMAGES_MEMORY_COMPONENT:
-                vkFreeMemory(renderer->device.handle, renderer->depth_images_memory, NULL);
-                renderer->depth_images_memory = VK_NULL_HANDLE;
+                for (uint32_t i = 0; i < renderer->image_count; i++)
+                {
+                    VulkanAllocator_Free(renderer->allocator, &renderer->depth_image_allocations[i]);
+                }
                 break;
             case RENDERER_DEPTH_IMAGE_VIEWS_COMPONENT:
                 for (uint32_t i = 0; i < renderer->image_count; i++)
@@ -101,6 +126,19 @@ void Renderer_Cleanup(Renderer renderer[static 1])
                     renderer->command_pools[i] = VK_NULL_HANDLE;
                 }
                 break;
+            case RENDERER_WORKERS_COMPONENT:
+                WorkerPool_Cleanup(&renderer->workers);
+                break;
+            case RENDERER_WORKER_COMMAND_POOLS_COMPONENT:
+                for (uint32_t i = 0; i < renderer->frame_count; i++)
+                {
+                    for (uint32_t j = 0; j < renderer->workers.worker_count; j++)
+                    {
+                        vkDestroyCommandPool(renderer->device.handle, renderer->worker_command_pools[(i * RENDERER_MAX_WORKER_COUNT) + j], NULL);
+                        renderer->worker_command_pools[(i * RENDERER_MAX_WORKER_COUNT) + j] = VK_NULL_HANDLE;
+                    }
+                }
+                break;
             default:
                 ROSINA_LOG_ERROR("Invalid renderer component value");
                 assert(false);
@@ -144,9 +182,10 @@ Renderer Renderer_Create()
     {
         // create vulkan device
         {
-            const VulkanDeviceCreateInfo device_create_info = {.queue_capabilities = QUEUE_CAPABILITY_FLAG_GRAPHICS_BIT | QUEUE_CAPABILITY_FLAG_PRESENT_BIT,
-                                                               .instance           = renderer.link.instance,
-                                                               .surface            = renderer.window.surface};
+            const VulkanDeviceCreateInfo device_create_info = {
+                .queue_capabilities = QUEUE_CAPABILITY_FLAG_GRAPHICS_BIT | QUEUE_CAPABILITY_FLAG_COMPUTE_BIT | QUEUE_CAPABILITY_FLAG_PRESENT_BIT,
+                .instance           = renderer.link.instance,
+                .surface            = renderer.window.surface};
             if (CreateVulkanDevice(&device_create_info, &renderer.device))
             {
                 ROSINA_LOG_ERROR("Failed to create VulkanDevice");
@@ -158,6 +197,17 @@ Renderer Renderer_Create()
         }
     }
 
+    // load pipeline cache
+    {
+        if (VulkanPipelineCache_Create(&renderer.device, RENDERER_PIPELINE_CACHE_FILE, &renderer.pipeline_cache))
+        {
+            ROSINA_LOG_ERROR("Failed to create pipeline cache");
+            Renderer_Cleanup(&renderer);
+            return renderer;
+        }
+        renderer.components[renderer.component_count++] = RENDERER_PIPELINE_CACHE_COMPONENT;
+    }
+
     // Create render_pass
     {
         if (VulkanRenderPass_Create(&renderer.device, renderer.window.surface, &renderer.render_pass))
@@ -208,18 +258,89 @@ Renderer Renderer_Create()
                                                               sizeof(VkCommandPool) +    // renderer.command_pools
                                                               sizeof(VkCommandBuffer) +  // renderer.main_buffers
                                                               sizeof(VkSemaphore) +      // renderer.render_finished
-                                                              sizeof(VkFence)            // renderer.in_flight
+                                                              sizeof(VkFence) +          // renderer.in_flight
+                                                              (RENDERER_MAX_WORKER_COUNT * sizeof(VkCommandPool)) +  // renderer.worker_command_pools
+                                                              (RENDERER_MAX_WORKER_COUNT * RENDERER_MAX_SECONDARY_COMMAND_BUFFERS *
+                                                               sizeof(VkCommandBuffer))  // renderer.secondary_command_buffers
+                                                              )) +
+                                  (renderer.image_capacity * (sizeof(VkImage) +           // renderer.swapchain_images
+                                                              sizeof(VkImage) +           // renderer.depth_images
+                                                              sizeof(VulkanAllocation) +  // renderer.depth_image_allocations
+                                                              sizeof(VkImageView) +       // renderer.swapchain_image_views
+                                                              sizeof(VkImageView) +       // renderer.depth_image_views
+                                                              sizeof(VkFramebuffer)       // renderer.framebuffers
                                                               )) +
-                                  (renderer.image_capacity * (sizeof(VkImage) +      // renderer.swapchain_images
-                                                              sizeof(VkImage) +      // renderer.depth_images
-                                                              sizeof(VkImageView) +  // renderer.swapchain_image_views
-                                                              sizeof(VkImageView) +  // renderer.depth_image_views
-                                                              sizeof(VkFramebuffer)  // renderer.framebuffers
-                                                              ));
+                                  sizeof(VulkanAllocator);  // renderer.allocator
         renderer.memory                                 = MemoryArena_Create(required_bytes);
         renderer.components[renderer.component_count++] = RENDERER_MEMORY_COMPONENT;
     }
 
+    // create allocator
+    {
+        renderer.allocator = MemoryArena_Allocate(&renderer.memory, sizeof(VulkanAllocator));
+        if (VulkanAllocator_Create(&renderer.device, renderer.allocator))
+        {
+            Renderer_Cleanup(&renderer);
+            return renderer;
+        }
+        renderer.components[renderer.component_count++] = RENDERER_ALLOCATOR_COMPONENT;
+    }
+
+    // open memory report
+    {
+        const char* const path = getenv(RENDERER_MEMORY_REPORT_VARIABLE);
+        if (path != NULL)
+        {
+            renderer.memory_report = fopen(path, "w");
+            if (renderer.memory_report == NULL)
+            {
+                ROSINA_LOG_ERROR("Could not open memory report %s", path);
+            }
+            else
+            {
+                VulkanAllocator_WriteCsvHeader(renderer.allocator, renderer.memory_report);
+                renderer.components[renderer.component_count++] = RENDERER_MEMORY_REPORT_COMPONENT;
+            }
+        }
+    }
+
+    // create staging ring
+    {
+        renderer.staging_ring = StagingRing_Create(renderer.allocator, RENDERER_STAGING_RING_SIZE);
+        if (renderer.staging_ring.buffer == VK_NULL_HANDLE)
+        {
+            ROSINA_LOG_ERROR("Failed to create staging ring");
+            Renderer_Cleanup(&renderer);
+            return renderer;
+        }
+        renderer.components[renderer.component_count++] = RENDERER_STAGING_RING_COMPONENT;
+    }
+
+    // create uniform ring
+    {
+        renderer.uniform_ring =
+            UniformRing_Create(renderer.allocator, renderer.device.physical_device, RENDERER_UNIFORM_RING_FRAME_SIZE, renderer.frame_capacity);
+        if (renderer.uniform_ring.buffer == VK_NULL_HANDLE)
+        {
+            ROSINA_LOG_ERROR("Failed to create uniform ring");
+            Renderer_Cleanup(&renderer);
+            return renderer;
+        }
+        renderer.components[renderer.component_count++] = RENDERER_UNIFORM_RING_COMPONENT;
+    }
+
+    // create uploader
+    {
+        renderer.uploader = Uploader_Create(&renderer.device, renderer.frame_capacity);
+        if (renderer.uploader.component_count == 0)
+        {
+            ROSINA_LOG_ERROR("Failed to create uploader");
+            Renderer_Cleanup(&renderer);
+            return renderer;
+        }
+        renderer.components[renderer.component_count++] = RENDERER_UPLOADER_COMPONENT;
+    }
+
     // get swapchain images
     {
         renderer.swapchain_images = MemoryArena_Allocate(&renderer.memory, renderer.image_capacity * sizeof(VkImage));
@@ -282,40 +403,20 @@ Renderer Renderer_Create()
 
     // allocate memory for depth images
     {
-        renderer.depth_images_memory = VK_NULL_HANDLE;
+        renderer.depth_image_allocations = MemoryArena_Allocate(&renderer.memory, renderer.image_capacity * sizeof(VulkanAllocation));
 
-        VkDeviceSize depth_images_memory_size = 0;
-        uint32_t depth_image_memory_type_bits = 0;
         for (uint32_t i = 0; i < renderer.image_count; i++)
         {
-            VkMemoryRequirements memory_requirements;
-            vkGetImageMemoryRequirements(renderer.device.handle, renderer.depth_images[i], &memory_requirements);
-            depth_images_memory_size += memory_requirements.size;
-            depth_image_memory_type_bits |= memory_requirements.memoryTypeBits;
-        }
-
-        const VkMemoryAllocateInfo alloc_info = {
-            .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .allocationSize  = depth_images_memory_size,
-            .memoryTypeIndex = FindMemoryType(renderer.device.physical_device, depth_image_memory_type_bits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)};
-
-        VK_ERROR_HANDLE(vkAllocateMemory(renderer.device.handle, &alloc_info, NULL, &renderer.depth_images_memory), {
-            Renderer_Cleanup(&renderer);
-            return renderer;
-        });
-
-        depth_images_memory_size = 0;
-        for (uint32_t i = 0; i < renderer.image_count; i++)
-        {
-            VkMemoryRequirements memory_requirements;
-            vkGetImageMemoryRequirements(renderer.device.handle, renderer.depth_images[i], &memory_requirements);
-
-            VK_ERROR_HANDLE(vkBindImageMemory(renderer.device.handle, renderer.depth_images[i], renderer.depth_images_memory, depth_images_memory_size), {
-                vkFreeMemory(renderer.device.handle, renderer.depth_images_memory, NULL);
-                renderer.depth_images_memory = VK_NULL_HANDLE;
+            if (VulkanAllocator_AllocateImage(renderer.allocator, renderer.depth_images[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+                                              VULKAN_MEMORY_CATEGORY_ATTACHMENT, &renderer.depth_image_allocations[i]))
+            {
+                for (uint32_t j = 0; j < i; j++)
+                {
+                    VulkanAllocator_Free(renderer.allocator, &renderer.depth_image_allocations[j]);
+                }
                 Renderer_Cleanup(&renderer);
                 return renderer;
-            });
+            }
         }
 
         renderer.components[renderer.component_count++] = RENDERER_DEPTH_IMAGES_MEMORY_COMPONENT;
@@ -486,7 +587,7 @@ Renderer Renderer_Create()
 
         const VkCommandPoolCreateInfo pool_create_info = {.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
                                                           .pNext            = NULL,
-                                                          .flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                                                          .flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
                                                           .queueFamilyIndex = renderer.device.graphics_queue.family_index};
         for (uint32_t i = 0; i < renderer.frame_count; i++)
         {
@@ -525,5 +626,61 @@ Renderer Renderer_Create()
         }
     }
 
+    // workers
+    {
+        const uint32_t processor_count = WorkerPool_GetProcessorCount();
+        renderer.workers = WorkerPool_Create(processor_count < RENDERER_MAX_WORKER_COUNT ? processor_count : RENDERER_MAX_WORKER_COUNT);
+        renderer.components[renderer.component_count++] = RENDERER_WORKERS_COMPONENT;
+        ROSINA_LOG_INFO("Recording draws on %u threads", renderer.workers.worker_count);
+    }
+
+    // worker command pools and their secondary command buffers, one pool per worker so no pool is used by two threads
+    {
+        renderer.worker_command_pools      = MemoryArena_Allocate(&renderer.memory, renderer.frame_capacity * RENDERER_MAX_WORKER_COUNT * sizeof(VkCommandPool));
+        renderer.secondary_command_buffers = MemoryArena_Allocate(
+            &renderer.memory, renderer.frame_capacity * RENDERER_MAX_WORKER_COUNT * RENDERER_MAX_SECONDARY_COMMAND_BUFFERS * sizeof(VkCommandBuffer));
+
+        const VkCommandPoolCreateInfo pool_create_info = {.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                                                          .pNext            = NULL,
+                                                          .flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+                                                          .queueFamilyIndex = renderer.device.graphics_queue.family_index};
+        const uint32_t pool_count = renderer.frame_count * RENDERER_MAX_WORKER_COUNT;
+        for (uint32_t i = 0; i < pool_count; i++)
+        {
+            renderer.worker_command_pools[i] = VK_NULL_HANDLE;
+            if (i % RENDERER_MAX_WORKER_COUNT >= renderer.workers.worker_count)
+            {
+                continue;
+            }
+
+            VK_ERROR_HANDLE(vkCreateCommandPool(renderer.device.handle, &pool_create_info, NULL, renderer.worker_command_pools + i), {
+                for (uint32_t j = 0; j < i; j++)
+                {
+                    vkDestroyCommandPool(renderer.device.handle, renderer.worker_command_pools[j], NULL);
+                }
+                Renderer_Cleanup(&renderer);
+                return renderer;
+            });
+
+            const VkCommandBufferAllocateInfo alloc_info = {.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                                            .pNext              = NULL,
+                                                            .commandPool        = renderer.worker_command_pools[i],
+                                                            .level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+                                                            .commandBufferCount = RENDERER_MAX_SECONDARY_COMMAND_BUFFERS};
+            VK_ERROR_HANDLE(vkAllocateCommandBuffers(renderer.device.handle, &alloc_info,
+                                                     renderer.secondary_command_buffers + ((size_t)i * RENDERER_MAX_SECONDARY_COMMAND_BUFFERS)),
+                            {
+                                for (uint32_t j = 0; j <= i; j++)
+                                {
+                                    vkDestroyCommandPool(renderer.device.handle, renderer.worker_command_pools[j], NULL);
+                                }
+                                Renderer_Cleanup(&renderer);
+                                return renderer;
+                            });
+        }
+
+        renderer.components[renderer.component_count++] = RENDERER_WORKER_COMMAND_POOLS_COMPONENT;
+    }
+
     return renderer;
 }
\ No newline at end of file
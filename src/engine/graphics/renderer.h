@@ -3,19 +3,49 @@
 
 #include <engine/backend/vulkan_helpers.h>
 #include <utility/memory_arena.h>
+#include <utility/worker_pool.h>
 
+#include <engine/graphics/command_recorder.h>
+#include <engine/graphics/staging_ring.h>
+#include <engine/graphics/uniform_ring.h>
+#include <engine/graphics/uploader.h>
 #include <engine/graphics/window.h>
 
+#define RENDERER_STAGING_RING_SIZE (32ull * 1024 * 1024)
+// bytes of uniforms and instance data each frame can write
+#define RENDERER_UNIFORM_RING_FRAME_SIZE (4ull * 1024 * 1024)
+// frames between two logs of the memory budget, and between two rows of the memory report
+#define RENDERER_MEMORY_LOG_INTERVAL 3600
+#define RENDERER_MEMORY_REPORT_INTERVAL 60
+// frames between two logs of the binds Renderer_RecordDraws issued and skipped
+#define RENDERER_BIND_LOG_INTERVAL 3600
+// environment variable with the path of a CSV file the memory report is written to
+#define RENDERER_MEMORY_REPORT_VARIABLE "ROSINA_MEMORY_REPORT"
+// compiled pipelines are kept here between runs
+#define RENDERER_PIPELINE_CACHE_FILE "pipeline_cache.bin"
+// threads recording draws, including the main thread, each with a command pool per frame
+#define RENDERER_MAX_WORKER_COUNT 8
+// Renderer_RecordDraws calls each frame can make
+#define RENDERER_MAX_SECONDARY_COMMAND_BUFFERS 8
+// fewer draws than this per worker cost more to hand out than to record
+#define RENDERER_MIN_WORKER_DRAW_COUNT 256
+
 typedef enum RendererComponent
 {
     RENDERER_LINK_COMPONENT,
     RENDERER_WINDOW_COMPONENT,
     RENDERER_CONTEXT_COMPONENT,
     RENDERER_DEVICE_COMPONENT,
+    RENDERER_PIPELINE_CACHE_COMPONENT,
     RENDERER_RENDER_PASS_COMPONENT,
     RENDERER_GRAPHICS_PIPELINE_COMPONENT,
     RENDERER_SWAPCHAIN_COMPONENT,
     RENDERER_MEMORY_COMPONENT,
+    RENDERER_ALLOCATOR_COMPONENT,
+    RENDERER_MEMORY_REPORT_COMPONENT,
+    RENDERER_STAGING_RING_COMPONENT,
+    RENDERER_UNIFORM_RING_COMPONENT,
+    RENDERER_UPLOADER_COMPONENT,
     RENDERER_SWAPCHAIN_IMAGES_COMPONENT,
     RENDERER_DEPTH_IMAGES_COMPONENT,
     RENDERER_DEPTH_IMAGES_MEMORY_COMPONENT,
@@ -27,6 +57,8 @@ typedef enum RendererComponent
     RENDERER_FRAME_IN_FLIGHT_COMPONENT,
     RENDERER_COMMAND_POOLS_COMPONENT,
     RENDERER_PRIMARY_COMMAND_BUFFERS_COMPONENT,
+    RENDERER_WORKERS_COMPONENT,
+    RENDERER_WORKER_COMMAND_POOLS_COMPONENT,
     RENDERER_COMPONENT_CAPACITY
 } RendererComponent;
 
@@ -37,6 +69,8 @@ typedef struct Renderer
     GraphicsLink link;
     Window window;
     VulkanDevice device;
+    // pass to every pipeline created, saved to RENDERER_PIPELINE_CACHE_FILE on cleanup
+    VkPipelineCache pipeline_cache;
     VulkanRenderPass render_pass;
     VulkanGraphicsPipeline graphics_pipeline;
     VulkanSwapchain swapchain;
@@ -46,28 +80,113 @@ typedef struct Renderer
     uint32_t frame_capacity;
     uint32_t frame_count;
     MemoryArena memory;
+    // lives in memory so it can be used through a const Renderer
+    VulkanAllocator* allocator;
+    // NULL when RENDERER_MEMORY_REPORT_VARIABLE is not set
+    FILE* memory_report;
+    StagingRing staging_ring;
+    UniformRing uniform_ring;
+    Uploader uploader;
     VkImage* swapchain_images;
     VkImage* depth_images;
-    VkDeviceMemory depth_images_memory;
+    VulkanAllocation* depth_image_allocations;
     VkImageView* depth_image_views;
     VkImageView* swapchain_image_views;
     VkFramebuffer* framebuffers;
     VkSemaphore* image_available;
     VkCommandPool* command_pools;
     VkCommandBuffer* primary_command_buffers;
+    WorkerPool workers;
+    // RENDERER_MAX_WORKER_COUNT per frame, reset with the frame
+    VkCommandPool* worker_command_pools;
+    // RENDERER_MAX_SECONDARY_COMMAND_BUFFERS per worker command pool
+    VkCommandBuffer* secondary_command_buffers;
+    // the secondary command buffers of each worker used by the frame being recorded
+    uint32_t secondary_count;
+    // summed over the secondary command buffers since the last log
+    CommandRecorderStats bind_stats;
     VkSemaphore* render_finished;
     VkFence* in_flight;
 
     uint32_t image_index;
     uint32_t frame_index;
+    // the number of frames submitted, uploads are tagged with it
+    uint64_t frame_number;
 } Renderer;
 
 void Renderer_Cleanup(Renderer renderer[static 1]);
 
 Renderer Renderer_Create();
 
+/**
+ * Waits for the frame slot, acquires the next image and begins the primary command buffer, without starting the render
+ * pass. Commands that may not be recorded inside a render pass, like compute dispatches, go between this and
+ * Renderer_StartRenderPass.
+ *
+ * @return true on error.
+ */
+bool Renderer_StartFrame(Renderer renderer[static 1]);
+
+void Renderer_StartRenderPass(const Renderer renderer[static 1]);
+
+/**
+ * Renderer_StartFrame followed by Renderer_StartRenderPass.
+ *
+ * @return true on error.
+ */
 bool Renderer_StartScene(Renderer renderer[static 1]);
 
 bool Renderer_EndScene(Renderer renderer[static 1]);
 
+/**
+ * Records draws first to first + draw_count - 1 through recorder. Runs on a worker thread, so it may only record
+ * commands and read what does not change while Renderer_RecordDraws runs.
+ */
+typedef void (*RendererRecordFunction)(const Renderer* const renderer, CommandRecorder recorder[static 1], const uint32_t first,
+                                       const uint32_t draw_count, void* const user_data);
+
+/**
+ * Splits the draws into one range per worker and records each range into a secondary command buffer, which starts with
+ * the graphics pipeline, viewport and scissor bound. The secondary command buffers are executed in the order of their
+ * ranges, so the frame is the same as if every draw was recorded on one thread. Call between Renderer_StartScene and
+ * Renderer_EndScene, at most RENDERER_MAX_SECONDARY_COMMAND_BUFFERS times a frame.
+ *
+ * @return true on error.
+ */
+bool Renderer_RecordDraws(Renderer renderer[static 1], const uint32_t draw_count, const RendererRecordFunction record, void* const user_data);
+
+/**
+ * Allocates upload space that stays valid until the frame being recorded has finished on the GPU. Commands reading it
+ * must be submitted to the graphics queue before that frame's Renderer_EndScene.
+ *
+ * @return true on error.
+ */
+static inline bool Renderer_AllocateStaging(Renderer renderer[static 1], const VkDeviceSize size, const VkDeviceSize alignment,
+                                            StagingAllocation allocation[static 1])
+{
+    return StagingRing_Allocate(&renderer->staging_ring, size, alignment, renderer->frame_number, allocation);
+}
+
+/**
+ * Starts recording uploads for the frame being recorded, or continues if they already are. The copies run on the
+ * transfer queue before the frame is submitted. Hand every written resource to the graphics queue with
+ * Uploader_TransferBuffer or Uploader_TransferImage so the frame can use it.
+ *
+ * @return The transfer command buffer, or VK_NULL_HANDLE on error.
+ */
+static inline VkCommandBuffer Renderer_BeginUpload(Renderer renderer[static 1])
+{
+    return Uploader_Begin(&renderer->uploader, renderer->frame_index);
+}
+
+/**
+ * Allocates uniforms for the frame being recorded. Bind them by passing allocation.offset to Shader_Bind.
+ *
+ * @return true when the uniforms of this frame do not fit in RENDERER_UNIFORM_RING_FRAME_SIZE.
+ */
+static inline bool Renderer_AllocateUniforms(Renderer renderer[static 1], const VkDeviceSize size, UniformAllocation allocation[static 1])
+{
+    return UniformRing_Allocate(&renderer->uniform_ring, size, allocation);
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include <engine/graphics/residency_manager.h>
+
+#include <assert.h>
+#include <stdlib.h>
+
+void ResidencyManager_Cleanup(ResidencyManager manager[static 1])
+{
+    while (manager->component_count > 0)
+    {
+        switch (manager->components[--manager->component_count])
+        {
+            case RESIDENCY_MANAGER_RESOURCES_COMPONENT:
+                ResidencyManager_LogStats(manager);
+                free(manager->resources);
+                manager->resources      = NULL;
+                manager->resource_count = 0;
+                break;
+            default:
+                ROSINA_LOG_ERROR("Invalid residency manager component!");
+                assert(false);
+        }
+    }
+}
+
+ResidencyManager ResidencyManager_Create(const Renderer renderer[static 1], const ResidencyManagerCreateInfo create_info[static 1])
+{
+    ResidencyManager manager = {
+        .component_count   = 0,
+        .components        = {},
+        .budget            = create_info->budget,
+        .resident_bytes    = 0,
+        .resource_capacity = create_info->resource_capacity,
+        .resource_count    = 0,
+        .resources         = NULL,
+        .least_recent      = RESIDENCY_MANAGER_NONE,
+        .most_recent       = RESIDENCY_MANAGER_NONE,
+        .stats             = {},
+    };
+
+    if (manager.budget == 0)
+    {
+        const VulkanAllocator* const allocator = renderer->allocator;
+        VkDeviceSize device_local_size         = 0;
+        for (uint32_t i = 0; i < allocator->memory_properties.memoryHeapCount; i++)
+        {
+            if ((allocator->memory_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && allocator->memory_properties.memoryHeaps[i].size > device_local_size)
+            {
+                device_local_size = allocator->memory_properties.memoryHeaps[i].size;
+                manager.budget    = allocator->heaps[i].budget / 2;
+            }
+        }
+    }
+
+    {
+        manager.resources = malloc(sizeof(ResidentResource) * manager.resource_capacity);
+        if (manager.resources == NULL)
+        {
+            ROSINA_LOG_ERROR("Failed to allocate resident resources");
+            return manager;
+        }
+        manager.components[manager.component_count++] = RESIDENCY_MANAGER_RESOURCES_COMPONENT;
+    }
+
+    ROSINA_LOG_INFO("Residency budget: %llu MiB", (unsigned long long)(manager.budget >> 20));
+
+    return manager;
+}
+
+static void Unlink(ResidencyManager manager[static 1], const uint32_t index)
+{
+    ResidentResource* const resource = &manager->resources[index];
+    if (resource->prev != RESIDENCY_MANAGER_NONE)
+    {
+        manager->resources[resource->prev].next = resource->next;
+    }
+    else
+    {
+        manager->least_recent = resource->next;
+    }
+    if (resource->next != RESIDENCY_MANAGER_NONE)
+    {
+        manager->resources[resource->next].prev = resource->prev;
+    }
+    else
+    {
+        manager->most_recent = resource->prev;
+    }
+    resource->prev = RESIDENCY_MANAGER_NONE;
+    resource->next = RESIDENCY_MANAGER_NONE;
+}
+
+static void LinkMostRecent(ResidencyManager manager[static 1], const uint32_t index)
+{
+    ResidentResource* const resource = &manager->resources[index];
+    resource->prev                   = manager->most_recent;
+    resource->next                   = RESIDENCY_MANAGER_NONE;
+    if (manager->most_recent != RESIDENCY_MANAGER_NONE)
+    {
+        manager->resources[manager->most_recent].next = index;
+    }
+    else
+    {
+        manager->least_recent = index;
+    }
+    manager->most_recent = index;
+}
+
+uint32_t ResidencyManager_Register(ResidencyManager manager[static 1], const ResidencyResourceInfo info[static 1])
+{
+    if (manager->resource_count == manager->resource_capacity)
+    {
+        ROSINA_LOG_ERROR("Residency manager is full (%u resources)", manager->resource_capacity);
+        return RESIDENCY_MANAGER_NONE;
+    }
+
+    const uint32_t index      = manager->resource_count++;
+    manager->resources[index] = (ResidentResource){
+        .info            = *info,
+        .resident        = false,
+        .last_used_frame = 0,
+        .generation      = 0,
+        .prev            = RESIDENCY_MANAGER_NONE,
+        .next            = RESIDENCY_MANAGER_NONE,
+    };
+    if (info->resident)
+    {
+        manager->resources[index].resident = true;
+        manager->resident_bytes += info->size;
+        LinkMostRecent(manager, index);
+    }
+    return index;
+}
+
+/**
+ * Evicts the least recently used resources that no frame in flight uses until size more bytes fit the budget.
+ *
+ * @return true on error.
+ */
+static bool MakeRoom(Renderer renderer[static 1], ResidencyManager manager[static 1], const VkDeviceSize size)
+{
+    if (manager->resident_bytes + size <= manager->budget)
+    {
+        return false;
+    }
+
+    // the frames that have finished on the GPU, see Uploader::graphics_semaphore
+    uint64_t completed_frames;
+    VK_ERROR_RETURN(vkGetSemaphoreCounterValue(renderer->device.handle, renderer->uploader.graphics_semaphore, &completed_frames), true);
+
+    // the list is ordered by last use, so once one is in flight the rest are too
+    while (manager->resident_bytes + size > manager->budget && manager->least_recent != RESIDENCY_MANAGER_NONE)
+    {
+        const uint32_t index             = manager->least_recent;
+        ResidentResource* const resource = &manager->resources[index];
+        if (resource->last_used_frame >= completed_frames)
+        {
+            break;
+        }
+
+        Unlink(manager, index);
+        resource->info.evict(renderer, resource->info.user_data);
+        resource->resident = false;
+        manager->resident_bytes -= resource->info.size;
+        manager->stats.evictions++;
+    }
+    return false;
+}
+
+bool ResidencyManager_Use(Renderer renderer[static 1], ResidencyManager manager[static 1], const uint32_t resource_index)
+{
+    assert(resource_index < manager->resource_count);
+    ResidentResource* const resource = &manager->resources[resource_index];
+
+    if (resource->resident)
+    {
+        manager->stats.hits++;
+        Unlink(manager, resource_index);
+    }
+    else
+    {
+        manager->stats.misses++;
+        if (MakeRoom(renderer, manager, resource->info.size))
+        {
+            return true;
+        }
+        if (resource->info.load(renderer, resource->info.user_data))
+        {
+            ROSINA_LOG_ERROR("Failed to load resident resource %u", resource_index);
+            return true;
+        }
+        resource->resident = true;
+        resource->generation++;
+        manager->resident_bytes += resource->info.size;
+    }
+
+    resource->last_used_frame = renderer->frame_number;
+    LinkMostRecent(manager, resource_index);
+    return false;
+}
+
+bool ResidencyManager_Update(Renderer renderer[static 1], ResidencyManager manager[static 1])
+{
+    return MakeRoom(renderer, manager, 0);
+}
+
+void ResidencyManager_LogStats(const ResidencyManager manager[static 1])
+{
+    const ResidencyStats* const stats = &manager->stats;
+    const uint64_t uses               = stats->hits + stats->misses;
+    ROSINA_LOG_INFO("Residency: %llu of %llu MiB resident, %llu hits, %llu misses (%.1f%%), %llu evictions", (unsigned long long)(manager->resident_bytes >> 20),
+                    (unsigned long long)(manager->budget >> 20), (unsigned long long)stats->hits, (unsigned long long)stats->misses,
+                    uses > 0 ? 100.0 * (double)stats->misses / (double)uses : 0.0, (unsigned long long)stats->evictions);
+}
@@ -0,0 +1,118 @@
+#ifndef ROSINA_ENGINE_RESIDENCY_MANAGER_H
+#define ROSINA_ENGINE_RESIDENCY_MANAGER_H
+
+#include <engine/graphics/renderer.h>
+
+#define RESIDENCY_MANAGER_NONE UINT32_MAX
+
+/**
+ * Makes the resource resident again through the upload path, recording into the frame being recorded.
+ *
+ * @return true on error.
+ */
+typedef bool (*ResidencyLoadFunction)(Renderer* renderer, void* user_data);
+
+/**
+ * Frees the GPU memory of the resource. No frame that used it is in flight.
+ */
+typedef void (*ResidencyEvictFunction)(Renderer* renderer, void* user_data);
+
+typedef struct ResidencyResourceInfo
+{
+    // the GPU memory the resource takes while resident
+    VkDeviceSize size;
+    ResidencyLoadFunction load;
+    ResidencyEvictFunction evict;
+    void* user_data;
+    // whether the resource was loaded before it was registered
+    bool resident;
+} ResidencyResourceInfo;
+
+typedef struct ResidentResource
+{
+    ResidencyResourceInfo info;
+    bool resident;
+    // the frame_number of the last frame that used the resource
+    uint64_t last_used_frame;
+    // incremented every time the resource is loaded again, so users know to update what refers to it
+    uint32_t generation;
+    // neighbours in the list of resident resources, least recently used first
+    uint32_t prev;
+    uint32_t next;
+} ResidentResource;
+
+typedef struct ResidencyStats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} ResidencyStats;
+
+typedef enum ResidencyManagerComponent
+{
+    RESIDENCY_MANAGER_RESOURCES_COMPONENT,
+    RESIDENCY_MANAGER_COMPONENT_COUNT
+} ResidencyManagerComponent;
+
+/**
+ * Keeps the GPU resources registered with it under a budget. Every use of a resource stamps it with the frame, and a
+ * resource that is used while evicted is loaded again. Before a load, and once per frame, the least recently used
+ * resources are evicted until the resident ones fit the budget. Resources used by a frame in flight are never evicted,
+ * so the budget can be exceeded for as long as they are.
+ */
+typedef struct ResidencyManager
+{
+    uint32_t component_count;
+    ResidencyManagerComponent components[RESIDENCY_MANAGER_COMPONENT_COUNT];
+
+    VkDeviceSize budget;
+    VkDeviceSize resident_bytes;
+
+    uint32_t resource_capacity;
+    uint32_t resource_count;
+    ResidentResource* resources;
+    uint32_t least_recent;
+    uint32_t most_recent;
+
+    ResidencyStats stats;
+} ResidencyManager;
+
+typedef struct ResidencyManagerCreateInfo
+{
+    // bytes the resident resources may use. 0 uses half of the budget of the largest device local heap.
+    VkDeviceSize budget;
+    uint32_t resource_capacity;
+} ResidencyManagerCreateInfo;
+
+/**
+ * Resources stay as they are, their owners clean them up.
+ */
+void ResidencyManager_Cleanup(ResidencyManager manager[static 1]);
+
+/**
+ * @return The created manager. On error, the component_count field will be 0.
+ */
+ResidencyManager ResidencyManager_Create(const Renderer renderer[static 1], const ResidencyManagerCreateInfo create_info[static 1]);
+
+/**
+ * @return The index of the resource, or RESIDENCY_MANAGER_NONE when the manager is full.
+ */
+uint32_t ResidencyManager_Register(ResidencyManager manager[static 1], const ResidencyResourceInfo info[static 1]);
+
+/**
+ * Marks the resource as used by the frame being recorded, loading it if it was evicted. Call before binding it.
+ *
+ * @return true on error.
+ */
+bool ResidencyManager_Use(Renderer renderer[static 1], ResidencyManager manager[static 1], const uint32_t resource);
+
+/**
+ * Evicts what is over budget and no longer in flight. Call once per frame.
+ *
+ * @return true on error.
+ */
+bool ResidencyManager_Update(Renderer renderer[static 1], ResidencyManager manager[static 1]);
+
+void ResidencyManager_LogStats(const ResidencyManager manager[static 1]);
+
+#endif
@@ -3,11 +3,33 @@
 #include <string.h>
 #include <utility/log.h>
 
-static inline bool StartFrame(Renderer renderer[static 1])
+bool Renderer_StartFrame(Renderer renderer[static 1])
 {
     VK_ERROR_RETURN(vkWaitForFences(renderer->device.handle, 1, renderer->in_flight + renderer->frame_index, VK_TRUE, UINT64_MAX), true);
     VK_ERROR_RETURN(vkResetFences(renderer->device.handle, 1, renderer->in_flight + renderer->frame_index), true);
 
+    // the last frame that used this slot is done, and with it everything submitted before it
+    if (renderer->frame_number >= renderer->frame_count)
+    {
+        StagingRing_Reclaim(&renderer->staging_ring, renderer->frame_number - renderer->frame_count + 1);
+    }
+    UniformRing_StartFrame(&renderer->uniform_ring, renderer->frame_index);
+
+    VulkanAllocator_UpdateBudget(renderer->allocator);
+    if (renderer->frame_number % RENDERER_MEMORY_LOG_INTERVAL == 0)
+    {
+        VulkanAllocator_LogBudget(renderer->allocator);
+    }
+    if (renderer->memory_report != NULL && renderer->frame_number % RENDERER_MEMORY_REPORT_INTERVAL == 0)
+    {
+        VulkanAllocator_WriteCsvRow(renderer->allocator, renderer->memory_report, renderer->frame_number);
+    }
+    if (renderer->frame_number > 0 && renderer->frame_number % RENDERER_BIND_LOG_INTERVAL == 0)
+    {
+        CommandRecorderStats_Log(&renderer->bind_stats);
+        renderer->bind_stats = (CommandRecorderStats){};
+    }
+
     const VkAcquireNextImageInfoKHR acquire_info = {
         .sType      = VK_STRUCTURE_TYPE_ACQUIRE_NEXT_IMAGE_INFO_KHR,
         .pNext      = NULL,
@@ -19,7 +41,15 @@ static inline bool StartFrame(Renderer renderer[static 1])
     };
     VK_ERROR_RETURN(vkAcquireNextImage2KHR(renderer->device.handle, &acquire_info, &renderer->image_index), true);
 
-    VK_ERROR_RETURN(vkResetCommandBuffer(renderer->primary_command_buffers[renderer->frame_index], 0), true);
+    // the frame that used these pools has finished, so every command buffer allocated from them can be reset at once
+    VK_ERROR_RETURN(vkResetCommandPool(renderer->device.handle, renderer->command_pools[renderer->frame_index], 0), true);
+    for (uint32_t i = 0; i < renderer->workers.worker_count; i++)
+    {
+        VK_ERROR_RETURN(
+            vkResetCommandPool(renderer->device.handle, renderer->worker_command_pools[(renderer->frame_index * RENDERER_MAX_WORKER_COUNT) + i], 0), true);
+    }
+    renderer->secondary_count = 0;
+
     const VkCommandBufferBeginInfo begin_info = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
         .pNext = NULL,
@@ -31,7 +61,7 @@ static inline bool StartFrame(Renderer renderer[static 1])
     return false;
 }
 
-static inline void StartRenderPass(const Renderer renderer[static 1])
+void Renderer_StartRenderPass(const Renderer renderer[static 1])
 {
     const VkClearValue clear_values[] = {{.color = {.float32 = {0.0f, 0.0f, 0.0f, 0.0f}}}, {.depthStencil = {1.0f, 0}}};
 
@@ -44,7 +74,16 @@ static inline void StartRenderPass(const Renderer renderer[static 1])
         .clearValueCount = sizeof(clear_values) / sizeof(VkClearValue),
         .pClearValues    = clear_values
     };
-    vkCmdBeginRenderPass(renderer->primary_command_buffers[renderer->frame_index], &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+    // every draw is recorded by Renderer_RecordDraws
+    vkCmdBeginRenderPass(renderer->primary_command_buffers[renderer->frame_index], &render_pass_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+}
+
+/**
+ * Sets the state a secondary command buffer does not inherit from the primary one.
+ */
+static inline void StartSecondary(const Renderer renderer[static 1], CommandRecorder recorder[static 1])
+{
+    CommandRecorder_BindPipeline(recorder, VK_PIPELINE_BIND_POINT_GRAPHICS, renderer->graphics_pipeline.handle);
 
     const VkViewport viewport = {
         .x        = 0.0f,
@@ -54,20 +93,110 @@ static inline void StartRenderPass(const Renderer renderer[static 1])
         .minDepth = 0.0f,
         .maxDepth = 1.0f
     };
-    vkCmdSetViewport(renderer->primary_command_buffers[renderer->frame_index], 0, 1, &viewport);
+    CommandRecorder_SetViewport(recorder, &viewport);
 
     const VkRect2D scissor = {.offset = {0, 0}, .extent = renderer->swapchain.extent};
-    vkCmdSetScissor(renderer->primary_command_buffers[renderer->frame_index], 0, 1, &scissor);
+    CommandRecorder_SetScissor(recorder, &scissor);
 }
 
 bool Renderer_StartScene(Renderer renderer[static 1])
 {
-    if (StartFrame(renderer)) return true;
+    if (Renderer_StartFrame(renderer)) return true;
+
+    Renderer_StartRenderPass(renderer);
+
+    return false;
+}
+
+typedef struct RecordJob
+{
+    const Renderer* renderer;
+    VkCommandBuffer command_buffers[RENDERER_MAX_WORKER_COUNT];
+    bool failed[RENDERER_MAX_WORKER_COUNT];
+    CommandRecorderStats stats[RENDERER_MAX_WORKER_COUNT];
+    uint32_t range_count;
+    uint32_t draw_count;
+    RendererRecordFunction record;
+    void* user_data;
+} RecordJob;
+
+static void RecordRange(const uint32_t range, void* const user_data)
+{
+    RecordJob* const job                 = user_data;
+    const Renderer* const renderer       = job->renderer;
+    const VkCommandBuffer command_buffer = job->command_buffers[range];
 
-    StartRenderPass(renderer);
+    const VkCommandBufferInheritanceInfo inheritance_info = {
+        .sType                = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .pNext                = NULL,
+        .renderPass           = renderer->render_pass.handle,
+        .subpass              = 0,
+        .framebuffer          = renderer->framebuffers[renderer->image_index],
+        .occlusionQueryEnable = VK_FALSE,
+        .queryFlags           = 0,
+        .pipelineStatistics   = 0
+    };
+    const VkCommandBufferBeginInfo begin_info = {
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext            = NULL,
+        .flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+        .pInheritanceInfo = &inheritance_info
+    };
+    VK_ERROR_HANDLE(vkBeginCommandBuffer(command_buffer, &begin_info), {
+        job->failed[range] = true;
+        return;
+    });
+
+    CommandRecorder recorder = CommandRecorder_Create(command_buffer);
+    StartSecondary(renderer, &recorder);
+
+    const uint32_t first = (uint32_t)(((uint64_t)job->draw_count * range) / job->range_count);
+    const uint32_t end   = (uint32_t)(((uint64_t)job->draw_count * (range + 1)) / job->range_count);
+    job->record(renderer, &recorder, first, end - first, job->user_data);
+    job->stats[range] = recorder.stats;
+
+    VK_ERROR_HANDLE(vkEndCommandBuffer(command_buffer), { job->failed[range] = true; });
+}
 
-    vkCmdBindPipeline(renderer->primary_command_buffers[renderer->frame_index], VK_PIPELINE_BIND_POINT_GRAPHICS, renderer->graphics_pipeline.handle);
+bool Renderer_RecordDraws(Renderer renderer[static 1], const uint32_t draw_count, const RendererRecordFunction record, void* const user_data)
+{
+    if (draw_count == 0)
+    {
+        return false;
+    }
+    if (renderer->secondary_count >= RENDERER_MAX_SECONDARY_COMMAND_BUFFERS)
+    {
+        ROSINA_LOG_ERROR("More than %u Renderer_RecordDraws calls in a frame", RENDERER_MAX_SECONDARY_COMMAND_BUFFERS);
+        return true;
+    }
+
+    const uint32_t wanted_count = (draw_count + RENDERER_MIN_WORKER_DRAW_COUNT - 1) / RENDERER_MIN_WORKER_DRAW_COUNT;
+    RecordJob job               = {
+        .renderer        = renderer,
+        .command_buffers = {},
+        .failed          = {},
+        .stats           = {},
+        .range_count     = wanted_count < renderer->workers.worker_count ? wanted_count : renderer->workers.worker_count,
+        .draw_count      = draw_count,
+        .record          = record,
+        .user_data       = user_data,
+    };
+    for (uint32_t i = 0; i < job.range_count; i++)
+    {
+        const uint32_t pool    = (renderer->frame_index * RENDERER_MAX_WORKER_COUNT) + i;
+        job.command_buffers[i] = renderer->secondary_command_buffers[((size_t)pool * RENDERER_MAX_SECONDARY_COMMAND_BUFFERS) + renderer->secondary_count];
+    }
+    renderer->secondary_count++;
+
+    // range i is recorded with the pool of worker i, whichever thread runs it, so a pool is only ever used by one thread
+    WorkerPool_Run(&renderer->workers, job.range_count, RecordRange, &job);
+    for (uint32_t i = 0; i < job.range_count; i++)
+    {
+        if (job.failed[i]) return true;
+        CommandRecorderStats_Add(&renderer->bind_stats, &job.stats[i]);
+    }
 
+    vkCmdExecuteCommands(renderer->primary_command_buffers[renderer->frame_index], job.range_count, job.command_buffers);
     return false;
 }
 
@@ -76,23 +205,44 @@ static inline void EndRenderPass(const Renderer renderer[static 1])
     vkCmdEndRenderPass(renderer->primary_command_buffers[renderer->frame_index]);
 }
 
-static inline bool EndFrame(const Renderer renderer[static 1])
+static inline bool EndFrame(Renderer renderer[static 1])
 {
     VK_ERROR_RETURN(vkEndCommandBuffer(renderer->primary_command_buffers[renderer->frame_index]), true);
 
+    // uploads of this frame go to the transfer queue first, the frame only waits for them if there were any
+    const uint64_t frame_value = renderer->frame_number + 1;
+    bool uploads_pending       = false;
+    if (Uploader_Submit(&renderer->uploader, frame_value, &uploads_pending)) return true;
+
     VK_ERROR_RETURN(vkWaitForFences(renderer->device.handle, 1, renderer->in_flight + renderer->frame_index, VK_TRUE, UINT64_MAX), true);
     VK_ERROR_RETURN(vkResetFences(renderer->device.handle, 1, renderer->in_flight + renderer->frame_index), true);
 
-    const VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    const VkCommandBuffer command_buffers[]  = {renderer->uploader.graphics_command_buffers[renderer->frame_index],
+                                                renderer->primary_command_buffers[renderer->frame_index]};
+    const VkSemaphore wait_semaphores[]      = {renderer->image_available[renderer->frame_index], renderer->uploader.transfer_semaphore};
+    const uint64_t wait_values[]             = {0, renderer->uploader.transfer_value};
+    const VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
+    const VkSemaphore signal_semaphores[]    = {renderer->render_finished[renderer->frame_index], renderer->uploader.graphics_semaphore};
+    const uint64_t signal_values[]           = {0, frame_value};
+
+    const VkTimelineSemaphoreSubmitInfo timeline_info = {
+        .sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .pNext                     = NULL,
+        .waitSemaphoreValueCount   = uploads_pending ? 2 : 1,
+        .pWaitSemaphoreValues      = wait_values,
+        .signalSemaphoreValueCount = 2,
+        .pSignalSemaphoreValues    = signal_values,
+    };
     const VkSubmitInfo submit_info = {
         .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .waitSemaphoreCount   = 1,
-        .pWaitSemaphores      = renderer->image_available + renderer->frame_index,
+        .pNext                = &timeline_info,
+        .waitSemaphoreCount   = uploads_pending ? 2 : 1,
+        .pWaitSemaphores      = wait_semaphores,
         .pWaitDstStageMask    = wait_stages,
-        .commandBufferCount   = 1,
-        .pCommandBuffers      = renderer->primary_command_buffers + renderer->frame_index,
-        .signalSemaphoreCount = 1,
-        .pSignalSemaphores    = renderer->render_finished + renderer->frame_index
+        .commandBufferCount   = uploads_pending ? 2 : 1,
+        .pCommandBuffers      = uploads_pending ? command_buffers : command_buffers + 1,
+        .signalSemaphoreCount = 2,
+        .pSignalSemaphores    = signal_semaphores
     };
     VK_ERROR_RETURN(vkQueueSubmit(renderer->device.graphics_queue.handle, 1, &submit_info, renderer->in_flight[renderer->frame_index]), true);
 
@@ -118,6 +268,7 @@ bool Renderer_EndScene(Renderer renderer[static 1])
 
     renderer->frame_index += 1;
     renderer->frame_index %= renderer->frame_count;
+    renderer->frame_number += 1;
 
     return false;
 }
\ No newline at end of file
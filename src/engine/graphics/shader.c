@@ -10,7 +10,6 @@ Shader Shader_Create(Renderer renderer[static 1], const ShaderCreateInfo create_
     assert(create_info->vertex_shader_path != NULL);
     assert(create_info->fragment_shader_path != NULL);
     assert(create_info->arena != NULL);
-    assert(create_info->memory != NULL);
 
     Shader shader = {
         .component_count = 0,
@@ -19,15 +18,20 @@ Shader Shader_Create(Renderer renderer[static 1], const ShaderCreateInfo create_
         .vertex_module   = VK_NULL_HANDLE,
         .fragment_module = VK_NULL_HANDLE,
         .descriptor_pool = VK_NULL_HANDLE,
-        .descriptor_set  = VK_NULL_HANDLE,
-        .ubo             = {.offset = 0, .size = 0},
+        .descriptor_sets = NULL,
+        .image_info      = {
+            .sampler = create_info->image->sampler, .imageView = create_info->image->view, .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        },
+        .stale_sets      = 0,
+        .uniform_size    = sizeof(Mat4f) * 3,
     };
+    assert(renderer->frame_count <= UPLOADER_FRAME_CAPACITY);
 
     // layouts
     {
         const VkDescriptorSetLayoutBinding bindings[] = {{
             .binding            = 0,
-            .descriptorType     = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorType     = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
             .descriptorCount    = 1,
             .stageFlags         = VK_SHADER_STAGE_VERTEX_BIT,
             .pImmutableSamplers = NULL
@@ -56,7 +60,7 @@ Shader Shader_Create(Renderer renderer[static 1], const ShaderCreateInfo create_
     // pool
     {
         const VkDescriptorPoolSize pool_sizes[] = {
-            {.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = renderer->frame_count},
+            {.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, .descriptorCount = renderer->frame_count},
             {.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = renderer->frame_count}
         };
         uint32_t max_sets = 0;
@@ -143,16 +147,27 @@ Shader Shader_Create(Renderer renderer[static 1], const ShaderCreateInfo create_
 
     // descriptor sets
     {
-        VkDescriptorSetLayout layout = shader.layout;
+        shader.descriptor_sets = MemoryArena_Allocate(create_info->arena, renderer->frame_count * sizeof(VkDescriptorSet));
+        if (shader.descriptor_sets == NULL)
+        {
+            ROSINA_LOG_ERROR("Failed to allocate descriptor sets");
+            Shader_Cleanup(renderer, &shader);
+            return shader;
+        }
 
+        VkDescriptorSetLayout layouts[UPLOADER_FRAME_CAPACITY];
+        for (uint32_t i = 0; i < renderer->frame_count; i++)
+        {
+            layouts[i] = shader.layout;
+        }
         const VkDescriptorSetAllocateInfo alloc_info = {
             .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
             .pNext              = NULL,
             .descriptorPool     = shader.descriptor_pool,
-            .descriptorSetCount = 1,
-            .pSetLayouts        = &shader.layout
+            .descriptorSetCount = renderer->frame_count,
+            .pSetLayouts        = layouts
         };
-        VK_ERROR_HANDLE(vkAllocateDescriptorSets(renderer->device.handle, &alloc_info, &shader.descriptor_set), {
+        VK_ERROR_HANDLE(vkAllocateDescriptorSets(renderer->device.handle, &alloc_info, shader.descriptor_sets), {
             Shader_Cleanup(renderer, &shader);
             return shader;
         });
@@ -161,46 +176,73 @@ Shader Shader_Create(Renderer renderer[static 1], const ShaderCreateInfo create_
     }
 
     // uniforms
+    for (uint32_t i = 0; i < renderer->frame_count; i++)
     {
-        {
-            shader.ubo = UniformBufferObject_Create(sizeof(Mat4f) * 3, create_info->memory);
-
-            const VkDescriptorBufferInfo buffer_info = {
-                .buffer = create_info->memory->uniform_buffer, .offset = shader.ubo.offset, .range = shader.ubo.size};
-            const VkDescriptorImageInfo image_info = {
-                .sampler = create_info->image->sampler, .imageView = create_info->image->view, .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-            };
-
-            const VkWriteDescriptorSet descriptor_writes[] = {{
-                .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                .pNext            = NULL,
-                .dstSet           = shader.descriptor_set,
-                .dstBinding       = 0,
-                .dstArrayElement  = 0,
-                .descriptorCount  = 1,
-                .descriptorType   = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                .pImageInfo       = NULL,
-                .pBufferInfo      = &buffer_info,
-                .pTexelBufferView = NULL
-            }, {
-                .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                .pNext            = NULL,
-                .dstSet           = shader.descriptor_set,
-                .dstBinding       = 1,
-                .dstArrayElement  = 0,
-                .descriptorCount  = 1,
-                .descriptorType   = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .pImageInfo       = &image_info, // Need to set image info. May require creating a sampler.
-                .pBufferInfo      = NULL,
-                .pTexelBufferView = NULL
-            }};
-            vkUpdateDescriptorSets(renderer->device.handle, sizeof(descriptor_writes) / sizeof(VkWriteDescriptorSet), descriptor_writes, 0, NULL);
-        }
+        // the offset into the ring is given to every Shader_Bind
+        const VkDescriptorBufferInfo buffer_info = {.buffer = renderer->uniform_ring.buffer, .offset = 0, .range = shader.uniform_size};
+
+        const VkWriteDescriptorSet descriptor_writes[] = {{
+            .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext            = NULL,
+            .dstSet           = shader.descriptor_sets[i],
+            .dstBinding       = 0,
+            .dstArrayElement  = 0,
+            .descriptorCount  = 1,
+            .descriptorType   = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            .pImageInfo       = NULL,
+            .pBufferInfo      = &buffer_info,
+            .pTexelBufferView = NULL
+        }, {
+            .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext            = NULL,
+            .dstSet           = shader.descriptor_sets[i],
+            .dstBinding       = 1,
+            .dstArrayElement  = 0,
+            .descriptorCount  = 1,
+            .descriptorType   = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .pImageInfo       = &shader.image_info,
+            .pBufferInfo      = NULL,
+            .pTexelBufferView = NULL
+        }};
+        vkUpdateDescriptorSets(renderer->device.handle, sizeof(descriptor_writes) / sizeof(VkWriteDescriptorSet), descriptor_writes, 0, NULL);
     }
 
     return shader;
 }
 
+void Shader_SetImage(Shader shader[static 1], const Image image[static 1])
+{
+    shader->image_info = (VkDescriptorImageInfo){
+        .sampler = image->sampler, .imageView = image->view, .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    };
+    shader->stale_sets = UINT32_MAX;
+}
+
+void Shader_Update(const Renderer renderer[static 1], Shader shader[static 1])
+{
+    // Renderer_StartFrame waited for the frame that last bound this set
+    const uint32_t bit = 1u << renderer->frame_index;
+    if ((shader->stale_sets & bit) == 0)
+    {
+        return;
+    }
+
+    const VkWriteDescriptorSet descriptor_write = {
+        .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext            = NULL,
+        .dstSet           = shader->descriptor_sets[renderer->frame_index],
+        .dstBinding       = 1,
+        .dstArrayElement  = 0,
+        .descriptorCount  = 1,
+        .descriptorType   = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .pImageInfo       = &shader->image_info,
+        .pBufferInfo      = NULL,
+        .pTexelBufferView = NULL
+    };
+    vkUpdateDescriptorSets(renderer->device.handle, 1, &descriptor_write, 0, NULL);
+    shader->stale_sets &= ~bit;
+}
+
 void Shader_Cleanup(const Renderer renderer[static 1], Shader shader[static 1])
 {
     vkDeviceWaitIdle(renderer->device.handle);
@@ -217,8 +259,8 @@ void Shader_Cleanup(const Renderer renderer[static 1], Shader shader[static 1])
                 shader->layout = VK_NULL_HANDLE;
                 break;
             case SHADER_DESCRIPTOR_SETS_COMPONENT:
-                vkFreeDescriptorSets(renderer->device.handle, shader->descriptor_pool, 1, &shader->descriptor_set);
-                shader->descriptor_set = NULL;
+                vkFreeDescriptorSets(renderer->device.handle, shader->descriptor_pool, renderer->frame_count, shader->descriptor_sets);
+                shader->descriptor_sets = NULL;
                 break;
             case SHADER_MODULES_COMPONENT:
                 vkDestroyShaderModule(renderer->device.handle, shader->vertex_module, NULL);
@@ -1,6 +1,8 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include <assert.h>
+
 #include <engine/graphics/renderer.h>
 
 #include <engine/graphics/buffer.h>
@@ -23,8 +25,13 @@ typedef struct Shader
     VkShaderModule vertex_module;
     VkShaderModule fragment_module;
     VkDescriptorPool descriptor_pool;
-    VkDescriptorSet descriptor_set;
-    UniformBufferObject ubo;
+    // one per frame slot, so a set is only written once the frames that bound it have finished
+    VkDescriptorSet* descriptor_sets;
+    // the sampler binding every set should have, and a bit per frame slot whose set does not have it yet
+    VkDescriptorImageInfo image_info;
+    uint32_t stale_sets;
+    // bytes of uniforms each draw reads from the renderer's uniform ring
+    VkDeviceSize uniform_size;
 } Shader;
 
 /**
@@ -39,7 +46,6 @@ typedef struct ShaderCreateInfo
     const char* vertex_shader_path;
     const char* fragment_shader_path;
     MemoryArena* arena;
-    BufferMemory* memory;
     Image* image;
 } ShaderCreateInfo;
 
@@ -51,10 +57,21 @@ typedef struct ShaderCreateInfo
  */
 Shader Shader_Create(Renderer renderer[static 1], const ShaderCreateInfo create_info[static 1]);
 
+/**
+ * Points the sampler binding at another image. The sets are rewritten by Shader_Update as their frame slots come up, so
+ * the previous image must stay alive until the frames in flight have finished.
+ */
+void Shader_SetImage(Shader shader[static 1], const Image image[static 1]);
+
+/**
+ * Rewrites the set of the current frame slot if Shader_SetImage changed the image since it was last written. Call after
+ * Renderer_StartFrame and before the first Shader_Bind of the frame.
+ */
+void Shader_Update(const Renderer renderer[static 1], Shader shader[static 1]);
+
 static inline uint64_t Shader_CalculateRequiredBytes(const Renderer renderer[static 1])
 {
-    return renderer->frame_count * (sizeof(VkDescriptorSet) +      // Shader::descriptor_sets
-                                    sizeof(UniformBufferObject));  // Shader::ubo
+    return renderer->frame_count * sizeof(VkDescriptorSet);  // Shader::descriptor_sets
 }
 
 /**
@@ -65,17 +82,22 @@ static inline uint64_t Shader_CalculateRequiredBytes(const Renderer renderer[sta
  */
 void Shader_GetVkVertexInputAttributeDescription(Shader shader [static 1], uint32_t n [static 1], VkVertexInputAttributeDescription* const dest);
 
-static inline void Shader_Bind(const Renderer renderer[static 1], const Shader shader[static 1])
+/**
+ * @param uniform_offset The offset of an allocation of shader->uniform_size bytes returned by Renderer_AllocateUniforms.
+ */
+static inline void Shader_Bind(const Renderer renderer[static 1], CommandRecorder recorder[static 1], const Shader shader[static 1],
+                               const uint32_t uniform_offset)
 {
-    vkCmdBindDescriptorSets(
-        renderer->primary_command_buffers[renderer->frame_index],
+    assert((shader->stale_sets & (1u << renderer->frame_index)) == 0);
+    CommandRecorder_BindDescriptorSets(
+        recorder,
         VK_PIPELINE_BIND_POINT_GRAPHICS,
         renderer->graphics_pipeline.layout,
         0,
         1,
-        &shader->descriptor_set,
-        0,
-        NULL
+        &shader->descriptor_sets[renderer->frame_index],
+        1,
+        &uniform_offset
     );
 }
 
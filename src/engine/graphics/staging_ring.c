@@ -0,0 +1,170 @@
+#include <engine/graphics/staging_ring.h>
+
+#include <assert.h>
+#include <stdlib.h>
+
+static bool CreateHostBuffer(VulkanAllocator allocator[static 1], const VkDeviceSize size, VkBuffer buffer[static 1], VulkanAllocation allocation[static 1])
+{
+    const VkBufferCreateInfo buffer_create_info = {
+        .sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext                 = NULL,
+        .flags                 = 0,
+        .size                  = size,
+        .usage                 = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices   = NULL,
+    };
+    VK_ERROR_RETURN(vkCreateBuffer(allocator->device, &buffer_create_info, NULL, buffer), true);
+
+    if (VulkanAllocator_AllocateBuffer(allocator, *buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0,
+                                       VULKAN_MEMORY_CATEGORY_STAGING, allocation))
+    {
+        vkDestroyBuffer(allocator->device, *buffer, NULL);
+        *buffer = VK_NULL_HANDLE;
+        return true;
+    }
+    return false;
+}
+
+void StagingRing_Cleanup(StagingRing ring[static 1])
+{
+    StagingRing_Reclaim(ring, UINT64_MAX);
+    free(ring->temporaries);
+    ring->temporaries        = NULL;
+    ring->temporary_capacity = 0;
+
+    if (ring->buffer != VK_NULL_HANDLE)
+    {
+        if (ring->overflow_count > 0)
+        {
+            ROSINA_LOG_INFO("Staging ring overflowed %llu times", (unsigned long long)ring->overflow_count);
+        }
+        vkDestroyBuffer(ring->allocator->device, ring->buffer, NULL);
+        ring->buffer = VK_NULL_HANDLE;
+        VulkanAllocator_Free(ring->allocator, &ring->allocation);
+    }
+}
+
+StagingRing StagingRing_Create(VulkanAllocator allocator[static 1], const VkDeviceSize size)
+{
+    StagingRing ring = {
+        .allocator          = allocator,
+        .buffer             = VK_NULL_HANDLE,
+        .allocation         = {.memory = VK_NULL_HANDLE},
+        .size               = size,
+        .head               = 0,
+        .tail               = 0,
+        .region_start       = 0,
+        .region_count       = 0,
+        .regions            = {},
+        .temporary_count    = 0,
+        .temporary_capacity = 0,
+        .temporaries        = NULL,
+        .overflow_count     = 0,
+    };
+
+    CreateHostBuffer(allocator, size, &ring.buffer, &ring.allocation);
+    return ring;
+}
+
+static bool AllocateTemporary(StagingRing ring[static 1], const VkDeviceSize size, const uint64_t tag, StagingAllocation allocation[static 1])
+{
+    if (ring->temporary_count == ring->temporary_capacity)
+    {
+        const uint32_t capacity                   = ring->temporary_capacity > 0 ? ring->temporary_capacity * 2 : 4;
+        StagingTemporaryBuffer* const temporaries = realloc(ring->temporaries, sizeof(StagingTemporaryBuffer) * capacity);
+        if (temporaries == NULL)
+        {
+            return true;
+        }
+        ring->temporaries        = temporaries;
+        ring->temporary_capacity = capacity;
+    }
+
+    StagingTemporaryBuffer* const temporary = &ring->temporaries[ring->temporary_count];
+    temporary->tag                          = tag;
+    if (CreateHostBuffer(ring->allocator, size, &temporary->buffer, &temporary->allocation))
+    {
+        return true;
+    }
+    ring->temporary_count++;
+    ring->overflow_count++;
+
+    allocation->buffer = temporary->buffer;
+    allocation->offset = 0;
+    allocation->mapped = temporary->allocation.mapped;
+    return false;
+}
+
+bool StagingRing_Allocate(StagingRing ring[static 1], const VkDeviceSize size, const VkDeviceSize alignment, const uint64_t tag,
+                          StagingAllocation allocation[static 1])
+{
+    StagingRegion* last = ring->region_count > 0 ? &ring->regions[(ring->region_start + ring->region_count - 1) % STAGING_RING_REGION_CAPACITY] : NULL;
+    assert(last == NULL || last->tag <= tag);
+
+    VkDeviceSize offset = (ring->head + alignment - 1) / alignment * alignment;
+    bool fits           = false;
+    if (ring->region_count == 0 || ring->head > ring->tail)
+    {
+        // free space runs from head to the end, then from the start to tail
+        fits = offset + size <= ring->size;
+        if (!fits)
+        {
+            offset = 0;
+            fits   = size <= ring->tail;
+        }
+    }
+    else
+    {
+        fits = offset + size <= ring->tail;
+    }
+
+    if (!fits || ((last == NULL || last->tag != tag) && ring->region_count == STAGING_RING_REGION_CAPACITY))
+    {
+        return AllocateTemporary(ring, size, tag, allocation);
+    }
+
+    if (last == NULL || last->tag != tag)
+    {
+        last      = &ring->regions[(ring->region_start + ring->region_count) % STAGING_RING_REGION_CAPACITY];
+        last->tag = tag;
+        ring->region_count++;
+    }
+    ring->head = offset + size;
+    last->end  = ring->head;
+
+    allocation->buffer = ring->buffer;
+    allocation->offset = offset;
+    allocation->mapped = (uint8_t*)ring->allocation.mapped + offset;
+    return false;
+}
+
+void StagingRing_Reclaim(StagingRing ring[static 1], const uint64_t completed_tag)
+{
+    while (ring->region_count > 0 && ring->regions[ring->region_start].tag < completed_tag)
+    {
+        ring->tail         = ring->regions[ring->region_start].end;
+        ring->region_start = (ring->region_start + 1) % STAGING_RING_REGION_CAPACITY;
+        ring->region_count--;
+    }
+    if (ring->region_count == 0)
+    {
+        ring->head = 0;
+        ring->tail = 0;
+    }
+
+    for (uint32_t i = 0; i < ring->temporary_count;)
+    {
+        if (ring->temporaries[i].tag < completed_tag)
+        {
+            vkDestroyBuffer(ring->allocator->device, ring->temporaries[i].buffer, NULL);
+            VulkanAllocator_Free(ring->allocator, &ring->temporaries[i].allocation);
+            ring->temporaries[i] = ring->temporaries[--ring->temporary_count];
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef ROSINA_ENGINE_STAGING_RING_H
+#define ROSINA_ENGINE_STAGING_RING_H
+
+#include <engine/backend/vulkan_helpers.h>
+
+#define STAGING_RING_REGION_CAPACITY 16
+
+// the bytes of the ring used by everything tagged with one value
+typedef struct StagingRegion
+{
+    uint64_t tag;
+    VkDeviceSize end;
+} StagingRegion;
+
+// an upload that did not fit in the ring
+typedef struct StagingTemporaryBuffer
+{
+    uint64_t tag;
+    VkBuffer buffer;
+    VulkanAllocation allocation;
+} StagingTemporaryBuffer;
+
+/**
+ * A persistently mapped, host coherent buffer that uploads are written into. Every allocation is tagged with the value
+ * of the submission that reads it, and the space is handed back once StagingRing_Reclaim is told that value completed.
+ * Tags must not decrease. Allocations that do not fit get a temporary buffer that is destroyed the same way.
+ */
+typedef struct StagingRing
+{
+    VulkanAllocator* allocator;
+    VkBuffer buffer;
+    VulkanAllocation allocation;
+    VkDeviceSize size;
+    VkDeviceSize head;
+    VkDeviceSize tail;
+
+    uint32_t region_start;
+    uint32_t region_count;
+    StagingRegion regions[STAGING_RING_REGION_CAPACITY];
+
+    uint32_t temporary_count;
+    uint32_t temporary_capacity;
+    StagingTemporaryBuffer* temporaries;
+    uint64_t overflow_count;
+} StagingRing;
+
+typedef struct StagingAllocation
+{
+    VkBuffer buffer;
+    VkDeviceSize offset;
+    void* mapped;
+} StagingAllocation;
+
+void StagingRing_Cleanup(StagingRing ring[static 1]);
+
+/**
+ * @return The created ring. On error, the buffer field will be VK_NULL_HANDLE.
+ */
+StagingRing StagingRing_Create(VulkanAllocator allocator[static 1], const VkDeviceSize size);
+
+/**
+ * @param alignment The alignment of the offset in the buffer.
+ * @param tag The value of the submission that reads the allocation.
+ * @return true on error.
+ */
+bool StagingRing_Allocate(StagingRing ring[static 1], const VkDeviceSize size, const VkDeviceSize alignment, const uint64_t tag,
+                          StagingAllocation allocation[static 1]);
+
+/**
+ * Releases everything tagged with a value less than completed_tag.
+ */
+void StagingRing_Reclaim(StagingRing ring[static 1], const uint64_t completed_tag);
+
+#endif
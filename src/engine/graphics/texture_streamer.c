@@ -0,0 +1,442 @@
+#include <engine/graphics/texture_streamer.h>
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <utility/ktx2.h>
+
+void TextureStreamer_Cleanup(Renderer renderer[static 1], TextureStreamer streamer[static 1])
+{
+    vkDeviceWaitIdle(renderer->device.handle);
+
+    while (streamer->component_count > 0)
+    {
+        switch (streamer->components[--streamer->component_count])
+        {
+            case TEXTURE_STREAMER_TEXTURES_COMPONENT:
+                if (streamer->upload_pending)
+                {
+                    Image_Cleanup(renderer, &streamer->upload_image);
+                    streamer->upload_pending = false;
+                }
+                for (uint32_t i = 0; i < streamer->texture_count; i++)
+                {
+                    Image_Cleanup(renderer, &streamer->textures[i].image);
+                }
+                for (uint32_t i = 0; i < streamer->retired_count; i++)
+                {
+                    Image_Cleanup(renderer, &streamer->retired[i].image);
+                }
+                streamer->retired_count = 0;
+                free(streamer->textures);
+                streamer->textures      = NULL;
+                streamer->texture_count = 0;
+                break;
+            default:
+                ROSINA_LOG_ERROR("Invalid texture streamer component!");
+                assert(false);
+        }
+    }
+}
+
+TextureStreamer TextureStreamer_Create(Renderer renderer[static 1], const TextureStreamerCreateInfo create_info[static 1])
+{
+    TextureStreamer streamer = {
+        .component_count  = 0,
+        .components       = {},
+        .budget           = create_info->budget,
+        .resident_bytes   = 0,
+        .frame            = 0,
+        .texture_capacity = create_info->texture_capacity,
+        .texture_count    = 0,
+        .textures         = NULL,
+        .upload_pending   = false,
+        .upload_texture   = 0,
+        .upload_image     = {},
+        .upload_value     = 0,
+        .retired_count    = 0,
+        .retired          = {},
+    };
+
+    if (streamer.budget == 0)
+    {
+        // half of what the allocator may use of the largest device local heap, like ResidencyManager_Create. The rest is
+        // left for buffers and render targets.
+        const VulkanAllocator* const allocator = renderer->allocator;
+        VkDeviceSize device_local_size         = 0;
+        for (uint32_t i = 0; i < allocator->memory_properties.memoryHeapCount; i++)
+        {
+            const VkMemoryHeap* const heap = &allocator->memory_properties.memoryHeaps[i];
+            if ((heap->flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && heap->size > device_local_size)
+            {
+                device_local_size = heap->size;
+                streamer.budget   = allocator->heaps[i].budget / 2;
+            }
+        }
+    }
+
+    {
+        streamer.textures = malloc(sizeof(StreamedTexture) * streamer.texture_capacity);
+        if (streamer.textures == NULL)
+        {
+            ROSINA_LOG_ERROR("Failed to allocate streamed textures");
+            return streamer;
+        }
+        streamer.components[streamer.component_count++] = TEXTURE_STREAMER_TEXTURES_COMPONENT;
+    }
+
+    ROSINA_LOG_INFO("Texture streaming budget: %llu MiB", (unsigned long long)(streamer.budget >> 20));
+
+    return streamer;
+}
+
+/**
+ * Creates the image holding the levels of texture from base_mip_level down and submits its upload. The levels the
+ * current image already holds are copied from it instead of being read again.
+ */
+static bool StartUpload(Renderer renderer[static 1], TextureStreamer streamer[static 1], const uint32_t texture, const uint32_t base_mip_level)
+{
+    assert(!streamer->upload_pending);
+
+    const StreamedTexture* const streamed = &streamer->textures[texture];
+    const ImageCreateInfo image_create_info = {
+        .path              = streamed->path,
+        .premultiply_alpha = false,
+        .base_mip_level    = base_mip_level,
+    };
+    Image image = Image_Create(renderer, &image_create_info);
+    if (image.handle == VK_NULL_HANDLE)
+    {
+        return true;
+    }
+
+    // the copy is submitted with the frame being recorded, so the staging memory lives as long as that frame
+    bool failed = false;
+    if (streamed->image.handle == VK_NULL_HANDLE)
+    {
+        StagingAllocation staging;
+        failed = Renderer_AllocateStaging(renderer, Image_CalculateSize(&image), IMAGE_STAGING_ALIGNMENT, &staging) ||
+                 Image_LoadStagingData(&image, image_create_info.path, NULL, staging.mapped) || Image_Upload(renderer, &image, staging.buffer, staging.offset);
+    }
+    else
+    {
+        // an upgrade reads the one level that is new, a downgrade reads nothing
+        const uint32_t resident_base = streamed->image.source_base_mip_level;
+        const uint32_t level_count   = resident_base > image.source_base_mip_level ? resident_base - image.source_base_mip_level : 0;
+        StagingAllocation staging    = {.buffer = VK_NULL_HANDLE, .offset = 0, .mapped = NULL};
+        if (level_count > 0)
+        {
+            failed = Renderer_AllocateStaging(renderer, Image_CalculateLevelsSize(&image, level_count), IMAGE_STAGING_ALIGNMENT, &staging) ||
+                     Image_LoadStagingLevels(&image, image_create_info.path, level_count, staging.mapped);
+        }
+        failed = failed || Image_UploadFrom(renderer, &image, level_count, staging.buffer, staging.offset, &streamed->image);
+    }
+    if (failed)
+    {
+        Image_Cleanup(renderer, &image);
+        return true;
+    }
+
+    streamer->upload_pending = true;
+    streamer->upload_texture = texture;
+    streamer->upload_image   = image;
+    streamer->upload_value   = renderer->frame_number + 1;
+    return false;
+}
+
+/**
+ * Blocks until the pending upload has landed.
+ *
+ * @return true on error.
+ */
+static bool WaitForUpload(Renderer renderer[static 1], const TextureStreamer streamer[static 1])
+{
+    // an upload of the frame being recorded has not been submitted yet
+    if (streamer->upload_value > renderer->frame_number)
+    {
+        return Uploader_Flush(&renderer->uploader);
+    }
+
+    const VkSemaphoreWaitInfo wait_info = {
+        .sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .pNext          = NULL,
+        .flags          = 0,
+        .semaphoreCount = 1,
+        .pSemaphores    = &renderer->uploader.graphics_semaphore,
+        .pValues        = &streamer->upload_value,
+    };
+    VK_ERROR_RETURN(vkWaitSemaphores(renderer->device.handle, &wait_info, UINT64_MAX), true);
+    return false;
+}
+
+/**
+ * Destroys the retired images that no frame can use anymore.
+ *
+ * @param completed_value The value graphics_semaphore has reached.
+ */
+static void ReleaseRetiredImages(Renderer renderer[static 1], TextureStreamer streamer[static 1], const uint64_t completed_value)
+{
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < streamer->retired_count; i++)
+    {
+        if (streamer->retired[i].value <= completed_value)
+        {
+            Image_Cleanup(renderer, &streamer->retired[i].image);
+            continue;
+        }
+        streamer->retired[kept++] = streamer->retired[i];
+    }
+    streamer->retired_count = kept;
+}
+
+/**
+ * Keeps image alive until the frame being recorded has finished, since it and the frames in flight may sample it.
+ *
+ * @return true on error.
+ */
+static bool RetireImage(Renderer renderer[static 1], TextureStreamer streamer[static 1], const Image image[static 1])
+{
+    if (streamer->retired_count == TEXTURE_STREAMER_RETIRED_CAPACITY)
+    {
+        // only happens when frames retire images faster than they finish, and then the oldest has been submitted
+        assert(streamer->retired[0].value <= renderer->frame_number);
+        const VkSemaphoreWaitInfo wait_info = {
+            .sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            .pNext          = NULL,
+            .flags          = 0,
+            .semaphoreCount = 1,
+            .pSemaphores    = &renderer->uploader.graphics_semaphore,
+            .pValues        = &streamer->retired[0].value,
+        };
+        VK_ERROR_RETURN(vkWaitSemaphores(renderer->device.handle, &wait_info, UINT64_MAX), true);
+        ReleaseRetiredImages(renderer, streamer, streamer->retired[0].value);
+    }
+
+    streamer->retired[streamer->retired_count++] = (TextureStreamerRetiredImage){
+        .image = *image,
+        .value = renderer->frame_number + 1,
+    };
+    return false;
+}
+
+/**
+ * Swaps the uploaded image in. The upload must have landed.
+ *
+ * @return true on error.
+ */
+static bool FinishUpload(Renderer renderer[static 1], TextureStreamer streamer[static 1])
+{
+    assert(streamer->upload_pending);
+    StreamedTexture* const texture = &streamer->textures[streamer->upload_texture];
+
+    // frames in flight may still sample the old image, and descriptors are moved off it by the caller after this
+    if (texture->image.handle != VK_NULL_HANDLE && RetireImage(renderer, streamer, &texture->image))
+    {
+        return true;
+    }
+
+    streamer->resident_bytes -= texture->resident_bytes;
+    streamer->resident_bytes += streamer->upload_image.allocation.size;
+    texture->resident_bytes          = streamer->upload_image.allocation.size;
+    texture->resident_base_mip_level = streamer->upload_image.source_base_mip_level;
+    texture->image                   = streamer->upload_image;
+    texture->generation++;
+
+    streamer->upload_pending = false;
+    return false;
+}
+
+uint32_t TextureStreamer_Register(Renderer renderer[static 1], TextureStreamer streamer[static 1], const char* const path)
+{
+    if (streamer->texture_count == streamer->texture_capacity)
+    {
+        ROSINA_LOG_ERROR("Texture streamer is full");
+        return UINT32_MAX;
+    }
+    if (strlen(path) >= sizeof(streamer->textures[0].path))
+    {
+        ROSINA_LOG_ERROR("Path \"%s\" is too long", path);
+        return UINT32_MAX;
+    }
+
+    Ktx2Info info;
+    if (!Ktx2File_Is(path) || Ktx2File_ReadInfo(path, &info))
+    {
+        ROSINA_LOG_ERROR("Only KTX2 files can be streamed: %s", path);
+        return UINT32_MAX;
+    }
+
+    // only one upload is tracked at a time
+    if (streamer->upload_pending)
+    {
+        if (WaitForUpload(renderer, streamer) || FinishUpload(renderer, streamer))
+        {
+            return UINT32_MAX;
+        }
+    }
+
+    uint32_t initial_base = 0;
+    while (initial_base + 1 < info.level_count && ((info.width >> initial_base) > TEXTURE_STREAMER_INITIAL_SIZE || (info.height >> initial_base) > TEXTURE_STREAMER_INITIAL_SIZE))
+    {
+        initial_base++;
+    }
+
+    const uint32_t texture          = streamer->texture_count;
+    StreamedTexture* const streamed = &streamer->textures[texture];
+    *streamed                       = (StreamedTexture){
+        .path                     = {},
+        .width                    = info.width,
+        .height                   = info.height,
+        .level_count              = info.level_count,
+        .initial_base_mip_level   = initial_base,
+        .resident_base_mip_level  = info.level_count,
+        .requested_base_mip_level = initial_base,
+        .last_request_frame       = 0,
+        .resident_bytes           = 0,
+        .generation               = 0,
+        .image                    = {.handle = VK_NULL_HANDLE},
+    };
+    strcpy(streamed->path, path);
+
+    if (StartUpload(renderer, streamer, texture, initial_base))
+    {
+        ROSINA_LOG_ERROR("Failed to upload %s", path);
+        return UINT32_MAX;
+    }
+    if (WaitForUpload(renderer, streamer) || FinishUpload(renderer, streamer))
+    {
+        return UINT32_MAX;
+    }
+
+    streamer->texture_count++;
+    return texture;
+}
+
+void TextureStreamer_Request(TextureStreamer streamer[static 1], const uint32_t texture, const float screen_size)
+{
+    StreamedTexture* const streamed = &streamer->textures[texture];
+
+    // the largest level that is not smaller than the area it covers
+    const uint32_t size = streamed->width > streamed->height ? streamed->width : streamed->height;
+    uint32_t base       = streamed->level_count - 1;
+    if (screen_size >= 1.0f)
+    {
+        const float level = floorf(log2f((float)size / screen_size));
+        base              = level <= 0.0f ? 0 : (level >= (float)base ? base : (uint32_t)level);
+    }
+
+    if (streamed->last_request_frame != streamer->frame || base < streamed->requested_base_mip_level)
+    {
+        streamed->requested_base_mip_level = base;
+    }
+    streamed->last_request_frame = streamer->frame;
+}
+
+static inline uint32_t GetWantedBaseMipLevel(const TextureStreamer streamer[static 1], const StreamedTexture texture[static 1])
+{
+    if (streamer->frame - texture->last_request_frame > TEXTURE_STREAMER_IDLE_FRAMES)
+    {
+        return texture->initial_base_mip_level > texture->requested_base_mip_level ? texture->initial_base_mip_level : texture->requested_base_mip_level;
+    }
+    return texture->requested_base_mip_level;
+}
+
+/**
+ * @return The texture whose largest level is the best to drop, or UINT32_MAX if none holds more than it needs.
+ */
+static uint32_t FindEvictionCandidate(const TextureStreamer streamer[static 1])
+{
+    uint32_t candidate = UINT32_MAX;
+    for (uint32_t i = 0; i < streamer->texture_count; i++)
+    {
+        const StreamedTexture* const texture = &streamer->textures[i];
+        if (GetWantedBaseMipLevel(streamer, texture) <= texture->resident_base_mip_level || texture->resident_base_mip_level + 1 >= texture->level_count)
+        {
+            continue;
+        }
+        // least recently requested first, then the one holding the largest level
+        if (candidate == UINT32_MAX || texture->last_request_frame < streamer->textures[candidate].last_request_frame ||
+            (texture->last_request_frame == streamer->textures[candidate].last_request_frame && texture->resident_bytes > streamer->textures[candidate].resident_bytes))
+        {
+            candidate = i;
+        }
+    }
+    return candidate;
+}
+
+/**
+ * @return The texture that is furthest from the levels it asked for, or UINT32_MAX if all have what they need.
+ */
+static uint32_t FindUpgradeCandidate(const TextureStreamer streamer[static 1])
+{
+    uint32_t candidate     = UINT32_MAX;
+    uint32_t largest_delta = 0;
+    for (uint32_t i = 0; i < streamer->texture_count; i++)
+    {
+        const StreamedTexture* const texture = &streamer->textures[i];
+        const uint32_t wanted                = GetWantedBaseMipLevel(streamer, texture);
+        if (wanted >= texture->resident_base_mip_level)
+        {
+            continue;
+        }
+        const uint32_t delta = texture->resident_base_mip_level - wanted;
+        if (delta > largest_delta || (delta == largest_delta && texture->last_request_frame > streamer->textures[candidate].last_request_frame))
+        {
+            candidate     = i;
+            largest_delta = delta;
+        }
+    }
+    return candidate;
+}
+
+bool TextureStreamer_Update(Renderer renderer[static 1], TextureStreamer streamer[static 1])
+{
+    streamer->frame++;
+
+    uint64_t completed_value = 0;
+    VK_ERROR_RETURN(vkGetSemaphoreCounterValue(renderer->device.handle, renderer->uploader.graphics_semaphore, &completed_value), true);
+    ReleaseRetiredImages(renderer, streamer, completed_value);
+
+    if (streamer->upload_pending)
+    {
+        if (completed_value < streamer->upload_value)
+        {
+            return false;
+        }
+        // one change per update keeps the retired images to about one per frame in flight
+        return FinishUpload(renderer, streamer);
+    }
+
+    // over budget, drop a level from whatever is holding more than it needs
+    if (streamer->resident_bytes > streamer->budget)
+    {
+        const uint32_t texture = FindEvictionCandidate(streamer);
+        if (texture != UINT32_MAX)
+        {
+            return StartUpload(renderer, streamer, texture, streamer->textures[texture].resident_base_mip_level + 1);
+        }
+    }
+
+    const uint32_t texture = FindUpgradeCandidate(streamer);
+    if (texture == UINT32_MAX)
+    {
+        return false;
+    }
+
+    // a level is about three times the size of every level below it together, so the upgrade roughly adds three times what
+    // is resident
+    const StreamedTexture* const streamed = &streamer->textures[texture];
+    const uint32_t base                   = streamed->resident_base_mip_level - 1;
+    const uint32_t width                  = streamed->width >> base > 0 ? streamed->width >> base : 1;
+    const uint32_t height                 = streamed->height >> base > 0 ? streamed->height >> base : 1;
+    const VkDeviceSize added              = Image_CalculateLevelSize(streamed->image.format, width, height);
+    if (streamer->resident_bytes + added > streamer->budget)
+    {
+        const uint32_t evicted = FindEvictionCandidate(streamer);
+        return evicted == UINT32_MAX ? false : StartUpload(renderer, streamer, evicted, streamer->textures[evicted].resident_base_mip_level + 1);
+    }
+
+    return StartUpload(renderer, streamer, texture, base);
+}
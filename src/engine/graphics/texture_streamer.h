@@ -0,0 +1,121 @@
+#ifndef ROSINA_ENGINE_TEXTURE_STREAMER_H
+#define ROSINA_ENGINE_TEXTURE_STREAMER_H
+
+#include <engine/graphics/image.h>
+#include <engine/graphics/renderer.h>
+
+// largest dimension of the levels uploaded when a texture is registered
+#define TEXTURE_STREAMER_INITIAL_SIZE 64
+// textures that are not requested for this many updates fall back to their initial levels
+#define TEXTURE_STREAMER_IDLE_FRAMES 120
+// replaced images waiting for the frames that may use them, at most about one per frame in flight
+#define TEXTURE_STREAMER_RETIRED_CAPACITY (UPLOADER_FRAME_CAPACITY + 1)
+
+typedef struct StreamedTexture
+{
+    char path[256];
+    // size and level count of the source file
+    uint32_t width;
+    uint32_t height;
+    uint32_t level_count;
+    uint32_t initial_base_mip_level;
+    // the largest level of the source that is resident
+    uint32_t resident_base_mip_level;
+    uint32_t requested_base_mip_level;
+    uint64_t last_request_frame;
+    VkDeviceSize resident_bytes;
+    // incremented every time image is replaced, so users know to update their descriptors
+    uint32_t generation;
+    Image image;
+} StreamedTexture;
+
+typedef struct TextureStreamerRetiredImage
+{
+    Image image;
+    // destroyed once the renderer's frames reach this value, see Uploader::graphics_semaphore
+    uint64_t value;
+} TextureStreamerRetiredImage;
+
+typedef enum TextureStreamerComponent
+{
+    TEXTURE_STREAMER_TEXTURES_COMPONENT,
+    TEXTURE_STREAMER_COMPONENT_COUNT
+} TextureStreamerComponent;
+
+/**
+ * Streams the mip levels of KTX2 textures. A texture starts with only its small levels resident, larger levels are
+ * uploaded one at a time as they are requested, and the largest levels of textures that are no longer needed are dropped
+ * when the resident size goes over the budget. A texture changes its resident levels by replacing its image, so at most
+ * one texture changes per TextureStreamer_Update. The levels the old and new image share are copied on the GPU, only a
+ * level that was not resident is read from the file, and the old image is destroyed once no frame can use it. Uploads
+ * go through the renderer's transfer queue with the frame.
+ */
+typedef struct TextureStreamer
+{
+    uint32_t component_count;
+    TextureStreamerComponent components[TEXTURE_STREAMER_COMPONENT_COUNT];
+
+    VkDeviceSize budget;
+    VkDeviceSize resident_bytes;
+    uint64_t frame;
+
+    uint32_t texture_capacity;
+    uint32_t texture_count;
+    StreamedTexture* textures;
+
+    bool upload_pending;
+    uint32_t upload_texture;
+    Image upload_image;
+    // the upload has landed once the renderer's frames reach this value, see Uploader::graphics_semaphore
+    uint64_t upload_value;
+
+    uint32_t retired_count;
+    TextureStreamerRetiredImage retired[TEXTURE_STREAMER_RETIRED_CAPACITY];
+} TextureStreamer;
+
+typedef struct TextureStreamerCreateInfo
+{
+    // bytes of image memory the streamed textures may use. 0 uses half of the allocator budget of the largest device local
+    // heap.
+    VkDeviceSize budget;
+    uint32_t texture_capacity;
+} TextureStreamerCreateInfo;
+
+void TextureStreamer_Cleanup(Renderer renderer[static 1], TextureStreamer streamer[static 1]);
+
+/**
+ * @return The created streamer. On error, the component_count field will be 0.
+ */
+TextureStreamer TextureStreamer_Create(Renderer renderer[static 1], const TextureStreamerCreateInfo create_info[static 1]);
+
+/**
+ * Registers a KTX2 texture and uploads its levels up to TEXTURE_STREAMER_INITIAL_SIZE. Waits for the upload.
+ *
+ * @return The index of the texture, or UINT32_MAX on error.
+ */
+uint32_t TextureStreamer_Register(Renderer renderer[static 1], TextureStreamer streamer[static 1], const char* const path);
+
+/**
+ * Asks for the levels needed to draw the texture at a size. Several requests in one frame keep the largest.
+ *
+ * @param texture The index returned by TextureStreamer_Register.
+ * @param screen_size The number of pixels the larger side of the texture covers on screen.
+ */
+void TextureStreamer_Request(TextureStreamer streamer[static 1], const uint32_t texture, const float screen_size);
+
+/**
+ * Finishes the previous upload if it is done and starts the next one. Call once per frame, after Renderer_StartFrame and
+ * before Renderer_EndScene. When an upload finishes the texture's generation changes, and its previous image stays
+ * alive until the frame being recorded has finished, so descriptors of frame slots can be moved to the new image as
+ * their slots come up.
+ *
+ * @return true on error.
+ */
+bool TextureStreamer_Update(Renderer renderer[static 1], TextureStreamer streamer[static 1]);
+
+static inline const Image* TextureStreamer_GetImage(const TextureStreamer streamer[static 1], const uint32_t texture)
+{
+    return &streamer->textures[texture].image;
+}
+
+#endif
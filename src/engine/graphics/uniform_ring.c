@@ -0,0 +1,67 @@
+#include <engine/graphics/uniform_ring.h>
+
+void UniformRing_Cleanup(UniformRing ring[static 1])
+{
+    if (ring->buffer != VK_NULL_HANDLE)
+    {
+        vkDestroyBuffer(ring->allocator->device, ring->buffer, NULL);
+        ring->buffer = VK_NULL_HANDLE;
+        VulkanAllocator_Free(ring->allocator, &ring->allocation);
+    }
+}
+
+UniformRing UniformRing_Create(VulkanAllocator allocator[static 1], const VkPhysicalDevice physical_device, const VkDeviceSize frame_size,
+                               const uint32_t frame_count)
+{
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(physical_device, &device_properties);
+
+    const VkDeviceSize alignment = device_properties.limits.minUniformBufferOffsetAlignment > 0 ? device_properties.limits.minUniformBufferOffsetAlignment : 1;
+
+    UniformRing ring = {
+        .allocator  = allocator,
+        .buffer     = VK_NULL_HANDLE,
+        .allocation = {.memory = VK_NULL_HANDLE},
+        .alignment  = alignment,
+        .frame_size = (frame_size + alignment - 1) / alignment * alignment,
+        .head       = 0,
+        .end        = 0,
+    };
+
+    const VkBufferCreateInfo buffer_create_info = {
+        .sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext                 = NULL,
+        .flags                 = 0,
+        .size                  = ring.frame_size * frame_count,
+        .usage                 = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices   = NULL,
+    };
+    VK_ERROR_RETURN(vkCreateBuffer(allocator->device, &buffer_create_info, NULL, &ring.buffer), ring);
+
+    // the shaders read every byte written here once per frame, so it is worth having it in video memory
+    if (VulkanAllocator_AllocateBuffer(allocator, ring.buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VULKAN_MEMORY_CATEGORY_UNIFORM, &ring.allocation))
+    {
+        vkDestroyBuffer(allocator->device, ring.buffer, NULL);
+        ring.buffer = VK_NULL_HANDLE;
+        return ring;
+    }
+
+    UniformRing_StartFrame(&ring, 0);
+    return ring;
+}
+
+bool UniformRing_Allocate(UniformRing ring[static 1], const VkDeviceSize size, UniformAllocation allocation[static 1])
+{
+    if (ring->head + size > ring->end)
+    {
+        return true;
+    }
+
+    allocation->offset = (uint32_t)ring->head;
+    allocation->mapped = (uint8_t*)ring->allocation.mapped + ring->head;
+    ring->head        += (size + ring->alignment - 1) / ring->alignment * ring->alignment;
+    return false;
+}
@@ -0,0 +1,54 @@
+#ifndef ROSINA_ENGINE_UNIFORM_RING_H
+#define ROSINA_ENGINE_UNIFORM_RING_H
+
+#include <engine/backend/vulkan_helpers.h>
+
+/**
+ * A persistently mapped uniform buffer split into one region per frame in flight. Uniforms for a frame are written
+ * straight into its region and read by the GPU through dynamic offsets, so updating them costs a memcpy and no
+ * descriptor writes. The buffer is placed in device local memory that the host can write to when there is some. It is
+ * also a vertex buffer, for per instance data.
+ */
+typedef struct UniformRing
+{
+    VulkanAllocator* allocator;
+    VkBuffer buffer;
+    VulkanAllocation allocation;
+    // minUniformBufferOffsetAlignment, every offset handed out is a multiple of it
+    VkDeviceSize alignment;
+    VkDeviceSize frame_size;
+    VkDeviceSize head;
+    VkDeviceSize end;
+} UniformRing;
+
+typedef struct UniformAllocation
+{
+    // offset from the start of the buffer, as passed to vkCmdBindDescriptorSets
+    uint32_t offset;
+    void* mapped;
+} UniformAllocation;
+
+void UniformRing_Cleanup(UniformRing ring[static 1]);
+
+/**
+ * @param frame_size The bytes of uniforms one frame may use.
+ * @return The created ring. On error, the buffer field will be VK_NULL_HANDLE.
+ */
+UniformRing UniformRing_Create(VulkanAllocator allocator[static 1], const VkPhysicalDevice physical_device, const VkDeviceSize frame_size,
+                               const uint32_t frame_count);
+
+/**
+ * Starts handing out the region of a frame slot. The previous frame that used the slot must be done on the GPU.
+ */
+static inline void UniformRing_StartFrame(UniformRing ring[static 1], const uint32_t frame_index)
+{
+    ring->head = ring->frame_size * frame_index;
+    ring->end  = ring->head + ring->frame_size;
+}
+
+/**
+ * @return true when the region of the current frame is full.
+ */
+bool UniformRing_Allocate(UniformRing ring[static 1], const VkDeviceSize size, UniformAllocation allocation[static 1]);
+
+#endif
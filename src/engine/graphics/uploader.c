@@ -0,0 +1,319 @@
+#include <engine/graphics/uploader.h>
+
+#include <assert.h>
+
+void Uploader_Cleanup(Uploader uploader[static 1])
+{
+    while (uploader->component_count > 0)
+    {
+        switch (uploader->components[--uploader->component_count])
+        {
+            case UPLOADER_TRANSFER_COMMAND_POOL_COMPONENT:
+                vkDestroyCommandPool(uploader->device, uploader->transfer_command_pool, NULL);
+                uploader->transfer_command_pool = VK_NULL_HANDLE;
+                break;
+            case UPLOADER_GRAPHICS_COMMAND_POOL_COMPONENT:
+                vkDestroyCommandPool(uploader->device, uploader->graphics_command_pool, NULL);
+                uploader->graphics_command_pool = VK_NULL_HANDLE;
+                break;
+            case UPLOADER_COMMAND_BUFFERS_COMPONENT:
+                vkFreeCommandBuffers(uploader->device, uploader->transfer_command_pool, uploader->frame_count, uploader->transfer_command_buffers);
+                vkFreeCommandBuffers(uploader->device, uploader->graphics_command_pool, uploader->frame_count, uploader->graphics_command_buffers);
+                break;
+            case UPLOADER_TRANSFER_SEMAPHORE_COMPONENT:
+                vkDestroySemaphore(uploader->device, uploader->transfer_semaphore, NULL);
+                uploader->transfer_semaphore = VK_NULL_HANDLE;
+                break;
+            case UPLOADER_GRAPHICS_SEMAPHORE_COMPONENT:
+                vkDestroySemaphore(uploader->device, uploader->graphics_semaphore, NULL);
+                uploader->graphics_semaphore = VK_NULL_HANDLE;
+                break;
+            default:
+                ROSINA_LOG_ERROR("Invalid uploader component!");
+                assert(false);
+        }
+    }
+}
+
+Uploader Uploader_Create(const VulkanDevice device[static 1], const uint32_t frame_count)
+{
+    assert(frame_count <= UPLOADER_FRAME_CAPACITY);
+
+    Uploader uploader = {
+        .component_count          = 0,
+        .components               = {},
+        .device                   = device->handle,
+        .transfer_queue           = device->transfer_queue,
+        .graphics_queue           = device->graphics_queue,
+        .transfer_command_pool    = VK_NULL_HANDLE,
+        .graphics_command_pool    = VK_NULL_HANDLE,
+        .frame_count              = frame_count,
+        .transfer_command_buffers = {},
+        .graphics_command_buffers = {},
+        .frame_values             = {},
+        .transfer_semaphore       = VK_NULL_HANDLE,
+        .transfer_value           = 0,
+        .graphics_semaphore       = VK_NULL_HANDLE,
+        .recording                = false,
+        .frame_index              = 0,
+    };
+
+    // command pools
+    {
+        VkCommandPoolCreateInfo pool_create_info = {
+            .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .pNext            = NULL,
+            .flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            .queueFamilyIndex = uploader.transfer_queue.family_index,
+        };
+        VK_ERROR_HANDLE(vkCreateCommandPool(uploader.device, &pool_create_info, NULL, &uploader.transfer_command_pool), {
+            Uploader_Cleanup(&uploader);
+            return uploader;
+        });
+        uploader.components[uploader.component_count++] = UPLOADER_TRANSFER_COMMAND_POOL_COMPONENT;
+
+        pool_create_info.queueFamilyIndex = uploader.graphics_queue.family_index;
+        VK_ERROR_HANDLE(vkCreateCommandPool(uploader.device, &pool_create_info, NULL, &uploader.graphics_command_pool), {
+            Uploader_Cleanup(&uploader);
+            return uploader;
+        });
+        uploader.components[uploader.component_count++] = UPLOADER_GRAPHICS_COMMAND_POOL_COMPONENT;
+    }
+
+    // command buffers
+    {
+        VkCommandBufferAllocateInfo allocate_info = {
+            .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext              = NULL,
+            .commandPool        = uploader.transfer_command_pool,
+            .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = frame_count,
+        };
+        VK_ERROR_HANDLE(vkAllocateCommandBuffers(uploader.device, &allocate_info, uploader.transfer_command_buffers), {
+            Uploader_Cleanup(&uploader);
+            return uploader;
+        });
+
+        allocate_info.commandPool = uploader.graphics_command_pool;
+        VK_ERROR_HANDLE(vkAllocateCommandBuffers(uploader.device, &allocate_info, uploader.graphics_command_buffers), {
+            vkFreeCommandBuffers(uploader.device, uploader.transfer_command_pool, frame_count, uploader.transfer_command_buffers);
+            Uploader_Cleanup(&uploader);
+            return uploader;
+        });
+        uploader.components[uploader.component_count++] = UPLOADER_COMMAND_BUFFERS_COMPONENT;
+    }
+
+    // semaphores
+    {
+        const VkSemaphoreTypeCreateInfo type_create_info = {
+            .sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+            .pNext         = NULL,
+            .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+            .initialValue  = 0,
+        };
+        const VkSemaphoreCreateInfo semaphore_create_info = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = &type_create_info,
+            .flags = 0,
+        };
+        VK_ERROR_HANDLE(vkCreateSemaphore(uploader.device, &semaphore_create_info, NULL, &uploader.transfer_semaphore), {
+            Uploader_Cleanup(&uploader);
+            return uploader;
+        });
+        uploader.components[uploader.component_count++] = UPLOADER_TRANSFER_SEMAPHORE_COMPONENT;
+
+        VK_ERROR_HANDLE(vkCreateSemaphore(uploader.device, &semaphore_create_info, NULL, &uploader.graphics_semaphore), {
+            Uploader_Cleanup(&uploader);
+            return uploader;
+        });
+        uploader.components[uploader.component_count++] = UPLOADER_GRAPHICS_SEMAPHORE_COMPONENT;
+    }
+
+    if (Uploader_IsQueueFamilyTransferNeeded(&uploader))
+    {
+        ROSINA_LOG_INFO("Uploading on queue family %u", uploader.transfer_queue.family_index);
+    }
+
+    return uploader;
+}
+
+VkCommandBuffer Uploader_Begin(Uploader uploader[static 1], const uint32_t frame_index)
+{
+    if (uploader->recording)
+    {
+        assert(uploader->frame_index == frame_index);
+        return uploader->transfer_command_buffers[frame_index];
+    }
+
+    // the last frame that used this slot may still be running its command buffers
+    const VkSemaphoreWaitInfo wait_info = {
+        .sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .pNext          = NULL,
+        .flags          = 0,
+        .semaphoreCount = 1,
+        .pSemaphores    = &uploader->graphics_semaphore,
+        .pValues        = &uploader->frame_values[frame_index],
+    };
+    VK_ERROR_RETURN(vkWaitSemaphores(uploader->device, &wait_info, UINT64_MAX), VK_NULL_HANDLE);
+
+    const VkCommandBufferBeginInfo begin_info = {
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext            = NULL,
+        .flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = NULL,
+    };
+    VK_ERROR_RETURN(vkBeginCommandBuffer(uploader->transfer_command_buffers[frame_index], &begin_info), VK_NULL_HANDLE);
+    VK_ERROR_RETURN(vkBeginCommandBuffer(uploader->graphics_command_buffers[frame_index], &begin_info), VK_NULL_HANDLE);
+
+    uploader->recording   = true;
+    uploader->frame_index = frame_index;
+    return uploader->transfer_command_buffers[frame_index];
+}
+
+void Uploader_TransferBuffer(const Uploader uploader[static 1], const VkBuffer buffer, const VkDeviceSize offset, const VkDeviceSize size,
+                             const VkPipelineStageFlags dst_stage, const VkAccessFlags dst_access)
+{
+    assert(uploader->recording);
+
+    // within one family the semaphore wait alone makes the writes visible
+    if (!Uploader_IsQueueFamilyTransferNeeded(uploader))
+    {
+        return;
+    }
+
+    VkBufferMemoryBarrier barrier = {
+        .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .pNext               = NULL,
+        .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask       = 0,
+        .srcQueueFamilyIndex = uploader->transfer_queue.family_index,
+        .dstQueueFamilyIndex = uploader->graphics_queue.family_index,
+        .buffer              = buffer,
+        .offset              = offset,
+        .size                = size,
+    };
+    vkCmdPipelineBarrier(uploader->transfer_command_buffers[uploader->frame_index], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0,
+                         NULL, 1, &barrier, 0, NULL);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = dst_access;
+    vkCmdPipelineBarrier(uploader->graphics_command_buffers[uploader->frame_index], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dst_stage, 0, 0, NULL, 1, &barrier, 0,
+                         NULL);
+}
+
+void Uploader_TransferImage(const Uploader uploader[static 1], const VkImage image, const VkImageSubresourceRange range[static 1], const VkImageLayout layout,
+                            const VkPipelineStageFlags dst_stage, const VkAccessFlags dst_access)
+{
+    assert(uploader->recording);
+
+    if (!Uploader_IsQueueFamilyTransferNeeded(uploader))
+    {
+        return;
+    }
+
+    VkImageMemoryBarrier barrier = {
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext               = NULL,
+        .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask       = 0,
+        .oldLayout           = layout,
+        .newLayout           = layout,
+        .srcQueueFamilyIndex = uploader->transfer_queue.family_index,
+        .dstQueueFamilyIndex = uploader->graphics_queue.family_index,
+        .image               = image,
+        .subresourceRange    = *range,
+    };
+    vkCmdPipelineBarrier(uploader->transfer_command_buffers[uploader->frame_index], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0,
+                         NULL, 0, NULL, 1, &barrier);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = dst_access;
+    vkCmdPipelineBarrier(uploader->graphics_command_buffers[uploader->frame_index], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dst_stage, 0, 0, NULL, 0, NULL, 1,
+                         &barrier);
+}
+
+static bool SubmitTransfer(Uploader uploader[static 1])
+{
+    VK_ERROR_RETURN(vkEndCommandBuffer(uploader->transfer_command_buffers[uploader->frame_index]), true);
+    VK_ERROR_RETURN(vkEndCommandBuffer(uploader->graphics_command_buffers[uploader->frame_index]), true);
+
+    const uint64_t value                               = uploader->transfer_value + 1;
+    const VkTimelineSemaphoreSubmitInfo timeline_info = {
+        .sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .pNext                     = NULL,
+        .waitSemaphoreValueCount   = 0,
+        .pWaitSemaphoreValues      = NULL,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues    = &value,
+    };
+    const VkSubmitInfo submit_info = {
+        .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext                = &timeline_info,
+        .waitSemaphoreCount   = 0,
+        .pWaitSemaphores      = NULL,
+        .pWaitDstStageMask    = NULL,
+        .commandBufferCount   = 1,
+        .pCommandBuffers      = &uploader->transfer_command_buffers[uploader->frame_index],
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores    = &uploader->transfer_semaphore,
+    };
+    VK_ERROR_RETURN(vkQueueSubmit(uploader->transfer_queue.handle, 1, &submit_info, VK_NULL_HANDLE), true);
+
+    uploader->transfer_value = value;
+    uploader->recording      = false;
+    return false;
+}
+
+bool Uploader_Submit(Uploader uploader[static 1], const uint64_t graphics_value, bool pending[static 1])
+{
+    *pending = uploader->recording;
+    if (!uploader->recording)
+    {
+        return false;
+    }
+
+    if (SubmitTransfer(uploader))
+    {
+        return true;
+    }
+    uploader->frame_values[uploader->frame_index] = graphics_value;
+    return false;
+}
+
+bool Uploader_Flush(Uploader uploader[static 1])
+{
+    if (!uploader->recording)
+    {
+        return false;
+    }
+
+    if (SubmitTransfer(uploader))
+    {
+        return true;
+    }
+
+    const VkPipelineStageFlags wait_stage             = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    const VkTimelineSemaphoreSubmitInfo timeline_info = {
+        .sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .pNext                     = NULL,
+        .waitSemaphoreValueCount   = 1,
+        .pWaitSemaphoreValues      = &uploader->transfer_value,
+        .signalSemaphoreValueCount = 0,
+        .pSignalSemaphoreValues    = NULL,
+    };
+    const VkSubmitInfo submit_info = {
+        .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext                = &timeline_info,
+        .waitSemaphoreCount   = 1,
+        .pWaitSemaphores      = &uploader->transfer_semaphore,
+        .pWaitDstStageMask    = &wait_stage,
+        .commandBufferCount   = 1,
+        .pCommandBuffers      = &uploader->graphics_command_buffers[uploader->frame_index],
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores    = NULL,
+    };
+    VK_ERROR_RETURN(vkQueueSubmit(uploader->graphics_queue.handle, 1, &submit_info, VK_NULL_HANDLE), true);
+    VK_ERROR_RETURN(vkQueueWaitIdle(uploader->graphics_queue.handle), true);
+
+    return false;
+}
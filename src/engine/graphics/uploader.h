@@ -0,0 +1,99 @@
+#ifndef ROSINA_ENGINE_UPLOADER_H
+#define ROSINA_ENGINE_UPLOADER_H
+
+#include <engine/backend/vulkan_helpers.h>
+
+#define UPLOADER_FRAME_CAPACITY 3
+
+typedef enum UploaderComponent
+{
+    UPLOADER_TRANSFER_COMMAND_POOL_COMPONENT,
+    UPLOADER_GRAPHICS_COMMAND_POOL_COMPONENT,
+    UPLOADER_COMMAND_BUFFERS_COMPONENT,
+    UPLOADER_TRANSFER_SEMAPHORE_COMPONENT,
+    UPLOADER_GRAPHICS_SEMAPHORE_COMPONENT,
+    UPLOADER_COMPONENT_COUNT
+} UploaderComponent;
+
+/**
+ * Records copies into device local resources on the transfer queue, so they run next to the rendering instead of in
+ * front of it. Each frame slot has a transfer command buffer for the copies and a graphics command buffer that takes
+ * ownership of the written resources on the graphics queue. Both are begun by the first upload of a frame and submitted
+ * together with the frame, whose graphics submit then waits for transfer_semaphore. Frames without uploads do not wait.
+ */
+typedef struct Uploader
+{
+    uint32_t component_count;
+    UploaderComponent components[UPLOADER_COMPONENT_COUNT];
+    VkDevice device;
+    VulkanQueue transfer_queue;
+    VulkanQueue graphics_queue;
+    VkCommandPool transfer_command_pool;
+    VkCommandPool graphics_command_pool;
+    uint32_t frame_count;
+    VkCommandBuffer transfer_command_buffers[UPLOADER_FRAME_CAPACITY];
+    VkCommandBuffer graphics_command_buffers[UPLOADER_FRAME_CAPACITY];
+    // the graphics_semaphore value after which the command buffers of a frame slot can be reused
+    uint64_t frame_values[UPLOADER_FRAME_CAPACITY];
+
+    // signaled by the transfer submits, transfer_value is the last value submitted
+    VkSemaphore transfer_semaphore;
+    uint64_t transfer_value;
+    // signaled by the frame submits with the number of frames submitted
+    VkSemaphore graphics_semaphore;
+
+    bool recording;
+    uint32_t frame_index;
+} Uploader;
+
+void Uploader_Cleanup(Uploader uploader[static 1]);
+
+/**
+ * @return The created uploader. On error, the component_count field will be 0.
+ */
+Uploader Uploader_Create(const VulkanDevice device[static 1], const uint32_t frame_count);
+
+/**
+ * @return The transfer command buffer of the frame slot, in the recording state, or VK_NULL_HANDLE on error.
+ */
+VkCommandBuffer Uploader_Begin(Uploader uploader[static 1], const uint32_t frame_index);
+
+static inline bool Uploader_IsQueueFamilyTransferNeeded(const Uploader uploader[static 1])
+{
+    return uploader->transfer_queue.family_index != uploader->graphics_queue.family_index;
+}
+
+/**
+ * Hands a buffer range written by the transfer command buffer to the graphics queue. Must be recorded after the writes.
+ *
+ * @param dst_stage The stages that use the range first.
+ * @param dst_access The accesses those stages make.
+ */
+void Uploader_TransferBuffer(const Uploader uploader[static 1], const VkBuffer buffer, const VkDeviceSize offset, const VkDeviceSize size,
+                             const VkPipelineStageFlags dst_stage, const VkAccessFlags dst_access);
+
+/**
+ * Hands image subresources written by the transfer command buffer to the graphics queue, keeping their layout. Commands
+ * recorded into uploader->graphics_command_buffers[uploader->frame_index] after this can use them.
+ */
+void Uploader_TransferImage(const Uploader uploader[static 1], const VkImage image, const VkImageSubresourceRange range[static 1], const VkImageLayout layout,
+                            const VkPipelineStageFlags dst_stage, const VkAccessFlags dst_access);
+
+/**
+ * Ends and submits the transfer command buffer of the frame, if anything was recorded.
+ *
+ * @param graphics_value The graphics_semaphore value the frame submit signals.
+ * @param pending Set to whether the frame submit has to execute the graphics command buffer first and wait for
+ * transfer_semaphore to reach transfer_value.
+ * @return true on error.
+ */
+bool Uploader_Submit(Uploader uploader[static 1], const uint64_t graphics_value, bool pending[static 1]);
+
+/**
+ * Submits what has been recorded right away and waits for it, for uploads that have to finish before any frame is.
+ *
+ * @return true on error.
+ */
+bool Uploader_Flush(Uploader uploader[static 1]);
+
+#endif
@@ -0,0 +1,263 @@
+#include <engine/graphics/vertex_format.h>
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include <utility/pixel_convert.h>
+
+// VK_FORMAT_UNDEFINED where the encoding does not suit the attribute
+static const VkFormat attribute_formats[VERTEX_ATTRIBUTE_COUNT][VERTEX_ENCODING_COUNT] = {
+    [VERTEX_ATTRIBUTE_POSITION] = {
+        [VERTEX_ENCODING_FLOAT32] = VK_FORMAT_R32G32B32_SFLOAT,
+        [VERTEX_ENCODING_FLOAT16] = VK_FORMAT_R16G16B16A16_SFLOAT,
+    },
+    [VERTEX_ATTRIBUTE_UV] = {
+        [VERTEX_ENCODING_FLOAT32] = VK_FORMAT_R32G32_SFLOAT,
+        [VERTEX_ENCODING_FLOAT16] = VK_FORMAT_R16G16_SFLOAT,
+        [VERTEX_ENCODING_UNORM16] = VK_FORMAT_R16G16_UNORM,
+    },
+    [VERTEX_ATTRIBUTE_NORMAL] = {
+        [VERTEX_ENCODING_FLOAT32]           = VK_FORMAT_R32G32B32_SFLOAT,
+        [VERTEX_ENCODING_FLOAT16]           = VK_FORMAT_R16G16B16A16_SFLOAT,
+        [VERTEX_ENCODING_SNORM8_OCTAHEDRAL] = VK_FORMAT_R8G8_SNORM,
+    },
+    [VERTEX_ATTRIBUTE_TANGENT] = {
+        [VERTEX_ENCODING_FLOAT32]           = VK_FORMAT_R32G32B32A32_SFLOAT,
+        [VERTEX_ENCODING_FLOAT16]           = VK_FORMAT_R16G16B16A16_SFLOAT,
+        [VERTEX_ENCODING_SNORM8_OCTAHEDRAL] = VK_FORMAT_R8G8B8A8_SNORM,
+    },
+};
+
+// the bytes each attribute takes before it is padded to 4
+static const uint32_t attribute_sizes[VERTEX_ATTRIBUTE_COUNT][VERTEX_ENCODING_COUNT] = {
+    [VERTEX_ATTRIBUTE_POSITION] = {[VERTEX_ENCODING_FLOAT32] = 12, [VERTEX_ENCODING_FLOAT16] = 8},
+    [VERTEX_ATTRIBUTE_UV]       = {[VERTEX_ENCODING_FLOAT32] = 8, [VERTEX_ENCODING_FLOAT16] = 4, [VERTEX_ENCODING_UNORM16] = 4},
+    [VERTEX_ATTRIBUTE_NORMAL]   = {[VERTEX_ENCODING_FLOAT32] = 12, [VERTEX_ENCODING_FLOAT16] = 8, [VERTEX_ENCODING_SNORM8_OCTAHEDRAL] = 2},
+    [VERTEX_ATTRIBUTE_TANGENT]  = {[VERTEX_ENCODING_FLOAT32] = 16, [VERTEX_ENCODING_FLOAT16] = 8, [VERTEX_ENCODING_SNORM8_OCTAHEDRAL] = 4},
+};
+
+VertexFormat VertexFormat_Create(const VertexEncoding encodings[static VERTEX_ATTRIBUTE_COUNT])
+{
+    VertexFormat format = {.encodings = {}, .offsets = {}, .stride = 0};
+
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < VERTEX_ATTRIBUTE_COUNT; i++)
+    {
+        format.encodings[i] = encodings[i];
+        if (encodings[i] == VERTEX_ENCODING_NONE)
+        {
+            continue;
+        }
+        if (encodings[i] >= VERTEX_ENCODING_COUNT || attribute_formats[i][encodings[i]] == VK_FORMAT_UNDEFINED)
+        {
+            ROSINA_LOG_ERROR("Vertex attribute %u cannot be stored with encoding %u", i, (unsigned)encodings[i]);
+            format.stride = 0;
+            return format;
+        }
+        format.offsets[i] = offset;
+        offset += (attribute_sizes[i][encodings[i]] + 3) & ~3u;
+    }
+
+    format.stride = offset;
+    if (format.stride == 0)
+    {
+        ROSINA_LOG_ERROR("Vertex format has no attributes");
+    }
+    return format;
+}
+
+/**
+ * @return The largest error of rounding a float of this magnitude to a half float.
+ */
+static float GetHalfRoundingError(const float magnitude)
+{
+    if (magnitude >= 65504.0f)
+    {
+        return INFINITY;
+    }
+    // halves have 10 mantissa bits, and below 2^-14 they are spaced 2^-24 apart
+    int exponent = 0;
+    frexpf(magnitude, &exponent);
+    exponent = exponent - 1 < -14 ? -14 : exponent - 1;
+    return ldexpf(1.0f, exponent - 11);
+}
+
+void VertexFormat_Fit(const VertexEncoding encodings[static VERTEX_ATTRIBUTE_COUNT], const Vertex* const vertices, const uint32_t count,
+                      const MeshBounds bounds[static 1], VertexEncoding dest[static VERTEX_ATTRIBUTE_COUNT])
+{
+    float largest_position = 0.0f;
+    float largest_uv       = 0.0f;
+    bool uv_in_unit_range  = true;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            largest_position = fmaxf(largest_position, fabsf(vertices[i].position.data[c]));
+        }
+        for (uint32_t c = 0; c < 2; c++)
+        {
+            largest_uv       = fmaxf(largest_uv, fabsf(vertices[i].uv.data[c]));
+            uv_in_unit_range = uv_in_unit_range && vertices[i].uv.data[c] >= 0.0f && vertices[i].uv.data[c] <= 1.0f;
+        }
+    }
+
+    memmove(dest, encodings, sizeof(VertexEncoding) * VERTEX_ATTRIBUTE_COUNT);
+
+    if (dest[VERTEX_ATTRIBUTE_UV] == VERTEX_ENCODING_UNORM16 && !uv_in_unit_range)
+    {
+        ROSINA_LOG_INFO("Uvs go outside [0, 1], storing them as half floats");
+        dest[VERTEX_ATTRIBUTE_UV] = VERTEX_ENCODING_FLOAT16;
+    }
+    if (dest[VERTEX_ATTRIBUTE_UV] == VERTEX_ENCODING_FLOAT16 && GetHalfRoundingError(largest_uv) > VERTEX_FORMAT_MAX_UV_ERROR)
+    {
+        ROSINA_LOG_INFO("Uvs reach %g, storing them as floats", (double)largest_uv);
+        dest[VERTEX_ATTRIBUTE_UV] = VERTEX_ENCODING_FLOAT32;
+    }
+
+    // the error is relative to the mesh, so a small mesh far from its origin loses the most
+    const float position_error = GetHalfRoundingError(largest_position);
+    if (dest[VERTEX_ATTRIBUTE_POSITION] == VERTEX_ENCODING_FLOAT16 && position_error > VERTEX_FORMAT_MAX_POSITION_ERROR * bounds->radius)
+    {
+        ROSINA_LOG_INFO("Half float positions would be off by up to %g for a radius of %g, storing them as floats", (double)position_error,
+                        (double)bounds->radius);
+        dest[VERTEX_ATTRIBUTE_POSITION] = VERTEX_ENCODING_FLOAT32;
+    }
+}
+
+void VertexFormat_GetVkVertexInputAttributeDescription(const VertexFormat format[static 1], const uint32_t binding, uint32_t n[static 1],
+                                                       VkVertexInputAttributeDescription* const dest)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < VERTEX_ATTRIBUTE_COUNT; i++)
+    {
+        if (format->encodings[i] == VERTEX_ENCODING_NONE)
+        {
+            continue;
+        }
+        if (dest != NULL)
+        {
+            dest[count] = (VkVertexInputAttributeDescription){
+                .location = i,
+                .binding  = binding,
+                .format   = attribute_formats[i][format->encodings[i]],
+                .offset   = format->offsets[i],
+            };
+        }
+        count++;
+    }
+    *n = count;
+}
+
+static inline int8_t EncodeSnorm8(const float x)
+{
+    const float clamped = x < -1.0f ? -1.0f : (x > 1.0f ? 1.0f : x);
+    return (int8_t)lroundf(clamped * 127.0f);
+}
+
+static inline uint16_t EncodeUnorm16(const float x)
+{
+    const float clamped = x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+    return (uint16_t)lroundf(clamped * 65535.0f);
+}
+
+/**
+ * Projects the unit vector onto the octahedron |x| + |y| + |z| = 1 and folds the lower half over the upper one.
+ */
+static void EncodeOctahedral(const float v[static 3], int8_t dest[static 2])
+{
+    const float l1 = fabsf(v[0]) + fabsf(v[1]) + fabsf(v[2]);
+    float x        = l1 > 0.0f ? v[0] / l1 : 0.0f;
+    float y        = l1 > 0.0f ? v[1] / l1 : 0.0f;
+    if (v[2] < 0.0f)
+    {
+        const float folded_x = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float folded_y = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x                    = folded_x;
+        y                    = folded_y;
+    }
+    dest[0] = EncodeSnorm8(x);
+    dest[1] = EncodeSnorm8(y);
+}
+
+/**
+ * Writes the first n components of src, padded with pad up to the size of the encoding.
+ */
+static void EncodeFloats(const VertexEncoding encoding, const float* const src, const uint32_t n, const float pad, uint8_t* const dest)
+{
+    float padded[4] = {pad, pad, pad, pad};
+    memcpy(padded, src, sizeof(float) * n);
+
+    switch (encoding)
+    {
+        case VERTEX_ENCODING_FLOAT32:
+            memcpy(dest, padded, sizeof(float) * n);
+            break;
+        case VERTEX_ENCODING_FLOAT16:
+            // three components are padded to four
+            PixelConvert_F32ToF16((uint16_t*)dest, padded, n == 2 ? 2 : 4);
+            break;
+        case VERTEX_ENCODING_UNORM16:
+            for (uint32_t i = 0; i < n; i++)
+            {
+                const uint16_t value = EncodeUnorm16(padded[i]);
+                memcpy(dest + i * sizeof(uint16_t), &value, sizeof(uint16_t));
+            }
+            break;
+        case VERTEX_ENCODING_SNORM8_OCTAHEDRAL:
+            EncodeOctahedral(padded, (int8_t*)dest);
+            if (n == 4)
+            {
+                dest[2] = 0;
+                dest[3] = (uint8_t)EncodeSnorm8(padded[3] < 0.0f ? -1.0f : 1.0f);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void VertexFormat_Encode(const VertexFormat format[static 1], const Vertex* const src, const uint32_t count, void* const dest)
+{
+    uint8_t* vertex = dest;
+    for (uint32_t v = 0; v < count; v++, vertex += format->stride)
+    {
+        // padding is zeroed so the encoded vertices hash and compare the same every time
+        memset(vertex, 0, format->stride);
+
+        const VertexEncoding* const encodings = format->encodings;
+        const uint32_t* const offsets         = format->offsets;
+        if (encodings[VERTEX_ATTRIBUTE_POSITION] != VERTEX_ENCODING_NONE)
+        {
+            EncodeFloats(encodings[VERTEX_ATTRIBUTE_POSITION], src[v].position.data, 3, 1.0f, vertex + offsets[VERTEX_ATTRIBUTE_POSITION]);
+        }
+        if (encodings[VERTEX_ATTRIBUTE_UV] != VERTEX_ENCODING_NONE)
+        {
+            EncodeFloats(encodings[VERTEX_ATTRIBUTE_UV], src[v].uv.data, 2, 0.0f, vertex + offsets[VERTEX_ATTRIBUTE_UV]);
+        }
+        if (encodings[VERTEX_ATTRIBUTE_NORMAL] != VERTEX_ENCODING_NONE)
+        {
+            EncodeFloats(encodings[VERTEX_ATTRIBUTE_NORMAL], src[v].normal.data, 3, 0.0f, vertex + offsets[VERTEX_ATTRIBUTE_NORMAL]);
+        }
+        if (encodings[VERTEX_ATTRIBUTE_TANGENT] != VERTEX_ENCODING_NONE)
+        {
+            EncodeFloats(encodings[VERTEX_ATTRIBUTE_TANGENT], src[v].tangent.data, 4, 0.0f, vertex + offsets[VERTEX_ATTRIBUTE_TANGENT]);
+        }
+    }
+}
+
+void VertexFormat_EncodeIndices(const VkIndexType index_type, const uint32_t* const src, const uint32_t count, void* const dest)
+{
+    if (index_type == VK_INDEX_TYPE_UINT32)
+    {
+        memcpy(dest, src, sizeof(uint32_t) * count);
+        return;
+    }
+
+    uint16_t* const indices = dest;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        assert(src[i] < VERTEX_FORMAT_UINT16_VERTEX_LIMIT);
+        indices[i] = (uint16_t)src[i];
+    }
+}
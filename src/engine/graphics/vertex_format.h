@@ -0,0 +1,133 @@
+#ifndef ROSINA_ENGINE_VERTEX_FORMAT_H
+#define ROSINA_ENGINE_VERTEX_FORMAT_H
+
+#include <engine/backend/vulkan_helpers.h>
+#include <utility/mesh.h>
+
+// meshes with fewer vertices than this are drawn with 16 bit indices
+#define VERTEX_FORMAT_UINT16_VERTEX_LIMIT 65536
+// the largest rounding error VertexFormat_Fit lets a position have, relative to the bounding radius of its mesh
+#define VERTEX_FORMAT_MAX_POSITION_ERROR (1.0f / 1024.0f)
+// the largest rounding error VertexFormat_Fit lets a uv have, half a texel of a 1024 texture
+#define VERTEX_FORMAT_MAX_UV_ERROR (1.0f / 2048.0f)
+
+/**
+ * The attributes a vertex can have. Each one is always read from the shader location of the same value, so shaders
+ * do not depend on which attributes a format leaves out.
+ */
+typedef enum VertexAttribute
+{
+    VERTEX_ATTRIBUTE_POSITION,
+    VERTEX_ATTRIBUTE_UV,
+    VERTEX_ATTRIBUTE_NORMAL,
+    VERTEX_ATTRIBUTE_TANGENT,
+    VERTEX_ATTRIBUTE_COUNT
+} VertexAttribute;
+
+/**
+ * How an attribute is stored in the vertex buffer. Not every encoding suits every attribute, see
+ * VertexFormat_Create.
+ */
+typedef enum VertexEncoding
+{
+    // the attribute is left out
+    VERTEX_ENCODING_NONE,
+    VERTEX_ENCODING_FLOAT32,
+    // positions get a fourth component of 1, since three component half floats are not a required vertex format
+    VERTEX_ENCODING_FLOAT16,
+    // normals and tangents only. A unit vector folded onto an octahedron in two snorm8 components e, tangents add the
+    // sign of the bitangent in the fourth one. Shaders unfold it as n = vec3(e, 1 - |e.x| - |e.y|), and where n.z < 0
+    // n.xy = (1 - |n.yx|) * sign(n.xy), then normalize n.
+    VERTEX_ENCODING_SNORM8_OCTAHEDRAL,
+    // uvs only, clamped to [0, 1]. VertexFormat_Fit replaces it for uvs that wrap or tile
+    VERTEX_ENCODING_UNORM16,
+    VERTEX_ENCODING_COUNT
+} VertexEncoding;
+
+/**
+ * The layout of the vertices in one vertex buffer binding.
+ */
+typedef struct VertexFormat
+{
+    VertexEncoding encodings[VERTEX_ATTRIBUTE_COUNT];
+    uint32_t offsets[VERTEX_ATTRIBUTE_COUNT];
+    uint32_t stride;
+} VertexFormat;
+
+/**
+ * The layout the engine used before there were vertex formats, 32 bit positions and uvs.
+ */
+static const VertexEncoding VERTEX_FORMAT_FULL_PRECISION[VERTEX_ATTRIBUTE_COUNT] = {
+    [VERTEX_ATTRIBUTE_POSITION] = VERTEX_ENCODING_FLOAT32,
+    [VERTEX_ATTRIBUTE_UV]       = VERTEX_ENCODING_FLOAT32,
+    [VERTEX_ATTRIBUTE_NORMAL]   = VERTEX_ENCODING_NONE,
+    [VERTEX_ATTRIBUTE_TANGENT]  = VERTEX_ENCODING_NONE,
+};
+
+/**
+ * Half float positions, unorm16 uvs and octahedral normals and tangents, 20 bytes instead of 48. Pass it through
+ * VertexFormat_Fit for meshes that may not suit it.
+ */
+static const VertexEncoding VERTEX_FORMAT_QUANTIZED[VERTEX_ATTRIBUTE_COUNT] = {
+    [VERTEX_ATTRIBUTE_POSITION] = VERTEX_ENCODING_FLOAT16,
+    [VERTEX_ATTRIBUTE_UV]       = VERTEX_ENCODING_UNORM16,
+    [VERTEX_ATTRIBUTE_NORMAL]   = VERTEX_ENCODING_SNORM8_OCTAHEDRAL,
+    [VERTEX_ATTRIBUTE_TANGENT]  = VERTEX_ENCODING_SNORM8_OCTAHEDRAL,
+};
+
+/**
+ * Lays the attributes out in the order of VertexAttribute, each aligned to 4 bytes.
+ *
+ * @param encodings One encoding per VertexAttribute.
+ * @return The format. On error, the stride field will be 0.
+ */
+VertexFormat VertexFormat_Create(const VertexEncoding encodings[static VERTEX_ATTRIBUTE_COUNT]);
+
+/**
+ * Widens the encodings that would lose too much of these vertices: unorm16 uvs outside [0, 1], and half float uvs and
+ * positions whose rounding error goes over VERTEX_FORMAT_MAX_UV_ERROR or VERTEX_FORMAT_MAX_POSITION_ERROR. Logs every
+ * attribute it widens.
+ *
+ * @param encodings One encoding per VertexAttribute.
+ * @param bounds The bounds of the vertices.
+ * @param dest Set to encodings, with the widened ones replaced. May equal encodings.
+ */
+void VertexFormat_Fit(const VertexEncoding encodings[static VERTEX_ATTRIBUTE_COUNT], const Vertex* const vertices, const uint32_t count,
+                      const MeshBounds bounds[static 1], VertexEncoding dest[static VERTEX_ATTRIBUTE_COUNT]);
+
+/**
+ * @param n The number of VkVertexInputAttributeDescription needed.
+ * @param dest A pointer to an array of n VkVertexInputAttributeDescriptions. If NULL, only n will be set.
+ */
+void VertexFormat_GetVkVertexInputAttributeDescription(const VertexFormat format[static 1], const uint32_t binding, uint32_t n[static 1],
+                                                       VkVertexInputAttributeDescription* const dest);
+
+static inline VkVertexInputBindingDescription VertexFormat_GetVkVertexInputBindingDescription(const VertexFormat format[static 1], const uint32_t binding)
+{
+    return (VkVertexInputBindingDescription){.binding = binding, .stride = format->stride, .inputRate = VK_VERTEX_INPUT_RATE_VERTEX};
+}
+
+/**
+ * Encodes count vertices into dest, which has room for count * format->stride bytes.
+ */
+void VertexFormat_Encode(const VertexFormat format[static 1], const Vertex* const src, const uint32_t count, void* const dest);
+
+/**
+ * @return The smallest index type that can address vertex_count vertices.
+ */
+static inline VkIndexType VertexFormat_GetIndexType(const uint32_t vertex_count)
+{
+    return vertex_count < VERTEX_FORMAT_UINT16_VERTEX_LIMIT ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+static inline uint32_t VertexFormat_GetIndexSize(const VkIndexType index_type)
+{
+    return index_type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+/**
+ * Writes count indices as index_type into dest. Every index must fit index_type.
+ */
+void VertexFormat_EncodeIndices(const VkIndexType index_type, const uint32_t* const src, const uint32_t count, void* const dest);
+
+#endif
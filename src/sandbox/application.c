@@ -1,8 +1,13 @@
 #include <sandbox/application.h>
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <utility/ktx2.h>
+#include <utility/mesh_lod.h>
+#include <utility/mesh_optimizer.h>
+
 static inline bool CreateVulkanGraphicsPipeline(const VulkanDevice device[static 1], const VulkanGraphicsPipelineCreateInfo create_info[static 1],
                                   VulkanGraphicsPipeline pipeline[static 1])
 {
@@ -40,21 +45,12 @@ static inline bool CreateVulkanGraphicsPipeline(const VulkanDevice device[static
             .pName               = "main",
             .pSpecializationInfo = NULL,
         }};
-        // Shader_GetVkVertexInputAttributeDescription
-        const VkVertexInputAttributeDescription vertex_attrib_descriptions[] = {
-            {.location = 0, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = 0},
-            { .location = 1, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = sizeof(float) * 3 },
-        };
-        // Shader_GetVkVertexInputAttributeDescription
-        const VkVertexInputBindingDescription vertex_binding_descriptions[] = {
-            {.binding = 0, .stride = (sizeof(float) * 5), .inputRate = VK_VERTEX_INPUT_RATE_VERTEX}
-        };
         const VkPipelineVertexInputStateCreateInfo vertex_input_info = {
             .sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-            .vertexBindingDescriptionCount   = sizeof(vertex_binding_descriptions) / sizeof(VkVertexInputBindingDescription),
-            .pVertexBindingDescriptions      = vertex_binding_descriptions,
-            .vertexAttributeDescriptionCount = sizeof(vertex_attrib_descriptions) / sizeof(VkVertexInputAttributeDescription),
-            .pVertexAttributeDescriptions    = vertex_attrib_descriptions
+            .vertexBindingDescriptionCount   = create_info->vertex_binding_count,
+            .pVertexBindingDescriptions      = create_info->vertex_bindings,
+            .vertexAttributeDescriptionCount = create_info->vertex_attribute_count,
+            .pVertexAttributeDescriptions    = create_info->vertex_attributes
         };
 
         const VkPipelineInputAssemblyStateCreateInfo input_assembly_info = {
@@ -142,9 +138,20 @@ static inline bool CreateVulkanGraphicsPipeline(const VulkanDevice device[static
             .pDynamicStates    = dynamic_states
         };
 
+        VkPipelineCreationFeedback stage_feedbacks[sizeof(shader_stages) / sizeof(VkPipelineShaderStageCreateInfo)] = {};
+
+        VkPipelineCreationFeedback pipeline_feedback        = {};
+        const VkPipelineCreationFeedbackCreateInfo feedback = {
+            .sType                              = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+            .pNext                              = NULL,
+            .pPipelineCreationFeedback          = &pipeline_feedback,
+            .pipelineStageCreationFeedbackCount = sizeof(stage_feedbacks) / sizeof(VkPipelineCreationFeedback),
+            .pPipelineStageCreationFeedbacks    = stage_feedbacks,
+        };
+
         const VkGraphicsPipelineCreateInfo pipeline_create_info = {
             .sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-            .pNext               = NULL,
+            .pNext               = &feedback,
             .flags               = 0,
             .stageCount          = sizeof(shader_stages) / sizeof(VkPipelineShaderStageCreateInfo),
             .pStages             = shader_stages,
@@ -164,25 +171,40 @@ static inline bool CreateVulkanGraphicsPipeline(const VulkanDevice device[static
             .basePipelineIndex   = 0
         };
 
-        VK_ERROR_HANDLE(vkCreateGraphicsPipelines(device->handle, VK_NULL_HANDLE, 1, &pipeline_create_info, NULL, &pipeline->handle), {
+        VK_ERROR_HANDLE(vkCreateGraphicsPipelines(device->handle, create_info->cache, 1, &pipeline_create_info, NULL, &pipeline->handle), {
             vkDestroyPipelineLayout(device->handle, pipeline->layout, NULL);
             pipeline->layout = VK_NULL_HANDLE;
             return true;
         });
+        VulkanPipelineFeedback_Log("graphics", &feedback);
     }
 
     return false;
 }
 
-static inline bool Renderer_InitializeGraphicsPipeline(Renderer renderer[static 1], Shader shader[static 1])
+static inline bool Renderer_InitializeGraphicsPipeline(Renderer renderer[static 1], Shader shader[static 1], const VertexFormat vertex_format[static 1])
 {
+    // the vertices, then the instances
+    const VkVertexInputBindingDescription vertex_bindings[] = {VertexFormat_GetVkVertexInputBindingDescription(vertex_format, 0),
+                                                               Instancing_GetVkVertexInputBindingDescription()};
+    VkVertexInputAttributeDescription vertex_attributes[VERTEX_ATTRIBUTE_COUNT + INSTANCE_ATTRIBUTE_COUNT];
+    uint32_t vertex_attribute_count;
+    VertexFormat_GetVkVertexInputAttributeDescription(vertex_format, 0, &vertex_attribute_count, vertex_attributes);
+    Instancing_GetVkVertexInputAttributeDescriptions(vertex_attributes + vertex_attribute_count);
+    vertex_attribute_count += INSTANCE_ATTRIBUTE_COUNT;
+
     const VulkanGraphicsPipelineCreateInfo pipeline_create_info = {
         .render_pass            = &renderer->render_pass,
         .vertex_shader_module   = shader->vertex_module,
         .fragment_shader_module = shader->fragment_module,
         .shader_layout          = shader->layout,
+        .vertex_binding_count   = sizeof(vertex_bindings) / sizeof(VkVertexInputBindingDescription),
+        .vertex_bindings        = vertex_bindings,
+        .vertex_attribute_count = vertex_attribute_count,
+        .vertex_attributes      = vertex_attributes,
         .width                  = renderer->window.width,
-        .height                 = renderer->window.height
+        .height                 = renderer->window.height,
+        .cache                  = renderer->pipeline_cache
     };
     if (CreateVulkanGraphicsPipeline(&renderer->device, &pipeline_create_info, &renderer->graphics_pipeline))
     {
@@ -215,6 +237,30 @@ void Application_Cleanup(Application application[static 1])
             case APPLICATION_IMAGE_COMPONENT:
                 Image_Cleanup(&application->renderer, &application->image);
                 break;
+            case APPLICATION_ASSET_CACHE_COMPONENT:
+                AssetCache_Cleanup(&application->asset_cache);
+                break;
+            case APPLICATION_TEXTURE_STREAMER_COMPONENT:
+                TextureStreamer_Cleanup(&application->renderer, &application->texture_streamer);
+                break;
+            case APPLICATION_RESIDENCY_MANAGER_COMPONENT:
+                ResidencyManager_Cleanup(&application->residency_manager);
+                break;
+            case APPLICATION_MESH_COMPONENT:
+                Mesh_Cleanup(&application->mesh);
+                break;
+            case APPLICATION_MESHLETS_COMPONENT:
+                Meshlets_Cleanup(&application->meshlets);
+                free(application->meshlet_draws);
+                break;
+            case APPLICATION_INSTANCES_COMPONENT:
+                InstanceBatcher_Cleanup(&application->instance_batcher);
+                free(application->instance_lods);
+                RenderQueue_Cleanup(&application->render_queue);
+                break;
+            case APPLICATION_GPU_SCENE_COMPONENT:
+                GpuScene_Cleanup(&application->renderer, &application->gpu_scene);
+                break;
             default:
                 ROSINA_LOG_ERROR("Invalid application component!");
                 assert(false);
@@ -226,9 +272,239 @@ void HandleKeyboardKeyEvent(const Event e) { printf("Event{%d, %d}\n", (int)e.ke
 
 void HandleMouseButtonEvent(const Event e) { printf("Event{%d, %d}\n", (int)e.keyboard_key, (int)e.type); }
 
+static const char* const texture_path = "/home/dlk/Pictures/vk_tutorial_texture.jpg";
+
+static const Vertex quad_vertices[] = {
+    {.position = {{-0.8f, -0.8f, 0.1f}}, .uv = {{1.0f, 0.0f}}},
+    {.position = {{ 0.8f, -0.8f, 0.1f}}, .uv = {{0.0f, 0.0f}}},
+    {.position = {{ 0.8f,  0.8f, 0.1f}}, .uv = {{0.0f, 1.0f}}},
+    {.position = {{-0.8f,  0.8f, 0.1f}}, .uv = {{1.0f, 1.0f}}}
+};
+static const uint32_t quad_indices[] = {0, 1, 2, 3, 2, 0};
+#define QUAD_VERTEX_COUNT (sizeof(quad_vertices) / sizeof(Vertex))
+#define QUAD_INDEX_COUNT  (sizeof(quad_indices) / sizeof(uint32_t))
+
+// the shaders only read positions and uvs
+static const VertexEncoding mesh_encodings[VERTEX_ATTRIBUTE_COUNT] = {
+    [VERTEX_ATTRIBUTE_POSITION] = VERTEX_ENCODING_FLOAT16,
+    [VERTEX_ATTRIBUTE_UV]       = VERTEX_ENCODING_UNORM16,
+    [VERTEX_ATTRIBUTE_NORMAL]   = VERTEX_ENCODING_NONE,
+    [VERTEX_ATTRIBUTE_TANGENT]  = VERTEX_ENCODING_NONE,
+};
+
+/**
+ * Loads the mesh from path, or falls back to the quad when path is NULL or fails to load.
+ *
+ * @return true on error.
+ */
+static bool LoadMeshData(const char* const path, Mesh mesh[static 1])
+{
+    if (path != NULL)
+    {
+        if (Mesh_Load(path, mesh) == false)
+        {
+            if (Mesh_Optimize(mesh) == false)
+            {
+                return false;
+            }
+            Mesh_Cleanup(mesh);
+        }
+        ROSINA_LOG_ERROR("Failed to load %s, drawing the quad instead", path);
+    }
+    return Mesh_Create(quad_vertices, QUAD_VERTEX_COUNT, quad_indices, QUAD_INDEX_COUNT, mesh);
+}
+
+/**
+ * Creates the buffer objects of the mesh and records their upload into the frame being recorded.
+ *
+ * @return true on error.
+ */
+static bool UploadMesh(Application application[static 1])
+{
+    if (application->mesh_file_path != NULL)
+    {
+        return MeshLoader_Upload(&application->renderer, &application->buffer_memory, application->mesh_file_path, &application->mesh_file_info,
+                                 &application->vbo, &application->ibo);
+    }
+
+    const Mesh* const mesh           = &application->mesh;
+    const VkDeviceSize vertices_size = (VkDeviceSize)application->vertex_format.stride * mesh->vertex_count;
+    const VkDeviceSize indices_size  = (VkDeviceSize)VertexFormat_GetIndexSize(application->index_type) * mesh->index_count;
+    application->vbo                 = VertexBufferObject_Create(vertices_size, &application->buffer_memory);
+    application->ibo                 = IndexBufferObject_Create(indices_size, &application->buffer_memory);
+    if (application->vbo.offset == UINT64_MAX || application->ibo.offset == UINT64_MAX)
+    {
+        ROSINA_LOG_ERROR("Out of buffer memory");
+        VertexBufferObject_Cleanup(&application->buffer_memory, &application->vbo);
+        IndexBufferObject_Cleanup(&application->buffer_memory, &application->ibo);
+        return true;
+    }
+
+    uint8_t* const vertices = malloc(vertices_size);
+    uint8_t* const indices  = malloc(indices_size);
+    if (vertices == NULL || indices == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate encoded mesh");
+        free(vertices);
+        free(indices);
+        VertexBufferObject_Cleanup(&application->buffer_memory, &application->vbo);
+        IndexBufferObject_Cleanup(&application->buffer_memory, &application->ibo);
+        return true;
+    }
+    VertexFormat_Encode(&application->vertex_format, mesh->vertices, mesh->vertex_count, vertices);
+    VertexFormat_EncodeIndices(application->index_type, mesh->indices, mesh->index_count, indices);
+
+    const bool failed = VertexBufferObject_Write(&application->renderer, &application->buffer_memory, &application->vbo, vertices) ||
+                        IndexBufferObject_Write(&application->renderer, &application->buffer_memory, &application->ibo, indices);
+    free(vertices);
+    free(indices);
+    if (failed)
+    {
+        ROSINA_LOG_ERROR("Failed to write the mesh");
+        VertexBufferObject_Cleanup(&application->buffer_memory, &application->vbo);
+        IndexBufferObject_Cleanup(&application->buffer_memory, &application->ibo);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Creates the image from texture_path and records its upload into the frame being recorded.
+ *
+ * @return true on error.
+ */
+static bool UploadImage(Application application[static 1])
+{
+    const ImageCreateInfo image_create_info = {
+        .path              = texture_path,
+        .premultiply_alpha = false,
+        .base_mip_level    = 0,
+    };
+    application->image = Image_Create(&application->renderer, &image_create_info);
+    if (application->image.handle == VK_NULL_HANDLE)
+    {
+        ROSINA_LOG_ERROR("Failed to create image");
+        return true;
+    }
+
+    StagingAllocation image_staging;
+    if (Renderer_AllocateStaging(&application->renderer, Image_CalculateSize(&application->image), IMAGE_STAGING_ALIGNMENT, &image_staging) ||
+        Image_LoadStagingData(&application->image, texture_path, &application->asset_cache, image_staging.mapped))
+    {
+        ROSINA_LOG_ERROR("Failed to load image into staging memory");
+        Image_Cleanup(&application->renderer, &application->image);
+        return true;
+    }
+
+    if (Image_Upload(&application->renderer, &application->image, image_staging.buffer, image_staging.offset))
+    {
+        ROSINA_LOG_ERROR("Failed to upload image");
+        Image_Cleanup(&application->renderer, &application->image);
+        return true;
+    }
+    return false;
+}
+
+static bool LoadMesh(Renderer* const renderer, void* const user_data)
+{
+    Application* const application = user_data;
+    if (UploadMesh(application))
+    {
+        return true;
+    }
+    VertexBufferObject_SetMovable(&application->buffer_memory, &application->vbo);
+    IndexBufferObject_SetMovable(&application->buffer_memory, &application->ibo);
+    return false;
+}
+
+static void EvictMesh(Renderer* const renderer, void* const user_data)
+{
+    Application* const application = user_data;
+    VertexBufferObject_Cleanup(&application->buffer_memory, &application->vbo);
+    IndexBufferObject_Cleanup(&application->buffer_memory, &application->ibo);
+}
+
+static bool LoadImage(Renderer* const renderer, void* const user_data)
+{
+    Application* const application = user_data;
+    if (UploadImage(application))
+    {
+        return true;
+    }
+    Shader_SetImage(&application->shader, &application->image);
+    return false;
+}
+
+static void EvictImage(Renderer* const renderer, void* const user_data)
+{
+    // the frames that sampled it have finished, and the sets still naming it are rewritten by LoadImage before the next bind
+    Application* const application = user_data;
+    Image_Cleanup(renderer, &application->image);
+}
+
+/**
+ * Places instance i on a square grid around the origin, far enough apart that the bounding spheres do not touch.
+ */
+static Mat4f GetInstanceModel(const Application application[static 1], const uint32_t i)
+{
+    const MeshBounds* const bounds = application->mesh_file_path != NULL ? &application->mesh_file_info.bounds : &application->mesh.bounds;
+    const uint32_t side            = (uint32_t)ceilf(SquareRoot((float)application->instance_count));
+    const float spacing            = 2.5f * bounds->radius;
+    const Vec3f position           = {{((float)(i % side) - (0.5f * (float)(side - 1))) * spacing, 0.0f, ((float)(i / side) - (0.5f * (float)(side - 1))) * spacing}};
+    return Mat4f_Translation(&position);
+}
+
+/**
+ * Uploads the mesh and every instance into application->gpu_scene once. Falls back to culling on the CPU when the
+ * device cannot draw a GpuScene.
+ *
+ * @return true on error.
+ */
+static bool CreateGpuScene(Application application[static 1])
+{
+    const GpuSceneCreateInfo gpu_scene_create_info = {
+        .shader_path       = SANDBOX_COMPILED_SHADER_DIR "cull.spv",
+        .instance_capacity = application->instance_count,
+        .mesh_capacity     = 1,
+        .pipeline_count    = 1,
+    };
+    application->gpu_scene = GpuScene_Create(&application->renderer, &gpu_scene_create_info);
+    if (application->gpu_scene.component_count == 0)
+    {
+        ROSINA_LOG_ERROR("Failed to create GPU scene, culling on the CPU instead");
+        return false;
+    }
+    application->components[application->component_count++] = APPLICATION_GPU_SCENE_COMPONENT;
+
+    const MeshBounds* const bounds = application->mesh_file_path != NULL ? &application->mesh_file_info.bounds : &application->mesh.bounds;
+    GpuMesh* const mesh            = GpuScene_MapMeshes(&application->renderer, &application->gpu_scene, 0, 1);
+    InstanceData* const instances  = GpuScene_MapInstances(&application->renderer, &application->gpu_scene, 0, application->instance_count);
+    if (mesh == NULL || instances == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to upload GPU scene");
+        return true;
+    }
+
+    *mesh = GpuMesh_Create(bounds, application->lods, application->lod_count, 0);
+    for (uint32_t i = 0; i < application->instance_count; i++)
+    {
+        instances[i] = (InstanceData){.model = GetInstanceModel(application, i), .material_index = 0, .mesh = 0, .pipeline = 0, .padding = 0};
+    }
+    application->gpu_driven = true;
+    return false;
+}
+
 Application Application_Create()
 {
-    Application application = {.component_count = 0, .components = {}};
+    Application application = {
+        .component_count  = 0,
+        .components       = {},
+        .mesh_file_path   = NULL,
+        .streamed_texture = UINT32_MAX,
+        .mesh_resource    = RESIDENCY_MANAGER_NONE,
+        .image_resource   = RESIDENCY_MANAGER_NONE,
+    };
 
     application.renderer = Renderer_Create();
     if (application.renderer.component_count == 0)
@@ -239,15 +515,9 @@ Application Application_Create()
     }
     application.components[application.component_count++] = APPLICATION_RENDERER_COMPONENT;
 
-    const float x = 0.8f;
-    const float vertices[] = {
-        -x, -x, 0.1f, 1.0f, 0.0f,
-         x, -x, 0.1f, 0.0f, 0.0f,
-         x,  x, 0.1f, 0.0f, 1.0f,
-        -x, x, 0.1f, 1.0f, 1.0f
-    };
-    const uint32_t indices[] = {0, 1, 2, 3, 2, 0};
-    Mat4f mvp[3]             = {Mat4f_Identity(), Mat4f_Identity(), Mat4f_Identity()};
+    application.mvp[0]       = Mat4f_Identity();
+    application.mvp[1]       = Mat4f_Identity();
+    application.mvp[2]       = Mat4f_Identity();
 
     // memory
     {
@@ -256,16 +526,126 @@ Application Application_Create()
         application.components[application.component_count++] = APPLICATION_MEMORY_ARENA_COMPONENT;
     }
 
+    // asset cache
+    {
+        const AssetCacheCreateInfo asset_cache_create_info = {
+            .directory = ".asset_cache",
+            .max_size  = 512ull * 1024 * 1024,
+        };
+        // without a cache directory every asset is processed on load
+        application.asset_cache = AssetCache_Create(&asset_cache_create_info);
+
+        application.components[application.component_count++] = APPLICATION_ASSET_CACHE_COMPONENT;
+    }
+
+    // mesh
+    uint32_t vertex_count = 0;
+    {
+        const char* const path = getenv(SANDBOX_MESH_VARIABLE);
+        if (path != NULL && MeshFile_Is(path))
+        {
+            // baked meshes are read straight into buffer memory and never parsed
+            if (MeshLoader_ReadInfo(path, &application.mesh_file_info, &application.vertex_format, &application.index_type))
+            {
+                Application_Cleanup(&application);
+                return application;
+            }
+            application.mesh_file_path = path;
+            application.index_count    = application.mesh_file_info.index_count;
+            application.lod_count      = application.mesh_file_info.lod_count;
+            vertex_count               = application.mesh_file_info.vertex_count;
+            memcpy(application.lods, application.mesh_file_info.lods, sizeof(MeshLod) * application.lod_count);
+        }
+        else
+        {
+            if (LoadMeshData(path, &application.mesh))
+            {
+                Application_Cleanup(&application);
+                return application;
+            }
+            application.components[application.component_count++] = APPLICATION_MESH_COMPONENT;
+
+            const MeshLodCreateInfo lod_info = {
+                .max_lod_count      = MESH_LOD_MAX_COUNT,
+                .reduction          = MESH_LOD_DEFAULT_REDUCTION,
+                .min_triangle_count = MESH_LOD_DEFAULT_MIN_TRIANGLE_COUNT,
+                .max_error          = MESH_LOD_DEFAULT_MAX_ERROR,
+            };
+            if (Mesh_GenerateLods(&application.mesh, &lod_info, application.lods, &application.lod_count))
+            {
+                Application_Cleanup(&application);
+                return application;
+            }
+
+            VertexEncoding encodings[VERTEX_ATTRIBUTE_COUNT];
+            VertexFormat_Fit(mesh_encodings, application.mesh.vertices, application.mesh.vertex_count, &application.mesh.bounds, encodings);
+            application.vertex_format = VertexFormat_Create(encodings);
+            application.index_type    = VertexFormat_GetIndexType(application.mesh.vertex_count);
+            application.index_count   = application.mesh.index_count;
+            vertex_count              = application.mesh.vertex_count;
+            if (application.vertex_format.stride == 0)
+            {
+                Application_Cleanup(&application);
+                return application;
+            }
+        }
+    }
+
+    // meshlets
+    {
+        // built for the full mesh only
+        Mesh full_mesh        = application.mesh;
+        full_mesh.index_count = application.lods[0].index_count;
+        if (application.mesh_file_path != NULL ? MeshFile_ReadMeshlets(application.mesh_file_path, &application.mesh_file_info, &application.meshlets)
+                                                : Meshlets_Build(&full_mesh, &application.meshlets))
+        {
+            Application_Cleanup(&application);
+            return application;
+        }
+        application.meshlet_draws = malloc(sizeof(MeshletDraw) * (application.meshlets.meshlet_count > 0 ? application.meshlets.meshlet_count : 1));
+        if (application.meshlet_draws == NULL)
+        {
+            ROSINA_LOG_ERROR("Failed to allocate meshlet draws");
+            Meshlets_Cleanup(&application.meshlets);
+            Application_Cleanup(&application);
+            return application;
+        }
+        application.components[application.component_count++] = APPLICATION_MESHLETS_COMPONENT;
+    }
+
+    // instances
+    {
+        const char* const count = getenv(SANDBOX_INSTANCE_COUNT_VARIABLE);
+        application.instance_count   = count != NULL ? (uint32_t)strtoul(count, NULL, 10) : 1;
+        application.instance_count   = application.instance_count > 0 ? application.instance_count : 1;
+        application.instance_batcher = InstanceBatcher_Create(application.instance_count);
+        application.instance_lods    = calloc(application.instance_count, sizeof(uint32_t));
+        application.render_queue     = RenderQueue_Create(application.meshlets.meshlet_count + MESH_LOD_MAX_COUNT);
+        if (application.instance_batcher.objects == NULL || application.instance_lods == NULL || application.render_queue.keys == NULL)
+        {
+            ROSINA_LOG_ERROR("Failed to allocate %u instances", application.instance_count);
+            InstanceBatcher_Cleanup(&application.instance_batcher);
+            free(application.instance_lods);
+            RenderQueue_Cleanup(&application.render_queue);
+            Application_Cleanup(&application);
+            return application;
+        }
+        application.components[application.component_count++] = APPLICATION_INSTANCES_COMPONENT;
+    }
+
     // buffer memory
     {
         // BufferMemory_Create rounds BufferMemoryCreateInfo fields to appropriate offsets
         BufferMemoryCreateInfo buffer_memory_create_info = {
-            .vertex_buffer_capacity  = sizeof(vertices),
-            .index_buffer_capacity   = sizeof(indices),
-            .uniform_buffer_capacity = sizeof(mvp) * application.renderer.frame_count,
+            .vertex_buffer_capacity  = (VkDeviceSize)application.vertex_format.stride * vertex_count,
+            .index_buffer_capacity   = (VkDeviceSize)VertexFormat_GetIndexSize(application.index_type) * application.index_count,
+            .uniform_buffer_capacity = 0,
+            .max_object_count        = 64,
+            .defragment_budget       = 1 << 20,
+            .host_writable           = true,
         };
         application.buffer_memory = BufferMemory_Create(&application.renderer, &buffer_memory_create_info);
-        if (application.buffer_memory.handle == VK_NULL_HANDLE)
+        if (application.buffer_memory.allocation.memory == VK_NULL_HANDLE)
         {
             ROSINA_LOG_ERROR("Failed to create buffer memory");
             Application_Cleanup(&application);
@@ -274,15 +654,56 @@ Application Application_Create()
         application.components[application.component_count++] = APPLICATION_BUFFER_MEMORY_COMPONENT;
     }
 
-    // image
+    // residency manager
+    {
+        const ResidencyManagerCreateInfo residency_manager_create_info = {
+            .budget            = 0,
+            .resource_capacity = 16,
+        };
+        application.residency_manager = ResidencyManager_Create(&application.renderer, &residency_manager_create_info);
+        if (application.residency_manager.component_count == 0)
+        {
+            ROSINA_LOG_ERROR("Failed to create residency manager");
+            Application_Cleanup(&application);
+            return application;
+        }
+        application.components[application.component_count++] = APPLICATION_RESIDENCY_MANAGER_COMPONENT;
+    }
+
+    // texture streamer
     {
-        const ImageCreateInfo image_create_info = {
-            .path = "/home/dlk/Pictures/vk_tutorial_texture.jpg",
+        const TextureStreamerCreateInfo texture_streamer_create_info = {
+            .budget           = 0,
+            .texture_capacity = 16,
         };
-        application.image = Image_Create(&application.renderer, &image_create_info);
-        if (application.image.handle == VK_NULL_HANDLE)
+        application.texture_streamer = TextureStreamer_Create(&application.renderer, &texture_streamer_create_info);
+        if (application.texture_streamer.component_count == 0)
+        {
+            ROSINA_LOG_ERROR("Failed to create texture streamer");
+            Application_Cleanup(&application);
+            return application;
+        }
+        application.components[application.component_count++] = APPLICATION_TEXTURE_STREAMER_COMPONENT;
+    }
+
+    // image
+    if (Ktx2File_Is(texture_path))
+    {
+        // the streamer owns the image and uploads it on its own
+        application.streamed_texture = TextureStreamer_Register(&application.renderer, &application.texture_streamer, texture_path);
+        if (application.streamed_texture == UINT32_MAX)
+        {
+            ROSINA_LOG_ERROR("Failed to register streamed texture");
+            Application_Cleanup(&application);
+            return application;
+        }
+        application.image                       = *TextureStreamer_GetImage(&application.texture_streamer, application.streamed_texture);
+        application.streamed_texture_generation = application.texture_streamer.textures[application.streamed_texture].generation;
+    }
+    else
+    {
+        if (UploadImage(&application))
         {
-            ROSINA_LOG_ERROR("Failed to create image");
             Application_Cleanup(&application);
             return application;
         }
@@ -291,14 +712,10 @@ Application Application_Create()
 
     // shader
     {
-        application.vbo = VertexBufferObject_Create(sizeof(vertices), &application.buffer_memory);
-        application.ibo = IndexBufferObject_Create(sizeof(indices), &application.buffer_memory);
-
         const ShaderCreateInfo shader_create_info = {
-            .fragment_shader_path = "/home/dlk/CLionProjects/learning_vulkan/compiled_shaders/fragment.spv",
-            .vertex_shader_path   = "/home/dlk/CLionProjects/learning_vulkan/compiled_shaders/vertex.spv",
+            .fragment_shader_path = SANDBOX_COMPILED_SHADER_DIR "fragment.spv",
+            .vertex_shader_path   = SANDBOX_COMPILED_SHADER_DIR "vertex.spv",
             .arena                = &application.arena,
-            .memory               = &application.buffer_memory,
             .image                = &application.image,
         };
         application.shader = Shader_Create(&application.renderer, &shader_create_info);
@@ -312,7 +729,7 @@ Application Application_Create()
     }
 
     // TODO: Get rid of this. It's bad code. It just shouldn't be here.
-    if (Renderer_InitializeGraphicsPipeline(&application.renderer, &application.shader))
+    if (Renderer_InitializeGraphicsPipeline(&application.renderer, &application.shader, &application.vertex_format))
     {
         ROSINA_LOG_ERROR("Failed to initialize graphics pipeline");
         Application_Cleanup(&application);
@@ -320,240 +737,296 @@ Application Application_Create()
     }
 
     // populate buffers
+    if (UploadMesh(&application))
     {
-        StagingBuffer staging_buffer =
-            StagingBuffer_Create(&application.renderer,
-                sizeof(vertices) +
-                sizeof(indices) +
-                Image_CalculateSize(&application.image) +
-                (sizeof(mvp) * (uint64_t)application.renderer.frame_count));
+        Application_Cleanup(&application);
+        return application;
+    }
 
-        // start commands
+    // gpu scene
+    if (getenv(SANDBOX_GPU_DRIVEN_VARIABLE) != NULL)
+    {
+        if (CreateGpuScene(&application))
         {
-            VK_ERROR_HANDLE(vkResetCommandBuffer(application.renderer.primary_command_buffers[application.renderer.frame_index], 0), {
-                ROSINA_LOG_ERROR("Failed to reset command buffer");
-                Application_Cleanup(&application);
-                return application;
-            });
-            const VkCommandBufferBeginInfo begin_info = {
-                .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-                .pNext            = NULL,
-                .flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-                .pInheritanceInfo = NULL
-            };
-            VK_ERROR_HANDLE(vkBeginCommandBuffer(application.renderer.primary_command_buffers[application.renderer.frame_index], &begin_info), {
-                ROSINA_LOG_ERROR("Failed to begin command buffer");
-                Application_Cleanup(&application);
-                return application;
-            });
+            Application_Cleanup(&application);
+            return application;
         }
+    }
 
-        // copy operations
-        {
-            // vertex buffer
-            {
-                void* data = NULL;
-                VK_ERROR_HANDLE(vkMapMemory(application.renderer.device.handle, staging_buffer.memory, 0, sizeof(vertices), 0, &data), {
-                    ROSINA_LOG_ERROR("Failed to map vertex buffer memory");
-                    Application_Cleanup(&application);
-                    return application;
-                });
-                memcpy(data, vertices, sizeof(vertices));
-                vkUnmapMemory(application.renderer.device.handle, staging_buffer.memory);
-
-                const VkBufferCopy2 regions[]     = {{
-                    .sType     = VK_STRUCTURE_TYPE_BUFFER_COPY_2,
-                    .pNext     = NULL,
-                    .srcOffset = 0,
-                    .dstOffset = application.vbo.offset,
-                    .size      = application.vbo.size
-                }};
-                const VkCopyBufferInfo2 copy_info = {
-                    .sType       = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2,
-                    .pNext       = NULL,
-                    .srcBuffer   = staging_buffer.handle,
-                    .dstBuffer   = application.buffer_memory.vertex_buffer,
-                    .regionCount = sizeof(regions) / sizeof(VkBufferCopy2),
-                    .pRegions    = regions
-                };
-                vkCmdCopyBuffer2(application.renderer.primary_command_buffers[application.renderer.frame_index], &copy_info);
-            }
+    Window_SetKeyboardEventCallbackFunction(&application.renderer.window, HandleKeyboardKeyEvent);
+    Window_SetMouseEventCallbackFunction(&application.renderer.window, HandleMouseButtonEvent);
 
-            // index buffer
-            {
-                void* data = NULL;
-                VK_ERROR_HANDLE(vkMapMemory(application.renderer.device.handle, staging_buffer.memory, sizeof(vertices), sizeof(indices), 0, &data), {
-                    ROSINA_LOG_ERROR("Failed to map index buffer memory");
-                    Application_Cleanup(&application);
-                    return application;
-                });
-                memcpy(data, indices, sizeof(indices));
-                vkUnmapMemory(application.renderer.device.handle, staging_buffer.memory);
-
-                const VkBufferCopy2 regions[]     = {{
-                    .sType     = VK_STRUCTURE_TYPE_BUFFER_COPY_2,
-                    .pNext     = NULL,
-                    .srcOffset = sizeof(vertices),
-                    .dstOffset = application.ibo.offset,
-                    .size      = application.ibo.size
-                }};
-                const VkCopyBufferInfo2 copy_info = {
-                    .sType       = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2,
-                    .pNext       = NULL,
-                    .srcBuffer   = staging_buffer.handle,
-                    .dstBuffer   = application.buffer_memory.index_buffer,
-                    .regionCount = sizeof(regions) / sizeof(VkBufferCopy2),
-                    .pRegions    = regions
-                };
-                vkCmdCopyBuffer2(application.renderer.primary_command_buffers[application.renderer.frame_index], &copy_info);
-            }
+    return application;
+}
 
-            // image
-            {
-                void* data = NULL;
-                const uint64_t offset = sizeof(vertices) + sizeof(indices);
-                uint64_t image_size = 0;
-                LoadImageIntoBuffer("/home/dlk/Pictures/vk_tutorial_texture.jpg", NULL, &image_size);
-
-                VK_ERROR_HANDLE(vkMapMemory(application.renderer.device.handle, staging_buffer.memory, offset, image_size, 0, &data), {
-                    ROSINA_LOG_ERROR("Failed to image memory");
-                    Application_Cleanup(&application);
-                    return application;
-                });
-                LoadImageIntoBuffer("/home/dlk/Pictures/vk_tutorial_texture.jpg", data, &image_size);
-                if (image_size == 0)
-                {
-                    ROSINA_LOG_ERROR("Failed to load image into staging buffer");
-                    Application_Cleanup(&application);
-                    return application;
-                }
-                vkUnmapMemory(application.renderer.device.handle, staging_buffer.memory);
-
-                Image_TransitionLayout(&application.renderer, &application.image, application.image.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-                const VkBufferImageCopy2 regions[]     = {{
-                    .sType     = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2,
-                    .pNext     = NULL,
-                    .bufferOffset = sizeof(vertices) + sizeof(indices),
-                    .bufferRowLength = 0,
-                    .bufferImageHeight = 0,
-                    .imageSubresource = {
-                        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                        .mipLevel = 0,
-                        .baseArrayLayer = 0,
-                        .layerCount = 1,
-                    },
-                    .imageOffset = { 0, 0, 0 },
-                    .imageExtent = { application.image.width, application.image.height, 1 }
-                }};
-                const VkCopyBufferToImageInfo2 copy_info = {
-                    .sType       = VK_STRUCTURE_TYPE_COPY_BUFFER_TO_IMAGE_INFO_2,
-                    .pNext       = NULL,
-                    .srcBuffer   = staging_buffer.handle,
-                    .dstImage   = application.image.handle,
-                    .dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                    .regionCount = sizeof(regions) / sizeof(VkBufferImageCopy2),
-                    .pRegions    = regions
-                };
-
-                vkCmdCopyBufferToImage2(application.renderer.primary_command_buffers[application.renderer.frame_index], &copy_info);
-
-                Image_TransitionLayout(&application.renderer, &application.image, application.image.format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-            }
+/**
+ * @param view_model Takes the mesh to view space, where the camera is the origin.
+ * @return The distance from the camera to the bounding sphere of the mesh.
+ */
+static float GetBoundsDistance(const Application application[static 1], const Mat4f view_model[static 1])
+{
+    const MeshBounds* const bounds = application->mesh_file_path != NULL ? &application->mesh_file_info.bounds : &application->mesh.bounds;
+    const float* const m           = view_model->data;
+    const float* const c           = bounds->center.data;
+    const Vec3f center             = {{m[0] * c[0] + m[4] * c[1] + m[8] * c[2] + m[12], m[1] * c[0] + m[5] * c[1] + m[9] * c[2] + m[13],
+                                       m[2] * c[0] + m[6] * c[1] + m[10] * c[2] + m[14]}};
+    return SquareRoot(Vec3_Dot(&center, &center)) - bounds->radius;
+}
 
-            // uniform buffers
-            {
-                void* data = NULL;
-                const uint64_t offset = sizeof(vertices) + sizeof(indices) + Image_CalculateSize(&application.image);
-                VK_ERROR_HANDLE(vkMapMemory(application.renderer.device.handle, staging_buffer.memory, offset, sizeof(mvp), 0, &data), {
-                    ROSINA_LOG_ERROR("Failed to map uniform buffer memory");
-                    Application_Cleanup(&application);
-                    return application;
-                });
-                memcpy(data, mvp, sizeof(mvp));
-                vkUnmapMemory(application.renderer.device.handle, staging_buffer.memory);
-
-                const VkBufferCopy2 regions[]     = {{
-                    .sType     = VK_STRUCTURE_TYPE_BUFFER_COPY_2,
-                    .pNext     = NULL,
-                    .srcOffset = offset,
-                    .dstOffset = application.shader.ubo.offset,
-                    .size      = application.shader.ubo.size
-                }};
-                const VkCopyBufferInfo2 copy_info = {
-                    .sType       = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2,
-                    .pNext       = NULL,
-                    .srcBuffer   = staging_buffer.handle,
-                    .dstBuffer   = application.buffer_memory.uniform_buffer,
-                    .regionCount = sizeof(regions) / sizeof(VkBufferCopy2),
-                    .pRegions    = regions
-                };
-                vkCmdCopyBuffer2(application.renderer.primary_command_buffers[application.renderer.frame_index], &copy_info);
-            }
-        }
+// the sandbox has a single pipeline and material, the meshes of the render queue are the levels of the mesh
+#define SANDBOX_PIPELINE 0
+#define SANDBOX_MATERIAL 0
+
+/**
+ * Groups the instances by the level they are drawn with and queues one instanced draw per group. A lone instance of the
+ * full mesh is drawn through its visible meshlets instead. The draws are sorted by level, then front to back.
+ *
+ * @param instances Room for application->instance_count instances.
+ */
+static void BuildDraws(Application application[static 1], InstanceData* const instances)
+{
+    const Mat4f view_model  = Mat4f_Multiplied(&application->mvp[1], &application->mvp[0]);
+    const float error_scale = MeshLod_GetErrorScale(&application->mvp[2], (float)application->renderer.swapchain.extent.height);
 
-        // end commands
+    // the closest instance of each level, which is how far its group of instances is
+    float lod_distances[MESH_LOD_MAX_COUNT];
+    for (uint32_t i = 0; i < MESH_LOD_MAX_COUNT; i++)
+    {
+        lod_distances[i] = FLOAT_INFINITY;
+    }
+
+    InstanceBatcher* const batcher = &application->instance_batcher;
+    InstanceBatcher_Clear(batcher);
+    for (uint32_t i = 0; i < application->instance_count; i++)
+    {
+        const Mat4f model               = GetInstanceModel(application, i);
+        const Mat4f instance_view_model = Mat4f_Multiplied(&view_model, &model);
+        const float distance            = GetBoundsDistance(application, &instance_view_model);
+        application->instance_lods[i]   = MeshLod_Select(application->lods, application->lod_count, distance, error_scale, MESH_LOD_DEFAULT_THRESHOLD,
+                                                         MESH_LOD_DEFAULT_HYSTERESIS, application->instance_lods[i]);
+        lod_distances[application->instance_lods[i]] = fminf(lod_distances[application->instance_lods[i]], distance);
+        InstanceBatcher_Add(batcher, application->instance_lods[i], SANDBOX_PIPELINE, &model, SANDBOX_MATERIAL);
+    }
+    const uint32_t group_count = InstanceBatcher_Build(batcher, instances);
+
+    RenderQueue* const queue = &application->render_queue;
+    RenderQueue_Clear(queue);
+    for (uint32_t i = 0; i < group_count; i++)
+    {
+        const InstanceGroup* const group = &batcher->groups[i];
+        const MeshLod* const lod         = &application->lods[group->mesh];
+        if (group->mesh > 0 || group->instance_count > 1 || application->meshlets.meshlet_count == 0)
         {
-            VK_ERROR_HANDLE(vkEndCommandBuffer(application.renderer.primary_command_buffers[application.renderer.frame_index]), {
-                ROSINA_LOG_ERROR("Failed to end command buffer");
-                Application_Cleanup(&application);
-                return application;
-            });
-            VK_ERROR_HANDLE(
-                vkWaitForFences(application.renderer.device.handle, 1, &application.renderer.in_flight[application.renderer.frame_index], VK_TRUE, UINT64_MAX),
-                {
-                    ROSINA_LOG_ERROR("Failed to wait for fences");
-                    Application_Cleanup(&application);
-                    return application;
-                });
-            VK_ERROR_HANDLE(vkResetFences(application.renderer.device.handle, 1, &application.renderer.in_flight[application.renderer.frame_index]), {
-                ROSINA_LOG_ERROR("Failed to reset fences");
-                Application_Cleanup(&application);
-                return application;
-            });
-
-            const VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-            const VkSubmitInfo submit_info           = {
-                .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-                .waitSemaphoreCount   = 0,
-                .pWaitSemaphores      = NULL,
-                .pWaitDstStageMask    = wait_stages,
-                .commandBufferCount   = 1,
-                .pCommandBuffers      = application.renderer.primary_command_buffers + application.renderer.frame_index,
-                .signalSemaphoreCount = 0,
-                .pSignalSemaphores    = NULL
+            const RenderQueueDraw draw = {
+                .pipeline       = SANDBOX_PIPELINE,
+                .material       = SANDBOX_MATERIAL,
+                .mesh           = group->mesh,
+                .index_count    = lod->index_count,
+                .instance_count = group->instance_count,
+                .first_index    = lod->first_index,
+                .vertex_offset  = 0,
+                .first_instance = group->first_instance,
             };
-            VK_ERROR_HANDLE(vkQueueSubmit(application.renderer.device.graphics_queue.handle, 1, &submit_info, application.renderer.in_flight[application.renderer.frame_index]), {
-                Application_Cleanup(&application);
-                return application;
-            });
+            RenderQueue_Add(queue, RenderQueue_MakeKey(0, false, &draw, lod_distances[group->mesh]), &draw);
+            continue;
         }
 
-        // wait for copy operations to complete
-        vkWaitForFences(application.renderer.device.handle, 1, &application.renderer.in_flight[application.renderer.frame_index], VK_TRUE, UINT64_MAX);
+        const Mat4f instance_view_model = Mat4f_Multiplied(&view_model, &batcher->objects[group->first_instance].model);
+        const Mat4f mvp                 = Mat4f_Multiplied(&application->mvp[2], &instance_view_model);
+
+        // the pipeline draws back faces, so only the frustum culls meshlets
+        MeshletCullInfo cull_info = {.frustum_planes = {}, .camera_position = {{0.0f, 0.0f, 0.0f}}, .cull_back_faces = false};
+        Mat4f_GetFrustumPlanes(&mvp, cull_info.frustum_planes);
 
-        StagingBuffer_Cleanup(&application.renderer, &staging_buffer);
+        const uint32_t meshlet_draw_count = Meshlets_Cull(&application->meshlets, &cull_info, application->meshlet_draws);
+        for (uint32_t j = 0; j < meshlet_draw_count; j++)
+        {
+            const RenderQueueDraw draw = {
+                .pipeline       = SANDBOX_PIPELINE,
+                .material       = SANDBOX_MATERIAL,
+                .mesh           = 0,
+                .index_count    = application->meshlet_draws[j].index_count,
+                .instance_count = 1,
+                .first_index    = application->meshlet_draws[j].first_index,
+                .vertex_offset  = 0,
+                .first_instance = group->first_instance,
+            };
+            RenderQueue_Add(queue, RenderQueue_MakeKey(0, false, &draw, lod_distances[0]), &draw);
+        }
     }
+    RenderQueue_Sort(queue, &application->renderer.workers);
+}
 
-    Window_SetKeyboardEventCallbackFunction(&application.renderer.window, HandleKeyboardKeyEvent);
-    Window_SetMouseEventCallbackFunction(&application.renderer.window, HandleMouseButtonEvent);
+typedef struct MeshRecordInfo
+{
+    const Application* application;
+    uint32_t uniform_offset;
+    uint32_t instance_offset;
+} MeshRecordInfo;
 
-    return application;
+static void BindPipeline(CommandRecorder recorder[static 1], const uint32_t pipeline, void* const user_data)
+{
+    const MeshRecordInfo* const info = user_data;
+    CommandRecorder_BindPipeline(recorder, VK_PIPELINE_BIND_POINT_GRAPHICS, info->application->renderer.graphics_pipeline.handle);
+}
+
+static void BindMaterial(CommandRecorder recorder[static 1], const uint32_t pipeline, const uint32_t material, void* const user_data)
+{
+    const MeshRecordInfo* const info = user_data;
+    Shader_Bind(&info->application->renderer, recorder, &info->application->shader, info->uniform_offset);
+}
+
+static void BindMesh(CommandRecorder recorder[static 1], const uint32_t mesh, void* const user_data)
+{
+    // every level is in the same buffers
+    const MeshRecordInfo* const info     = user_data;
+    const Application* const application = info->application;
+    VertexBufferObject_Bind(recorder, &application->buffer_memory, &application->vbo);
+    IndexBufferObject_Bind(recorder, &application->buffer_memory, &application->ibo, application->index_type);
+}
+
+/**
+ * Records a range of the sorted render queue. Runs on the workers of the renderer.
+ */
+static void RecordMeshDraws(const Renderer* const renderer, CommandRecorder recorder[static 1], const uint32_t first, const uint32_t draw_count,
+                            void* const user_data)
+{
+    const MeshRecordInfo* const info = user_data;
+
+    Instancing_Bind(renderer, recorder, info->instance_offset);
+
+    const RenderQueueBindings bindings = {
+        .bind_pipeline = BindPipeline,
+        .bind_material = BindMaterial,
+        .bind_mesh     = BindMesh,
+        .user_data     = user_data,
+    };
+    RenderQueue_Record(&info->application->render_queue, recorder, first, draw_count, &bindings);
+}
+
+/**
+ * Records the draws the GPU culled into. Runs on a worker of the renderer.
+ */
+static void RecordGpuSceneDraws(const Renderer* const renderer, CommandRecorder recorder[static 1], const uint32_t first, const uint32_t draw_count,
+                                void* const user_data)
+{
+    const MeshRecordInfo* const info     = user_data;
+    const Application* const application = info->application;
+
+    Shader_Bind(renderer, recorder, &application->shader, info->uniform_offset);
+    VertexBufferObject_Bind(recorder, &application->buffer_memory, &application->vbo);
+    IndexBufferObject_Bind(recorder, &application->buffer_memory, &application->ibo, application->index_type);
+    GpuScene_Draw(renderer, &application->gpu_scene, recorder, 0);
+}
+
+/**
+ * The camera and frustum the GPU culls the instances with, in the space of their models.
+ */
+static GpuCullConstants GetCullConstants(const Application application[static 1])
+{
+    const Mat4f view_model = Mat4f_Multiplied(&application->mvp[1], &application->mvp[0]);
+    const Mat4f mvp        = Mat4f_Multiplied(&application->mvp[2], &view_model);
+    const Vec3f camera     = Mat4f_GetViewPosition(&view_model);
+
+    GpuCullConstants constants = {
+        .frustum_planes = {},
+        .camera         = {{camera.data[0], camera.data[1], camera.data[2],
+                            MeshLod_GetErrorScale(&application->mvp[2], (float)application->renderer.swapchain.extent.height)}},
+        .instance_count = 0,
+        .draw_capacity  = 0,
+        .threshold      = MESH_LOD_DEFAULT_THRESHOLD,
+        .padding        = 0,
+    };
+    Mat4f_GetFrustumPlanes(&mvp, constants.frustum_planes);
+    return constants;
 }
 
 void Application_Run(Application application[static 1])
 {
+    // the objects and the residency callbacks keep this address until the application is cleaned up
+    VertexBufferObject_SetMovable(&application->buffer_memory, &application->vbo);
+    IndexBufferObject_SetMovable(&application->buffer_memory, &application->ibo);
+    {
+        const ResidencyResourceInfo mesh_info = {
+            .size      = application->vbo.size + application->ibo.size,
+            .load      = LoadMesh,
+            .evict     = EvictMesh,
+            .user_data = application,
+            .resident  = true,
+        };
+        application->mesh_resource = ResidencyManager_Register(&application->residency_manager, &mesh_info);
+
+        // a streamed texture is kept under budget by the streamer
+        if (application->streamed_texture == UINT32_MAX)
+        {
+            const ResidencyResourceInfo image_info = {
+                .size      = application->image.allocation.size,
+                .load      = LoadImage,
+                .evict     = EvictImage,
+                .user_data = application,
+                .resident  = true,
+            };
+            application->image_resource = ResidencyManager_Register(&application->residency_manager, &image_info);
+        }
+    }
+
     while (!Window_ShouldClose(&application->renderer.window))
     {
         Window_PollEvents(&application->renderer.window);
 
-        if (Renderer_StartScene(&application->renderer)) break;  // also binds graphics pipeline
+        // after the slot's fence, so loads and evictions do not touch what the frame last in this slot was using
+        if (Renderer_StartFrame(&application->renderer)) break;
+
+        if (application->streamed_texture != UINT32_MAX)
+        {
+            // the quad covers 80% of the window
+            const VkExtent2D extent = application->renderer.swapchain.extent;
+            TextureStreamer_Request(&application->texture_streamer, application->streamed_texture, 0.8f * (float)(extent.width > extent.height ? extent.width : extent.height));
+            if (TextureStreamer_Update(&application->renderer, &application->texture_streamer)) break;
+
+            const StreamedTexture* const texture = &application->texture_streamer.textures[application->streamed_texture];
+            if (texture->generation != application->streamed_texture_generation)
+            {
+                application->image                       = texture->image;
+                application->streamed_texture_generation = texture->generation;
+                Shader_SetImage(&application->shader, &application->image);
+            }
+        }
+
+        if (BufferMemory_Defragment(&application->renderer, &application->buffer_memory)) break;
+        if (ResidencyManager_Update(&application->renderer, &application->residency_manager)) break;
+        if (application->mesh_resource != RESIDENCY_MANAGER_NONE &&
+            ResidencyManager_Use(&application->renderer, &application->residency_manager, application->mesh_resource)) break;
+        if (application->image_resource != RESIDENCY_MANAGER_NONE &&
+            ResidencyManager_Use(&application->renderer, &application->residency_manager, application->image_resource)) break;
+
+        Shader_Update(&application->renderer, &application->shader);
+
+        UniformAllocation uniforms;
+        if (Renderer_AllocateUniforms(&application->renderer, application->shader.uniform_size, &uniforms)) break;
+        memcpy(uniforms.mapped, application->mvp, sizeof(application->mvp));
+
+        if (application->gpu_driven)
+        {
+            // the same few commands however many instances there are
+            GpuCullConstants constants = GetCullConstants(application);
+            GpuScene_Cull(&application->renderer, &application->gpu_scene, &constants);
+            Renderer_StartRenderPass(&application->renderer);
+
+            MeshRecordInfo record_info = {.application = application, .uniform_offset = uniforms.offset, .instance_offset = 0};
+            if (Renderer_RecordDraws(&application->renderer, 1, RecordGpuSceneDraws, &record_info)) break;
+
+            if (Renderer_EndScene(&application->renderer)) break;
+            continue;
+        }
+        Renderer_StartRenderPass(&application->renderer);
 
-        Shader_Bind(&application->renderer, &application->shader);
-        VertexBufferObject_Bind(&application->renderer, &application->buffer_memory, &application->vbo);
-        IndexBufferObject_Bind(&application->renderer, &application->buffer_memory, &application->ibo);
+        UniformAllocation instances;
+        if (Instancing_Allocate(&application->renderer, application->instance_count, &instances)) break;
+        BuildDraws(application, instances.mapped);
 
-        vkCmdDrawIndexed(application->renderer.primary_command_buffers[application->renderer.frame_index], 6, 1, 0, 0, 0);
+        MeshRecordInfo record_info = {.application = application, .uniform_offset = uniforms.offset, .instance_offset = instances.offset};
+        if (Renderer_RecordDraws(&application->renderer, application->render_queue.count, RecordMeshDraws, &record_info)) break;
 
         if (Renderer_EndScene(&application->renderer)) break;
     }
@@ -1,9 +1,25 @@
 #ifndef SANDBOX_APPLICATION_H
 #define SANDBOX_APPLICATION_H
 
+// an OBJ, glTF or baked mesh file drawn instead of the quad
+#define SANDBOX_MESH_VARIABLE "ROSINA_MESH"
+// how many copies of the mesh to draw on a grid, 1 by default
+#define SANDBOX_INSTANCE_COUNT_VARIABLE "ROSINA_INSTANCE_COUNT"
+// set to anything to cull the instances and pick their levels on the GPU, drawing them with one indirect draw
+#define SANDBOX_GPU_DRIVEN_VARIABLE "ROSINA_GPU_DRIVEN"
+// where scripts/compile_shaders.sh and scripts/all.sh write the compiled shaders
+#define SANDBOX_COMPILED_SHADER_DIR "/home/dlk/CLionProjects/learning_vulkan/compiled_shaders/"
+
 #include <engine/graphics/renderer.h>
 #include <engine/graphics/shader.h>
 #include <engine/graphics/image.h>
+#include <engine/graphics/gpu_scene.h>
+#include <engine/graphics/instancing.h>
+#include <engine/graphics/residency_manager.h>
+#include <engine/graphics/texture_streamer.h>
+#include <engine/graphics/mesh_loader.h>
+#include <engine/graphics/render_queue.h>
+#include <engine/graphics/vertex_format.h>
 
 typedef enum ApplicationComponent
 {
@@ -12,6 +28,13 @@ typedef enum ApplicationComponent
     APPLICATION_SHADER_COMPONENT,
     APPLICATION_BUFFER_MEMORY_COMPONENT,
     APPLICATION_IMAGE_COMPONENT,
+    APPLICATION_ASSET_CACHE_COMPONENT,
+    APPLICATION_TEXTURE_STREAMER_COMPONENT,
+    APPLICATION_RESIDENCY_MANAGER_COMPONENT,
+    APPLICATION_MESH_COMPONENT,
+    APPLICATION_MESHLETS_COMPONENT,
+    APPLICATION_INSTANCES_COMPONENT,
+    APPLICATION_GPU_SCENE_COMPONENT,
     APPLICATION_COMPONENT_COUNT
 } ApplicationComponent;
 
@@ -21,11 +44,47 @@ typedef struct Application
     ApplicationComponent components[APPLICATION_COMPONENT_COUNT];
     Renderer renderer;
     MemoryArena arena;
+    // the imported mesh, unused when drawing a baked mesh file
+    Mesh mesh;
+    // NULL unless the mesh is read from a mesh file
+    const char* mesh_file_path;
+    MeshFileInfo mesh_file_info;
+    uint32_t index_count;
+    // culled on the CPU every frame, drawing the whole mesh when there are none
+    Meshlets meshlets;
+    // room for a draw per meshlet
+    MeshletDraw* meshlet_draws;
+    // lods[0] is the full mesh, the coarser levels follow it in the index buffer
+    MeshLod lods[MESH_LOD_MAX_COUNT];
+    uint32_t lod_count;
+    // copies of the mesh, grouped by the level they are drawn with
+    uint32_t instance_count;
+    InstanceBatcher instance_batcher;
+    // the level each instance was drawn with last frame, picked again every frame from its projected error
+    uint32_t* instance_lods;
+    // the draws of the frame, one per group of instances, or one per visible meshlet range of a lone full mesh
+    RenderQueue render_queue;
+    // holds the instances when SANDBOX_GPU_DRIVEN_VARIABLE is set and the device can draw with it
+    bool gpu_driven;
+    GpuScene gpu_scene;
     VertexBufferObject vbo;
     IndexBufferObject ibo;
+    VertexFormat vertex_format;
+    VkIndexType index_type;
+    // model, view and projection, written to the uniform ring every frame
+    Mat4f mvp[3];
     Shader shader;
     BufferMemory buffer_memory;
     Image image;
+    AssetCache asset_cache;
+    TextureStreamer texture_streamer;
+    // UINT32_MAX when image is not streamed
+    uint32_t streamed_texture;
+    uint32_t streamed_texture_generation;
+    ResidencyManager residency_manager;
+    // RESIDENCY_MANAGER_NONE when not managed
+    uint32_t mesh_resource;
+    uint32_t image_resource;
 } Application;
 
 void Application_Cleanup(Application application[static 1]);
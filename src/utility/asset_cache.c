@@ -0,0 +1,322 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <utility/asset_cache.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility/hash.h>
+#include <utility/log.h>
+
+#define ASSET_CACHE_MAGIC   0x43415352u  // "RSAC"
+#define ASSET_CACHE_VERSION 1u
+
+typedef struct AssetCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t payload_size;
+    uint64_t payload_hash;
+    uint8_t padding[32];
+} AssetCacheHeader;
+
+// keeps the payload aligned for any element type once mapped
+_Static_assert(sizeof(AssetCacheHeader) == 64, "AssetCacheHeader must be 64 bytes");
+
+typedef struct AssetCacheFile
+{
+    char name[64];
+    uint64_t size;
+    struct timespec last_used;
+} AssetCacheFile;
+
+/**
+ * @return true if the path does not fit, in which case path must not be used.
+ */
+static inline bool GetFilePath(const AssetCache cache[static 1], const char name[static 1], char path[static ASSET_CACHE_MAX_PATH])
+{
+    const int length = snprintf(path, ASSET_CACHE_MAX_PATH, "%s/%s", cache->directory, name);
+    if (length < 0 || length >= ASSET_CACHE_MAX_PATH)
+    {
+        ROSINA_LOG_ERROR("Asset cache path of \"%s\" is too long", name);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @return true if the path does not fit, in which case path must not be used.
+ */
+static inline bool GetEntryPath(const AssetCache cache[static 1], const uint64_t key, char path[static ASSET_CACHE_MAX_PATH])
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.blob", (unsigned long long)key);
+    return GetFilePath(cache, name, path);
+}
+
+static int CompareLastUsed(const void* a, const void* b)
+{
+    const struct timespec* const ta = &((const AssetCacheFile*)a)->last_used;
+    const struct timespec* const tb = &((const AssetCacheFile*)b)->last_used;
+    if (ta->tv_sec != tb->tv_sec) return ta->tv_sec < tb->tv_sec ? -1 : 1;
+    if (ta->tv_nsec != tb->tv_nsec) return ta->tv_nsec < tb->tv_nsec ? -1 : 1;
+    return 0;
+}
+
+/**
+ * Scans the directory for its total size, then deletes the least recently used entries until it is under max_size.
+ */
+static void EvictEntries(AssetCache cache[static 1])
+{
+    DIR* const dir = opendir(cache->directory);
+    if (dir == NULL)
+    {
+        return;
+    }
+
+    uint64_t file_count    = 0;
+    uint64_t file_capacity = 64;
+    uint64_t total_size    = 0;
+    AssetCacheFile* files  = malloc(sizeof(AssetCacheFile) * file_capacity);
+
+    for (const struct dirent* e = readdir(dir); e != NULL && files != NULL; e = readdir(dir))
+    {
+        const size_t length = strlen(e->d_name);
+        if (length < 5 || length >= sizeof(files[0].name) || strcmp(e->d_name + length - 5, ".blob") != 0)
+        {
+            continue;
+        }
+
+        char path[ASSET_CACHE_MAX_PATH];
+        struct stat st;
+        if (GetFilePath(cache, e->d_name, path) || stat(path, &st) != 0)
+        {
+            continue;
+        }
+
+        if (file_count == file_capacity)
+        {
+            file_capacity *= 2;
+            AssetCacheFile* const new_files = realloc(files, sizeof(AssetCacheFile) * file_capacity);
+            if (new_files == NULL)
+            {
+                break;
+            }
+            files = new_files;
+        }
+
+        AssetCacheFile* const file = &files[file_count++];
+        strcpy(file->name, e->d_name);
+        file->size      = (uint64_t)st.st_size;
+        file->last_used = st.st_mtim;
+        total_size += file->size;
+    }
+    closedir(dir);
+    cache->total_size = total_size;
+
+    if (total_size > cache->max_size && files != NULL)
+    {
+        qsort(files, file_count, sizeof(AssetCacheFile), CompareLastUsed);
+        for (uint64_t i = 0; i < file_count && total_size > cache->max_size; i++)
+        {
+            char path[ASSET_CACHE_MAX_PATH];
+            if (!GetFilePath(cache, files[i].name, path) && unlink(path) == 0)
+            {
+                total_size -= files[i].size;
+                cache->total_size -= files[i].size;
+                cache->eviction_count++;
+            }
+        }
+    }
+
+    free(files);
+}
+
+AssetCache AssetCache_Create(const AssetCacheCreateInfo create_info[static 1])
+{
+    AssetCache cache = {
+        .directory      = {},
+        .max_size       = create_info->max_size,
+        .total_size     = 0,
+        .hit_count      = 0,
+        .miss_count     = 0,
+        .eviction_count = 0,
+    };
+
+    if (strlen(create_info->directory) + 32 >= ASSET_CACHE_MAX_PATH)
+    {
+        ROSINA_LOG_ERROR("Asset cache path \"%s\" is too long", create_info->directory);
+        return cache;
+    }
+
+    if (mkdir(create_info->directory, 0755) != 0)
+    {
+        struct stat st;
+        if (stat(create_info->directory, &st) != 0 || !S_ISDIR(st.st_mode))
+        {
+            ROSINA_LOG_ERROR("Failed to create asset cache directory \"%s\"", create_info->directory);
+            return cache;
+        }
+    }
+
+    strcpy(cache.directory, create_info->directory);
+    EvictEntries(&cache);
+    return cache;
+}
+
+void AssetCache_Cleanup(AssetCache cache[static 1])
+{
+    if (cache->directory[0] != '\0')
+    {
+        ROSINA_LOG_INFO("Asset cache: %llu hits, %llu misses, %llu evictions", (unsigned long long)cache->hit_count, (unsigned long long)cache->miss_count,
+                        (unsigned long long)cache->eviction_count);
+    }
+    cache->directory[0] = '\0';
+}
+
+uint64_t AssetCache_ComputeKey(const void* const source, const uint64_t source_size, const void* const parameters, const uint64_t parameters_size)
+{
+    return Hash64(parameters, parameters_size, Hash64(source, source_size, ASSET_CACHE_VERSION));
+}
+
+bool AssetCache_Load(AssetCache cache[static 1], const uint64_t key, AssetCacheEntry entry[static 1])
+{
+    *entry = (AssetCacheEntry){
+        .data         = NULL,
+        .size         = 0,
+        .mapping      = NULL,
+        .mapping_size = 0,
+    };
+
+    if (cache->directory[0] == '\0')
+    {
+        return true;
+    }
+
+    char path[ASSET_CACHE_MAX_PATH];
+    if (GetEntryPath(cache, key, path))
+    {
+        cache->miss_count++;
+        return true;
+    }
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        cache->miss_count++;
+        return true;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(AssetCacheHeader))
+    {
+        close(fd);
+        cache->miss_count++;
+        return true;
+    }
+
+    void* const mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        close(fd);
+        cache->miss_count++;
+        return true;
+    }
+
+    // stamp the entry as used for the eviction order
+    futimens(fd, NULL);
+    close(fd);
+
+    const AssetCacheHeader* const header = mapping;
+    const uint8_t* const payload         = (const uint8_t*)mapping + sizeof(AssetCacheHeader);
+    if (header->magic != ASSET_CACHE_MAGIC || header->version != ASSET_CACHE_VERSION || header->key != key ||
+        header->payload_size != (uint64_t)st.st_size - sizeof(AssetCacheHeader) || header->payload_hash != Hash64(payload, header->payload_size, 0))
+    {
+        ROSINA_LOG_ERROR("Discarding corrupt asset cache entry %s", path);
+        munmap(mapping, (size_t)st.st_size);
+        if (unlink(path) == 0)
+        {
+            cache->total_size -= cache->total_size < (uint64_t)st.st_size ? cache->total_size : (uint64_t)st.st_size;
+        }
+        cache->miss_count++;
+        return true;
+    }
+
+    entry->data         = payload;
+    entry->size         = header->payload_size;
+    entry->mapping      = mapping;
+    entry->mapping_size = (size_t)st.st_size;
+    cache->hit_count++;
+    return false;
+}
+
+void AssetCacheEntry_Release(AssetCacheEntry entry[static 1])
+{
+    if (entry->mapping != NULL)
+    {
+        munmap(entry->mapping, entry->mapping_size);
+    }
+    entry->data         = NULL;
+    entry->size         = 0;
+    entry->mapping      = NULL;
+    entry->mapping_size = 0;
+}
+
+bool AssetCache_Store(AssetCache cache[static 1], const uint64_t key, const void* const data, const uint64_t size)
+{
+    if (cache->directory[0] == '\0')
+    {
+        return true;
+    }
+
+    char path[ASSET_CACHE_MAX_PATH];
+    char temp_path[ASSET_CACHE_MAX_PATH + 16];
+    if (GetEntryPath(cache, key, path))
+    {
+        return true;
+    }
+    snprintf(temp_path, sizeof(temp_path), "%s.%d", path, (int)getpid());
+
+    const AssetCacheHeader header = {
+        .magic        = ASSET_CACHE_MAGIC,
+        .version      = ASSET_CACHE_VERSION,
+        .key          = key,
+        .payload_size = size,
+        .payload_hash = Hash64(data, size, 0),
+        .padding      = {},
+    };
+
+    // written to a temporary name and renamed so a crash never leaves a partial entry behind
+    FILE* const fp = fopen(temp_path, "wb");
+    if (fp == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to open %s", temp_path);
+        return true;
+    }
+    const bool failed = fwrite(&header, sizeof(header), 1, fp) != 1 || fwrite(data, 1, size, fp) != size;
+
+    // an entry being replaced no longer counts once the rename is done
+    struct stat st;
+    const uint64_t replaced_size = stat(path, &st) == 0 ? (uint64_t)st.st_size : 0;
+    if (fclose(fp) != 0 || failed || rename(temp_path, path) != 0)
+    {
+        ROSINA_LOG_ERROR("Failed to write asset cache entry %s", path);
+        unlink(temp_path);
+        return true;
+    }
+
+    cache->total_size -= cache->total_size < replaced_size ? cache->total_size : replaced_size;
+    cache->total_size += sizeof(AssetCacheHeader) + size;
+    if (cache->total_size > cache->max_size)
+    {
+        EvictEntries(cache);
+    }
+    return false;
+}
@@ -0,0 +1,72 @@
+#ifndef ROSINA_UTILITY_ASSET_CACHE_H
+#define ROSINA_UTILITY_ASSET_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ASSET_CACHE_MAX_PATH 512
+
+/**
+ * Derived data cache. Each entry is one file named after its key, holding a 64 byte header followed by the payload, so a
+ * mapped entry can be handed out without copying. The least recently used entries are deleted once the directory grows
+ * past max_size.
+ */
+typedef struct AssetCache
+{
+    char directory[ASSET_CACHE_MAX_PATH];
+    uint64_t max_size;
+    // the size of the directory as of its last scan plus what was stored since, so it is only scanned again when full
+    uint64_t total_size;
+    uint64_t hit_count;
+    uint64_t miss_count;
+    uint64_t eviction_count;
+} AssetCache;
+
+typedef struct AssetCacheCreateInfo
+{
+    const char* directory;
+    uint64_t max_size;
+} AssetCacheCreateInfo;
+
+typedef struct AssetCacheEntry
+{
+    const void* data;
+    uint64_t size;
+    void* mapping;
+    size_t mapping_size;
+} AssetCacheEntry;
+
+/**
+ * Creates the cache directory if it does not exist and adds up the size of the entries already in it. On error, directory is empty and every lookup misses.
+ */
+AssetCache AssetCache_Create(const AssetCacheCreateInfo create_info[static 1]);
+
+void AssetCache_Cleanup(AssetCache cache[static 1]);
+
+/**
+ * @param source The bytes of the source asset.
+ * @param source_size The size of source.
+ * @param parameters Every setting that changes the processed result.
+ * @param parameters_size The size of parameters.
+ * @return The key of the processed asset.
+ */
+uint64_t AssetCache_ComputeKey(const void* const source, const uint64_t source_size, const void* const parameters, const uint64_t parameters_size);
+
+/**
+ * Maps the entry of key. The entry stays valid until AssetCacheEntry_Release.
+ *
+ * @return true if there is no valid entry for key.
+ */
+bool AssetCache_Load(AssetCache cache[static 1], const uint64_t key, AssetCacheEntry entry[static 1]);
+
+void AssetCacheEntry_Release(AssetCacheEntry entry[static 1]);
+
+/**
+ * Writes the entry of key, replacing any existing one, then evicts old entries if the cache is over its size.
+ *
+ * @return true on error.
+ */
+bool AssetCache_Store(AssetCache cache[static 1], const uint64_t key, const void* const data, const uint64_t size);
+
+#endif
@@ -0,0 +1,105 @@
+#include <utility/hash.h>
+
+#include <string.h>
+
+// https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t RotateLeft(const uint64_t value, const uint32_t count)
+{
+    return (value << count) | (value >> (64 - count));
+}
+
+static inline uint64_t Read64(const uint8_t* const p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t Read32(const uint8_t* const p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t Round(uint64_t accumulator, const uint64_t lane)
+{
+    accumulator += lane * PRIME64_2;
+    accumulator = RotateLeft(accumulator, 31);
+    return accumulator * PRIME64_1;
+}
+
+static inline uint64_t MergeRound(uint64_t accumulator, const uint64_t value)
+{
+    accumulator ^= Round(0, value);
+    return (accumulator * PRIME64_1) + PRIME64_4;
+}
+
+uint64_t Hash64(const void* const data, const uint64_t size, const uint64_t seed)
+{
+    const uint8_t* p         = data;
+    const uint8_t* const end = p + size;
+    uint64_t hash;
+
+    if (size >= 32)
+    {
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+
+        const uint8_t* const limit = end - 32;
+        do
+        {
+            v1 = Round(v1, Read64(p));
+            v2 = Round(v2, Read64(p + 8));
+            v3 = Round(v3, Read64(p + 16));
+            v4 = Round(v4, Read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        hash = MergeRound(hash, v1);
+        hash = MergeRound(hash, v2);
+        hash = MergeRound(hash, v3);
+        hash = MergeRound(hash, v4);
+    }
+    else
+    {
+        hash = seed + PRIME64_5;
+    }
+
+    hash += size;
+
+    while (p + 8 <= end)
+    {
+        hash ^= Round(0, Read64(p));
+        hash = (RotateLeft(hash, 27) * PRIME64_1) + PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end)
+    {
+        hash ^= (uint64_t)Read32(p) * PRIME64_1;
+        hash = (RotateLeft(hash, 23) * PRIME64_2) + PRIME64_3;
+        p += 4;
+    }
+    while (p < end)
+    {
+        hash ^= (uint64_t)(*p) * PRIME64_5;
+        hash = RotateLeft(hash, 11) * PRIME64_1;
+        p++;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
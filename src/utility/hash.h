@@ -0,0 +1,16 @@
+#ifndef ROSINA_UTILITY_HASH_H
+#define ROSINA_UTILITY_HASH_H
+
+#include <stdint.h>
+
+/**
+ * 64 bit hash of data, compatible with XXH64.
+ *
+ * @param data The bytes to hash.
+ * @param size The number of bytes.
+ * @param seed Different seeds give unrelated hashes of the same bytes.
+ * @return The hash.
+ */
+uint64_t Hash64(const void* const data, const uint64_t size, const uint64_t seed);
+
+#endif
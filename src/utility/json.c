@@ -0,0 +1,287 @@
+#include <utility/json.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <utility/log.h>
+
+// deeper documents are rejected instead of overflowing the stack
+#define JSON_MAX_DEPTH 64
+
+typedef struct JsonParser
+{
+    Json* json;
+    const char* text;
+    uint32_t length;
+    uint32_t position;
+} JsonParser;
+
+static void SkipWhitespace(JsonParser parser[static 1])
+{
+    while (parser->position < parser->length)
+    {
+        const char c = parser->text[parser->position];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+        {
+            return;
+        }
+        parser->position++;
+    }
+}
+
+/**
+ * @return The index of the new token, or JSON_NONE when out of memory.
+ */
+static uint32_t AddToken(JsonParser parser[static 1], const JsonType type, const uint32_t start)
+{
+    Json* const json = parser->json;
+    if (json->token_count == json->token_capacity)
+    {
+        const uint32_t capacity = json->token_capacity > 0 ? json->token_capacity * 2 : 256;
+        JsonToken* const tokens = realloc(json->tokens, sizeof(JsonToken) * capacity);
+        if (tokens == NULL)
+        {
+            return JSON_NONE;
+        }
+        json->tokens         = tokens;
+        json->token_capacity = capacity;
+    }
+
+    const uint32_t index = json->token_count++;
+    json->tokens[index]  = (JsonToken){.type = type, .start = start, .end = start, .size = 0, .next = index + 1};
+    return index;
+}
+
+static bool ParseValue(JsonParser parser[static 1], const uint32_t depth);
+
+static bool ParseString(JsonParser parser[static 1])
+{
+    // past the opening quote
+    const uint32_t index = AddToken(parser, JSON_TYPE_STRING, ++parser->position);
+    if (index == JSON_NONE)
+    {
+        return true;
+    }
+
+    while (parser->position < parser->length && parser->text[parser->position] != '"')
+    {
+        // escapes are kept as they are, only the quote they may hide matters here
+        parser->position += parser->text[parser->position] == '\\' ? 2 : 1;
+    }
+    if (parser->position >= parser->length)
+    {
+        return true;
+    }
+
+    parser->json->tokens[index].end = parser->position++;
+    return false;
+}
+
+static bool ParsePrimitive(JsonParser parser[static 1])
+{
+    const uint32_t index = AddToken(parser, JSON_TYPE_PRIMITIVE, parser->position);
+    if (index == JSON_NONE)
+    {
+        return true;
+    }
+
+    while (parser->position < parser->length)
+    {
+        const char c = parser->text[parser->position];
+        if (c == ',' || c == ']' || c == '}' || c == ' ' || c == '\t' || c == '\n' || c == '\r')
+        {
+            break;
+        }
+        parser->position++;
+    }
+
+    parser->json->tokens[index].end = parser->position;
+    return parser->json->tokens[index].end == parser->json->tokens[index].start;
+}
+
+/**
+ * Parses an object or an array, whose opening bracket the parser is at.
+ */
+static bool ParseContainer(JsonParser parser[static 1], const uint32_t depth)
+{
+    const bool object    = parser->text[parser->position] == '{';
+    const char close     = object ? '}' : ']';
+    const uint32_t index = AddToken(parser, object ? JSON_TYPE_OBJECT : JSON_TYPE_ARRAY, parser->position);
+    if (index == JSON_NONE)
+    {
+        return true;
+    }
+    parser->position++;
+
+    uint32_t size = 0;
+    SkipWhitespace(parser);
+    if (parser->position < parser->length && parser->text[parser->position] == close)
+    {
+        parser->position++;
+    }
+    else
+    {
+        while (true)
+        {
+            SkipWhitespace(parser);
+            if (object)
+            {
+                if (parser->position >= parser->length || parser->text[parser->position] != '"' || ParseString(parser))
+                {
+                    return true;
+                }
+                SkipWhitespace(parser);
+                if (parser->position >= parser->length || parser->text[parser->position++] != ':')
+                {
+                    return true;
+                }
+            }
+            if (ParseValue(parser, depth + 1))
+            {
+                return true;
+            }
+            size++;
+
+            SkipWhitespace(parser);
+            if (parser->position >= parser->length)
+            {
+                return true;
+            }
+            const char c = parser->text[parser->position++];
+            if (c == close)
+            {
+                break;
+            }
+            if (c != ',')
+            {
+                return true;
+            }
+        }
+    }
+
+    // tokens may have moved while the children were added
+    JsonToken* const token = &parser->json->tokens[index];
+    token->end             = parser->position;
+    token->size            = size;
+    token->next            = parser->json->token_count;
+    return false;
+}
+
+static bool ParseValue(JsonParser parser[static 1], const uint32_t depth)
+{
+    if (depth > JSON_MAX_DEPTH)
+    {
+        return true;
+    }
+
+    SkipWhitespace(parser);
+    if (parser->position >= parser->length)
+    {
+        return true;
+    }
+
+    switch (parser->text[parser->position])
+    {
+        case '{':
+        case '[':
+            return ParseContainer(parser, depth);
+        case '"':
+            return ParseString(parser);
+        default:
+            return ParsePrimitive(parser);
+    }
+}
+
+Json Json_Parse(const char* const text, const size_t length)
+{
+    Json json = {.text = text, .tokens = NULL, .token_count = 0, .token_capacity = 0};
+    if (length >= UINT32_MAX)
+    {
+        ROSINA_LOG_ERROR("JSON document is too large");
+        return json;
+    }
+
+    JsonParser parser = {.json = &json, .text = text, .length = (uint32_t)length, .position = 0};
+    if (ParseValue(&parser, 0))
+    {
+        ROSINA_LOG_ERROR("Invalid JSON near byte %u", parser.position);
+        Json_Cleanup(&json);
+    }
+    return json;
+}
+
+void Json_Cleanup(Json json[static 1])
+{
+    free(json->tokens);
+    json->tokens         = NULL;
+    json->token_count    = 0;
+    json->token_capacity = 0;
+}
+
+uint32_t Json_Find(const Json json[static 1], const uint32_t object, const char* const key)
+{
+    if (object == JSON_NONE || json->tokens[object].type != JSON_TYPE_OBJECT)
+    {
+        return JSON_NONE;
+    }
+
+    uint32_t token = object + 1;
+    for (uint32_t i = 0; i < json->tokens[object].size; i++)
+    {
+        const uint32_t value = token + 1;
+        if (Json_Equals(json, token, key))
+        {
+            return value;
+        }
+        token = json->tokens[value].next;
+    }
+    return JSON_NONE;
+}
+
+uint32_t Json_Index(const Json json[static 1], const uint32_t array, const uint32_t index)
+{
+    if (array == JSON_NONE || json->tokens[array].type != JSON_TYPE_ARRAY || index >= json->tokens[array].size)
+    {
+        return JSON_NONE;
+    }
+
+    uint32_t token = array + 1;
+    for (uint32_t i = 0; i < index; i++)
+    {
+        token = json->tokens[token].next;
+    }
+    return token;
+}
+
+bool Json_Equals(const Json json[static 1], const uint32_t token, const char* const string)
+{
+    if (token == JSON_NONE || json->tokens[token].type != JSON_TYPE_STRING)
+    {
+        return false;
+    }
+
+    const size_t length = json->tokens[token].end - json->tokens[token].start;
+    return strlen(string) == length && memcmp(json->text + json->tokens[token].start, string, length) == 0;
+}
+
+double Json_GetNumber(const Json json[static 1], const uint32_t token, const double fallback)
+{
+    if (token == JSON_NONE || json->tokens[token].type != JSON_TYPE_PRIMITIVE)
+    {
+        return fallback;
+    }
+
+    // numbers are short, and the text is not null terminated after them
+    char number[64];
+    const size_t length = json->tokens[token].end - json->tokens[token].start;
+    if (length >= sizeof(number))
+    {
+        return fallback;
+    }
+    memcpy(number, json->text + json->tokens[token].start, length);
+    number[length] = '\0';
+
+    char* end;
+    const double value = strtod(number, &end);
+    return end == number ? fallback : value;
+}
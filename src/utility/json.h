@@ -0,0 +1,74 @@
+#ifndef ROSINA_UTILITY_JSON_H
+#define ROSINA_UTILITY_JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSON_NONE UINT32_MAX
+
+typedef enum JsonType
+{
+    JSON_TYPE_OBJECT,
+    JSON_TYPE_ARRAY,
+    JSON_TYPE_STRING,
+    // numbers, true, false and null
+    JSON_TYPE_PRIMITIVE,
+} JsonType;
+
+/**
+ * A value in the text. Tokens are stored depth first, so the children of a value follow it, and next skips over them.
+ * The members of an object are a string token for the key followed by the value.
+ */
+typedef struct JsonToken
+{
+    JsonType type;
+    // the range of the value in the text, without the quotes of strings
+    uint32_t start;
+    uint32_t end;
+    // the number of elements of an array or members of an object
+    uint32_t size;
+    // the index of the first token after this value and its children
+    uint32_t next;
+} JsonToken;
+
+/**
+ * A JSON document split into tokens. Nothing is copied or unescaped, the tokens point into text, which has to outlive
+ * the document.
+ */
+typedef struct Json
+{
+    const char* text;
+    JsonToken* tokens;
+    uint32_t token_count;
+    uint32_t token_capacity;
+} Json;
+
+/**
+ * @return The document, its root is token 0. On error, the tokens field will be NULL.
+ */
+Json Json_Parse(const char* const text, const size_t length);
+
+void Json_Cleanup(Json json[static 1]);
+
+/**
+ * @return The value of key in the object, or JSON_NONE when object is not an object or has no such member.
+ */
+uint32_t Json_Find(const Json json[static 1], const uint32_t object, const char* const key);
+
+/**
+ * @return The element at index of the array, or JSON_NONE when array is not an array or is too short.
+ */
+uint32_t Json_Index(const Json json[static 1], const uint32_t array, const uint32_t index);
+
+/**
+ * @return Whether the token is a string equal to string.
+ */
+bool Json_Equals(const Json json[static 1], const uint32_t token, const char* const string);
+
+/**
+ * @return The number the token holds, or fallback when it is JSON_NONE or not a number.
+ */
+double Json_GetNumber(const Json json[static 1], const uint32_t token, const double fallback);
+
+#endif
@@ -0,0 +1,333 @@
+#include <utility/ktx2.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <utility/log.h>
+#include <vulkan/vulkan_core.h>
+
+// https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+static const uint8_t KTX2_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+#define KTX2_HEADER_SIZE 80
+#define KTX2_LEVEL_INDEX_ENTRY_SIZE 24
+
+// https://registry.khronos.org/DataFormat/specs/1.3/dataformat.1.3.html
+#define KHR_DF_MODEL_RGBSDA 1
+#define KHR_DF_MODEL_BC1A 128
+#define KHR_DF_MODEL_BC3 130
+#define KHR_DF_MODEL_BC7 134
+#define KHR_DF_PRIMARIES_BT709 1
+#define KHR_DF_TRANSFER_LINEAR 1
+#define KHR_DF_TRANSFER_SRGB 2
+#define KHR_DF_CHANNEL_COLOR 0
+#define KHR_DF_CHANNEL_R 0
+#define KHR_DF_CHANNEL_G 1
+#define KHR_DF_CHANNEL_B 2
+#define KHR_DF_CHANNEL_ALPHA 15
+#define KHR_DF_SAMPLE_DATATYPE_LINEAR (1 << 4)
+
+static inline uint32_t ReadU32(const uint8_t bytes[static 4])
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static inline uint64_t ReadU64(const uint8_t bytes[static 8])
+{
+    return (uint64_t)ReadU32(bytes) | ((uint64_t)ReadU32(bytes + 4) << 32);
+}
+
+static inline void WriteU32(uint8_t bytes[static 4], const uint32_t value)
+{
+    bytes[0] = (uint8_t)(value);
+    bytes[1] = (uint8_t)(value >> 8);
+    bytes[2] = (uint8_t)(value >> 16);
+    bytes[3] = (uint8_t)(value >> 24);
+}
+
+static inline void WriteU64(uint8_t bytes[static 8], const uint64_t value)
+{
+    WriteU32(bytes, (uint32_t)value);
+    WriteU32(bytes + 4, (uint32_t)(value >> 32));
+}
+
+bool Ktx2File_Is(const char* const path)
+{
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) return false;
+
+    uint8_t identifier[sizeof(KTX2_IDENTIFIER)];
+    const bool is_ktx2 = fread(identifier, 1, sizeof(identifier), fp) == sizeof(identifier) && memcmp(identifier, KTX2_IDENTIFIER, sizeof(identifier)) == 0;
+
+    fclose(fp);
+    return is_ktx2;
+}
+
+bool Ktx2File_ReadInfo(const char* const path, Ktx2Info info[static 1])
+{
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        ROSINA_LOG_ERROR("Could not open \"%s\"", path);
+        return true;
+    }
+
+    uint8_t header[KTX2_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header) || memcmp(header, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+    {
+        ROSINA_LOG_ERROR("\"%s\" is not a KTX2 file", path);
+        fclose(fp);
+        return true;
+    }
+
+    info->vk_format               = ReadU32(header + 12);
+    info->type_size               = ReadU32(header + 16);
+    info->width                   = ReadU32(header + 20);
+    info->height                  = ReadU32(header + 24);
+    const uint32_t depth          = ReadU32(header + 28);
+    const uint32_t layer_count    = ReadU32(header + 32);
+    const uint32_t face_count     = ReadU32(header + 36);
+    info->level_count             = ReadU32(header + 40);
+    info->supercompression_scheme = ReadU32(header + 44);
+
+    // a level count of 0 asks the loader to generate the mip chain.
+    if (info->level_count == 0) info->level_count = 1;
+
+    if (depth > 1 || layer_count > 1 || face_count != 1 || info->height == 0)
+    {
+        ROSINA_LOG_ERROR("\"%s\": only 2D textures with a single layer and face are supported", path);
+        fclose(fp);
+        return true;
+    }
+    if (info->level_count > KTX2_MAX_LEVEL_COUNT)
+    {
+        ROSINA_LOG_ERROR("\"%s\": too many levels (%u)", path, info->level_count);
+        fclose(fp);
+        return true;
+    }
+    if (info->supercompression_scheme != 0)
+    {
+        ROSINA_LOG_ERROR("\"%s\": supercompression is not supported", path);
+        fclose(fp);
+        return true;
+    }
+
+    uint8_t level_index[KTX2_LEVEL_INDEX_ENTRY_SIZE * KTX2_MAX_LEVEL_COUNT];
+    if (fread(level_index, KTX2_LEVEL_INDEX_ENTRY_SIZE, info->level_count, fp) != info->level_count)
+    {
+        ROSINA_LOG_ERROR("\"%s\": truncated level index", path);
+        fclose(fp);
+        return true;
+    }
+    fclose(fp);
+
+    for (uint32_t i = 0; i < info->level_count; i++)
+    {
+        const uint8_t* const entry               = level_index + (KTX2_LEVEL_INDEX_ENTRY_SIZE * i);
+        info->levels[i].byte_offset              = ReadU64(entry);
+        info->levels[i].byte_length              = ReadU64(entry + 8);
+        info->levels[i].uncompressed_byte_length = ReadU64(entry + 16);
+    }
+
+    // the payload has to be one contiguous range so it can be read straight into a staging buffer.
+    for (uint32_t i = info->level_count - 1; i > 0; i--)
+    {
+        if (info->levels[i].byte_offset + info->levels[i].byte_length != info->levels[i - 1].byte_offset)
+        {
+            ROSINA_LOG_ERROR("\"%s\": levels are not tightly packed smallest first", path);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Ktx2File_ReadPayload(const char* const path, const Ktx2Info info[static 1], const uint32_t first_level, void* const data)
+{
+    if (first_level >= info->level_count) return true;
+
+    return Ktx2File_ReadLevels(path, info, first_level, info->level_count - first_level, data);
+}
+
+bool Ktx2File_ReadLevels(const char* const path, const Ktx2Info info[static 1], const uint32_t first_level, const uint32_t level_count, void* const data)
+{
+    if (level_count == 0 || first_level + level_count > info->level_count) return true;
+
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) return true;
+
+    // the smallest of the levels comes first in the file
+    const uint64_t size = Ktx2Info_CalculateLevelsSize(info, first_level, level_count);
+    if (fseek(fp, (long)info->levels[first_level + level_count - 1].byte_offset, SEEK_SET) != 0 || fread(data, 1, size, fp) != size)
+    {
+        ROSINA_LOG_ERROR("\"%s\": could not read level data", path);
+        fclose(fp);
+        return true;
+    }
+
+    fclose(fp);
+    return false;
+}
+
+typedef struct DataFormatDescriptor
+{
+    uint32_t color_model;
+    uint32_t transfer_function;
+    uint32_t block_dimension;
+    uint32_t block_byte_count;
+    uint32_t sample_count;
+    // channel type, bit offset, bit length
+    uint32_t samples[4][3];
+} DataFormatDescriptor;
+
+static inline bool GetDataFormatDescriptor(const uint32_t vk_format, DataFormatDescriptor dfd[static 1])
+{
+    switch (vk_format)
+    {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            *dfd = (DataFormatDescriptor){
+                .color_model       = KHR_DF_MODEL_RGBSDA,
+                .transfer_function = vk_format == VK_FORMAT_R8G8B8A8_SRGB ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR,
+                .block_dimension   = 1,
+                .block_byte_count  = 4,
+                .sample_count      = 4,
+                .samples           = {{KHR_DF_CHANNEL_R, 0, 8}, {KHR_DF_CHANNEL_G, 8, 8}, {KHR_DF_CHANNEL_B, 16, 8}, {KHR_DF_CHANNEL_ALPHA | KHR_DF_SAMPLE_DATATYPE_LINEAR, 24, 8}}};
+            return false;
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            *dfd = (DataFormatDescriptor){
+                .color_model       = KHR_DF_MODEL_BC1A,
+                .transfer_function = vk_format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR,
+                .block_dimension   = 4,
+                .block_byte_count  = 8,
+                .sample_count      = 1,
+                .samples           = {{KHR_DF_CHANNEL_COLOR, 0, 64}}};
+            return false;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            *dfd = (DataFormatDescriptor){
+                .color_model       = KHR_DF_MODEL_BC3,
+                .transfer_function = vk_format == VK_FORMAT_BC3_SRGB_BLOCK ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR,
+                .block_dimension   = 4,
+                .block_byte_count  = 16,
+                .sample_count      = 2,
+                .samples           = {{KHR_DF_CHANNEL_ALPHA | KHR_DF_SAMPLE_DATATYPE_LINEAR, 0, 64}, {KHR_DF_CHANNEL_COLOR, 64, 64}}};
+            return false;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            *dfd = (DataFormatDescriptor){
+                .color_model       = KHR_DF_MODEL_BC7,
+                .transfer_function = vk_format == VK_FORMAT_BC7_SRGB_BLOCK ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR,
+                .block_dimension   = 4,
+                .block_byte_count  = 16,
+                .sample_count      = 1,
+                .samples           = {{KHR_DF_CHANNEL_COLOR, 0, 128}}};
+            return false;
+        default:
+            return true;
+    }
+}
+
+bool Ktx2File_Write(const char* const path, const Ktx2WriteInfo write_info[static 1])
+{
+    DataFormatDescriptor dfd;
+    if (GetDataFormatDescriptor(write_info->vk_format, &dfd))
+    {
+        ROSINA_LOG_ERROR("Unsupported KTX2 format (%u)", write_info->vk_format);
+        return true;
+    }
+    if (write_info->level_count == 0 || write_info->level_count > KTX2_MAX_LEVEL_COUNT)
+    {
+        ROSINA_LOG_ERROR("Invalid KTX2 level count (%u)", write_info->level_count);
+        return true;
+    }
+
+    const uint32_t dfd_offset = KTX2_HEADER_SIZE + (KTX2_LEVEL_INDEX_ENTRY_SIZE * write_info->level_count);
+    const uint32_t dfd_size   = 4 + 24 + (16 * dfd.sample_count);
+
+    // mip levels are aligned to lcm(texel block size, 4), which is the block size for every supported format.
+    uint64_t level_offset      = dfd_offset + dfd_size;
+    level_offset               = (level_offset + dfd.block_byte_count - 1) / dfd.block_byte_count * dfd.block_byte_count;
+    const uint64_t header_size = level_offset;
+
+    uint8_t header[KTX2_HEADER_SIZE + (KTX2_LEVEL_INDEX_ENTRY_SIZE * KTX2_MAX_LEVEL_COUNT) + 4 + 24 + (16 * 4) + 16] = {};
+
+    memcpy(header, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    WriteU32(header + 12, write_info->vk_format);
+    WriteU32(header + 16, 1);  // typeSize
+    WriteU32(header + 20, write_info->width);
+    WriteU32(header + 24, write_info->height);
+    WriteU32(header + 28, 0);  // pixelDepth
+    WriteU32(header + 32, 0);  // layerCount
+    WriteU32(header + 36, 1);  // faceCount
+    WriteU32(header + 40, write_info->level_count);
+    WriteU32(header + 44, 0);  // supercompressionScheme
+    WriteU32(header + 48, dfd_offset);
+    WriteU32(header + 52, dfd_size);
+    WriteU32(header + 56, 0);  // kvdByteOffset
+    WriteU32(header + 60, 0);  // kvdByteLength
+    WriteU64(header + 64, 0);  // sgdByteOffset
+    WriteU64(header + 72, 0);  // sgdByteLength
+
+    // smallest level first
+    for (uint32_t i = write_info->level_count; i-- > 0;)
+    {
+        if (write_info->level_sizes[i] % dfd.block_byte_count != 0)
+        {
+            ROSINA_LOG_ERROR("Level %u is not a whole number of blocks", i);
+            return true;
+        }
+
+        uint8_t* const entry = header + KTX2_HEADER_SIZE + (KTX2_LEVEL_INDEX_ENTRY_SIZE * i);
+        WriteU64(entry, level_offset);
+        WriteU64(entry + 8, write_info->level_sizes[i]);
+        WriteU64(entry + 16, write_info->level_sizes[i]);
+        level_offset += write_info->level_sizes[i];
+    }
+
+    {
+        uint8_t* const block = header + dfd_offset;
+        WriteU32(block, dfd_size);
+        WriteU32(block + 4, 0);  // vendorId = KHRONOS, descriptorType = BASICFORMAT
+        WriteU32(block + 8, 2 | ((24 + (16 * dfd.sample_count)) << 16));
+        WriteU32(block + 12, dfd.color_model | (KHR_DF_PRIMARIES_BT709 << 8) | (dfd.transfer_function << 16));
+        WriteU32(block + 16, (dfd.block_dimension - 1) | ((dfd.block_dimension - 1) << 8));
+        WriteU32(block + 20, dfd.block_byte_count);
+        WriteU32(block + 24, 0);
+        for (uint32_t i = 0; i < dfd.sample_count; i++)
+        {
+            uint8_t* const sample = block + 28 + (16 * i);
+            WriteU32(sample, dfd.samples[i][1] | ((dfd.samples[i][2] - 1) << 16) | (dfd.samples[i][0] << 24));
+            WriteU32(sample + 4, 0);
+            WriteU32(sample + 8, 0);
+            WriteU32(sample + 12, dfd.samples[i][2] == 8 ? 0xFF : UINT32_MAX);
+        }
+    }
+
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL)
+    {
+        ROSINA_LOG_ERROR("Could not open \"%s\" for writing", path);
+        return true;
+    }
+
+    if (fwrite(header, 1, header_size, fp) != header_size)
+    {
+        fclose(fp);
+        return true;
+    }
+
+    for (uint32_t i = write_info->level_count; i-- > 0;)
+    {
+        if (fwrite(write_info->level_data[i], 1, write_info->level_sizes[i], fp) != write_info->level_sizes[i])
+        {
+            ROSINA_LOG_ERROR("Could not write level %u to \"%s\"", i, path);
+            fclose(fp);
+            return true;
+        }
+    }
+
+    fclose(fp);
+    return false;
+}
@@ -0,0 +1,95 @@
+#ifndef ROSINA_UTILITY_KTX2_H
+#define ROSINA_UTILITY_KTX2_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define KTX2_MAX_LEVEL_COUNT 16
+
+typedef struct Ktx2Level
+{
+    uint64_t byte_offset;
+    uint64_t byte_length;
+    uint64_t uncompressed_byte_length;
+} Ktx2Level;
+
+typedef struct Ktx2Info
+{
+    uint32_t vk_format;
+    uint32_t type_size;
+    uint32_t width;
+    uint32_t height;
+    uint32_t level_count;
+    uint32_t supercompression_scheme;
+    Ktx2Level levels[KTX2_MAX_LEVEL_COUNT];
+} Ktx2Info;
+
+/**
+ * Returns true if the file at path starts with the KTX2 identifier.
+ */
+bool Ktx2File_Is(const char* const path);
+
+/**
+ * Reads the header and level index of a KTX2 file. Only 2D, single layer, single face files are accepted.
+ *
+ * @param path The path of the file.
+ * @param info Filled with the header and level index of the file.
+ * @return true on error.
+ */
+bool Ktx2File_ReadInfo(const char* const path, Ktx2Info info[static 1]);
+
+/**
+ * Levels are stored smallest first, so the levels from first_level down to the smallest one are a single contiguous
+ * range starting at levels[level_count - 1].byte_offset. This reads that range into data.
+ *
+ * @param path The path of the file.
+ * @param info The info returned by Ktx2File_ReadInfo.
+ * @param first_level The largest level to read. 0 reads the whole payload.
+ * @param data Destination for the level data. Must hold Ktx2Info_CalculatePayloadSize(info, first_level) bytes.
+ * @return true on error.
+ */
+bool Ktx2File_ReadPayload(const char* const path, const Ktx2Info info[static 1], const uint32_t first_level, void* const data);
+
+/**
+ * Like Ktx2File_ReadPayload, but reads only the levels from first_level to first_level + level_count - 1, which are
+ * just as contiguous.
+ *
+ * @param data Destination for the level data. Must hold Ktx2Info_CalculateLevelsSize(info, first_level, level_count) bytes.
+ * @return true on error.
+ */
+bool Ktx2File_ReadLevels(const char* const path, const Ktx2Info info[static 1], const uint32_t first_level, const uint32_t level_count, void* const data);
+
+static inline uint64_t Ktx2Info_CalculateLevelsSize(const Ktx2Info info[static 1], const uint32_t first_level, const uint32_t level_count)
+{
+    uint64_t size = 0;
+    for (uint32_t i = first_level; i < first_level + level_count && i < info->level_count; i++)
+    {
+        size += info->levels[i].byte_length;
+    }
+    return size;
+}
+
+static inline uint64_t Ktx2Info_CalculatePayloadSize(const Ktx2Info info[static 1], const uint32_t first_level)
+{
+    return first_level < info->level_count ? Ktx2Info_CalculateLevelsSize(info, first_level, info->level_count - first_level) : 0;
+}
+
+typedef struct Ktx2WriteInfo
+{
+    uint32_t vk_format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t level_count;
+    // level 0 is the largest level.
+    const void* level_data[KTX2_MAX_LEVEL_COUNT];
+    uint64_t level_sizes[KTX2_MAX_LEVEL_COUNT];
+} Ktx2WriteInfo;
+
+/**
+ * Writes a KTX2 file with a basic data format descriptor and no supercompression.
+ *
+ * @return true on error.
+ */
+bool Ktx2File_Write(const char* const path, const Ktx2WriteInfo write_info[static 1]);
+
+#endif
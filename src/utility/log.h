@@ -9,6 +9,11 @@
     fprintf(stdout, __VA_ARGS__); \
     fprintf(stdout, "\"\n")
 
+#define ROSINA_LOG_WARNING(...) \
+    fprintf(stdout, "[WARNING] FILE: \"%s\", LINE: %d, MESSAGE: \"", __FILE__, __LINE__); \
+    fprintf(stdout, __VA_ARGS__); \
+    fprintf(stdout, "\"\n")
+
 #define ROSINA_LOG_INFO(...) \
     fprintf(stdout, "[INFO] FILE: \"%s\", LINE: %d, MESSAGE: \"", __FILE__, __LINE__); \
     fprintf(stdout, __VA_ARGS__); \
@@ -158,4 +158,74 @@ static inline Mat4f Mat4f_Translation(const Vec3f position [static 1]) {
     return m;
 }
 
+/**
+ * Column major, like GLSL: the result transforms by m2, then by m1.
+ */
+static inline Mat4f Mat4f_Multiplied(const Mat4f m1 [static 1], const Mat4f m2 [static 1]) {
+    Mat4f m3;
+
+    for (uint32_t column = 0; column < 4; column++) {
+        for (uint32_t row = 0; row < 4; row++) {
+            m3.data[(column * 4) + row] = (
+                (m1->data[0 + row] * m2->data[(column * 4) + 0]) +
+                (m1->data[4 + row] * m2->data[(column * 4) + 1]) +
+                (m1->data[8 + row] * m2->data[(column * 4) + 2]) +
+                (m1->data[12 + row] * m2->data[(column * 4) + 3])
+            );
+        }
+    }
+
+    return m3;
+}
+
+/**
+ * @param view_model An affine column major matrix from some space to view space, where the camera is the origin.
+ * @return The camera position in that space, or the origin when the matrix cannot be inverted.
+ */
+static inline Vec3f Mat4f_GetViewPosition(const Mat4f view_model [static 1]) {
+    const float* d = view_model->data;
+
+    // the inverse of the upper 3x3 part is its adjugate over its determinant, the rows of the adjugate being crosses of columns
+    const Vec3f c0 = {{d[0], d[1], d[2]}};
+    const Vec3f c1 = {{d[4], d[5], d[6]}};
+    const Vec3f c2 = {{d[8], d[9], d[10]}};
+    const Vec3f r0 = Vec3_Crossed(&c1, &c2);
+    const Vec3f r1 = Vec3_Crossed(&c2, &c0);
+    const Vec3f r2 = Vec3_Crossed(&c0, &c1);
+    const float determinant = Vec3_Dot(&c0, &r0);
+    if (determinant == 0.0f) {
+        return (Vec3f){{0.0f, 0.0f, 0.0f}};
+    }
+
+    const Vec3f t = {{d[12], d[13], d[14]}};
+    return (Vec3f){{-Vec3_Dot(&r0, &t) / determinant, -Vec3_Dot(&r1, &t) / determinant, -Vec3_Dot(&r2, &t) / determinant}};
+}
+
+/**
+ * Extracts the left, right, bottom, top, near and far planes of the clip volume of a column major view projection
+ * matrix, with Vulkan's 0 to 1 depth. Points p inside have dot(plane.xyz, p) + plane.w >= 0. The planes are normalized,
+ * so that is also the distance to them.
+ */
+static inline void Mat4f_GetFrustumPlanes(const Mat4f m [static 1], Vec4f planes [static 6]) {
+    const float* d = m->data;
+    const Vec4f x = {{d[0], d[4], d[8], d[12]}};
+    const Vec4f y = {{d[1], d[5], d[9], d[13]}};
+    const Vec4f z = {{d[2], d[6], d[10], d[14]}};
+    const Vec4f w = {{d[3], d[7], d[11], d[15]}};
+
+    for (uint32_t i = 0; i < 4; i++) {
+        planes[0].data[i] = w.data[i] + x.data[i];
+        planes[1].data[i] = w.data[i] - x.data[i];
+        planes[2].data[i] = w.data[i] + y.data[i];
+        planes[3].data[i] = w.data[i] - y.data[i];
+        planes[4].data[i] = z.data[i];
+        planes[5].data[i] = w.data[i] - z.data[i];
+    }
+
+    for (uint32_t i = 0; i < 6; i++) {
+        const float l = SquareRoot((planes[i].data[0] * planes[i].data[0]) + (planes[i].data[1] * planes[i].data[1]) + (planes[i].data[2] * planes[i].data[2]));
+        Vec4f_Scale(&planes[i], l > 0.0f ? 1.0f / l : 0.0f);
+    }
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include <utility/mesh.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <utility/log.h>
+
+void Mesh_Cleanup(Mesh mesh[static 1])
+{
+    free(mesh->vertices);
+    mesh->vertices     = NULL;
+    mesh->vertex_count = 0;
+    free(mesh->indices);
+    mesh->indices     = NULL;
+    mesh->index_count = 0;
+}
+
+bool Mesh_Create(const Vertex* const vertices, const uint32_t vertex_count, const uint32_t* const indices, const uint32_t index_count,
+                 Mesh mesh[static 1])
+{
+    *mesh = (Mesh){
+        .vertices     = malloc(sizeof(Vertex) * vertex_count),
+        .vertex_count = vertex_count,
+        .indices      = malloc(sizeof(uint32_t) * index_count),
+        .index_count  = index_count,
+        .bounds       = {},
+    };
+    if (mesh->vertices == NULL || mesh->indices == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate mesh");
+        Mesh_Cleanup(mesh);
+        return true;
+    }
+
+    memcpy(mesh->vertices, vertices, sizeof(Vertex) * vertex_count);
+    memcpy(mesh->indices, indices, sizeof(uint32_t) * index_count);
+    Mesh_ComputeBounds(mesh);
+    return false;
+}
+
+bool Mesh_Load(const char* const path, Mesh mesh[static 1])
+{
+    const char* const extension = strrchr(path, '.');
+    if (extension != NULL && strcasecmp(extension, ".obj") == 0)
+    {
+        return Mesh_LoadObj(path, mesh);
+    }
+    if (extension != NULL && (strcasecmp(extension, ".gltf") == 0 || strcasecmp(extension, ".glb") == 0))
+    {
+        return Mesh_LoadGltf(path, mesh);
+    }
+
+    ROSINA_LOG_ERROR("Unknown mesh format %s", path);
+    return true;
+}
+
+static inline float DistanceSquared(const Vec3f a[static 1], const Vec3f b[static 1])
+{
+    const float x = a->data[0] - b->data[0];
+    const float y = a->data[1] - b->data[1];
+    const float z = a->data[2] - b->data[2];
+    return (x * x) + (y * y) + (z * z);
+}
+
+/**
+ * @return The vertex farthest from point.
+ */
+static uint32_t FindFarthest(const Mesh mesh[static 1], const Vec3f point[static 1])
+{
+    uint32_t farthest  = 0;
+    float max_distance = -1.0f;
+    for (uint32_t i = 0; i < mesh->vertex_count; i++)
+    {
+        const float distance = DistanceSquared(&mesh->vertices[i].position, point);
+        if (distance > max_distance)
+        {
+            farthest     = i;
+            max_distance = distance;
+        }
+    }
+    return farthest;
+}
+
+void Mesh_ComputeBounds(Mesh mesh[static 1])
+{
+    MeshBounds bounds = {.min = {{0.0f, 0.0f, 0.0f}}, .max = {{0.0f, 0.0f, 0.0f}}, .center = {{0.0f, 0.0f, 0.0f}}, .radius = 0.0f};
+    if (mesh->vertex_count == 0)
+    {
+        mesh->bounds = bounds;
+        return;
+    }
+
+    bounds.min = mesh->vertices[0].position;
+    bounds.max = mesh->vertices[0].position;
+    for (uint32_t i = 1; i < mesh->vertex_count; i++)
+    {
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            const float x         = mesh->vertices[i].position.data[axis];
+            bounds.min.data[axis] = x < bounds.min.data[axis] ? x : bounds.min.data[axis];
+            bounds.max.data[axis] = x > bounds.max.data[axis] ? x : bounds.max.data[axis];
+        }
+    }
+
+    // Ritter: start from the two vertices farthest apart along some direction and grow the sphere over the rest
+    const Vec3f* const a = &mesh->vertices[FindFarthest(mesh, &mesh->vertices[0].position)].position;
+    const Vec3f* const b = &mesh->vertices[FindFarthest(mesh, a)].position;
+    Vec3f center         = {{(a->data[0] + b->data[0]) * 0.5f, (a->data[1] + b->data[1]) * 0.5f, (a->data[2] + b->data[2]) * 0.5f}};
+    float radius         = SquareRoot(DistanceSquared(a, b)) * 0.5f;
+    for (uint32_t i = 0; i < mesh->vertex_count; i++)
+    {
+        const Vec3f* const p = &mesh->vertices[i].position;
+        const float distance = SquareRoot(DistanceSquared(p, &center));
+        if (distance > radius)
+        {
+            // move the center toward p just enough to cover it
+            const float new_radius = (radius + distance) * 0.5f;
+            const float t          = (new_radius - radius) / distance;
+            for (uint32_t axis = 0; axis < 3; axis++)
+            {
+                center.data[axis] += (p->data[axis] - center.data[axis]) * t;
+            }
+            radius = new_radius;
+        }
+    }
+
+    // for boxy meshes the sphere around the box is the tighter one
+    const Vec3f box_center = {{(bounds.min.data[0] + bounds.max.data[0]) * 0.5f, (bounds.min.data[1] + bounds.max.data[1]) * 0.5f,
+                               (bounds.min.data[2] + bounds.max.data[2]) * 0.5f}};
+    float box_radius       = 0.0f;
+    for (uint32_t i = 0; i < mesh->vertex_count; i++)
+    {
+        const float distance = DistanceSquared(&mesh->vertices[i].position, &box_center);
+        box_radius           = distance > box_radius ? distance : box_radius;
+    }
+    box_radius = SquareRoot(box_radius);
+
+    bounds.center = box_radius < radius ? box_center : center;
+    bounds.radius = box_radius < radius ? box_radius : radius;
+    mesh->bounds  = bounds;
+}
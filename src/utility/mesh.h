@@ -0,0 +1,77 @@
+#ifndef ROSINA_UTILITY_MESH_H
+#define ROSINA_UTILITY_MESH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <utility/math.h>
+
+/**
+ * A vertex at full precision, as loaded or generated before it is encoded. The w component of tangent is the sign of
+ * the bitangent.
+ */
+typedef struct Vertex
+{
+    Vec3f position;
+    Vec2f uv;
+    Vec3f normal;
+    Vec4f tangent;
+} Vertex;
+
+typedef struct MeshBounds
+{
+    Vec3f min;
+    Vec3f max;
+    // a sphere around every vertex, not necessarily the smallest one
+    Vec3f center;
+    float radius;
+} MeshBounds;
+
+/**
+ * An indexed triangle list in memory the mesh owns.
+ */
+typedef struct Mesh
+{
+    Vertex* vertices;
+    uint32_t vertex_count;
+    uint32_t* indices;
+    uint32_t index_count;
+    MeshBounds bounds;
+} Mesh;
+
+void Mesh_Cleanup(Mesh mesh[static 1]);
+
+/**
+ * Copies the vertices and indices into a new mesh and computes its bounds.
+ *
+ * @return true on error.
+ */
+bool Mesh_Create(const Vertex* const vertices, const uint32_t vertex_count, const uint32_t* const indices, const uint32_t index_count,
+                 Mesh mesh[static 1]);
+
+/**
+ * Loads the triangles of every mesh in a Wavefront OBJ file. Polygons are triangulated as fans and uvs are flipped to
+ * have their origin at the top left, like glTF and Vulkan. Vertices are not welded.
+ *
+ * @return true on error.
+ */
+bool Mesh_LoadObj(const char* const path, Mesh mesh[static 1]);
+
+/**
+ * Loads the triangles of every mesh primitive in a glTF 2.0 file, either .gltf with its buffers in separate files or
+ * data URIs, or .glb. Node transforms and sparse accessors are not supported. Vertices are not welded.
+ *
+ * @return true on error.
+ */
+bool Mesh_LoadGltf(const char* const path, Mesh mesh[static 1]);
+
+/**
+ * Loads an OBJ or glTF file depending on its extension.
+ *
+ * @return true on error.
+ */
+bool Mesh_Load(const char* const path, Mesh mesh[static 1]);
+
+void Mesh_ComputeBounds(Mesh mesh[static 1]);
+
+#endif
@@ -0,0 +1,468 @@
+#include <utility/mesh_file.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <utility/log.h>
+
+static const uint8_t MESH_FILE_IDENTIFIER[8] = {0xAB, 'R', 'M', 'S', 'H', 0xBB, 0x0D, 0x0A};
+
+#define MESH_FILE_HEADER_SIZE 160
+#define MESH_FILE_LOD_ENTRY_SIZE 12
+// a 32 bit delta takes at most 5 varint bytes
+#define MESH_FILE_MAX_VARINT_SIZE 5
+
+// the meshlet stream is the arrays as they are in memory, ready for a storage buffer
+_Static_assert(sizeof(Meshlet) == 16, "Meshlet must be tightly packed");
+_Static_assert(sizeof(MeshletBounds) == 44, "MeshletBounds must be tightly packed");
+
+static inline uint64_t CalculateMeshletDataSize(const uint32_t meshlet_count, const uint32_t vertex_count, const uint32_t triangle_count)
+{
+    return ((sizeof(Meshlet) + sizeof(MeshletBounds)) * (uint64_t)meshlet_count) + (sizeof(uint32_t) * (uint64_t)vertex_count) + (3 * (uint64_t)triangle_count);
+}
+
+static inline uint32_t ReadU32(const uint8_t bytes[static 4])
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static inline uint64_t ReadU64(const uint8_t bytes[static 8])
+{
+    return (uint64_t)ReadU32(bytes) | ((uint64_t)ReadU32(bytes + 4) << 32);
+}
+
+static inline float ReadF32(const uint8_t bytes[static 4])
+{
+    const uint32_t bits = ReadU32(bytes);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static inline void WriteU32(uint8_t bytes[static 4], const uint32_t value)
+{
+    bytes[0] = (uint8_t)(value);
+    bytes[1] = (uint8_t)(value >> 8);
+    bytes[2] = (uint8_t)(value >> 16);
+    bytes[3] = (uint8_t)(value >> 24);
+}
+
+static inline void WriteU64(uint8_t bytes[static 8], const uint64_t value)
+{
+    WriteU32(bytes, (uint32_t)value);
+    WriteU32(bytes + 4, (uint32_t)(value >> 32));
+}
+
+static inline void WriteF32(uint8_t bytes[static 4], const float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    WriteU32(bytes, bits);
+}
+
+static inline uint64_t AlignUp(const uint64_t value, const uint64_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+static inline void WriteVec3f(uint8_t bytes[static 12], const Vec3f v[static 1])
+{
+    WriteF32(bytes, v->data[0]);
+    WriteF32(bytes + 4, v->data[1]);
+    WriteF32(bytes + 8, v->data[2]);
+}
+
+static inline Vec3f ReadVec3f(const uint8_t bytes[static 12]) { return (Vec3f){{ReadF32(bytes), ReadF32(bytes + 4), ReadF32(bytes + 8)}}; }
+
+/**
+ * Each index is stored as the zigzag encoded difference to the index before it, in 7 bit groups with the high bit set
+ * on all but the last. Indices optimized for the vertex cache and vertex fetch are close to each other, so most take a
+ * single byte.
+ *
+ * @param dest NULL to only measure.
+ * @return The size of the encoded indices.
+ */
+static uint64_t CompressIndices(const uint32_t* const indices, const uint32_t count, uint8_t* const dest)
+{
+    uint64_t size     = 0;
+    uint32_t previous = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const int64_t delta = (int64_t)indices[i] - (int64_t)previous;
+        uint64_t zigzag     = delta < 0 ? ((uint64_t)(-delta) * 2) - 1 : (uint64_t)delta * 2;
+        previous            = indices[i];
+        do
+        {
+            const uint8_t byte = (uint8_t)(zigzag & 0x7F) | (zigzag > 0x7F ? 0x80 : 0);
+            if (dest != NULL) dest[size] = byte;
+            size++;
+            zigzag >>= 7;
+        } while (zigzag != 0);
+    }
+    return size;
+}
+
+/**
+ * @return true if src is truncated, has trailing bytes or decodes to an index of vertex_count or more.
+ */
+static bool DecompressIndices(const uint8_t* const src, const uint64_t size, const uint32_t count, const uint32_t index_size,
+                              const uint32_t vertex_count, void* const dest)
+{
+    uint64_t position = 0;
+    uint32_t previous = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint64_t zigzag = 0;
+        for (uint32_t shift = 0;; shift += 7)
+        {
+            if (position == size || shift >= 7 * MESH_FILE_MAX_VARINT_SIZE) return true;
+            const uint8_t byte = src[position++];
+            zigzag |= (uint64_t)(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) break;
+        }
+
+        const int64_t delta = (zigzag & 1) != 0 ? -(int64_t)((zigzag + 1) / 2) : (int64_t)(zigzag / 2);
+        const int64_t index = (int64_t)previous + delta;
+        if (index < 0 || index >= vertex_count) return true;
+        previous = (uint32_t)index;
+
+        if (index_size == sizeof(uint16_t))
+        {
+            ((uint16_t*)dest)[i] = (uint16_t)index;
+        }
+        else
+        {
+            ((uint32_t*)dest)[i] = (uint32_t)index;
+        }
+    }
+    return position != size;
+}
+
+bool MeshFile_Is(const char* const path)
+{
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) return false;
+
+    uint8_t identifier[sizeof(MESH_FILE_IDENTIFIER)];
+    const bool is_mesh_file = fread(identifier, 1, sizeof(identifier), fp) == sizeof(identifier) && memcmp(identifier, MESH_FILE_IDENTIFIER, sizeof(identifier)) == 0;
+
+    fclose(fp);
+    return is_mesh_file;
+}
+
+bool MeshFile_ReadInfo(const char* const path, MeshFileInfo info[static 1])
+{
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        ROSINA_LOG_ERROR("Could not open \"%s\"", path);
+        return true;
+    }
+
+    uint8_t header[MESH_FILE_HEADER_SIZE + (MESH_FILE_LOD_ENTRY_SIZE * MESH_LOD_MAX_COUNT)];
+    const bool truncated = fread(header, 1, sizeof(header), fp) != sizeof(header);
+    fseek(fp, 0, SEEK_END);
+    const long file_size = ftell(fp);
+    fclose(fp);
+    if (truncated || memcmp(header, MESH_FILE_IDENTIFIER, sizeof(MESH_FILE_IDENTIFIER)) != 0)
+    {
+        ROSINA_LOG_ERROR("\"%s\" is not a mesh file", path);
+        return true;
+    }
+
+    info->version = ReadU32(header + 8);
+    if (info->version != MESH_FILE_VERSION)
+    {
+        ROSINA_LOG_ERROR("\"%s\": version %u, expected %u", path, info->version, MESH_FILE_VERSION);
+        return true;
+    }
+
+    info->flags = ReadU32(header + 12);
+    for (uint32_t i = 0; i < MESH_FILE_ATTRIBUTE_COUNT; i++)
+    {
+        info->vertex_encodings[i] = ReadU32(header + 16 + (4 * i));
+    }
+    info->vertex_stride          = ReadU32(header + 32);
+    info->vertex_count           = ReadU32(header + 36);
+    info->index_size             = ReadU32(header + 40);
+    info->index_count            = ReadU32(header + 44);
+    info->bounds.min             = ReadVec3f(header + 48);
+    info->bounds.max             = ReadVec3f(header + 60);
+    info->bounds.center          = ReadVec3f(header + 72);
+    info->bounds.radius          = ReadF32(header + 84);
+    info->lod_count              = ReadU32(header + 88);
+    info->meshlet_count          = ReadU32(header + 92);
+    info->vertex_data_offset     = ReadU64(header + 96);
+    info->vertex_data_size       = ReadU64(header + 104);
+    info->index_data_offset      = ReadU64(header + 112);
+    info->index_data_size        = ReadU64(header + 120);
+    info->meshlet_vertex_count   = ReadU32(header + 128);
+    info->meshlet_triangle_count = ReadU32(header + 132);
+    info->meshlet_data_offset    = ReadU64(header + 136);
+    info->meshlet_data_size      = ReadU64(header + 144);
+
+    if (info->index_size != sizeof(uint16_t) && info->index_size != sizeof(uint32_t))
+    {
+        ROSINA_LOG_ERROR("\"%s\": invalid index size (%u)", path, info->index_size);
+        return true;
+    }
+    if (info->lod_count == 0 || info->lod_count > MESH_LOD_MAX_COUNT)
+    {
+        ROSINA_LOG_ERROR("\"%s\": invalid LOD count (%u)", path, info->lod_count);
+        return true;
+    }
+    if (info->vertex_data_size != (uint64_t)info->vertex_stride * info->vertex_count ||
+        ((info->flags & MESH_FILE_FLAG_COMPRESSED_INDICES) == 0 && info->index_data_size != (uint64_t)info->index_size * info->index_count))
+    {
+        ROSINA_LOG_ERROR("\"%s\": stream sizes do not match the header", path);
+        return true;
+    }
+    if (info->meshlet_data_size != CalculateMeshletDataSize(info->meshlet_count, info->meshlet_vertex_count, info->meshlet_triangle_count))
+    {
+        ROSINA_LOG_ERROR("\"%s\": meshlet stream size does not match the header", path);
+        return true;
+    }
+    if (info->vertex_data_offset + info->vertex_data_size > (uint64_t)file_size || info->index_data_offset + info->index_data_size > (uint64_t)file_size ||
+        info->meshlet_data_offset + info->meshlet_data_size > (uint64_t)file_size)
+    {
+        ROSINA_LOG_ERROR("\"%s\": truncated streams", path);
+        return true;
+    }
+
+    for (uint32_t i = 0; i < info->lod_count; i++)
+    {
+        const uint8_t* const entry = header + MESH_FILE_HEADER_SIZE + (MESH_FILE_LOD_ENTRY_SIZE * i);
+        info->lods[i]              = (MeshLod){.first_index = ReadU32(entry), .index_count = ReadU32(entry + 4), .error = ReadF32(entry + 8)};
+        if ((uint64_t)info->lods[i].first_index + info->lods[i].index_count > info->index_count)
+        {
+            ROSINA_LOG_ERROR("\"%s\": LOD %u is out of range", path, i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Reads size bytes at offset of the file at path into dest.
+ */
+static bool ReadRange(const char* const path, const uint64_t offset, const uint64_t size, void* const dest)
+{
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        ROSINA_LOG_ERROR("Could not open \"%s\"", path);
+        return true;
+    }
+
+    if (fseek(fp, (long)offset, SEEK_SET) != 0 || fread(dest, 1, size, fp) != size)
+    {
+        ROSINA_LOG_ERROR("\"%s\": could not read %llu bytes at %llu", path, (unsigned long long)size, (unsigned long long)offset);
+        fclose(fp);
+        return true;
+    }
+
+    fclose(fp);
+    return false;
+}
+
+bool MeshFile_ReadVertices(const char* const path, const MeshFileInfo info[static 1], void* const dest)
+{
+    return ReadRange(path, info->vertex_data_offset, info->vertex_data_size, dest);
+}
+
+bool MeshFile_ReadIndices(const char* const path, const MeshFileInfo info[static 1], void* const dest)
+{
+    if ((info->flags & MESH_FILE_FLAG_COMPRESSED_INDICES) == 0)
+    {
+        return ReadRange(path, info->index_data_offset, info->index_data_size, dest);
+    }
+
+    uint8_t* const compressed = malloc(info->index_data_size);
+    if (compressed == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate compressed indices");
+        return true;
+    }
+    if (ReadRange(path, info->index_data_offset, info->index_data_size, compressed))
+    {
+        free(compressed);
+        return true;
+    }
+
+    const bool failed = DecompressIndices(compressed, info->index_data_size, info->index_count, info->index_size, info->vertex_count, dest);
+    free(compressed);
+    if (failed)
+    {
+        ROSINA_LOG_ERROR("\"%s\": corrupt compressed indices", path);
+        return true;
+    }
+    return false;
+}
+
+bool MeshFile_ReadMeshlets(const char* const path, const MeshFileInfo info[static 1], Meshlets meshlets[static 1])
+{
+    if (Meshlets_Allocate(info->meshlet_count, info->meshlet_vertex_count, info->meshlet_triangle_count, meshlets))
+    {
+        return true;
+    }
+    if (info->meshlet_count == 0)
+    {
+        return false;
+    }
+
+    const uint64_t meshlets_size  = sizeof(Meshlet) * (uint64_t)info->meshlet_count;
+    const uint64_t bounds_size    = sizeof(MeshletBounds) * (uint64_t)info->meshlet_count;
+    const uint64_t vertices_size  = sizeof(uint32_t) * (uint64_t)info->meshlet_vertex_count;
+    const uint64_t triangles_size = 3 * (uint64_t)info->meshlet_triangle_count;
+    FILE* fp                      = fopen(path, "rb");
+    if (fp == NULL || fseek(fp, (long)info->meshlet_data_offset, SEEK_SET) != 0 || fread(meshlets->meshlets, 1, meshlets_size, fp) != meshlets_size ||
+        fread(meshlets->bounds, 1, bounds_size, fp) != bounds_size || fread(meshlets->vertices, 1, vertices_size, fp) != vertices_size ||
+        fread(meshlets->triangles, 1, triangles_size, fp) != triangles_size)
+    {
+        ROSINA_LOG_ERROR("\"%s\": could not read meshlets", path);
+        if (fp != NULL) fclose(fp);
+        Meshlets_Cleanup(meshlets);
+        return true;
+    }
+    fclose(fp);
+
+    // the triangles of a meshlet are drawn straight from the index buffer, so they have to be in it
+    for (uint32_t i = 0; i < meshlets->meshlet_count; i++)
+    {
+        const Meshlet* const meshlet = &meshlets->meshlets[i];
+        if (meshlet->vertex_count > MESHLET_MAX_VERTICES || meshlet->triangle_count > MESHLET_MAX_TRIANGLES ||
+            (uint64_t)meshlet->vertex_offset + meshlet->vertex_count > meshlets->vertex_count ||
+            (uint64_t)meshlet->triangle_offset + meshlet->triangle_count > meshlets->triangle_count ||
+            ((uint64_t)meshlet->triangle_offset + meshlet->triangle_count) * 3 > info->lods[0].index_count)
+        {
+            ROSINA_LOG_ERROR("\"%s\": meshlet %u is out of range", path, i);
+            Meshlets_Cleanup(meshlets);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MeshFile_Write(const char* const path, const MeshFileWriteInfo write_info[static 1])
+{
+    if (write_info->index_size != sizeof(uint16_t) && write_info->index_size != sizeof(uint32_t))
+    {
+        ROSINA_LOG_ERROR("Invalid index size (%u)", write_info->index_size);
+        return true;
+    }
+    if (write_info->lod_count == 0 || write_info->lod_count > MESH_LOD_MAX_COUNT)
+    {
+        ROSINA_LOG_ERROR("Invalid LOD count (%u)", write_info->lod_count);
+        return true;
+    }
+    for (uint32_t i = 0; i < write_info->index_count; i++)
+    {
+        if (write_info->indices[i] >= write_info->vertex_count || (write_info->index_size == sizeof(uint16_t) && write_info->indices[i] > UINT16_MAX))
+        {
+            ROSINA_LOG_ERROR("Index %u (%u) does not fit", i, write_info->indices[i]);
+            return true;
+        }
+    }
+
+    const uint64_t vertex_data_size = (uint64_t)write_info->vertex_stride * write_info->vertex_count;
+    const uint64_t index_data_size  = write_info->compress_indices ? CompressIndices(write_info->indices, write_info->index_count, NULL)
+                                                                   : (uint64_t)write_info->index_size * write_info->index_count;
+    uint8_t* const index_data       = malloc(index_data_size > 0 ? index_data_size : 1);
+    if (index_data == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate index stream");
+        return true;
+    }
+    if (write_info->compress_indices)
+    {
+        CompressIndices(write_info->indices, write_info->index_count, index_data);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < write_info->index_count; i++)
+        {
+            if (write_info->index_size == sizeof(uint16_t))
+            {
+                const uint16_t index = (uint16_t)write_info->indices[i];
+                memcpy(index_data + (sizeof(uint16_t) * i), &index, sizeof(index));
+            }
+            else
+            {
+                memcpy(index_data + (sizeof(uint32_t) * i), &write_info->indices[i], sizeof(uint32_t));
+            }
+        }
+    }
+
+    uint8_t header[MESH_FILE_HEADER_SIZE + (MESH_FILE_LOD_ENTRY_SIZE * MESH_LOD_MAX_COUNT)] = {};
+    const uint64_t vertex_data_offset  = AlignUp(sizeof(header), MESH_FILE_STREAM_ALIGNMENT);
+    const uint64_t index_data_offset   = AlignUp(vertex_data_offset + vertex_data_size, MESH_FILE_STREAM_ALIGNMENT);
+    const Meshlets no_meshlets         = {};
+    const Meshlets* const meshlets     = write_info->meshlets != NULL ? write_info->meshlets : &no_meshlets;
+    const uint64_t meshlet_data_size   = CalculateMeshletDataSize(meshlets->meshlet_count, meshlets->vertex_count, meshlets->triangle_count);
+    // without meshlets nothing is written after the indices, so the offset must not point past them
+    const uint64_t meshlet_data_offset = meshlets->meshlet_count > 0 ? AlignUp(index_data_offset + index_data_size, MESH_FILE_STREAM_ALIGNMENT) : 0;
+
+    memcpy(header, MESH_FILE_IDENTIFIER, sizeof(MESH_FILE_IDENTIFIER));
+    WriteU32(header + 8, MESH_FILE_VERSION);
+    WriteU32(header + 12, write_info->compress_indices ? MESH_FILE_FLAG_COMPRESSED_INDICES : 0);
+    for (uint32_t i = 0; i < MESH_FILE_ATTRIBUTE_COUNT; i++)
+    {
+        WriteU32(header + 16 + (4 * i), write_info->vertex_encodings[i]);
+    }
+    WriteU32(header + 32, write_info->vertex_stride);
+    WriteU32(header + 36, write_info->vertex_count);
+    WriteU32(header + 40, write_info->index_size);
+    WriteU32(header + 44, write_info->index_count);
+    WriteVec3f(header + 48, &write_info->bounds.min);
+    WriteVec3f(header + 60, &write_info->bounds.max);
+    WriteVec3f(header + 72, &write_info->bounds.center);
+    WriteF32(header + 84, write_info->bounds.radius);
+    WriteU32(header + 88, write_info->lod_count);
+    WriteU32(header + 92, meshlets->meshlet_count);
+    WriteU64(header + 96, vertex_data_offset);
+    WriteU64(header + 104, vertex_data_size);
+    WriteU64(header + 112, index_data_offset);
+    WriteU64(header + 120, index_data_size);
+    WriteU32(header + 128, meshlets->vertex_count);
+    WriteU32(header + 132, meshlets->triangle_count);
+    WriteU64(header + 136, meshlet_data_offset);
+    WriteU64(header + 144, meshlet_data_size);
+    WriteU64(header + 152, 0);  // reserved
+    for (uint32_t i = 0; i < write_info->lod_count; i++)
+    {
+        uint8_t* const entry = header + MESH_FILE_HEADER_SIZE + (MESH_FILE_LOD_ENTRY_SIZE * i);
+        WriteU32(entry, write_info->lods[i].first_index);
+        WriteU32(entry + 4, write_info->lods[i].index_count);
+        WriteF32(entry + 8, write_info->lods[i].error);
+    }
+
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL)
+    {
+        ROSINA_LOG_ERROR("Could not open \"%s\" for writing", path);
+        free(index_data);
+        return true;
+    }
+
+    static const uint8_t padding[MESH_FILE_STREAM_ALIGNMENT] = {};
+    const uint64_t vertex_padding_size  = vertex_data_offset - sizeof(header);
+    const uint64_t index_padding_size   = index_data_offset - (vertex_data_offset + vertex_data_size);
+    const uint64_t meshlet_padding_size = meshlets->meshlet_count > 0 ? meshlet_data_offset - (index_data_offset + index_data_size) : 0;
+    bool failed = fwrite(header, 1, sizeof(header), fp) != sizeof(header) || fwrite(padding, 1, vertex_padding_size, fp) != vertex_padding_size ||
+                  fwrite(write_info->vertices, 1, vertex_data_size, fp) != vertex_data_size ||
+                  fwrite(padding, 1, index_padding_size, fp) != index_padding_size || fwrite(index_data, 1, index_data_size, fp) != index_data_size;
+    if (!failed && meshlets->meshlet_count > 0)
+    {
+        failed = fwrite(padding, 1, meshlet_padding_size, fp) != meshlet_padding_size ||
+                 fwrite(meshlets->meshlets, sizeof(Meshlet), meshlets->meshlet_count, fp) != meshlets->meshlet_count ||
+                 fwrite(meshlets->bounds, sizeof(MeshletBounds), meshlets->meshlet_count, fp) != meshlets->meshlet_count ||
+                 fwrite(meshlets->vertices, sizeof(uint32_t), meshlets->vertex_count, fp) != meshlets->vertex_count ||
+                 fwrite(meshlets->triangles, 3, meshlets->triangle_count, fp) != meshlets->triangle_count;
+    }
+    free(index_data);
+    if (fclose(fp) != 0 || failed)
+    {
+        ROSINA_LOG_ERROR("Could not write \"%s\"", path);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,108 @@
+#ifndef ROSINA_UTILITY_MESH_FILE_H
+#define ROSINA_UTILITY_MESH_FILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <utility/mesh.h>
+#include <utility/mesh_lod.h>
+#include <utility/meshlet.h>
+
+#define MESH_FILE_VERSION 2
+#define MESH_FILE_ATTRIBUTE_COUNT 4
+// streams start on a page boundary so they can be read or mapped straight into buffer memory
+#define MESH_FILE_STREAM_ALIGNMENT 4096
+
+// the index stream holds zigzag varint deltas instead of index_size byte indices
+#define MESH_FILE_FLAG_COMPRESSED_INDICES (1u << 0)
+
+typedef struct MeshFileInfo
+{
+    uint32_t version;
+    uint32_t flags;
+    // VertexEncoding per VertexAttribute, the file does not interpret them
+    uint32_t vertex_encodings[MESH_FILE_ATTRIBUTE_COUNT];
+    uint32_t vertex_stride;
+    uint32_t vertex_count;
+    // 2 or 4 bytes
+    uint32_t index_size;
+    uint32_t index_count;
+    MeshBounds bounds;
+    // level 0 is the full mesh. Every level is a range of the one index stream.
+    uint32_t lod_count;
+    MeshLod lods[MESH_LOD_MAX_COUNT];
+    uint64_t vertex_data_offset;
+    uint64_t vertex_data_size;
+    uint64_t index_data_offset;
+    uint64_t index_data_size;
+    // meshlets of LOD 0, 0 when the file has none
+    uint32_t meshlet_count;
+    uint32_t meshlet_vertex_count;
+    uint32_t meshlet_triangle_count;
+    // the Meshlet, MeshletBounds, vertex and triangle arrays one after another, offset 0 when there are no meshlets
+    uint64_t meshlet_data_offset;
+    uint64_t meshlet_data_size;
+} MeshFileInfo;
+
+/**
+ * Returns true if the file at path starts with the mesh file identifier.
+ */
+bool MeshFile_Is(const char* const path);
+
+/**
+ * Reads and validates the header of a mesh file.
+ *
+ * @return true on error, or when the file was written by another version.
+ */
+bool MeshFile_ReadInfo(const char* const path, MeshFileInfo info[static 1]);
+
+/**
+ * Reads the vertex stream as it is stored, ready for the GPU.
+ *
+ * @param dest Must hold info->vertex_data_size bytes.
+ * @return true on error.
+ */
+bool MeshFile_ReadVertices(const char* const path, const MeshFileInfo info[static 1], void* const dest);
+
+/**
+ * Reads the index stream, decompressing it if needed.
+ *
+ * @param dest Must hold info->index_count * info->index_size bytes.
+ * @return true on error, or when a compressed index is out of range.
+ */
+bool MeshFile_ReadIndices(const char* const path, const MeshFileInfo info[static 1], void* const dest);
+
+/**
+ * Reads the meshlets into newly allocated arrays, which are empty when the file has none.
+ *
+ * @return true on error, or when a meshlet is out of range.
+ */
+bool MeshFile_ReadMeshlets(const char* const path, const MeshFileInfo info[static 1], Meshlets meshlets[static 1]);
+
+typedef struct MeshFileWriteInfo
+{
+    uint32_t vertex_encodings[MESH_FILE_ATTRIBUTE_COUNT];
+    uint32_t vertex_stride;
+    uint32_t vertex_count;
+    // vertex_count * vertex_stride bytes
+    const void* vertices;
+    uint32_t index_size;
+    uint32_t index_count;
+    // written as index_size byte indices or compressed
+    const uint32_t* indices;
+    bool compress_indices;
+    MeshBounds bounds;
+    uint32_t lod_count;
+    MeshLod lods[MESH_LOD_MAX_COUNT];
+    // built from the indices, NULL to write none
+    const Meshlets* meshlets;
+} MeshFileWriteInfo;
+
+/**
+ * Writes a mesh file. Compressed indices usually take 1 to 1.5 bytes each on meshes optimized with Mesh_Optimize.
+ *
+ * @return true on error.
+ */
+bool MeshFile_Write(const char* const path, const MeshFileWriteInfo write_info[static 1]);
+
+#endif
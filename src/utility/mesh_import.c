@@ -0,0 +1,758 @@
+#include <utility/mesh.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <utility/json.h>
+#include <utility/load_file.h>
+#include <utility/log.h>
+
+// polygons with more corners than this are rejected
+#define MESH_OBJ_MAX_POLYGON_CORNERS 64
+
+#define GLB_MAGIC      0x46546C67u
+#define GLB_CHUNK_JSON 0x4E4F534Au
+#define GLB_CHUNK_BIN  0x004E4942u
+
+#define GLTF_COMPONENT_BYTE           5120
+#define GLTF_COMPONENT_UNSIGNED_BYTE  5121
+#define GLTF_COMPONENT_SHORT          5122
+#define GLTF_COMPONENT_UNSIGNED_SHORT 5123
+#define GLTF_COMPONENT_UNSIGNED_INT   5125
+#define GLTF_COMPONENT_FLOAT          5126
+#define GLTF_MODE_TRIANGLES           4
+
+/**
+ * Grows *data so it holds at least count elements.
+ *
+ * @return true on error.
+ */
+static bool Reserve(void** const data, uint32_t capacity[static 1], const uint64_t count, const size_t element_size)
+{
+    if (count <= *capacity)
+    {
+        return false;
+    }
+    if (count > UINT32_MAX)
+    {
+        return true;
+    }
+
+    uint64_t new_capacity = *capacity > 0 ? *capacity : 64;
+    while (new_capacity < count)
+    {
+        new_capacity *= 2;
+    }
+    new_capacity = new_capacity > UINT32_MAX ? UINT32_MAX : new_capacity;
+
+    void* const new_data = realloc(*data, element_size * new_capacity);
+    if (new_data == NULL)
+    {
+        return true;
+    }
+    *data     = new_data;
+    *capacity = (uint32_t)new_capacity;
+    return false;
+}
+
+/**
+ * @param text_size Set to the size of the file, not counting the null terminator that is added.
+ * @return The contents of the file, or NULL on error. Free with free.
+ */
+static char* ReadFile(const char* const path, size_t text_size[static 1])
+{
+    if (LoadFile(NULL, text_size, path))
+    {
+        ROSINA_LOG_ERROR("Could not open %s", path);
+        return NULL;
+    }
+
+    char* const text = malloc(*text_size + 1);
+    if (text == NULL || LoadFile(text, text_size, path))
+    {
+        ROSINA_LOG_ERROR("Could not read %s", path);
+        free(text);
+        return NULL;
+    }
+    text[*text_size] = '\0';
+    return text;
+}
+
+/*
+ * OBJ
+ */
+
+typedef struct ObjAttributes
+{
+    Vec3f* positions;
+    uint32_t position_count;
+    uint32_t position_capacity;
+    Vec2f* uvs;
+    uint32_t uv_count;
+    uint32_t uv_capacity;
+    Vec3f* normals;
+    uint32_t normal_count;
+    uint32_t normal_capacity;
+} ObjAttributes;
+
+/**
+ * Parses up to n floats, missing ones are left as they are.
+ */
+static const char* ParseFloats(const char* text, float* const dest, const uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        char* end;
+        const float value = strtof(text, &end);
+        if (end == text)
+        {
+            break;
+        }
+        dest[i] = value;
+        text    = end;
+    }
+    return text;
+}
+
+/**
+ * Resolves a 1 based or negative, relative OBJ index.
+ *
+ * @return The 0 based index, or UINT32_MAX when it is out of range.
+ */
+static uint32_t ResolveObjIndex(const long index, const uint32_t count)
+{
+    if (index > 0 && (unsigned long)index <= count)
+    {
+        return (uint32_t)(index - 1);
+    }
+    if (index < 0 && (unsigned long)-index <= count)
+    {
+        return (uint32_t)((long)count + index);
+    }
+    return UINT32_MAX;
+}
+
+/**
+ * Parses a face corner, v, v/vt, v//vn or v/vt/vn.
+ *
+ * @return The text after the corner, or NULL on error.
+ */
+static const char* ParseObjCorner(const char* text, const ObjAttributes attributes[static 1], Vertex vertex[static 1])
+{
+    *vertex = (Vertex){.position = {{0.0f, 0.0f, 0.0f}}, .uv = {{0.0f, 0.0f}}, .normal = {{0.0f, 0.0f, 0.0f}}, .tangent = {{0.0f, 0.0f, 0.0f, 0.0f}}};
+
+    char* end;
+    const uint32_t position = ResolveObjIndex(strtol(text, &end, 10), attributes->position_count);
+    if (end == text || position == UINT32_MAX)
+    {
+        return NULL;
+    }
+    vertex->position = attributes->positions[position];
+    text             = end;
+
+    if (*text == '/')
+    {
+        text++;
+        if (*text != '/')
+        {
+            const uint32_t uv = ResolveObjIndex(strtol(text, &end, 10), attributes->uv_count);
+            if (end == text || uv == UINT32_MAX)
+            {
+                return NULL;
+            }
+            vertex->uv = attributes->uvs[uv];
+            text       = end;
+        }
+        if (*text == '/')
+        {
+            text++;
+            const uint32_t normal = ResolveObjIndex(strtol(text, &end, 10), attributes->normal_count);
+            if (end == text || normal == UINT32_MAX)
+            {
+                return NULL;
+            }
+            vertex->normal = attributes->normals[normal];
+            text           = end;
+        }
+    }
+    return text;
+}
+
+bool Mesh_LoadObj(const char* const path, Mesh mesh[static 1])
+{
+    *mesh = (Mesh){.vertices = NULL, .vertex_count = 0, .indices = NULL, .index_count = 0, .bounds = {}};
+
+    size_t text_size;
+    char* const text = ReadFile(path, &text_size);
+    if (text == NULL)
+    {
+        return true;
+    }
+
+    ObjAttributes attributes = {};
+    uint32_t vertex_capacity = 0;
+    uint32_t index_capacity  = 0;
+    uint32_t line_number     = 0;
+    bool error               = false;
+
+    for (const char* line = text; *line != '\0' && !error;)
+    {
+        line_number++;
+        const char* const line_end = line + strcspn(line, "\n");
+        while (*line == ' ' || *line == '\t')
+        {
+            line++;
+        }
+
+        if (line[0] == 'v' && (line[1] == ' ' || line[1] == '\t'))
+        {
+            error = Reserve((void**)&attributes.positions, &attributes.position_capacity, (uint64_t)attributes.position_count + 1, sizeof(Vec3f));
+            if (!error)
+            {
+                Vec3f* const position = &attributes.positions[attributes.position_count++];
+                *position             = (Vec3f){{0.0f, 0.0f, 0.0f}};
+                ParseFloats(line + 2, position->data, 3);
+            }
+        }
+        else if (line[0] == 'v' && line[1] == 't' && (line[2] == ' ' || line[2] == '\t'))
+        {
+            error = Reserve((void**)&attributes.uvs, &attributes.uv_capacity, (uint64_t)attributes.uv_count + 1, sizeof(Vec2f));
+            if (!error)
+            {
+                Vec2f* const uv = &attributes.uvs[attributes.uv_count++];
+                *uv             = (Vec2f){{0.0f, 0.0f}};
+                ParseFloats(line + 3, uv->data, 2);
+                uv->data[1] = 1.0f - uv->data[1];
+            }
+        }
+        else if (line[0] == 'v' && line[1] == 'n' && (line[2] == ' ' || line[2] == '\t'))
+        {
+            error = Reserve((void**)&attributes.normals, &attributes.normal_capacity, (uint64_t)attributes.normal_count + 1, sizeof(Vec3f));
+            if (!error)
+            {
+                Vec3f* const normal = &attributes.normals[attributes.normal_count++];
+                *normal             = (Vec3f){{0.0f, 0.0f, 0.0f}};
+                ParseFloats(line + 3, normal->data, 3);
+            }
+        }
+        else if (line[0] == 'f' && (line[1] == ' ' || line[1] == '\t'))
+        {
+            Vertex corners[MESH_OBJ_MAX_POLYGON_CORNERS];
+            uint32_t corner_count = 0;
+            const char* corner    = line + 2;
+            while (!error)
+            {
+                while (corner < line_end && (*corner == ' ' || *corner == '\t' || *corner == '\r'))
+                {
+                    corner++;
+                }
+                if (corner >= line_end)
+                {
+                    break;
+                }
+                if (corner_count == MESH_OBJ_MAX_POLYGON_CORNERS)
+                {
+                    error = true;
+                    break;
+                }
+                corner = ParseObjCorner(corner, &attributes, &corners[corner_count++]);
+                error  = corner == NULL;
+            }
+
+            if (!error && corner_count >= 3)
+            {
+                const uint32_t base = mesh->vertex_count;
+                error               = Reserve((void**)&mesh->vertices, &vertex_capacity, (uint64_t)base + corner_count, sizeof(Vertex)) ||
+                        Reserve((void**)&mesh->indices, &index_capacity, (uint64_t)mesh->index_count + ((corner_count - 2) * 3), sizeof(uint32_t));
+                if (!error)
+                {
+                    memcpy(mesh->vertices + base, corners, sizeof(Vertex) * corner_count);
+                    mesh->vertex_count += corner_count;
+                    for (uint32_t i = 2; i < corner_count; i++)
+                    {
+                        mesh->indices[mesh->index_count++] = base;
+                        mesh->indices[mesh->index_count++] = base + i - 1;
+                        mesh->indices[mesh->index_count++] = base + i;
+                    }
+                }
+            }
+        }
+
+        line = *line_end == '\n' ? line_end + 1 : line_end;
+    }
+
+    free(attributes.positions);
+    free(attributes.uvs);
+    free(attributes.normals);
+    free(text);
+
+    if (error || mesh->index_count == 0)
+    {
+        if (error)
+        {
+            ROSINA_LOG_ERROR("Invalid OBJ %s at line %u", path, line_number);
+        }
+        else
+        {
+            ROSINA_LOG_ERROR("OBJ %s has no faces", path);
+        }
+        Mesh_Cleanup(mesh);
+        return true;
+    }
+
+    Mesh_ComputeBounds(mesh);
+    return false;
+}
+
+/*
+ * glTF
+ */
+
+typedef struct GltfBuffer
+{
+    const uint8_t* data;
+    uint64_t size;
+    // NULL when data points into the .glb
+    uint8_t* owned;
+} GltfBuffer;
+
+typedef struct GltfFile
+{
+    Json json;
+    GltfBuffer* buffers;
+    uint32_t buffer_count;
+} GltfFile;
+
+static inline uint32_t ReadU32(const uint8_t* const data)
+{
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static int8_t Base64Value(const char c)
+{
+    if (c >= 'A' && c <= 'Z') return (int8_t)(c - 'A');
+    if (c >= 'a' && c <= 'z') return (int8_t)(c - 'a' + 26);
+    if (c >= '0' && c <= '9') return (int8_t)(c - '0' + 52);
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+/**
+ * @return The decoded bytes, or NULL on error. Free with free.
+ */
+static uint8_t* DecodeBase64(const char* const text, const uint32_t length, uint64_t size[static 1])
+{
+    uint8_t* const data = malloc(((size_t)length / 4 * 3) + 3);
+    if (data == NULL)
+    {
+        return NULL;
+    }
+
+    uint32_t bits      = 0;
+    uint32_t bit_count = 0;
+    *size              = 0;
+    for (uint32_t i = 0; i < length && text[i] != '='; i++)
+    {
+        const int8_t value = Base64Value(text[i]);
+        if (value < 0)
+        {
+            free(data);
+            return NULL;
+        }
+        bits = (bits << 6) | (uint32_t)value;
+        bit_count += 6;
+        if (bit_count >= 8)
+        {
+            bit_count -= 8;
+            data[(*size)++] = (uint8_t)(bits >> bit_count);
+        }
+    }
+    return data;
+}
+
+/**
+ * Loads the buffer from its URI, relative to the directory of path, or from the BIN chunk of a .glb.
+ *
+ * @return true on error.
+ */
+static bool LoadGltfBuffer(const char* const path, const GltfFile file[static 1], const uint32_t buffer_token, const uint8_t* const bin,
+                           const uint64_t bin_size, GltfBuffer buffer[static 1])
+{
+    const Json* const json  = &file->json;
+    const uint32_t uri      = Json_Find(json, buffer_token, "uri");
+    const uint64_t declared = (uint64_t)Json_GetNumber(json, Json_Find(json, buffer_token, "byteLength"), 0.0);
+
+    if (uri == JSON_NONE)
+    {
+        buffer->data = bin;
+        buffer->size = bin_size;
+    }
+    else
+    {
+        const char* const text = json->text + json->tokens[uri].start;
+        const uint32_t length  = json->tokens[uri].end - json->tokens[uri].start;
+        if (length > 5 && memcmp(text, "data:", 5) == 0)
+        {
+            const char* const comma = memchr(text, ',', length);
+            if (comma == NULL)
+            {
+                return true;
+            }
+            buffer->owned = DecodeBase64(comma + 1, (uint32_t)(text + length - comma - 1), &buffer->size);
+        }
+        else
+        {
+            // the URI is relative to the directory of the glTF file
+            const char* const slash = strrchr(path, '/');
+            const size_t directory  = slash != NULL ? (size_t)(slash - path) + 1 : 0;
+            char* const buffer_path = malloc(directory + length + 1);
+            if (buffer_path == NULL)
+            {
+                return true;
+            }
+            memcpy(buffer_path, path, directory);
+            memcpy(buffer_path + directory, text, length);
+            buffer_path[directory + length] = '\0';
+
+            size_t size;
+            buffer->owned = (uint8_t*)ReadFile(buffer_path, &size);
+            buffer->size  = size;
+            free(buffer_path);
+        }
+        if (buffer->owned == NULL)
+        {
+            return true;
+        }
+        buffer->data = buffer->owned;
+    }
+
+    return buffer->data == NULL || buffer->size < declared;
+}
+
+static inline uint32_t GetComponentSize(const uint32_t component_type)
+{
+    switch (component_type)
+    {
+        case GLTF_COMPONENT_BYTE:
+        case GLTF_COMPONENT_UNSIGNED_BYTE:
+            return 1;
+        case GLTF_COMPONENT_SHORT:
+        case GLTF_COMPONENT_UNSIGNED_SHORT:
+            return 2;
+        case GLTF_COMPONENT_UNSIGNED_INT:
+        case GLTF_COMPONENT_FLOAT:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+static inline float ReadComponent(const uint8_t* const data, const uint32_t component_type, const bool normalized)
+{
+    switch (component_type)
+    {
+        case GLTF_COMPONENT_BYTE:
+        {
+            const float x = (float)(int8_t)data[0];
+            return normalized ? (x / 127.0f < -1.0f ? -1.0f : x / 127.0f) : x;
+        }
+        case GLTF_COMPONENT_UNSIGNED_BYTE:
+            return normalized ? (float)data[0] / 255.0f : (float)data[0];
+        case GLTF_COMPONENT_SHORT:
+        {
+            int16_t value;
+            memcpy(&value, data, sizeof(value));
+            const float x = (float)value;
+            return normalized ? (x / 32767.0f < -1.0f ? -1.0f : x / 32767.0f) : x;
+        }
+        case GLTF_COMPONENT_UNSIGNED_SHORT:
+        {
+            uint16_t value;
+            memcpy(&value, data, sizeof(value));
+            return normalized ? (float)value / 65535.0f : (float)value;
+        }
+        case GLTF_COMPONENT_UNSIGNED_INT:
+            return (float)ReadU32(data);
+        default:
+        {
+            float value;
+            memcpy(&value, data, sizeof(value));
+            return value;
+        }
+    }
+}
+
+/**
+ * @return The index the token holds, or JSON_NONE when it is missing or not an index.
+ */
+static uint32_t GetGltfIndex(const Json json[static 1], const uint32_t token)
+{
+    const double index = Json_GetNumber(json, token, -1.0);
+    return index >= 0.0 && index < (double)JSON_NONE ? (uint32_t)index : JSON_NONE;
+}
+
+typedef struct GltfAccessor
+{
+    const uint8_t* data;
+    uint32_t count;
+    uint32_t component_type;
+    uint32_t component_count;
+    uint32_t stride;
+    bool normalized;
+} GltfAccessor;
+
+/**
+ * Resolves the accessor to where its elements are in the buffers, checking that they all are inside them.
+ *
+ * @return true on error.
+ */
+static bool GetGltfAccessor(const GltfFile file[static 1], const uint32_t index, GltfAccessor accessor[static 1])
+{
+    const Json* const json = &file->json;
+    const uint32_t token   = Json_Index(json, Json_Find(json, 0, "accessors"), index);
+    if (token == JSON_NONE || Json_Find(json, token, "sparse") != JSON_NONE)
+    {
+        return true;
+    }
+
+    const uint32_t type = Json_Find(json, token, "type");
+    accessor->component_count = Json_Equals(json, type, "SCALAR") ? 1
+                              : Json_Equals(json, type, "VEC2")   ? 2
+                              : Json_Equals(json, type, "VEC3")   ? 3
+                              : Json_Equals(json, type, "VEC4")   ? 4
+                                                                  : 0;
+    accessor->component_type = (uint32_t)Json_GetNumber(json, Json_Find(json, token, "componentType"), 0.0);
+    accessor->count          = (uint32_t)Json_GetNumber(json, Json_Find(json, token, "count"), 0.0);
+    const uint32_t normalized = Json_Find(json, token, "normalized");
+    accessor->normalized      = normalized != JSON_NONE && json->text[json->tokens[normalized].start] == 't';
+    const uint32_t component_size = GetComponentSize(accessor->component_type);
+    if (accessor->component_count == 0 || component_size == 0)
+    {
+        return true;
+    }
+
+    const uint32_t view = Json_Index(json, Json_Find(json, 0, "bufferViews"), GetGltfIndex(json, Json_Find(json, token, "bufferView")));
+    if (view == JSON_NONE)
+    {
+        return true;
+    }
+    const uint32_t buffer = GetGltfIndex(json, Json_Find(json, view, "buffer"));
+    if (buffer >= file->buffer_count)
+    {
+        return true;
+    }
+
+    const uint64_t element_size = (uint64_t)component_size * accessor->component_count;
+    const uint64_t view_offset  = (uint64_t)Json_GetNumber(json, Json_Find(json, view, "byteOffset"), 0.0);
+    const uint64_t view_length  = (uint64_t)Json_GetNumber(json, Json_Find(json, view, "byteLength"), 0.0);
+    const uint64_t offset       = (uint64_t)Json_GetNumber(json, Json_Find(json, token, "byteOffset"), 0.0);
+    accessor->stride            = (uint32_t)Json_GetNumber(json, Json_Find(json, view, "byteStride"), (double)element_size);
+    if (view_offset + view_length > file->buffers[buffer].size ||
+        (accessor->count > 0 && offset + ((uint64_t)(accessor->count - 1) * accessor->stride) + element_size > view_length))
+    {
+        return true;
+    }
+
+    accessor->data = file->buffers[buffer].data + view_offset + offset;
+    return false;
+}
+
+/**
+ * Reads the attribute into count vertices, which are read as arrays of floats starting at field.
+ *
+ * @return true on error.
+ */
+static bool ReadGltfAttribute(const GltfFile file[static 1], const uint32_t primitive, const char* const name, const uint32_t count,
+                              const uint32_t max_components, float* const field)
+{
+    const uint32_t attribute = Json_Find(&file->json, Json_Find(&file->json, primitive, "attributes"), name);
+    if (attribute == JSON_NONE)
+    {
+        return false;
+    }
+
+    GltfAccessor accessor;
+    if (GetGltfAccessor(file, GetGltfIndex(&file->json, attribute), &accessor) || accessor.count != count)
+    {
+        ROSINA_LOG_ERROR("Invalid glTF attribute %s", name);
+        return true;
+    }
+
+    const uint32_t components        = accessor.component_count < max_components ? accessor.component_count : max_components;
+    const uint32_t component_size    = GetComponentSize(accessor.component_type);
+    const uint32_t floats_per_vertex = sizeof(Vertex) / sizeof(float);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint8_t* const element = accessor.data + ((uint64_t)i * accessor.stride);
+        for (uint32_t c = 0; c < components; c++)
+        {
+            field[((size_t)i * floats_per_vertex) + c] = ReadComponent(element + (c * component_size), accessor.component_type, accessor.normalized);
+        }
+    }
+    return false;
+}
+
+/**
+ * Appends the triangles of the primitive to the mesh.
+ *
+ * @return true on error.
+ */
+static bool LoadGltfPrimitive(const GltfFile file[static 1], const uint32_t primitive, Mesh mesh[static 1], uint32_t vertex_capacity[static 1],
+                              uint32_t index_capacity[static 1])
+{
+    const Json* const json = &file->json;
+    if ((uint32_t)Json_GetNumber(json, Json_Find(json, primitive, "mode"), GLTF_MODE_TRIANGLES) != GLTF_MODE_TRIANGLES)
+    {
+        ROSINA_LOG_INFO("Skipping glTF primitive that is not a triangle list");
+        return false;
+    }
+
+    GltfAccessor positions;
+    if (GetGltfAccessor(file, GetGltfIndex(json, Json_Find(json, Json_Find(json, primitive, "attributes"), "POSITION")), &positions))
+    {
+        ROSINA_LOG_ERROR("glTF primitive has no valid positions");
+        return true;
+    }
+    if (positions.count == 0)
+    {
+        ROSINA_LOG_INFO("Skipping glTF primitive without vertices");
+        return false;
+    }
+
+    GltfAccessor indices         = {.data = NULL, .count = positions.count};
+    const uint32_t indices_token = Json_Find(json, primitive, "indices");
+    if (indices_token != JSON_NONE &&
+        (GetGltfAccessor(file, GetGltfIndex(json, indices_token), &indices) || indices.component_count != 1 ||
+         indices.component_type == GLTF_COMPONENT_FLOAT || indices.component_type == GLTF_COMPONENT_BYTE || indices.component_type == GLTF_COMPONENT_SHORT))
+    {
+        ROSINA_LOG_ERROR("Invalid glTF indices");
+        return true;
+    }
+
+    const uint32_t base = mesh->vertex_count;
+    if (Reserve((void**)&mesh->vertices, vertex_capacity, (uint64_t)base + positions.count, sizeof(Vertex)) ||
+        Reserve((void**)&mesh->indices, index_capacity, (uint64_t)mesh->index_count + indices.count, sizeof(uint32_t)))
+    {
+        ROSINA_LOG_ERROR("Failed to allocate mesh");
+        return true;
+    }
+
+    Vertex* const vertices = mesh->vertices + base;
+    memset(vertices, 0, sizeof(Vertex) * positions.count);
+    if (ReadGltfAttribute(file, primitive, "POSITION", positions.count, 3, vertices->position.data) ||
+        ReadGltfAttribute(file, primitive, "TEXCOORD_0", positions.count, 2, vertices->uv.data) ||
+        ReadGltfAttribute(file, primitive, "NORMAL", positions.count, 3, vertices->normal.data) ||
+        ReadGltfAttribute(file, primitive, "TANGENT", positions.count, 4, vertices->tangent.data))
+    {
+        return true;
+    }
+
+    for (uint32_t i = 0; i < indices.count - (indices.count % 3); i++)
+    {
+        uint32_t index = i;
+        if (indices.data != NULL)
+        {
+            index = (uint32_t)ReadComponent(indices.data + ((uint64_t)i * indices.stride), indices.component_type, false);
+        }
+        if (index >= positions.count)
+        {
+            ROSINA_LOG_ERROR("glTF index %u is out of range", index);
+            return true;
+        }
+        mesh->indices[mesh->index_count++] = base + index;
+    }
+    mesh->vertex_count += positions.count;
+    return false;
+}
+
+bool Mesh_LoadGltf(const char* const path, Mesh mesh[static 1])
+{
+    *mesh = (Mesh){.vertices = NULL, .vertex_count = 0, .indices = NULL, .index_count = 0, .bounds = {}};
+
+    size_t file_size;
+    char* const contents = ReadFile(path, &file_size);
+    if (contents == NULL)
+    {
+        return true;
+    }
+
+    // a .glb is a JSON chunk followed by an optional BIN chunk, a .gltf is only the JSON
+    const char* json_text = contents;
+    uint64_t json_size    = file_size;
+    const uint8_t* bin    = NULL;
+    uint64_t bin_size     = 0;
+    const uint8_t* bytes  = (const uint8_t*)contents;
+    if (file_size >= 20 && ReadU32(bytes) == GLB_MAGIC)
+    {
+        json_size = ReadU32(bytes + 12);
+        json_text = contents + 20;
+        if (ReadU32(bytes + 16) != GLB_CHUNK_JSON || 20 + json_size > file_size)
+        {
+            ROSINA_LOG_ERROR("Invalid glb %s", path);
+            free(contents);
+            return true;
+        }
+        const uint64_t bin_chunk = 20 + ((json_size + 3) & ~3ull);
+        if (bin_chunk + 8 <= file_size && ReadU32(bytes + bin_chunk + 4) == GLB_CHUNK_BIN)
+        {
+            bin_size = ReadU32(bytes + bin_chunk);
+            bin      = bytes + bin_chunk + 8;
+            bin_size = bin_chunk + 8 + bin_size <= file_size ? bin_size : 0;
+        }
+    }
+
+    GltfFile file = {.json = Json_Parse(json_text, json_size), .buffers = NULL, .buffer_count = 0};
+    bool error    = file.json.tokens == NULL || file.json.tokens[0].type != JSON_TYPE_OBJECT;
+
+    const uint32_t buffers = error ? JSON_NONE : Json_Find(&file.json, 0, "buffers");
+    if (!error && buffers != JSON_NONE)
+    {
+        file.buffer_count = file.json.tokens[buffers].size;
+        file.buffers      = calloc(file.buffer_count, sizeof(GltfBuffer));
+        error             = file.buffers == NULL;
+        for (uint32_t i = 0; i < file.buffer_count && !error; i++)
+        {
+            error = LoadGltfBuffer(path, &file, Json_Index(&file.json, buffers, i), bin, bin_size, &file.buffers[i]);
+        }
+    }
+
+    uint32_t vertex_capacity = 0;
+    uint32_t index_capacity  = 0;
+    const uint32_t meshes    = error ? JSON_NONE : Json_Find(&file.json, 0, "meshes");
+    for (uint32_t m = 0; meshes != JSON_NONE && m < file.json.tokens[meshes].size && !error; m++)
+    {
+        const uint32_t primitives = Json_Find(&file.json, Json_Index(&file.json, meshes, m), "primitives");
+        for (uint32_t p = 0; primitives != JSON_NONE && p < file.json.tokens[primitives].size && !error; p++)
+        {
+            error = LoadGltfPrimitive(&file, Json_Index(&file.json, primitives, p), mesh, &vertex_capacity, &index_capacity);
+        }
+    }
+
+    for (uint32_t i = 0; i < file.buffer_count; i++)
+    {
+        free(file.buffers[i].owned);
+    }
+    free(file.buffers);
+    Json_Cleanup(&file.json);
+    free(contents);
+
+    if (error || mesh->index_count == 0)
+    {
+        if (error)
+        {
+            ROSINA_LOG_ERROR("Invalid glTF %s", path);
+        }
+        else
+        {
+            ROSINA_LOG_ERROR("glTF %s has no triangles", path);
+        }
+        Mesh_Cleanup(mesh);
+        return true;
+    }
+
+    Mesh_ComputeBounds(mesh);
+    return false;
+}
@@ -0,0 +1,502 @@
+#include <utility/mesh_lod.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <utility/hash.h>
+#include <utility/log.h>
+#include <utility/mesh_optimizer.h>
+
+/**
+ * The sum of the squared distances to a set of planes, as the symmetric matrix of the products of their (a, b, c, d),
+ * and the total weight of the planes.
+ */
+typedef struct Quadric
+{
+    double a2, ab, ac, ad;
+    double b2, bc, bd;
+    double c2, cd;
+    double d2;
+    double weight;
+} Quadric;
+
+typedef struct Collapse
+{
+    // the positions, as the first vertex found at each
+    uint32_t from;
+    uint32_t to;
+    double cost;
+} Collapse;
+
+static void Quadric_AddPlane(Quadric q[static 1], const Vec3f normal[static 1], const float distance, const double weight)
+{
+    const double a = normal->data[0];
+    const double b = normal->data[1];
+    const double c = normal->data[2];
+    const double d = distance;
+    q->a2 += a * a * weight;
+    q->ab += a * b * weight;
+    q->ac += a * c * weight;
+    q->ad += a * d * weight;
+    q->b2 += b * b * weight;
+    q->bc += b * c * weight;
+    q->bd += b * d * weight;
+    q->c2 += c * c * weight;
+    q->cd += c * d * weight;
+    q->d2 += d * d * weight;
+    q->weight += weight;
+}
+
+static void Quadric_Add(Quadric q[static 1], const Quadric other[static 1])
+{
+    q->a2 += other->a2;
+    q->ab += other->ab;
+    q->ac += other->ac;
+    q->ad += other->ad;
+    q->b2 += other->b2;
+    q->bc += other->bc;
+    q->bd += other->bd;
+    q->c2 += other->c2;
+    q->cd += other->cd;
+    q->d2 += other->d2;
+    q->weight += other->weight;
+}
+
+/**
+ * @return The weighted mean of the squared distances from p to the planes.
+ */
+static double Quadric_Evaluate(const Quadric q[static 1], const Vec3f p[static 1])
+{
+    const double x     = p->data[0];
+    const double y     = p->data[1];
+    const double z     = p->data[2];
+    const double value = (q->a2 * x * x) + (2.0 * q->ab * x * y) + (2.0 * q->ac * x * z) + (2.0 * q->ad * x) + (q->b2 * y * y) + (2.0 * q->bc * y * z) +
+                         (2.0 * q->bd * y) + (q->c2 * z * z) + (2.0 * q->cd * z) + q->d2;
+    return q->weight > 0.0 ? fabs(value) / q->weight : 0.0;
+}
+
+static inline Vec3f Subtracted(const Vec3f a[static 1], const Vec3f b[static 1])
+{
+    return (Vec3f){{a->data[0] - b->data[0], a->data[1] - b->data[1], a->data[2] - b->data[2]}};
+}
+
+static inline Vec3f TriangleNormal(const Vec3f p0[static 1], const Vec3f p1[static 1], const Vec3f p2[static 1])
+{
+    const Vec3f e1 = Subtracted(p1, p0);
+    const Vec3f e2 = Subtracted(p2, p0);
+    return Vec3_Crossed(&e1, &e2);
+}
+
+static int CompareCollapses(const void* const a, const void* const b)
+{
+    const double cost_a = ((const Collapse*)a)->cost;
+    const double cost_b = ((const Collapse*)b)->cost;
+    return (cost_a > cost_b) - (cost_a < cost_b);
+}
+
+/**
+ * Sets positions[v] to the first vertex at the position of v, so seams, where vertices share a position but not their
+ * other attributes, are one position.
+ */
+static bool FindPositions(const Mesh mesh[static 1], uint32_t* const positions)
+{
+    uint32_t table_size = 1;
+    while (table_size < mesh->vertex_count * 2)
+    {
+        table_size *= 2;
+    }
+    uint32_t* const table = malloc(sizeof(uint32_t) * table_size);
+    if (table == NULL)
+    {
+        return true;
+    }
+    memset(table, 0xFF, sizeof(uint32_t) * table_size);
+
+    for (uint32_t i = 0; i < mesh->vertex_count; i++)
+    {
+        const Vec3f* const position = &mesh->vertices[i].position;
+        uint32_t slot               = (uint32_t)Hash64(position, sizeof(Vec3f), 0) & (table_size - 1);
+        while (table[slot] != UINT32_MAX && memcmp(&mesh->vertices[table[slot]].position, position, sizeof(Vec3f)) != 0)
+        {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        if (table[slot] == UINT32_MAX)
+        {
+            table[slot] = i;
+        }
+        positions[i] = table[slot];
+    }
+
+    free(table);
+    return false;
+}
+
+/**
+ * Lists the triangles around each position, in adjacency[offsets[p]] to adjacency[offsets[p + 1]].
+ */
+static void BuildAdjacency(const uint32_t* const indices, const uint32_t index_count, const uint32_t* const positions, const uint32_t vertex_count,
+                           uint32_t* const offsets, uint32_t* const adjacency)
+{
+    memset(offsets, 0, sizeof(uint32_t) * ((size_t)vertex_count + 1));
+    for (uint32_t i = 0; i < index_count; i++)
+    {
+        offsets[positions[indices[i]] + 1]++;
+    }
+    for (uint32_t i = 0; i < vertex_count; i++)
+    {
+        offsets[i + 1] += offsets[i];
+    }
+    for (uint32_t i = 0; i < index_count; i++)
+    {
+        adjacency[offsets[positions[indices[i]]]++] = i / 3;
+    }
+    // filling moved every offset to the start of the next position
+    for (uint32_t i = vertex_count; i > 0; i--)
+    {
+        offsets[i] = offsets[i - 1];
+    }
+    offsets[0] = 0;
+}
+
+/**
+ * @return The corner of the triangle at position, or 3.
+ */
+static inline uint32_t FindCorner(const uint32_t triangle[static 3], const uint32_t* const positions, const uint32_t position)
+{
+    for (uint32_t corner = 0; corner < 3; corner++)
+    {
+        if (positions[triangle[corner]] == position) return corner;
+    }
+    return 3;
+}
+
+/**
+ * Checks that moving the position from onto to flips no triangle, and maps every vertex at from to the vertex at to
+ * it shares an edge with, which keeps the uvs on both sides of a seam. Leaves remap untouched when the collapse is
+ * rejected.
+ *
+ * @return true if the collapse can be made.
+ */
+static bool PrepareCollapse(const Mesh mesh[static 1], const uint32_t* const indices, const uint32_t* const positions, const uint32_t* const offsets,
+                            const uint32_t* const adjacency, const uint32_t from, const uint32_t to, uint32_t* const remap)
+{
+    const Vec3f* const target = &mesh->vertices[to].position;
+    for (uint32_t i = offsets[from]; i < offsets[from + 1]; i++)
+    {
+        const uint32_t* const triangle = indices + ((size_t)adjacency[i] * 3);
+        const uint32_t corner          = FindCorner(triangle, positions, from);
+        const uint32_t other           = FindCorner(triangle, positions, to);
+        if (other != 3)
+        {
+            // collapses into a line and goes away
+            remap[triangle[corner]] = triangle[other];
+            continue;
+        }
+
+        const Vec3f* p[3] = {&mesh->vertices[triangle[0]].position, &mesh->vertices[triangle[1]].position, &mesh->vertices[triangle[2]].position};
+        const Vec3f before = TriangleNormal(p[0], p[1], p[2]);
+        p[corner]          = target;
+        const Vec3f after  = TriangleNormal(p[0], p[1], p[2]);
+        if (Vec3_Dot(&before, &after) <= 0.0f)
+        {
+            for (uint32_t j = offsets[from]; j < offsets[from + 1]; j++)
+            {
+                const uint32_t* const undo = indices + ((size_t)adjacency[j] * 3);
+                remap[undo[FindCorner(undo, positions, from)]] = undo[FindCorner(undo, positions, from)];
+            }
+            return false;
+        }
+    }
+
+    // a vertex with no edge to the other position would not know which of its vertices to take
+    for (uint32_t i = offsets[from]; i < offsets[from + 1]; i++)
+    {
+        const uint32_t* const triangle = indices + ((size_t)adjacency[i] * 3);
+        const uint32_t vertex          = triangle[FindCorner(triangle, positions, from)];
+        if (remap[vertex] == vertex)
+        {
+            for (uint32_t j = offsets[from]; j < offsets[from + 1]; j++)
+            {
+                const uint32_t* const undo = indices + ((size_t)adjacency[j] * 3);
+                remap[undo[FindCorner(undo, positions, from)]] = undo[FindCorner(undo, positions, from)];
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Mesh_Simplify(const Mesh mesh[static 1], const uint32_t* const indices, const uint32_t index_count, const uint32_t target_index_count,
+                   const float max_error, uint32_t* const dest, uint32_t dest_count[static 1], float error[static 1])
+{
+    const uint32_t vertex_count = mesh->vertex_count;
+    memmove(dest, indices, sizeof(uint32_t) * index_count);
+    *dest_count = index_count - (index_count % 3);
+    *error      = 0.0f;
+    if (*dest_count <= target_index_count || max_error <= 0.0f)
+    {
+        return false;
+    }
+
+    uint32_t* const positions  = malloc(sizeof(uint32_t) * vertex_count);
+    uint32_t* const remap      = malloc(sizeof(uint32_t) * vertex_count);
+    uint32_t* const offsets    = malloc(sizeof(uint32_t) * ((size_t)vertex_count + 1));
+    uint32_t* const adjacency  = malloc(sizeof(uint32_t) * index_count);
+    bool* const locked         = malloc(sizeof(bool) * vertex_count);
+    Quadric* const quadrics    = calloc(vertex_count, sizeof(Quadric));
+    Collapse* const collapses  = malloc(sizeof(Collapse) * index_count);
+    if (positions == NULL || remap == NULL || offsets == NULL || adjacency == NULL || locked == NULL || quadrics == NULL || collapses == NULL ||
+        FindPositions(mesh, positions))
+    {
+        ROSINA_LOG_ERROR("Failed to allocate simplifier");
+        free(positions);
+        free(remap);
+        free(offsets);
+        free(adjacency);
+        free(locked);
+        free(quadrics);
+        free(collapses);
+        return true;
+    }
+
+    uint32_t count = *dest_count;
+    BuildAdjacency(dest, count, positions, vertex_count, offsets, adjacency);
+
+    // the planes of the triangles around each position, weighted by area, and the planes standing on border edges
+    for (uint32_t t = 0; t < count / 3; t++)
+    {
+        const uint32_t* const triangle = dest + ((size_t)t * 3);
+        Vec3f normal = TriangleNormal(&mesh->vertices[triangle[0]].position, &mesh->vertices[triangle[1]].position, &mesh->vertices[triangle[2]].position);
+        const float length = SquareRoot(Vec3_Dot(&normal, &normal));
+        if (length <= 0.0f)
+        {
+            continue;
+        }
+        Vec3f_Scale(&normal, 1.0f / length);
+
+        const float distance = -Vec3_Dot(&normal, &mesh->vertices[triangle[0]].position);
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            Quadric_AddPlane(&quadrics[positions[triangle[corner]]], &normal, distance, length * 0.5f);
+        }
+
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            const uint32_t a = positions[triangle[corner]];
+            const uint32_t b = positions[triangle[(corner + 1) % 3]];
+
+            // an edge is on the border when no triangle around b has it the other way
+            bool border = true;
+            for (uint32_t i = offsets[b]; i < offsets[b + 1] && border; i++)
+            {
+                const uint32_t* const neighbour = dest + ((size_t)adjacency[i] * 3);
+                const uint32_t corner_b         = FindCorner(neighbour, positions, b);
+                border                          = positions[neighbour[(corner_b + 1) % 3]] != a;
+            }
+            if (!border)
+            {
+                continue;
+            }
+
+            const Vec3f edge          = Subtracted(&mesh->vertices[b].position, &mesh->vertices[a].position);
+            const float edge_length   = Vec3_Dot(&edge, &edge);
+            Vec3f border_normal       = Vec3_Crossed(&edge, &normal);
+            const float normal_length = SquareRoot(Vec3_Dot(&border_normal, &border_normal));
+            if (normal_length <= 0.0f)
+            {
+                continue;
+            }
+            Vec3f_Scale(&border_normal, 1.0f / normal_length);
+
+            const float border_distance = -Vec3_Dot(&border_normal, &mesh->vertices[a].position);
+            Quadric_AddPlane(&quadrics[a], &border_normal, border_distance, edge_length * MESH_LOD_BORDER_WEIGHT);
+            Quadric_AddPlane(&quadrics[b], &border_normal, border_distance, edge_length * MESH_LOD_BORDER_WEIGHT);
+        }
+    }
+
+    // passes of the cheapest collapses that touch different positions, until the target or the error limit is reached
+    const double max_cost = (double)max_error * max_error;
+    double result_cost    = 0.0;
+    while (count > target_index_count)
+    {
+        uint32_t collapse_count = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const uint32_t a = positions[dest[i]];
+            const uint32_t b = positions[dest[i - (i % 3) + ((i + 1) % 3)]];
+            if (a == b)
+            {
+                continue;
+            }
+
+            Quadric q = quadrics[a];
+            Quadric_Add(&q, &quadrics[b]);
+            const double a_to_b       = Quadric_Evaluate(&q, &mesh->vertices[b].position);
+            const double b_to_a       = Quadric_Evaluate(&q, &mesh->vertices[a].position);
+            collapses[collapse_count++] = a_to_b <= b_to_a ? (Collapse){.from = a, .to = b, .cost = a_to_b} : (Collapse){.from = b, .to = a, .cost = b_to_a};
+        }
+        qsort(collapses, collapse_count, sizeof(Collapse), CompareCollapses);
+
+        for (uint32_t i = 0; i < vertex_count; i++)
+        {
+            remap[i]  = i;
+            locked[i] = false;
+        }
+
+        // most collapses remove two triangles
+        const uint32_t triangles_to_remove = (count - target_index_count + 2) / 3;
+        uint32_t removed                   = 0;
+        uint32_t collapsed                 = 0;
+        for (uint32_t i = 0; i < collapse_count && removed < triangles_to_remove; i++)
+        {
+            const Collapse* const collapse = &collapses[i];
+            if (collapse->cost > max_cost)
+            {
+                break;
+            }
+            if (locked[collapse->from] || locked[collapse->to] ||
+                !PrepareCollapse(mesh, dest, positions, offsets, adjacency, collapse->from, collapse->to, remap))
+            {
+                continue;
+            }
+
+            locked[collapse->from] = true;
+            locked[collapse->to]   = true;
+            Quadric_Add(&quadrics[collapse->to], &quadrics[collapse->from]);
+            result_cost = collapse->cost > result_cost ? collapse->cost : result_cost;
+            collapsed++;
+            for (uint32_t j = offsets[collapse->from]; j < offsets[collapse->from + 1]; j++)
+            {
+                removed += FindCorner(dest + ((size_t)adjacency[j] * 3), positions, collapse->to) != 3;
+            }
+        }
+        if (collapsed == 0)
+        {
+            break;
+        }
+
+        // drop the triangles that collapsed into lines
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < count; i += 3)
+        {
+            const uint32_t a = remap[dest[i]];
+            const uint32_t b = remap[dest[i + 1]];
+            const uint32_t c = remap[dest[i + 2]];
+            if (positions[a] == positions[b] || positions[b] == positions[c] || positions[c] == positions[a])
+            {
+                continue;
+            }
+            dest[kept++] = a;
+            dest[kept++] = b;
+            dest[kept++] = c;
+        }
+        count = kept;
+        BuildAdjacency(dest, count, positions, vertex_count, offsets, adjacency);
+    }
+
+    *dest_count = count;
+    *error      = SquareRoot((float)result_cost);
+
+    free(positions);
+    free(remap);
+    free(offsets);
+    free(adjacency);
+    free(locked);
+    free(quadrics);
+    free(collapses);
+    return false;
+}
+
+bool Mesh_GenerateLods(Mesh mesh[static 1], const MeshLodCreateInfo info[static 1], MeshLod lods[static MESH_LOD_MAX_COUNT], uint32_t lod_count[static 1])
+{
+    lods[0]    = (MeshLod){.first_index = 0, .index_count = mesh->index_count, .error = 0.0f};
+    *lod_count = 1;
+
+    const uint32_t max_lod_count = info->max_lod_count < MESH_LOD_MAX_COUNT ? info->max_lod_count : MESH_LOD_MAX_COUNT;
+    const float max_error        = info->max_error * mesh->bounds.radius;
+    uint32_t* const indices      = malloc(sizeof(uint32_t) * (mesh->index_count > 0 ? mesh->index_count : 1));
+    if (indices == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate LOD indices");
+        return true;
+    }
+
+    while (*lod_count < max_lod_count)
+    {
+        const MeshLod previous = lods[*lod_count - 1];
+        if (previous.index_count / 3 <= info->min_triangle_count)
+        {
+            break;
+        }
+
+        uint32_t target_triangle_count = (uint32_t)((float)(previous.index_count / 3) * info->reduction);
+        target_triangle_count          = target_triangle_count > info->min_triangle_count ? target_triangle_count : info->min_triangle_count;
+
+        uint32_t index_count = 0;
+        float error          = 0.0f;
+        if (Mesh_Simplify(mesh, mesh->indices + previous.first_index, previous.index_count, target_triangle_count * 3, max_error - previous.error, indices,
+                          &index_count, &error))
+        {
+            free(indices);
+            return true;
+        }
+        // a level that barely simplified is not worth its indices
+        if (index_count == 0 || (uint64_t)index_count * 10 > (uint64_t)previous.index_count * 9)
+        {
+            break;
+        }
+
+        Mesh level = {
+            .vertices     = mesh->vertices,
+            .vertex_count = mesh->vertex_count,
+            .indices      = indices,
+            .index_count  = index_count,
+            .bounds       = mesh->bounds,
+        };
+        uint32_t* const grown = realloc(mesh->indices, sizeof(uint32_t) * ((size_t)mesh->index_count + index_count));
+        if (Mesh_OptimizeVertexCache(&level) || grown == NULL)
+        {
+            ROSINA_LOG_ERROR("Failed to add LOD %u", *lod_count);
+            if (grown != NULL) mesh->indices = grown;
+            free(indices);
+            return true;
+        }
+        mesh->indices = grown;
+        memcpy(mesh->indices + mesh->index_count, indices, sizeof(uint32_t) * index_count);
+
+        lods[(*lod_count)++] = (MeshLod){.first_index = mesh->index_count, .index_count = index_count, .error = previous.error + error};
+        mesh->index_count += index_count;
+    }
+    free(indices);
+
+    char triangle_counts[MESH_LOD_MAX_COUNT * 16] = {};
+    uint32_t length                               = 0;
+    for (uint32_t i = 0; i < *lod_count && length < sizeof(triangle_counts); i++)
+    {
+        length += (uint32_t)snprintf(triangle_counts + length, sizeof(triangle_counts) - length, i == 0 ? "%u" : ", %u", lods[i].index_count / 3);
+    }
+    ROSINA_LOG_INFO("LODs: %u levels of %s triangles, largest error %f", *lod_count, triangle_counts, (double)lods[*lod_count - 1].error);
+    return false;
+}
+
+uint32_t MeshLod_Select(const MeshLod* const lods, const uint32_t lod_count, const float distance, const float error_scale, const float threshold,
+                        const float hysteresis, const uint32_t current)
+{
+    // inside the bounding sphere every error is too large
+    if (distance <= 0.0f || lod_count == 0)
+    {
+        return 0;
+    }
+
+    uint32_t lod = current < lod_count ? current : 0;
+    while (lod > 0 && lods[lod].error * error_scale / distance > threshold * (1.0f + hysteresis))
+    {
+        lod--;
+    }
+    while (lod + 1 < lod_count && lods[lod + 1].error * error_scale / distance <= threshold * (1.0f - hysteresis))
+    {
+        lod++;
+    }
+    return lod;
+}
@@ -0,0 +1,90 @@
+#ifndef ROSINA_UTILITY_MESH_LOD_H
+#define ROSINA_UTILITY_MESH_LOD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <utility/mesh.h>
+
+#define MESH_LOD_MAX_COUNT 8
+// how much more a border edge resists moving than the surface around it
+#define MESH_LOD_BORDER_WEIGHT 10.0f
+
+#define MESH_LOD_DEFAULT_REDUCTION 0.5f
+#define MESH_LOD_DEFAULT_MIN_TRIANGLE_COUNT 128
+#define MESH_LOD_DEFAULT_MAX_ERROR 0.05f
+// projected error in pixels the selector allows
+#define MESH_LOD_DEFAULT_THRESHOLD 1.0f
+#define MESH_LOD_DEFAULT_HYSTERESIS 0.25f
+
+/**
+ * A level of detail, as a range of the index buffer of a mesh. Every level uses the vertices of the full mesh.
+ */
+typedef struct MeshLod
+{
+    uint32_t first_index;
+    uint32_t index_count;
+    // how far, in the space of the mesh, this level may deviate from the full mesh. 0 for the full mesh.
+    float error;
+} MeshLod;
+
+typedef struct MeshLodCreateInfo
+{
+    // including the full mesh, at most MESH_LOD_MAX_COUNT
+    uint32_t max_lod_count;
+    // the triangle count of each level relative to the one before
+    float reduction;
+    // no level is simplified below this many triangles
+    uint32_t min_triangle_count;
+    // no level deviates from the full mesh by more than this, relative to the bounding sphere radius
+    float max_error;
+} MeshLodCreateInfo;
+
+/**
+ * Simplifies the triangles with quadric error metrics, collapsing edges into one of their vertices until
+ * target_index_count is reached or the next collapse would deviate by more than max_error. Vertices are never moved or
+ * created, so the result indexes the same vertices. Vertices on UV seams are collapsed along with their other side
+ * and borders of open meshes are preserved.
+ *
+ * @param dest Room for index_count indices.
+ * @param dest_count Set to the number of indices written.
+ * @param error Set to how far the result deviates from the input, in the space of the mesh.
+ * @return true on error.
+ */
+bool Mesh_Simplify(const Mesh mesh[static 1], const uint32_t* const indices, const uint32_t index_count, const uint32_t target_index_count,
+                   const float max_error, uint32_t* const dest, uint32_t dest_count[static 1], float error[static 1]);
+
+/**
+ * Appends simplified levels to the indices of the mesh, each one simplified from the one before and optimized for the
+ * vertex cache. Run after Mesh_Optimize.
+ *
+ * @param lods Set to the levels, lods[0] being the full mesh.
+ * @param lod_count Set to the number of levels, 1 if the mesh could not be simplified.
+ * @return true on error.
+ */
+bool Mesh_GenerateLods(Mesh mesh[static 1], const MeshLodCreateInfo info[static 1], MeshLod lods[static MESH_LOD_MAX_COUNT], uint32_t lod_count[static 1]);
+
+/**
+ * @param projection A projection made by SetPerspectiveProjectionMatrix.
+ * @param viewport_height In pixels.
+ * @return Pixels per unit of error at a distance of 1.
+ */
+static inline float MeshLod_GetErrorScale(const Mat4f projection[static 1], const float viewport_height)
+{
+    return projection->data[5] * viewport_height * 0.5f;
+}
+
+/**
+ * Picks the coarsest level whose error projects to at most threshold pixels. The current level is only left for a
+ * finer one once its error exceeds threshold * (1 + hysteresis), and for a coarser one once that one's error is below
+ * threshold * (1 - hysteresis), so a level does not flip back and forth at the boundary.
+ *
+ * @param distance From the camera to the closest point of the bounding sphere of the mesh.
+ * @param error_scale See MeshLod_GetErrorScale.
+ * @param current The level drawn last, or 0.
+ * @return The level to draw.
+ */
+uint32_t MeshLod_Select(const MeshLod* const lods, const uint32_t lod_count, const float distance, const float error_scale, const float threshold,
+                        const float hysteresis, const uint32_t current);
+
+#endif
@@ -0,0 +1,448 @@
+#include <utility/mesh_optimizer.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <utility/hash.h>
+#include <utility/log.h>
+
+MeshVertexCacheStats Mesh_AnalyzeVertexCache(const Mesh mesh[static 1], const uint32_t cache_size)
+{
+    MeshVertexCacheStats stats = {.acmr = 0.0f, .atvr = 0.0f};
+    if (mesh->index_count == 0)
+    {
+        return stats;
+    }
+
+    // a vertex is in the cache when fewer than cache_size misses happened since it was loaded
+    uint32_t* const loaded_at = malloc(sizeof(uint32_t) * mesh->vertex_count);
+    if (loaded_at == NULL)
+    {
+        return stats;
+    }
+    memset(loaded_at, 0xFF, sizeof(uint32_t) * mesh->vertex_count);
+
+    uint32_t misses        = 0;
+    uint32_t used_vertices = 0;
+    for (uint32_t i = 0; i < mesh->index_count; i++)
+    {
+        const uint32_t vertex = mesh->indices[i];
+        if (loaded_at[vertex] == UINT32_MAX)
+        {
+            used_vertices++;
+        }
+        if (loaded_at[vertex] == UINT32_MAX || misses - loaded_at[vertex] >= cache_size)
+        {
+            loaded_at[vertex] = misses++;
+        }
+    }
+    free(loaded_at);
+
+    stats.acmr = (float)misses / (float)(mesh->index_count / 3);
+    stats.atvr = (float)misses / (float)used_vertices;
+    return stats;
+}
+
+bool Mesh_Weld(Mesh mesh[static 1])
+{
+    if (mesh->vertex_count == 0)
+    {
+        return false;
+    }
+
+    // at most half full, so probes stay short
+    uint32_t table_size = 1;
+    while (table_size < mesh->vertex_count * 2)
+    {
+        table_size *= 2;
+    }
+    uint32_t* const table = malloc(sizeof(uint32_t) * table_size);
+    uint32_t* const remap = malloc(sizeof(uint32_t) * mesh->vertex_count);
+    if (table == NULL || remap == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate weld table");
+        free(table);
+        free(remap);
+        return true;
+    }
+    memset(table, 0xFF, sizeof(uint32_t) * table_size);
+
+    // unique vertices are moved to the front, which never overwrites one that is still to be looked at
+    uint32_t unique_count = 0;
+    for (uint32_t i = 0; i < mesh->vertex_count; i++)
+    {
+        const Vertex* const vertex = &mesh->vertices[i];
+        uint32_t slot              = (uint32_t)Hash64(vertex, sizeof(Vertex), 0) & (table_size - 1);
+        while (table[slot] != UINT32_MAX && memcmp(&mesh->vertices[table[slot]], vertex, sizeof(Vertex)) != 0)
+        {
+            slot = (slot + 1) & (table_size - 1);
+        }
+
+        if (table[slot] == UINT32_MAX)
+        {
+            mesh->vertices[unique_count] = *vertex;
+            table[slot]                  = unique_count++;
+        }
+        remap[i] = table[slot];
+    }
+
+    for (uint32_t i = 0; i < mesh->index_count; i++)
+    {
+        mesh->indices[i] = remap[mesh->indices[i]];
+    }
+    mesh->vertex_count = unique_count;
+
+    free(table);
+    free(remap);
+    return false;
+}
+
+/**
+ * The score of a vertex from Forsyth's paper: recently used vertices score high, except for the ones of the last
+ * triangle so strips are not followed forever, and vertices with few triangles left get a boost so they are finished.
+ */
+static float VertexScore(const int32_t cache_position, const uint32_t remaining)
+{
+    if (remaining == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cache_position >= 0)
+    {
+        if (cache_position < 3)
+        {
+            score = 0.75f;
+        }
+        else
+        {
+            const float scale = 1.0f / (MESH_OPTIMIZER_VERTEX_CACHE_SIZE - 3);
+            score             = powf(1.0f - ((float)(cache_position - 3) * scale), 1.5f);
+        }
+    }
+    return score + (2.0f * powf((float)remaining, -0.5f));
+}
+
+bool Mesh_OptimizeVertexCache(Mesh mesh[static 1])
+{
+    const uint32_t triangle_count = mesh->index_count / 3;
+    const uint32_t vertex_count   = mesh->vertex_count;
+    if (triangle_count == 0)
+    {
+        return false;
+    }
+
+    // the triangles of each vertex, the first remaining[v] of them are not drawn yet
+    uint32_t* const offsets    = calloc((size_t)vertex_count + 1, sizeof(uint32_t));
+    uint32_t* const remaining  = calloc(vertex_count, sizeof(uint32_t));
+    uint32_t* const adjacency  = malloc(sizeof(uint32_t) * triangle_count * 3);
+    int32_t* const positions   = malloc(sizeof(int32_t) * vertex_count);
+    float* const vertex_scores = malloc(sizeof(float) * vertex_count);
+    bool* const drawn          = calloc(triangle_count, sizeof(bool));
+    uint32_t* const indices    = malloc(sizeof(uint32_t) * triangle_count * 3);
+    if (offsets == NULL || remaining == NULL || adjacency == NULL || positions == NULL || vertex_scores == NULL || drawn == NULL || indices == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate vertex cache optimizer");
+        free(offsets);
+        free(remaining);
+        free(adjacency);
+        free(positions);
+        free(vertex_scores);
+        free(drawn);
+        free(indices);
+        return true;
+    }
+
+    for (uint32_t i = 0; i < triangle_count * 3; i++)
+    {
+        remaining[mesh->indices[i]]++;
+    }
+    for (uint32_t v = 0; v < vertex_count; v++)
+    {
+        offsets[v + 1] = offsets[v] + remaining[v];
+        remaining[v]   = 0;
+    }
+    for (uint32_t t = 0; t < triangle_count; t++)
+    {
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t v                       = mesh->indices[(t * 3) + k];
+            adjacency[offsets[v] + remaining[v]++] = t;
+        }
+    }
+    for (uint32_t v = 0; v < vertex_count; v++)
+    {
+        positions[v]     = -1;
+        vertex_scores[v] = VertexScore(-1, remaining[v]);
+    }
+
+    uint32_t cache[MESH_OPTIMIZER_VERTEX_CACHE_SIZE];
+    uint32_t cache_count   = 0;
+    uint32_t best_triangle = UINT32_MAX;
+    // triangles before it are all drawn, for when no cached vertex has any left
+    uint32_t next_unused = 0;
+
+    for (uint32_t output = 0; output < triangle_count; output++)
+    {
+        if (best_triangle == UINT32_MAX)
+        {
+            while (drawn[next_unused])
+            {
+                next_unused++;
+            }
+            best_triangle = next_unused;
+        }
+
+        const uint32_t* const triangle = &mesh->indices[best_triangle * 3];
+        memcpy(&indices[output * 3], triangle, sizeof(uint32_t) * 3);
+        drawn[best_triangle] = true;
+
+        // the vertices of the triangle move to the front of the cache, pushing up to three out of it
+        uint32_t new_cache[MESH_OPTIMIZER_VERTEX_CACHE_SIZE + 3];
+        uint32_t new_count = 0;
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t v = triangle[k];
+            // degenerate triangles use a vertex twice
+            if (k == 0 || (v != triangle[0] && (k == 1 || v != triangle[1])))
+            {
+                new_cache[new_count++] = v;
+            }
+
+            uint32_t* const list = &adjacency[offsets[v]];
+            for (uint32_t i = 0; i < remaining[v]; i++)
+            {
+                if (list[i] == best_triangle)
+                {
+                    list[i] = list[--remaining[v]];
+                    break;
+                }
+            }
+        }
+        for (uint32_t i = 0; i < cache_count; i++)
+        {
+            const uint32_t v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+            {
+                new_cache[new_count++] = v;
+            }
+        }
+
+        // vertices pushed out lose their cache score, the others get a new one
+        for (uint32_t i = 0; i < new_count; i++)
+        {
+            const uint32_t v = new_cache[i];
+            positions[v]     = i < MESH_OPTIMIZER_VERTEX_CACHE_SIZE ? (int32_t)i : -1;
+            vertex_scores[v] = VertexScore(positions[v], remaining[v]);
+        }
+        cache_count = new_count < MESH_OPTIMIZER_VERTEX_CACHE_SIZE ? new_count : MESH_OPTIMIZER_VERTEX_CACHE_SIZE;
+        memcpy(cache, new_cache, sizeof(uint32_t) * cache_count);
+
+        // the next triangle is the best one around the cached vertices
+        best_triangle    = UINT32_MAX;
+        float best_score = -1.0f;
+        for (uint32_t i = 0; i < new_count; i++)
+        {
+            const uint32_t v           = new_cache[i];
+            const uint32_t* const list = &adjacency[offsets[v]];
+            for (uint32_t j = 0; j < remaining[v]; j++)
+            {
+                const uint32_t* const other = &mesh->indices[list[j] * 3];
+                const float score           = vertex_scores[other[0]] + vertex_scores[other[1]] + vertex_scores[other[2]];
+                if (score > best_score)
+                {
+                    best_score    = score;
+                    best_triangle = list[j];
+                }
+            }
+        }
+    }
+
+    memcpy(mesh->indices, indices, sizeof(uint32_t) * triangle_count * 3);
+    free(offsets);
+    free(remaining);
+    free(adjacency);
+    free(positions);
+    free(vertex_scores);
+    free(drawn);
+    free(indices);
+    return false;
+}
+
+typedef struct OverdrawCluster
+{
+    uint32_t first_triangle;
+    uint32_t triangle_count;
+    float sort_key;
+} OverdrawCluster;
+
+static int CompareClusters(const void* const a, const void* const b)
+{
+    const float key_a = ((const OverdrawCluster*)a)->sort_key;
+    const float key_b = ((const OverdrawCluster*)b)->sort_key;
+    // outward facing first
+    return (key_a < key_b) - (key_a > key_b);
+}
+
+bool Mesh_OptimizeOverdraw(Mesh mesh[static 1], const float threshold)
+{
+    const uint32_t triangle_count = mesh->index_count / 3;
+    if (triangle_count == 0)
+    {
+        return false;
+    }
+
+    OverdrawCluster* const clusters = malloc(sizeof(OverdrawCluster) * triangle_count);
+    uint32_t* const loaded_at       = malloc(sizeof(uint32_t) * mesh->vertex_count);
+    uint32_t* const indices         = malloc(sizeof(uint32_t) * triangle_count * 3);
+    if (clusters == NULL || loaded_at == NULL || indices == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate overdraw optimizer");
+        free(clusters);
+        free(loaded_at);
+        free(indices);
+        return true;
+    }
+    memset(loaded_at, 0xFF, sizeof(uint32_t) * mesh->vertex_count);
+
+    // a triangle that misses with all three vertices starts over, so the order before it does not matter to the cache
+    uint32_t cluster_count = 0;
+    uint32_t misses        = 0;
+    for (uint32_t t = 0; t < triangle_count; t++)
+    {
+        uint32_t triangle_misses = 0;
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t v = mesh->indices[(t * 3) + k];
+            if (loaded_at[v] == UINT32_MAX || misses - loaded_at[v] >= MESH_OPTIMIZER_ANALYZE_CACHE_SIZE)
+            {
+                loaded_at[v] = misses++;
+                triangle_misses++;
+            }
+        }
+        if (t == 0 || triangle_misses == 3)
+        {
+            clusters[cluster_count++] = (OverdrawCluster){.first_triangle = t, .triangle_count = 0, .sort_key = 0.0f};
+        }
+        clusters[cluster_count - 1].triangle_count++;
+    }
+
+    Vec3f mesh_center = {{0.0f, 0.0f, 0.0f}};
+    for (uint32_t v = 0; v < mesh->vertex_count; v++)
+    {
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            mesh_center.data[axis] += mesh->vertices[v].position.data[axis] / (float)mesh->vertex_count;
+        }
+    }
+
+    // how far the cluster faces away from the center of the mesh
+    for (uint32_t c = 0; c < cluster_count; c++)
+    {
+        float center[3] = {0.0f, 0.0f, 0.0f};
+        float normal[3] = {0.0f, 0.0f, 0.0f};
+        float area      = 0.0f;
+        for (uint32_t t = clusters[c].first_triangle; t < clusters[c].first_triangle + clusters[c].triangle_count; t++)
+        {
+            const float* const p0 = mesh->vertices[mesh->indices[t * 3]].position.data;
+            const float* const p1 = mesh->vertices[mesh->indices[(t * 3) + 1]].position.data;
+            const float* const p2 = mesh->vertices[mesh->indices[(t * 3) + 2]].position.data;
+            const float e1[3]     = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            const float e2[3]     = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            // twice the area, pointing along the face normal
+            const float n[3]          = {(e1[1] * e2[2]) - (e1[2] * e2[1]), (e1[2] * e2[0]) - (e1[0] * e2[2]), (e1[0] * e2[1]) - (e1[1] * e2[0])};
+            const float triangle_area = SquareRoot((n[0] * n[0]) + (n[1] * n[1]) + (n[2] * n[2]));
+            for (uint32_t axis = 0; axis < 3; axis++)
+            {
+                center[axis] += (p0[axis] + p1[axis] + p2[axis]) * triangle_area / 3.0f;
+                normal[axis] += n[axis];
+            }
+            area += triangle_area;
+        }
+
+        const float normal_length = SquareRoot((normal[0] * normal[0]) + (normal[1] * normal[1]) + (normal[2] * normal[2]));
+        float key                 = 0.0f;
+        for (uint32_t axis = 0; axis < 3 && area > 0.0f && normal_length > 0.0f; axis++)
+        {
+            key += (center[axis] / area - mesh_center.data[axis]) * normal[axis] / normal_length;
+        }
+        clusters[c].sort_key = key;
+    }
+    qsort(clusters, cluster_count, sizeof(OverdrawCluster), CompareClusters);
+
+    uint32_t index_count = 0;
+    for (uint32_t c = 0; c < cluster_count; c++)
+    {
+        memcpy(&indices[index_count], &mesh->indices[clusters[c].first_triangle * 3], sizeof(uint32_t) * clusters[c].triangle_count * 3);
+        index_count += clusters[c].triangle_count * 3;
+    }
+
+    // a cluster only starts cold when the one drawn before it flushed the cache, which sorting does not keep
+    const MeshVertexCacheStats before = Mesh_AnalyzeVertexCache(mesh, MESH_OPTIMIZER_ANALYZE_CACHE_SIZE);
+    const Mesh reordered              = {.vertices = mesh->vertices, .vertex_count = mesh->vertex_count, .indices = indices, .index_count = index_count};
+    const MeshVertexCacheStats after  = Mesh_AnalyzeVertexCache(&reordered, MESH_OPTIMIZER_ANALYZE_CACHE_SIZE);
+    if (after.acmr <= before.acmr * threshold)
+    {
+        memcpy(mesh->indices, indices, sizeof(uint32_t) * index_count);
+    }
+
+    free(clusters);
+    free(loaded_at);
+    free(indices);
+    return false;
+}
+
+bool Mesh_OptimizeVertexFetch(Mesh mesh[static 1])
+{
+    uint32_t* const remap  = malloc(sizeof(uint32_t) * mesh->vertex_count);
+    Vertex* const vertices = malloc(sizeof(Vertex) * mesh->vertex_count);
+    if (remap == NULL || vertices == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate vertex fetch optimizer");
+        free(remap);
+        free(vertices);
+        return true;
+    }
+    memset(remap, 0xFF, sizeof(uint32_t) * mesh->vertex_count);
+
+    uint32_t vertex_count = 0;
+    for (uint32_t i = 0; i < mesh->index_count; i++)
+    {
+        const uint32_t v = mesh->indices[i];
+        if (remap[v] == UINT32_MAX)
+        {
+            vertices[vertex_count] = mesh->vertices[v];
+            remap[v]               = vertex_count++;
+        }
+        mesh->indices[i] = remap[v];
+    }
+
+    memcpy(mesh->vertices, vertices, sizeof(Vertex) * vertex_count);
+    mesh->vertex_count = vertex_count;
+    free(remap);
+    free(vertices);
+    return false;
+}
+
+bool Mesh_Optimize(Mesh mesh[static 1])
+{
+    const uint32_t vertex_count = mesh->vertex_count;
+    if (Mesh_Weld(mesh))
+    {
+        return true;
+    }
+
+    // measured after welding, when the vertex cache can actually reuse anything
+    const MeshVertexCacheStats before = Mesh_AnalyzeVertexCache(mesh, MESH_OPTIMIZER_ANALYZE_CACHE_SIZE);
+    if (Mesh_OptimizeVertexCache(mesh) || Mesh_OptimizeOverdraw(mesh, MESH_OPTIMIZER_OVERDRAW_THRESHOLD) || Mesh_OptimizeVertexFetch(mesh))
+    {
+        return true;
+    }
+    Mesh_ComputeBounds(mesh);
+
+    const MeshVertexCacheStats after = Mesh_AnalyzeVertexCache(mesh, MESH_OPTIMIZER_ANALYZE_CACHE_SIZE);
+    ROSINA_LOG_INFO("Mesh: %u triangles, %u vertices welded to %u, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", mesh->index_count / 3, vertex_count,
+                    mesh->vertex_count, before.acmr, after.acmr, before.atvr, after.atvr);
+    return false;
+}
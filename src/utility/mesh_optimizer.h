@@ -0,0 +1,66 @@
+#ifndef ROSINA_UTILITY_MESH_OPTIMIZER_H
+#define ROSINA_UTILITY_MESH_OPTIMIZER_H
+
+#include <utility/mesh.h>
+
+// the LRU cache Mesh_OptimizeVertexCache orders triangles for
+#define MESH_OPTIMIZER_VERTEX_CACHE_SIZE 32
+// the FIFO cache the statistics are measured with, close to what current GPUs reuse
+#define MESH_OPTIMIZER_ANALYZE_CACHE_SIZE 16
+// how much worse the vertex cache may get for a better draw order, see Mesh_OptimizeOverdraw
+#define MESH_OPTIMIZER_OVERDRAW_THRESHOLD 1.05f
+
+typedef struct MeshVertexCacheStats
+{
+    // vertices shaded per triangle, between 0.5 for a regular grid and 3
+    float acmr;
+    // vertices shaded per vertex, 1 is optimal
+    float atvr;
+} MeshVertexCacheStats;
+
+/**
+ * Simulates a FIFO post-transform cache of cache_size vertices over the triangles.
+ */
+MeshVertexCacheStats Mesh_AnalyzeVertexCache(const Mesh mesh[static 1], const uint32_t cache_size);
+
+/**
+ * Merges vertices whose attributes are identical, found through a hash table.
+ *
+ * @return true on error.
+ */
+bool Mesh_Weld(Mesh mesh[static 1]);
+
+/**
+ * Reorders the triangles for an LRU vertex cache with Forsyth's linear speed algorithm. Triangles whose vertices are
+ * in the cache and have few triangles left are taken first.
+ *
+ * @return true on error.
+ */
+bool Mesh_OptimizeVertexCache(Mesh mesh[static 1]);
+
+/**
+ * Splits the triangles into the clusters where the vertex cache starts over, and draws the clusters that face away from
+ * the center of the mesh first, so they occlude the rest. Run after Mesh_OptimizeVertexCache. If the ACMR would grow by
+ * more than threshold times, the order is left as it is.
+ *
+ * @return true on error.
+ */
+bool Mesh_OptimizeOverdraw(Mesh mesh[static 1], const float threshold);
+
+/**
+ * Reorders the vertices in the order the triangles first use them and drops the ones no triangle uses, so vertex
+ * fetches walk the buffer forward.
+ *
+ * @return true on error.
+ */
+bool Mesh_OptimizeVertexFetch(Mesh mesh[static 1]);
+
+/**
+ * Welds, then optimizes for the vertex cache, overdraw and vertex fetch, logging the cache statistics before and
+ * after.
+ *
+ * @return true on error.
+ */
+bool Mesh_Optimize(Mesh mesh[static 1]);
+
+#endif
@@ -0,0 +1,271 @@
+#include <utility/meshlet.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <utility/log.h>
+
+void Meshlets_Cleanup(Meshlets meshlets[static 1])
+{
+    free(meshlets->meshlets);
+    free(meshlets->bounds);
+    free(meshlets->vertices);
+    free(meshlets->triangles);
+    *meshlets = (Meshlets){};
+}
+
+bool Meshlets_Allocate(const uint32_t meshlet_count, const uint32_t vertex_count, const uint32_t triangle_count, Meshlets meshlets[static 1])
+{
+    // never malloc(0), so NULL always means failure
+    *meshlets = (Meshlets){
+        .meshlets       = malloc(sizeof(Meshlet) * (meshlet_count > 0 ? meshlet_count : 1)),
+        .bounds         = malloc(sizeof(MeshletBounds) * (meshlet_count > 0 ? meshlet_count : 1)),
+        .meshlet_count  = meshlet_count,
+        .vertices       = malloc(sizeof(uint32_t) * (vertex_count > 0 ? vertex_count : 1)),
+        .vertex_count   = vertex_count,
+        .triangles      = malloc((size_t)3 * (triangle_count > 0 ? triangle_count : 1)),
+        .triangle_count = triangle_count,
+    };
+    if (meshlets->meshlets == NULL || meshlets->bounds == NULL || meshlets->vertices == NULL || meshlets->triangles == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate meshlets");
+        Meshlets_Cleanup(meshlets);
+        return true;
+    }
+    return false;
+}
+
+static inline Vec3f Subtracted(const Vec3f a[static 1], const Vec3f b[static 1])
+{
+    return (Vec3f){{a->data[0] - b->data[0], a->data[1] - b->data[1], a->data[2] - b->data[2]}};
+}
+
+static MeshletBounds ComputeBounds(const Mesh mesh[static 1], const Meshlets meshlets[static 1], const Meshlet meshlet[static 1])
+{
+    const uint32_t* const vertices = meshlets->vertices + meshlet->vertex_offset;
+    const uint8_t* const triangles = meshlets->triangles + ((size_t)meshlet->triangle_offset * 3);
+
+    MeshletBounds bounds = {
+        .center      = {{0.0f, 0.0f, 0.0f}},
+        .radius      = 0.0f,
+        .cone_apex   = {{0.0f, 0.0f, 0.0f}},
+        .cone_axis   = {{0.0f, 0.0f, 0.0f}},
+        .cone_cutoff = 1.0f,
+    };
+
+    // the sphere around the box of the vertices
+    Vec3f min = mesh->vertices[vertices[0]].position;
+    Vec3f max = min;
+    for (uint32_t i = 1; i < meshlet->vertex_count; i++)
+    {
+        const Vec3f* const p = &mesh->vertices[vertices[i]].position;
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            min.data[axis] = p->data[axis] < min.data[axis] ? p->data[axis] : min.data[axis];
+            max.data[axis] = p->data[axis] > max.data[axis] ? p->data[axis] : max.data[axis];
+        }
+    }
+    for (uint32_t axis = 0; axis < 3; axis++)
+    {
+        bounds.center.data[axis] = (min.data[axis] + max.data[axis]) * 0.5f;
+    }
+    for (uint32_t i = 0; i < meshlet->vertex_count; i++)
+    {
+        const Vec3f d        = Subtracted(&mesh->vertices[vertices[i]].position, &bounds.center);
+        const float distance = Vec3_Dot(&d, &d);
+        bounds.radius        = distance > bounds.radius ? distance : bounds.radius;
+    }
+    bounds.radius = SquareRoot(bounds.radius);
+
+    // the axis of the cone is the average direction the triangles face
+    Vec3f normals[MESHLET_MAX_TRIANGLES];
+    const Vec3f* corners[MESHLET_MAX_TRIANGLES];
+    uint32_t normal_count = 0;
+    for (uint32_t i = 0; i < meshlet->triangle_count; i++)
+    {
+        const Vec3f* const p0 = &mesh->vertices[vertices[triangles[(i * 3) + 0]]].position;
+        const Vec3f* const p1 = &mesh->vertices[vertices[triangles[(i * 3) + 1]]].position;
+        const Vec3f* const p2 = &mesh->vertices[vertices[triangles[(i * 3) + 2]]].position;
+        const Vec3f e1        = Subtracted(p1, p0);
+        const Vec3f e2        = Subtracted(p2, p0);
+        Vec3f n               = Vec3_Crossed(&e1, &e2);
+        if (Vec3_Dot(&n, &n) <= FLOAT_EPSILON * FLOAT_EPSILON)
+        {
+            // degenerate triangles face no way and are never rasterized
+            continue;
+        }
+        Vec3f_Normalize(&n);
+        normals[normal_count]   = n;
+        corners[normal_count++] = p0;
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            bounds.cone_axis.data[axis] += n.data[axis];
+        }
+    }
+    if (normal_count == 0 || Vec3_Dot(&bounds.cone_axis, &bounds.cone_axis) <= FLOAT_EPSILON)
+    {
+        return bounds;
+    }
+    Vec3f_Normalize(&bounds.cone_axis);
+
+    float min_dot = 1.0f;
+    for (uint32_t i = 0; i < normal_count; i++)
+    {
+        const float dot = Vec3_Dot(&normals[i], &bounds.cone_axis);
+        min_dot         = dot < min_dot ? dot : min_dot;
+    }
+    if (min_dot <= MESHLET_MIN_CONE_DOT)
+    {
+        return bounds;
+    }
+
+    // move the apex back along the axis until it is behind every triangle plane
+    float max_t = 0.0f;
+    for (uint32_t i = 0; i < normal_count; i++)
+    {
+        const Vec3f d = Subtracted(&bounds.center, corners[i]);
+        const float t = Vec3_Dot(&d, &normals[i]) / Vec3_Dot(&bounds.cone_axis, &normals[i]);
+        max_t         = t > max_t ? t : max_t;
+    }
+    for (uint32_t axis = 0; axis < 3; axis++)
+    {
+        bounds.cone_apex.data[axis] = bounds.center.data[axis] - (bounds.cone_axis.data[axis] * max_t);
+    }
+
+    // the triangles are within acos(min_dot) of the axis, so a view direction within 90 degrees minus that of the axis
+    // sees all of their backs
+    bounds.cone_cutoff = SquareRoot(1.0f - (min_dot * min_dot));
+    return bounds;
+}
+
+bool Meshlets_Build(const Mesh mesh[static 1], Meshlets meshlets[static 1])
+{
+    const uint32_t triangle_count = mesh->index_count / 3;
+    // every triangle could start a meshlet and bring its own vertices
+    if (Meshlets_Allocate(triangle_count, triangle_count * 3, triangle_count, meshlets))
+    {
+        return true;
+    }
+
+    // the meshlet a mesh vertex was last added to, plus 1, and its index within it
+    uint32_t* const owners = calloc(mesh->vertex_count > 0 ? mesh->vertex_count : 1, sizeof(uint32_t));
+    uint8_t* const locals  = malloc(mesh->vertex_count > 0 ? mesh->vertex_count : 1);
+    if (owners == NULL || locals == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate meshlet builder");
+        free(owners);
+        free(locals);
+        Meshlets_Cleanup(meshlets);
+        return true;
+    }
+
+    uint32_t meshlet_count = 0;
+    uint32_t vertex_count  = 0;
+    Meshlet meshlet        = {.vertex_offset = 0, .triangle_offset = 0, .vertex_count = 0, .triangle_count = 0};
+    for (uint32_t t = 0; t < triangle_count; t++)
+    {
+        const uint32_t* const triangle = mesh->indices + ((size_t)t * 3);
+        const uint32_t id              = meshlet_count + 1;
+        const uint32_t new_vertices    = (owners[triangle[0]] != id) + (owners[triangle[1]] != id && triangle[1] != triangle[0]) +
+                                         (owners[triangle[2]] != id && triangle[2] != triangle[0] && triangle[2] != triangle[1]);
+        if (meshlet.vertex_count + new_vertices > MESHLET_MAX_VERTICES || meshlet.triangle_count == MESHLET_MAX_TRIANGLES)
+        {
+            meshlets->meshlets[meshlet_count++] = meshlet;
+            meshlet = (Meshlet){.vertex_offset = vertex_count, .triangle_offset = t, .vertex_count = 0, .triangle_count = 0};
+        }
+
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            const uint32_t v = triangle[corner];
+            if (owners[v] != meshlet_count + 1)
+            {
+                owners[v]                          = meshlet_count + 1;
+                locals[v]                          = (uint8_t)meshlet.vertex_count++;
+                meshlets->vertices[vertex_count++] = v;
+            }
+            meshlets->triangles[((size_t)t * 3) + corner] = locals[v];
+        }
+        meshlet.triangle_count++;
+    }
+    if (meshlet.triangle_count > 0)
+    {
+        meshlets->meshlets[meshlet_count++] = meshlet;
+    }
+    free(owners);
+    free(locals);
+
+    meshlets->meshlet_count = meshlet_count;
+    meshlets->vertex_count  = vertex_count;
+
+    // give back what the worst case reserved, keeping the larger arrays if that fails
+    Meshlet* const shrunk_meshlets     = realloc(meshlets->meshlets, sizeof(Meshlet) * (meshlet_count > 0 ? meshlet_count : 1));
+    MeshletBounds* const shrunk_bounds = realloc(meshlets->bounds, sizeof(MeshletBounds) * (meshlet_count > 0 ? meshlet_count : 1));
+    uint32_t* const shrunk_vertices    = realloc(meshlets->vertices, sizeof(uint32_t) * (vertex_count > 0 ? vertex_count : 1));
+    meshlets->meshlets                 = shrunk_meshlets != NULL ? shrunk_meshlets : meshlets->meshlets;
+    meshlets->bounds                   = shrunk_bounds != NULL ? shrunk_bounds : meshlets->bounds;
+    meshlets->vertices                 = shrunk_vertices != NULL ? shrunk_vertices : meshlets->vertices;
+
+    for (uint32_t i = 0; i < meshlet_count; i++)
+    {
+        meshlets->bounds[i] = ComputeBounds(mesh, meshlets, &meshlets->meshlets[i]);
+    }
+
+    uint32_t cone_count = 0;
+    for (uint32_t i = 0; i < meshlet_count; i++)
+    {
+        cone_count += meshlets->bounds[i].cone_cutoff < 1.0f;
+    }
+    ROSINA_LOG_INFO("Meshlets: %u triangles in %u meshlets, %.1f vertices and %.1f triangles each, %u with a normal cone", triangle_count, meshlet_count,
+                    meshlet_count > 0 ? (double)vertex_count / meshlet_count : 0.0, meshlet_count > 0 ? (double)triangle_count / meshlet_count : 0.0,
+                    cone_count);
+    return false;
+}
+
+bool Meshlet_IsVisible(const MeshletBounds bounds[static 1], const MeshletCullInfo info[static 1])
+{
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        const Vec4f* const plane = &info->frustum_planes[i];
+        const float distance     = (plane->data[0] * bounds->center.data[0]) + (plane->data[1] * bounds->center.data[1]) +
+                                   (plane->data[2] * bounds->center.data[2]) + plane->data[3];
+        if (distance < -bounds->radius)
+        {
+            return false;
+        }
+    }
+
+    if (info->cull_back_faces && bounds->cone_cutoff < 1.0f)
+    {
+        const Vec3f d        = Subtracted(&bounds->cone_apex, &info->camera_position);
+        const float distance = SquareRoot(Vec3_Dot(&d, &d));
+        if (Vec3_Dot(&d, &bounds->cone_axis) >= bounds->cone_cutoff * distance)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t Meshlets_Cull(const Meshlets meshlets[static 1], const MeshletCullInfo info[static 1], MeshletDraw* const draws)
+{
+    uint32_t draw_count = 0;
+    for (uint32_t i = 0; i < meshlets->meshlet_count; i++)
+    {
+        if (!Meshlet_IsVisible(&meshlets->bounds[i], info))
+        {
+            continue;
+        }
+
+        const Meshlet* const meshlet = &meshlets->meshlets[i];
+        const uint32_t first_index   = meshlet->triangle_offset * 3;
+        if (draw_count > 0 && draws[draw_count - 1].first_index + draws[draw_count - 1].index_count == first_index)
+        {
+            draws[draw_count - 1].index_count += meshlet->triangle_count * 3;
+        }
+        else
+        {
+            draws[draw_count++] = (MeshletDraw){.first_index = first_index, .index_count = meshlet->triangle_count * 3};
+        }
+    }
+    return draw_count;
+}
@@ -0,0 +1,104 @@
+#ifndef ROSINA_UTILITY_MESHLET_H
+#define ROSINA_UTILITY_MESHLET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <utility/mesh.h>
+
+// the limits NVIDIA recommends for mesh shaders, so meshlets can be drawn by them later
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+// below this, the triangles of a meshlet face too many ways for the cone to ever cull it
+#define MESHLET_MIN_CONE_DOT 0.1f
+
+typedef struct Meshlet
+{
+    // into Meshlets.vertices
+    uint32_t vertex_offset;
+    // into Meshlets.triangles. Also the first triangle of the meshlet in the index buffer of its mesh.
+    uint32_t triangle_offset;
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+} Meshlet;
+
+typedef struct MeshletBounds
+{
+    Vec3f center;
+    float radius;
+    // every triangle faces away from a camera for which dot(normalize(cone_apex - camera), cone_axis) >= cone_cutoff
+    Vec3f cone_apex;
+    Vec3f cone_axis;
+    // 1 when the cone never culls
+    float cone_cutoff;
+} MeshletBounds;
+
+/**
+ * Clusters of neighbouring triangles in the order of the index buffer they were built from, so each meshlet is also a
+ * contiguous range of that index buffer.
+ */
+typedef struct Meshlets
+{
+    Meshlet* meshlets;
+    MeshletBounds* bounds;
+    uint32_t meshlet_count;
+    // the mesh vertex each meshlet vertex is
+    uint32_t* vertices;
+    uint32_t vertex_count;
+    // three meshlet vertices per triangle
+    uint8_t* triangles;
+    uint32_t triangle_count;
+} Meshlets;
+
+typedef struct MeshletCullInfo
+{
+    // in the space of the mesh, see Mat4f_GetFrustumPlanes
+    Vec4f frustum_planes[6];
+    // in the space of the mesh
+    Vec3f camera_position;
+    // the cone test only holds when back faces are culled, counter-clockwise being the front
+    bool cull_back_faces;
+} MeshletCullInfo;
+
+/**
+ * A range of the index buffer covering one or more consecutive visible meshlets.
+ */
+typedef struct MeshletDraw
+{
+    uint32_t first_index;
+    uint32_t index_count;
+} MeshletDraw;
+
+void Meshlets_Cleanup(Meshlets meshlets[static 1]);
+
+/**
+ * Allocates the arrays of meshlets for the given sizes, with the counts set.
+ *
+ * @return true on error.
+ */
+bool Meshlets_Allocate(const uint32_t meshlet_count, const uint32_t vertex_count, const uint32_t triangle_count, Meshlets meshlets[static 1]);
+
+/**
+ * Splits the triangles into meshlets of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles,
+ * scanning them in index buffer order, and computes the bounding sphere and normal cone of each. Run after
+ * Mesh_Optimize, whose vertex cache order keeps neighbouring triangles together.
+ *
+ * @return true on error.
+ */
+bool Meshlets_Build(const Mesh mesh[static 1], Meshlets meshlets[static 1]);
+
+/**
+ * @return false if the meshlet is outside the frustum or, when info->cull_back_faces is set, all its triangles face away
+ * from the camera.
+ */
+bool Meshlet_IsVisible(const MeshletBounds bounds[static 1], const MeshletCullInfo info[static 1]);
+
+/**
+ * Tests the meshlets and merges the visible ones that follow each other into the same draw.
+ *
+ * @param draws Room for meshlets->meshlet_count draws.
+ * @return The number of draws written.
+ */
+uint32_t Meshlets_Cull(const Meshlets meshlets[static 1], const MeshletCullInfo info[static 1], MeshletDraw* const draws);
+
+#endif
@@ -0,0 +1,305 @@
+#include <utility/offset_allocator.h>
+
+#include <assert.h>
+#include <stdlib.h>
+
+#define MANTISSA_BITS  3
+#define MANTISSA_VALUE (1u << MANTISSA_BITS)
+#define MANTISSA_MASK  (MANTISSA_VALUE - 1)
+
+/**
+ * @return The smallest bin whose sizes are all at least size.
+ */
+static inline uint32_t BinRoundUp(const uint32_t size)
+{
+    if (size < MANTISSA_VALUE)
+    {
+        return size;
+    }
+
+    const uint32_t mantissa_start = 31 - (uint32_t)__builtin_clz(size) - MANTISSA_BITS;
+    const uint32_t exponent       = mantissa_start + 1;
+    uint32_t mantissa             = (size >> mantissa_start) & MANTISSA_MASK;
+    if ((size & ((1u << mantissa_start) - 1)) != 0)
+    {
+        mantissa++;
+    }
+    // a mantissa that overflows moves to the next exponent
+    return (exponent << MANTISSA_BITS) + mantissa;
+}
+
+/**
+ * @return The bin a free range of size is kept in.
+ */
+static inline uint32_t BinRoundDown(const uint32_t size)
+{
+    if (size < MANTISSA_VALUE)
+    {
+        return size;
+    }
+
+    const uint32_t mantissa_start = 31 - (uint32_t)__builtin_clz(size) - MANTISSA_BITS;
+    const uint32_t exponent       = mantissa_start + 1;
+    const uint32_t mantissa       = (size >> mantissa_start) & MANTISSA_MASK;
+    return (exponent << MANTISSA_BITS) | mantissa;
+}
+
+static inline uint32_t FindLowestBitFrom(const uint32_t mask, const uint32_t start)
+{
+    const uint32_t masked = start < 32 ? mask & (~0u << start) : 0;
+    return masked != 0 ? (uint32_t)__builtin_ctz(masked) : OFFSET_ALLOCATOR_NONE;
+}
+
+static uint32_t InsertFreeNode(OffsetAllocator allocator[static 1], const uint32_t offset, const uint32_t size)
+{
+    const uint32_t bin  = BinRoundDown(size);
+    const uint32_t top  = bin / OFFSET_ALLOCATOR_LEAF_BIN_COUNT;
+    const uint32_t leaf = bin % OFFSET_ALLOCATOR_LEAF_BIN_COUNT;
+
+    if (allocator->bins[bin] == OFFSET_ALLOCATOR_NONE)
+    {
+        allocator->used_leaf_bins[top] |= (uint8_t)(1u << leaf);
+        allocator->used_top_bins |= 1u << top;
+    }
+
+    assert(allocator->free_node_count > 0);
+    const uint32_t index         = allocator->free_nodes[--allocator->free_node_count];
+    allocator->nodes[index]      = (OffsetAllocatorNode){
+        .offset        = offset,
+        .size          = size,
+        .bin_prev      = OFFSET_ALLOCATOR_NONE,
+        .bin_next      = allocator->bins[bin],
+        .neighbor_prev = OFFSET_ALLOCATOR_NONE,
+        .neighbor_next = OFFSET_ALLOCATOR_NONE,
+        .used          = false,
+    };
+    if (allocator->bins[bin] != OFFSET_ALLOCATOR_NONE)
+    {
+        allocator->nodes[allocator->bins[bin]].bin_prev = index;
+    }
+    allocator->bins[bin] = index;
+    allocator->free_size += size;
+    return index;
+}
+
+/**
+ * Takes a free node out of its bin and returns it to the node pool.
+ */
+static void RemoveFreeNode(OffsetAllocator allocator[static 1], const uint32_t index)
+{
+    const OffsetAllocatorNode* const node = &allocator->nodes[index];
+
+    if (node->bin_prev != OFFSET_ALLOCATOR_NONE)
+    {
+        allocator->nodes[node->bin_prev].bin_next = node->bin_next;
+    }
+    else
+    {
+        const uint32_t bin   = BinRoundDown(node->size);
+        allocator->bins[bin] = node->bin_next;
+        if (node->bin_next == OFFSET_ALLOCATOR_NONE)
+        {
+            const uint32_t top = bin / OFFSET_ALLOCATOR_LEAF_BIN_COUNT;
+            allocator->used_leaf_bins[top] &= (uint8_t)~(1u << (bin % OFFSET_ALLOCATOR_LEAF_BIN_COUNT));
+            if (allocator->used_leaf_bins[top] == 0)
+            {
+                allocator->used_top_bins &= ~(1u << top);
+            }
+        }
+    }
+    if (node->bin_next != OFFSET_ALLOCATOR_NONE)
+    {
+        allocator->nodes[node->bin_next].bin_prev = node->bin_prev;
+    }
+
+    allocator->free_size -= node->size;
+    allocator->free_nodes[allocator->free_node_count++] = index;
+}
+
+OffsetAllocator OffsetAllocator_Create(const uint32_t size, const uint32_t max_allocation_count)
+{
+    OffsetAllocator allocator = {
+        .size                 = size,
+        .max_allocation_count = max_allocation_count,
+        .node_count           = OFFSET_ALLOCATOR_NODE_COUNT(max_allocation_count),
+        .allocation_count     = 0,
+        .free_size            = 0,
+        .used_top_bins        = 0,
+        .used_leaf_bins       = {},
+        .bins                 = {},
+        .nodes                = NULL,
+        .free_nodes           = NULL,
+        .free_node_count      = 0,
+    };
+
+    const uint32_t node_count = allocator.node_count;
+    allocator.nodes           = malloc(sizeof(OffsetAllocatorNode) * node_count);
+    allocator.free_nodes      = malloc(sizeof(uint32_t) * node_count);
+    if (allocator.nodes == NULL || allocator.free_nodes == NULL)
+    {
+        OffsetAllocator_Cleanup(&allocator);
+        return allocator;
+    }
+
+    for (uint32_t i = 0; i < OFFSET_ALLOCATOR_BIN_COUNT; i++)
+    {
+        allocator.bins[i] = OFFSET_ALLOCATOR_NONE;
+    }
+    // popped from the back, so the lowest indices are used first
+    for (uint32_t i = 0; i < node_count; i++)
+    {
+        allocator.free_nodes[i] = node_count - i - 1;
+    }
+    allocator.free_node_count = node_count;
+
+    if (size > 0)
+    {
+        InsertFreeNode(&allocator, 0, size);
+    }
+    return allocator;
+}
+
+void OffsetAllocator_Cleanup(OffsetAllocator allocator[static 1])
+{
+    free(allocator->nodes);
+    allocator->nodes = NULL;
+    free(allocator->free_nodes);
+    allocator->free_nodes = NULL;
+}
+
+OffsetAllocation OffsetAllocator_Allocate(OffsetAllocator allocator[static 1], const uint32_t size)
+{
+    OffsetAllocation allocation = {.offset = 0, .node = OFFSET_ALLOCATOR_NONE};
+    if (size == 0 || allocator->allocation_count == allocator->max_allocation_count)
+    {
+        return allocation;
+    }
+
+    // the smallest bin that is known to fit, so the first node of it can be taken without looking further
+    const uint32_t min_bin = BinRoundUp(size);
+    if (min_bin >= OFFSET_ALLOCATOR_BIN_COUNT)
+    {
+        return allocation;
+    }
+    uint32_t top  = min_bin / OFFSET_ALLOCATOR_LEAF_BIN_COUNT;
+    uint32_t leaf = OFFSET_ALLOCATOR_NONE;
+    if (allocator->used_top_bins & (1u << top))
+    {
+        leaf = FindLowestBitFrom(allocator->used_leaf_bins[top], min_bin % OFFSET_ALLOCATOR_LEAF_BIN_COUNT);
+    }
+    if (leaf == OFFSET_ALLOCATOR_NONE)
+    {
+        top = FindLowestBitFrom(allocator->used_top_bins, top + 1);
+        if (top == OFFSET_ALLOCATOR_NONE)
+        {
+            return allocation;
+        }
+        leaf = (uint32_t)__builtin_ctz(allocator->used_leaf_bins[top]);
+    }
+
+    const uint32_t index = allocator->bins[top * OFFSET_ALLOCATOR_LEAF_BIN_COUNT + leaf];
+    // the rest of the range needs a node of its own
+    if (allocator->nodes[index].size > size && allocator->free_node_count == 0)
+    {
+        return allocation;
+    }
+    RemoveFreeNode(allocator, index);
+    // the node is reused for the allocation
+    allocator->free_node_count--;
+    assert(allocator->free_nodes[allocator->free_node_count] == index);
+
+    OffsetAllocatorNode* const node = &allocator->nodes[index];
+    const uint32_t remainder        = node->size - size;
+    node->size                      = size;
+    node->used                      = true;
+
+    if (remainder > 0)
+    {
+        const uint32_t next                    = InsertFreeNode(allocator, node->offset + size, remainder);
+        allocator->nodes[next].neighbor_prev = index;
+        allocator->nodes[next].neighbor_next = node->neighbor_next;
+        if (node->neighbor_next != OFFSET_ALLOCATOR_NONE)
+        {
+            allocator->nodes[node->neighbor_next].neighbor_prev = next;
+        }
+        node->neighbor_next = next;
+    }
+
+    allocator->allocation_count++;
+    allocation.offset = node->offset;
+    allocation.node   = index;
+    return allocation;
+}
+
+void OffsetAllocator_Free(OffsetAllocator allocator[static 1], const OffsetAllocation allocation)
+{
+    if (allocation.node == OFFSET_ALLOCATOR_NONE)
+    {
+        return;
+    }
+
+    const OffsetAllocatorNode node = allocator->nodes[allocation.node];
+    assert(node.used);
+
+    uint32_t offset        = node.offset;
+    uint32_t size          = node.size;
+    uint32_t neighbor_prev = node.neighbor_prev;
+    uint32_t neighbor_next = node.neighbor_next;
+
+    if (neighbor_prev != OFFSET_ALLOCATOR_NONE && !allocator->nodes[neighbor_prev].used)
+    {
+        const OffsetAllocatorNode* const prev = &allocator->nodes[neighbor_prev];
+        offset                                = prev->offset;
+        size += prev->size;
+        const uint32_t prev_index = neighbor_prev;
+        neighbor_prev             = prev->neighbor_prev;
+        RemoveFreeNode(allocator, prev_index);
+    }
+    if (neighbor_next != OFFSET_ALLOCATOR_NONE && !allocator->nodes[neighbor_next].used)
+    {
+        const OffsetAllocatorNode* const next = &allocator->nodes[neighbor_next];
+        size += next->size;
+        const uint32_t next_index = neighbor_next;
+        neighbor_next             = next->neighbor_next;
+        RemoveFreeNode(allocator, next_index);
+    }
+
+    allocator->allocation_count--;
+    allocator->nodes[allocation.node].used              = false;
+    allocator->free_nodes[allocator->free_node_count++] = allocation.node;
+
+    const uint32_t index                   = InsertFreeNode(allocator, offset, size);
+    allocator->nodes[index].neighbor_prev = neighbor_prev;
+    allocator->nodes[index].neighbor_next = neighbor_next;
+    if (neighbor_prev != OFFSET_ALLOCATOR_NONE)
+    {
+        allocator->nodes[neighbor_prev].neighbor_next = index;
+    }
+    if (neighbor_next != OFFSET_ALLOCATOR_NONE)
+    {
+        allocator->nodes[neighbor_next].neighbor_prev = index;
+    }
+}
+
+OffsetAllocatorStats OffsetAllocator_GetStats(const OffsetAllocator allocator[static 1])
+{
+    OffsetAllocatorStats stats = {
+        .allocation_count  = allocator->allocation_count,
+        .free_size         = allocator->free_size,
+        .largest_free_size = 0,
+        .free_range_count  = 0,
+    };
+
+    for (uint32_t bin = 0; bin < OFFSET_ALLOCATOR_BIN_COUNT; bin++)
+    {
+        for (uint32_t index = allocator->bins[bin]; index != OFFSET_ALLOCATOR_NONE; index = allocator->nodes[index].bin_next)
+        {
+            stats.free_range_count++;
+            if (allocator->nodes[index].size > stats.largest_free_size)
+            {
+                stats.largest_free_size = allocator->nodes[index].size;
+            }
+        }
+    }
+    return stats;
+}
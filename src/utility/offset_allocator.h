@@ -0,0 +1,84 @@
+#ifndef ROSINA_UTILITY_OFFSET_ALLOCATOR_H
+#define ROSINA_UTILITY_OFFSET_ALLOCATOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// sizes are binned by a float with 3 mantissa and 5 exponent bits, 8 bins for every power of two
+#define OFFSET_ALLOCATOR_TOP_BIN_COUNT  32
+#define OFFSET_ALLOCATOR_LEAF_BIN_COUNT 8
+#define OFFSET_ALLOCATOR_BIN_COUNT      (OFFSET_ALLOCATOR_TOP_BIN_COUNT * OFFSET_ALLOCATOR_LEAF_BIN_COUNT)
+#define OFFSET_ALLOCATOR_NONE           UINT32_MAX
+// every allocation can split a free range in two, so n allocations can leave n + 1 free ranges between them
+#define OFFSET_ALLOCATOR_NODE_COUNT(max_allocation_count) ((2 * (max_allocation_count)) + 1)
+
+typedef struct OffsetAllocatorNode
+{
+    uint32_t offset;
+    uint32_t size;
+    // neighbours in the free list of the bin, only valid while free
+    uint32_t bin_prev;
+    uint32_t bin_next;
+    // neighbours in the range, ordered by offset
+    uint32_t neighbor_prev;
+    uint32_t neighbor_next;
+    bool used;
+} OffsetAllocatorNode;
+
+/**
+ * Hands out ranges of [0, size) in constant time. Free ranges are kept in lists binned by size, with a bitmap of the
+ * non-empty bins to find the smallest one that fits, and freed ranges are merged with free neighbours. Nothing is
+ * stored in the range itself, so it can manage memory the CPU cannot see. Units are up to the caller.
+ */
+typedef struct OffsetAllocator
+{
+    uint32_t size;
+    uint32_t max_allocation_count;
+    // OFFSET_ALLOCATOR_NODE_COUNT(max_allocation_count)
+    uint32_t node_count;
+    uint32_t allocation_count;
+    uint32_t free_size;
+
+    uint32_t used_top_bins;
+    uint8_t used_leaf_bins[OFFSET_ALLOCATOR_TOP_BIN_COUNT];
+    uint32_t bins[OFFSET_ALLOCATOR_BIN_COUNT];
+
+    OffsetAllocatorNode* nodes;
+    uint32_t* free_nodes;
+    uint32_t free_node_count;
+} OffsetAllocator;
+
+typedef struct OffsetAllocation
+{
+    uint32_t offset;
+    // the node of the allocation, OFFSET_ALLOCATOR_NONE when the allocation failed
+    uint32_t node;
+} OffsetAllocation;
+
+typedef struct OffsetAllocatorStats
+{
+    uint32_t allocation_count;
+    uint32_t free_size;
+    uint32_t largest_free_size;
+    uint32_t free_range_count;
+} OffsetAllocatorStats;
+
+/**
+ * @param max_allocation_count The number of allocations that can be alive at once.
+ * @return The created allocator. On error, the nodes field will be NULL.
+ */
+OffsetAllocator OffsetAllocator_Create(const uint32_t size, const uint32_t max_allocation_count);
+
+void OffsetAllocator_Cleanup(OffsetAllocator allocator[static 1]);
+
+/**
+ * @return The allocation. When there is no free range of size units or no node left, its node field is
+ *         OFFSET_ALLOCATOR_NONE.
+ */
+OffsetAllocation OffsetAllocator_Allocate(OffsetAllocator allocator[static 1], const uint32_t size);
+
+void OffsetAllocator_Free(OffsetAllocator allocator[static 1], const OffsetAllocation allocation);
+
+OffsetAllocatorStats OffsetAllocator_GetStats(const OffsetAllocator allocator[static 1]);
+
+#endif
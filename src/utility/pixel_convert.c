@@ -0,0 +1,725 @@
+#include <utility/pixel_convert.h>
+
+#include <math.h>
+#include <string.h>
+#include <threads.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PIXEL_CONVERT_X86 1
+#include <immintrin.h>
+#else
+#define PIXEL_CONVERT_X86 0
+#endif
+
+typedef enum PixelConvertCpuFeatureBits
+{
+    PIXEL_CONVERT_CPU_FEATURE_SSE2_BIT  = 1 << 0,
+    PIXEL_CONVERT_CPU_FEATURE_SSSE3_BIT = 1 << 1,
+    PIXEL_CONVERT_CPU_FEATURE_AVX2_BIT  = 1 << 2,
+    PIXEL_CONVERT_CPU_FEATURE_F16C_BIT  = 1 << 3,
+} PixelConvertCpuFeatureBits;
+
+static once_flag init_once = ONCE_FLAG_INIT;
+static uint32_t cpu_features;
+static bool scalar_only;
+
+// [0, 256) decodes sRGB, [256, 512) decodes unorm, so one gather covers color and alpha
+static float decode_table[512];
+// linear quantized to 12 bits, enough that every 8 bit sRGB value round trips. The 3 bytes of padding keep a 4 byte
+// gather of the last entry inside the table
+static uint8_t srgb_encode_table[4096 + 3];
+// every sRGB color byte premultiplied by every alpha byte, indexed by alpha * 256 + color
+static uint8_t srgb_premultiply_table[256 * 256];
+
+static inline uint8_t EncodeSrgb(const float linear)
+{
+    const float clamped = linear < 0.0f ? 0.0f : (linear > 1.0f ? 1.0f : linear);
+    return srgb_encode_table[(uint32_t)((clamped * 4095.0f) + 0.5f)];
+}
+
+static void Initialize(void)
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        const float c         = (float)i / 255.0f;
+        decode_table[i]       = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        decode_table[256 + i] = c;
+    }
+    for (uint32_t i = 0; i < 4096; i++)
+    {
+        const float l        = (float)i / 4095.0f;
+        const float c        = l <= 0.0031308f ? l * 12.92f : (1.055f * powf(l, 1.0f / 2.4f)) - 0.055f;
+        srgb_encode_table[i] = (uint8_t)((c * 255.0f) + 0.5f);
+    }
+    for (uint32_t a = 0; a < 256; a++)
+    {
+        for (uint32_t c = 0; c < 256; c++)
+        {
+            srgb_premultiply_table[(a * 256) + c] = EncodeSrgb(decode_table[c] * decode_table[256 + a]);
+        }
+    }
+
+#if PIXEL_CONVERT_X86
+    __builtin_cpu_init();
+    cpu_features = (__builtin_cpu_supports("sse2") ? PIXEL_CONVERT_CPU_FEATURE_SSE2_BIT : 0) |
+                   (__builtin_cpu_supports("ssse3") ? PIXEL_CONVERT_CPU_FEATURE_SSSE3_BIT : 0) |
+                   (__builtin_cpu_supports("avx2") ? PIXEL_CONVERT_CPU_FEATURE_AVX2_BIT : 0) |
+                   (__builtin_cpu_supports("f16c") ? PIXEL_CONVERT_CPU_FEATURE_F16C_BIT : 0);
+#endif
+}
+
+static inline uint32_t GetCpuFeatures(void)
+{
+    call_once(&init_once, Initialize);
+    return scalar_only ? 0 : cpu_features;
+}
+
+static inline uint8_t EncodeUnorm8(const float value)
+{
+    const float clamped = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    return (uint8_t)((clamped * 255.0f) + 0.5f);
+}
+
+// (x * a) / 255 rounded, exact for 8 bit x and a
+static inline uint8_t MultiplyUnorm8(const uint32_t x, const uint32_t a)
+{
+    const uint32_t t = (x * a) + 128;
+    return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+static inline uint16_t FloatToHalf(const float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    const uint32_t abs  = bits & 0x7FFFFFFF;
+
+    if (abs >= 0x7F800000)
+    {
+        // infinity stays infinity, NaN stays a quiet NaN
+        return sign | 0x7C00 | (abs > 0x7F800000 ? 0x0200 : 0);
+    }
+    if (abs < 0x38800000)
+    {
+        // below the smallest normal half, the result is a multiple of 2^-24
+        float magnitude;
+        memcpy(&magnitude, &abs, sizeof(magnitude));
+        return sign | (uint16_t)lrintf(magnitude * 16777216.0f);
+    }
+
+    // rebias the exponent from 127 to 15 and round the dropped 13 mantissa bits to nearest even.
+    // values past the largest half carry into the exponent and become infinity.
+    uint32_t half            = (abs - 0x38000000) >> 13;
+    const uint32_t remainder = abs & 0x1FFF;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+    {
+        half++;
+    }
+    return half >= 0x7C00 ? sign | 0x7C00 : sign | (uint16_t)half;
+}
+
+static inline float HalfToFloat(const uint16_t half)
+{
+    const uint32_t sign     = (uint32_t)(half & 0x8000) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1F;
+    const uint32_t mantissa = half & 0x3FF;
+
+    uint32_t bits;
+    if (exponent == 0x1F)
+    {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else if (exponent == 0)
+    {
+        // zero or subnormal, a multiple of 2^-24
+        const float magnitude = (float)mantissa * (1.0f / 16777216.0f);
+        memcpy(&bits, &magnitude, sizeof(bits));
+        bits |= sign;
+    }
+    else
+    {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/*
+ * Scalar reference implementations
+ */
+
+static void Rgb8ToRgba8_Scalar(uint8_t* const dest, const uint8_t* const src, const uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++)
+    {
+        dest[(i * 4) + 0] = src[(i * 3) + 0];
+        dest[(i * 4) + 1] = src[(i * 3) + 1];
+        dest[(i * 4) + 2] = src[(i * 3) + 2];
+        dest[(i * 4) + 3] = 0xFF;
+    }
+}
+
+static void SwapRedBlue_Scalar(uint8_t* const dest, const uint8_t* const src, const uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++)
+    {
+        const uint8_t r   = src[(i * 4) + 0];
+        dest[(i * 4) + 0] = src[(i * 4) + 2];
+        dest[(i * 4) + 1] = src[(i * 4) + 1];
+        dest[(i * 4) + 2] = r;
+        dest[(i * 4) + 3] = src[(i * 4) + 3];
+    }
+}
+
+static void PremultiplyAlpha_Scalar(uint8_t* const dest, const uint8_t* const src, const uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++)
+    {
+        const uint32_t a  = src[(i * 4) + 3];
+        dest[(i * 4) + 0] = MultiplyUnorm8(src[(i * 4) + 0], a);
+        dest[(i * 4) + 1] = MultiplyUnorm8(src[(i * 4) + 1], a);
+        dest[(i * 4) + 2] = MultiplyUnorm8(src[(i * 4) + 2], a);
+        dest[(i * 4) + 3] = (uint8_t)a;
+    }
+}
+
+static void PremultiplyAlphaSrgb_Scalar(uint8_t* const dest, const uint8_t* const src, const uint64_t count)
+{
+    // 8 bit linear loses too much in the darks, so color is decoded to float, scaled and encoded again
+    for (uint64_t i = 0; i < count; i++)
+    {
+        const uint8_t a   = src[(i * 4) + 3];
+        const float alpha = decode_table[256 + a];
+        dest[(i * 4) + 0] = EncodeSrgb(decode_table[src[(i * 4) + 0]] * alpha);
+        dest[(i * 4) + 1] = EncodeSrgb(decode_table[src[(i * 4) + 1]] * alpha);
+        dest[(i * 4) + 2] = EncodeSrgb(decode_table[src[(i * 4) + 2]] * alpha);
+        dest[(i * 4) + 3] = a;
+    }
+}
+
+static void PremultiplyAlphaSrgb_Table(uint8_t* const dest, const uint8_t* const src, const uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++)
+    {
+        const uint8_t a             = src[(i * 4) + 3];
+        const uint8_t* const scaled = srgb_premultiply_table + ((uint32_t)a * 256);
+        dest[(i * 4) + 0]           = scaled[src[(i * 4) + 0]];
+        dest[(i * 4) + 1]           = scaled[src[(i * 4) + 1]];
+        dest[(i * 4) + 2]           = scaled[src[(i * 4) + 2]];
+        dest[(i * 4) + 3]           = a;
+    }
+}
+
+static void PremultiplyAlphaF32_Scalar(float* const dest, const float* const src, const uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++)
+    {
+        const float a     = src[(i * 4) + 3];
+        dest[(i * 4) + 0] = src[(i * 4) + 0] * a;
+        dest[(i * 4) + 1] = src[(i * 4) + 1] * a;
+        dest[(i * 4) + 2] = src[(i * 4) + 2] * a;
+        dest[(i * 4) + 3] = a;
+    }
+}
+
+static void PremultiplyAlphaUnorm16_Scalar(uint16_t* const dest, const uint16_t* const src, const uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++)
+    {
+        const uint32_t a  = src[(i * 4) + 3];
+        dest[(i * 4) + 0] = (uint16_t)((((uint32_t)src[(i * 4) + 0] * a) + 32767) / 65535);
+        dest[(i * 4) + 1] = (uint16_t)((((uint32_t)src[(i * 4) + 1] * a) + 32767) / 65535);
+        dest[(i * 4) + 2] = (uint16_t)((((uint32_t)src[(i * 4) + 2] * a) + 32767) / 65535);
+        dest[(i * 4) + 3] = (uint16_t)a;
+    }
+}
+
+static void Rgba8ToRgba32f_Scalar(float* const dest, const uint8_t* const src, const uint64_t count, const bool srgb)
+{
+    const float* const color_table = srgb ? decode_table : decode_table + 256;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        dest[(i * 4) + 0] = color_table[src[(i * 4) + 0]];
+        dest[(i * 4) + 1] = color_table[src[(i * 4) + 1]];
+        dest[(i * 4) + 2] = color_table[src[(i * 4) + 2]];
+        dest[(i * 4) + 3] = decode_table[256 + src[(i * 4) + 3]];
+    }
+}
+
+static void Rgba32fToRgba8_Scalar(uint8_t* const dest, const float* const src, const uint64_t count, const bool srgb)
+{
+    for (uint64_t i = 0; i < count; i++)
+    {
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            dest[(i * 4) + c] = srgb ? EncodeSrgb(src[(i * 4) + c]) : EncodeUnorm8(src[(i * 4) + c]);
+        }
+        dest[(i * 4) + 3] = EncodeUnorm8(src[(i * 4) + 3]);
+    }
+}
+
+static void F32ToF16_Scalar(uint16_t* const dest, const float* const src, const uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++)
+    {
+        dest[i] = FloatToHalf(src[i]);
+    }
+}
+
+static void F16ToF32_Scalar(float* const dest, const uint16_t* const src, const uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++)
+    {
+        dest[i] = HalfToFloat(src[i]);
+    }
+}
+
+static void Unorm16ToF16_Scalar(uint16_t* const dest, const uint16_t* const src, const uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++)
+    {
+        dest[i] = FloatToHalf((float)src[i] * (1.0f / 65535.0f));
+    }
+}
+
+/*
+ * x86 implementations. Each handles the largest multiple of its vector width and returns how many it converted.
+ */
+
+#if PIXEL_CONVERT_X86
+
+__attribute__((target("ssse3"))) static uint64_t Rgb8ToRgba8_Ssse3(uint8_t* const dest, const uint8_t* const src, const uint64_t count)
+{
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha   = _mm_set1_epi32((int)0xFF000000);
+
+    // 16 pixels at a time: 48 bytes in, 64 bytes out
+    uint64_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m128i in0 = _mm_loadu_si128((const __m128i*)(src + (i * 3)));
+        const __m128i in1 = _mm_loadu_si128((const __m128i*)(src + (i * 3) + 16));
+        const __m128i in2 = _mm_loadu_si128((const __m128i*)(src + (i * 3) + 32));
+
+        const __m128i out0 = _mm_shuffle_epi8(in0, shuffle);
+        const __m128i out1 = _mm_shuffle_epi8(_mm_alignr_epi8(in1, in0, 12), shuffle);
+        const __m128i out2 = _mm_shuffle_epi8(_mm_alignr_epi8(in2, in1, 8), shuffle);
+        const __m128i out3 = _mm_shuffle_epi8(_mm_srli_si128(in2, 4), shuffle);
+
+        _mm_storeu_si128((__m128i*)(dest + (i * 4)), _mm_or_si128(out0, alpha));
+        _mm_storeu_si128((__m128i*)(dest + (i * 4) + 16), _mm_or_si128(out1, alpha));
+        _mm_storeu_si128((__m128i*)(dest + (i * 4) + 32), _mm_or_si128(out2, alpha));
+        _mm_storeu_si128((__m128i*)(dest + (i * 4) + 48), _mm_or_si128(out3, alpha));
+    }
+    return i;
+}
+
+__attribute__((target("ssse3"))) static uint64_t SwapRedBlue_Ssse3(uint8_t* const dest, const uint8_t* const src, const uint64_t count)
+{
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+    uint64_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(src + (i * 4)));
+        _mm_storeu_si128((__m128i*)(dest + (i * 4)), _mm_shuffle_epi8(v, shuffle));
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) static uint64_t SwapRedBlue_Avx2(uint8_t* const dest, const uint8_t* const src, const uint64_t count)
+{
+    const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+    uint64_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(src + (i * 4)));
+        _mm256_storeu_si256((__m256i*)(dest + (i * 4)), _mm256_shuffle_epi8(v, shuffle));
+    }
+    return i;
+}
+
+static inline __m128i PremultiplyHalf_Sse2(const __m128i pixels)
+{
+    // pixels holds two RGBA pixels as 16 bit lanes; the alpha lanes are multiplied by 255 so they stay unchanged
+    const __m128i color_mask = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+    const __m128i alpha_one  = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+
+    __m128i alpha = _mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+    alpha         = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+    alpha         = _mm_or_si128(_mm_and_si128(alpha, color_mask), alpha_one);
+
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), _mm_set1_epi16(128));
+    t         = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    return t;
+}
+
+__attribute__((target("sse2"))) static uint64_t PremultiplyAlpha_Sse2(uint8_t* const dest, const uint8_t* const src, const uint64_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    uint64_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i v  = _mm_loadu_si128((const __m128i*)(src + (i * 4)));
+        const __m128i lo = PremultiplyHalf_Sse2(_mm_unpacklo_epi8(v, zero));
+        const __m128i hi = PremultiplyHalf_Sse2(_mm_unpackhi_epi8(v, zero));
+        _mm_storeu_si128((__m128i*)(dest + (i * 4)), _mm_packus_epi16(lo, hi));
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) static uint64_t PremultiplyAlpha_Avx2(uint8_t* const dest, const uint8_t* const src, const uint64_t count)
+{
+    const __m256i zero          = _mm256_setzero_si256();
+    const __m256i alpha_shuffle = _mm256_setr_epi8(6, 7, 6, 7, 6, 7, -1, -1, 14, 15, 14, 15, 14, 15, -1, -1, 6, 7, 6, 7, 6, 7, -1, -1, 14, 15, 14, 15, 14, 15, -1, -1);
+    const __m256i alpha_one     = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+    const __m256i round         = _mm256_set1_epi16(128);
+
+    uint64_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(src + (i * 4)));
+
+        // unpack and pack both work within 128 bit lanes, so the pixel order survives the round trip
+        __m256i halves[2] = {_mm256_unpacklo_epi8(v, zero), _mm256_unpackhi_epi8(v, zero)};
+        for (uint32_t h = 0; h < 2; h++)
+        {
+            const __m256i alpha = _mm256_or_si256(_mm256_shuffle_epi8(halves[h], alpha_shuffle), alpha_one);
+            __m256i t           = _mm256_add_epi16(_mm256_mullo_epi16(halves[h], alpha), round);
+            halves[h]           = _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+        }
+        _mm256_storeu_si256((__m256i*)(dest + (i * 4)), _mm256_packus_epi16(halves[0], halves[1]));
+    }
+    return i;
+}
+
+/**
+ * Packs 8 RGBA pixels held as 32 bit lanes, two per register, into 32 bytes in pixel order.
+ */
+__attribute__((target("avx2"))) static inline __m256i PackPixels_Avx2(const __m256i q[static 4])
+{
+    const __m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(q[0], q[1]), _mm256_packs_epi32(q[2], q[3]));
+    // the packs work within 128 bit lanes, which leaves the even pixels in the low lane and the odd ones in the high lane
+    return _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+__attribute__((target("sse2"))) static uint64_t PremultiplyAlphaF32_Sse2(float* const dest, const float* const src, const uint64_t count)
+{
+    const __m128 color_mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    const __m128 alpha_one  = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+    uint64_t i = 0;
+    for (; i < count; i++)
+    {
+        const __m128 v     = _mm_loadu_ps(src + (i * 4));
+        const __m128 alpha = _mm_or_ps(_mm_and_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)), color_mask), alpha_one);
+        _mm_storeu_ps(dest + (i * 4), _mm_mul_ps(v, alpha));
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) static uint64_t PremultiplyAlphaUnorm16_Avx2(uint16_t* const dest, const uint16_t* const src, const uint64_t count)
+{
+    const __m256i max   = _mm256_set1_epi32(65535);
+    const __m256i round = _mm256_set1_epi32(32767);
+    const __m256i one   = _mm256_set1_epi32(1);
+
+    uint64_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i halves[2];
+        for (uint32_t h = 0; h < 2; h++)
+        {
+            const __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src + ((i + (h * 2)) * 4))));
+            // the alpha lanes are multiplied by 65535 so they stay unchanged
+            const __m256i alpha = _mm256_blend_epi32(_mm256_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3)), max, 0x88);
+
+            // t / 65535 as (t + (t >> 16) + 1) >> 16, exact for every t the products can reach and without overflow
+            const __m256i t = _mm256_add_epi32(_mm256_mullo_epi32(v, alpha), round);
+            halves[h]       = _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(t, _mm256_srli_epi32(t, 16)), one), 16);
+        }
+        // packus works within 128 bit lanes, so the pixels come out as 0, 2, 1, 3
+        const __m256i packed = _mm256_packus_epi32(halves[0], halves[1]);
+        _mm256_storeu_si256((__m256i*)(dest + (i * 4)), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) static uint64_t Rgba8ToRgba32f_Avx2(float* const dest, const uint8_t* const src, const uint64_t count)
+{
+    // linear only. Dividing rather than multiplying by 1 / 255 gives the same floats as the table
+    const __m256 scale = _mm256_set1_ps(255.0f);
+
+    uint64_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        for (uint32_t p = 0; p < 4; p++)
+        {
+            const __m256i bytes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + ((i + (p * 2)) * 4))));
+            _mm256_storeu_ps(dest + ((i + (p * 2)) * 4), _mm256_div_ps(_mm256_cvtepi32_ps(bytes), scale));
+        }
+    }
+    return i;
+}
+
+__attribute__((target("sse2"))) static uint64_t Rgba32fToRgba8_Sse2(uint8_t* const dest, const float* const src, const uint64_t count)
+{
+    // linear only, sRGB needs the gather of Rgba32fToRgba8_Avx2
+    const __m128 zero  = _mm_setzero_ps();
+    const __m128 one   = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 half  = _mm_set1_ps(0.5f);
+
+    uint64_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i q[4];
+        for (uint32_t p = 0; p < 4; p++)
+        {
+            const __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + ((i + p) * 4)), zero), one);
+            q[p]           = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half));
+        }
+        _mm_storeu_si128((__m128i*)(dest + (i * 4)), _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3])));
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) static uint64_t Rgba32fToRgba8_Avx2(uint8_t* const dest, const float* const src, const uint64_t count, const bool srgb)
+{
+    // color is quantized to the 12 bit encode table index for sRGB and straight to 8 bits otherwise
+    const __m256 scale = srgb ? _mm256_setr_ps(4095.0f, 4095.0f, 4095.0f, 255.0f, 4095.0f, 4095.0f, 4095.0f, 255.0f) : _mm256_set1_ps(255.0f);
+    const __m256i color_lanes = _mm256_setr_epi32(-1, -1, -1, 0, -1, -1, -1, 0);
+    const __m256i byte_mask   = _mm256_set1_epi32(0xFF);
+    const __m256 zero         = _mm256_setzero_ps();
+    const __m256 one          = _mm256_set1_ps(1.0f);
+    const __m256 half         = _mm256_set1_ps(0.5f);
+
+    uint64_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i q[4];
+        for (uint32_t p = 0; p < 4; p++)
+        {
+            const __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + ((i + (p * 2)) * 4)), zero), one);
+            q[p]           = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, scale), half));
+            if (srgb)
+            {
+                // the alpha lanes skip the gather and keep their 8 bit value
+                q[p] = _mm256_and_si256(_mm256_mask_i32gather_epi32(q[p], (const int*)srgb_encode_table, q[p], color_lanes, 1), byte_mask);
+            }
+        }
+        _mm256_storeu_si256((__m256i*)(dest + (i * 4)), PackPixels_Avx2(q));
+    }
+    return i;
+}
+
+__attribute__((target("avx2,f16c"))) static uint64_t F32ToF16_F16c(uint16_t* const dest, const float* const src, const uint64_t count)
+{
+    uint64_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i*)(dest + i), half);
+    }
+    return i;
+}
+
+__attribute__((target("avx2,f16c"))) static uint64_t F16ToF32_F16c(float* const dest, const uint16_t* const src, const uint64_t count)
+{
+    uint64_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_ps(dest + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + i))));
+    }
+    return i;
+}
+
+__attribute__((target("avx2,f16c"))) static uint64_t Unorm16ToF16_F16c(uint16_t* const dest, const uint16_t* const src, const uint64_t count)
+{
+    const __m256 scale = _mm256_set1_ps(1.0f / 65535.0f);
+
+    uint64_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i values = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src + i)));
+        const __m256 floats  = _mm256_mul_ps(_mm256_cvtepi32_ps(values), scale);
+        _mm_storeu_si128((__m128i*)(dest + i), _mm256_cvtps_ph(floats, _MM_FROUND_TO_NEAREST_INT));
+    }
+    return i;
+}
+
+#endif
+
+/*
+ * Dispatch. The scalar loops finish whatever the vector loops left over.
+ */
+
+void PixelConvert_Rgb8ToRgba8(uint8_t* const dest, const uint8_t* const src, const uint64_t count)
+{
+    uint64_t done = 0;
+#if PIXEL_CONVERT_X86
+    if (GetCpuFeatures() & PIXEL_CONVERT_CPU_FEATURE_SSSE3_BIT)
+    {
+        done = Rgb8ToRgba8_Ssse3(dest, src, count);
+    }
+#endif
+    Rgb8ToRgba8_Scalar(dest + (done * 4), src + (done * 3), count - done);
+}
+
+void PixelConvert_SwapRedBlue(uint8_t* const dest, const uint8_t* const src, const uint64_t count)
+{
+    uint64_t done = 0;
+#if PIXEL_CONVERT_X86
+    const uint32_t features = GetCpuFeatures();
+    if (features & PIXEL_CONVERT_CPU_FEATURE_AVX2_BIT)
+    {
+        done = SwapRedBlue_Avx2(dest, src, count);
+    }
+    else if (features & PIXEL_CONVERT_CPU_FEATURE_SSSE3_BIT)
+    {
+        done = SwapRedBlue_Ssse3(dest, src, count);
+    }
+#endif
+    SwapRedBlue_Scalar(dest + (done * 4), src + (done * 4), count - done);
+}
+
+void PixelConvert_PremultiplyAlpha(uint8_t* const dest, const uint8_t* const src, const uint64_t count, const bool srgb)
+{
+    uint64_t done           = 0;
+    const uint32_t features = GetCpuFeatures();
+    if (srgb)
+    {
+        // three lookups in a 64 KiB table beat decoding to float and encoding again, even with AVX2 gathers
+        if (scalar_only)
+        {
+            PremultiplyAlphaSrgb_Scalar(dest, src, count);
+        }
+        else
+        {
+            PremultiplyAlphaSrgb_Table(dest, src, count);
+        }
+        return;
+    }
+
+#if PIXEL_CONVERT_X86
+    if (features & PIXEL_CONVERT_CPU_FEATURE_AVX2_BIT)
+    {
+        done = PremultiplyAlpha_Avx2(dest, src, count);
+    }
+    else if (features & PIXEL_CONVERT_CPU_FEATURE_SSE2_BIT)
+    {
+        done = PremultiplyAlpha_Sse2(dest, src, count);
+    }
+#else
+    (void)features;
+#endif
+    PremultiplyAlpha_Scalar(dest + (done * 4), src + (done * 4), count - done);
+}
+
+void PixelConvert_PremultiplyAlphaF32(float* const dest, const float* const src, const uint64_t count)
+{
+    uint64_t done = 0;
+#if PIXEL_CONVERT_X86
+    if (GetCpuFeatures() & PIXEL_CONVERT_CPU_FEATURE_SSE2_BIT)
+    {
+        done = PremultiplyAlphaF32_Sse2(dest, src, count);
+    }
+#endif
+    PremultiplyAlphaF32_Scalar(dest + (done * 4), src + (done * 4), count - done);
+}
+
+void PixelConvert_PremultiplyAlphaUnorm16(uint16_t* const dest, const uint16_t* const src, const uint64_t count)
+{
+    uint64_t done = 0;
+#if PIXEL_CONVERT_X86
+    if (GetCpuFeatures() & PIXEL_CONVERT_CPU_FEATURE_AVX2_BIT)
+    {
+        done = PremultiplyAlphaUnorm16_Avx2(dest, src, count);
+    }
+#endif
+    PremultiplyAlphaUnorm16_Scalar(dest + (done * 4), src + (done * 4), count - done);
+}
+
+void PixelConvert_Rgba8ToRgba32f(float* const dest, const uint8_t* const src, const uint64_t count, const bool srgb)
+{
+    uint64_t done           = 0;
+    const uint32_t features = GetCpuFeatures();
+#if PIXEL_CONVERT_X86
+    // sRGB stays on the scalar table lookups, which measured faster than an AVX2 gather of the same table
+    if (!srgb && (features & PIXEL_CONVERT_CPU_FEATURE_AVX2_BIT))
+    {
+        done = Rgba8ToRgba32f_Avx2(dest, src, count);
+    }
+#else
+    (void)features;
+#endif
+    Rgba8ToRgba32f_Scalar(dest + (done * 4), src + (done * 4), count - done, srgb);
+}
+
+void PixelConvert_Rgba32fToRgba8(uint8_t* const dest, const float* const src, const uint64_t count, const bool srgb)
+{
+    uint64_t done = 0;
+#if PIXEL_CONVERT_X86
+    const uint32_t features = GetCpuFeatures();
+    if (features & PIXEL_CONVERT_CPU_FEATURE_AVX2_BIT)
+    {
+        done = Rgba32fToRgba8_Avx2(dest, src, count, srgb);
+    }
+    else if (!srgb && (features & PIXEL_CONVERT_CPU_FEATURE_SSE2_BIT))
+    {
+        done = Rgba32fToRgba8_Sse2(dest, src, count);
+    }
+#else
+    GetCpuFeatures();
+#endif
+    Rgba32fToRgba8_Scalar(dest + (done * 4), src + (done * 4), count - done, srgb);
+}
+
+void PixelConvert_F32ToF16(uint16_t* const dest, const float* const src, const uint64_t count)
+{
+    uint64_t done = 0;
+#if PIXEL_CONVERT_X86
+    const uint32_t required = PIXEL_CONVERT_CPU_FEATURE_AVX2_BIT | PIXEL_CONVERT_CPU_FEATURE_F16C_BIT;
+    if ((GetCpuFeatures() & required) == required)
+    {
+        done = F32ToF16_F16c(dest, src, count);
+    }
+#endif
+    F32ToF16_Scalar(dest + done, src + done, count - done);
+}
+
+void PixelConvert_F16ToF32(float* const dest, const uint16_t* const src, const uint64_t count)
+{
+    uint64_t done = 0;
+#if PIXEL_CONVERT_X86
+    const uint32_t required = PIXEL_CONVERT_CPU_FEATURE_AVX2_BIT | PIXEL_CONVERT_CPU_FEATURE_F16C_BIT;
+    if ((GetCpuFeatures() & required) == required)
+    {
+        done = F16ToF32_F16c(dest, src, count);
+    }
+#endif
+    F16ToF32_Scalar(dest + done, src + done, count - done);
+}
+
+void PixelConvert_Unorm16ToF16(uint16_t* const dest, const uint16_t* const src, const uint64_t count)
+{
+    uint64_t done = 0;
+#if PIXEL_CONVERT_X86
+    const uint32_t required = PIXEL_CONVERT_CPU_FEATURE_AVX2_BIT | PIXEL_CONVERT_CPU_FEATURE_F16C_BIT;
+    if ((GetCpuFeatures() & required) == required)
+    {
+        done = Unorm16ToF16_F16c(dest, src, count);
+    }
+#endif
+    Unorm16ToF16_Scalar(dest + done, src + done, count - done);
+}
+
+void PixelConvert_SetScalarOnly(const bool scalar)
+{
+    GetCpuFeatures();
+    scalar_only = scalar;
+}
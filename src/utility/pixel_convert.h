@@ -0,0 +1,70 @@
+#ifndef ROSINA_UTILITY_PIXEL_CONVERT_H
+#define ROSINA_UTILITY_PIXEL_CONVERT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Pixel conversion kernels used while loading textures. Each function picks an SSE/AVX2 implementation at runtime when
+ * the CPU has it and otherwise runs the scalar reference loop. count is always a number of pixels (or of elements for
+ * the single channel conversions), and dest and src may not overlap unless stated otherwise.
+ */
+
+/**
+ * Expands tightly packed RGB8 into RGBA8 with an opaque alpha.
+ */
+void PixelConvert_Rgb8ToRgba8(uint8_t* const dest, const uint8_t* const src, const uint64_t count);
+
+/**
+ * Swaps the red and blue channels of RGBA8 or BGRA8 pixels. dest may equal src.
+ */
+void PixelConvert_SwapRedBlue(uint8_t* const dest, const uint8_t* const src, const uint64_t count);
+
+/**
+ * Multiplies the color of RGBA8 pixels by their alpha. For sRGB pixels the multiplication is done in linear space.
+ * dest may equal src.
+ */
+void PixelConvert_PremultiplyAlpha(uint8_t* const dest, const uint8_t* const src, const uint64_t count, const bool srgb);
+
+/**
+ * Multiplies the color of RGBA float pixels by their alpha. dest may equal src.
+ */
+void PixelConvert_PremultiplyAlphaF32(float* const dest, const float* const src, const uint64_t count);
+
+/**
+ * Multiplies the color of RGBA unorm16 pixels by their alpha, rounded to nearest. dest may equal src.
+ */
+void PixelConvert_PremultiplyAlphaUnorm16(uint16_t* const dest, const uint16_t* const src, const uint64_t count);
+
+/**
+ * RGBA8 to RGBA float in [0, 1]. Color is decoded from sRGB to linear when srgb is set, alpha is always linear.
+ */
+void PixelConvert_Rgba8ToRgba32f(float* const dest, const uint8_t* const src, const uint64_t count, const bool srgb);
+
+/**
+ * RGBA float to RGBA8, clamped to [0, 1]. Color is encoded from linear to sRGB when srgb is set, alpha is always linear.
+ */
+void PixelConvert_Rgba32fToRgba8(uint8_t* const dest, const float* const src, const uint64_t count, const bool srgb);
+
+/**
+ * Converts count floats to IEEE half floats, rounding to nearest even.
+ */
+void PixelConvert_F32ToF16(uint16_t* const dest, const float* const src, const uint64_t count);
+
+/**
+ * Converts count IEEE half floats to floats. Every half is exactly representable.
+ */
+void PixelConvert_F16ToF32(float* const dest, const uint16_t* const src, const uint64_t count);
+
+/**
+ * Converts count unorm16 values to half floats in [0, 1].
+ */
+void PixelConvert_Unorm16ToF16(uint16_t* const dest, const uint16_t* const src, const uint64_t count);
+
+/**
+ * Makes every conversion run its scalar reference loop while set, so the vector kernels can be compared against it. Not
+ * safe to call while other threads are converting.
+ */
+void PixelConvert_SetScalarOnly(const bool scalar_only);
+
+#endif
@@ -0,0 +1,130 @@
+#include <utility/radix_sort.h>
+
+#include <string.h>
+
+#define RADIX_SORT_DIGIT_COUNT 256
+
+typedef struct RadixSortPass
+{
+    uint64_t* source_keys;
+    uint32_t* source_values;
+    uint64_t* destination_keys;
+    uint32_t* destination_values;
+    uint32_t count;
+    uint32_t block_count;
+    uint32_t shift;
+    // the counts of each digit per block, then where each block writes its first key of each digit
+    uint32_t offsets[WORKER_POOL_MAX_WORKER_COUNT][RADIX_SORT_DIGIT_COUNT];
+} RadixSortPass;
+
+static inline uint32_t GetBlockStart(const RadixSortPass pass[static 1], const uint32_t block)
+{
+    return (uint32_t)(((uint64_t)pass->count * block) / pass->block_count);
+}
+
+static void CountBlock(const uint32_t block, void* const user_data)
+{
+    RadixSortPass* const pass = user_data;
+    uint32_t* const counts    = pass->offsets[block];
+    memset(counts, 0, sizeof(uint32_t) * RADIX_SORT_DIGIT_COUNT);
+
+    const uint32_t end = GetBlockStart(pass, block + 1);
+    for (uint32_t i = GetBlockStart(pass, block); i < end; i++)
+    {
+        counts[(pass->source_keys[i] >> pass->shift) & 0xFF]++;
+    }
+}
+
+static void ScatterBlock(const uint32_t block, void* const user_data)
+{
+    RadixSortPass* const pass = user_data;
+    uint32_t* const offsets   = pass->offsets[block];
+
+    const uint32_t end = GetBlockStart(pass, block + 1);
+    for (uint32_t i = GetBlockStart(pass, block); i < end; i++)
+    {
+        const uint32_t destination           = offsets[(pass->source_keys[i] >> pass->shift) & 0xFF]++;
+        pass->destination_keys[destination]   = pass->source_keys[i];
+        pass->destination_values[destination] = pass->source_values[i];
+    }
+}
+
+void RadixSort64(uint64_t* const keys, uint32_t* const values, uint64_t* const key_scratch, uint32_t* const value_scratch, const uint32_t count,
+                 WorkerPool* const workers)
+{
+    if (count < 2)
+    {
+        return;
+    }
+
+    const uint32_t worker_count = workers != NULL ? workers->worker_count : 1;
+    const uint32_t wanted_count = (count + RADIX_SORT_MIN_BLOCK_SIZE - 1) / RADIX_SORT_MIN_BLOCK_SIZE;
+
+    RadixSortPass pass = {
+        .source_keys        = keys,
+        .source_values      = values,
+        .destination_keys   = key_scratch,
+        .destination_values = value_scratch,
+        .count              = count,
+        .block_count        = wanted_count < worker_count ? wanted_count : worker_count,
+        .shift              = 0,
+        .offsets            = {},
+    };
+    if (pass.block_count > WORKER_POOL_MAX_WORKER_COUNT)
+    {
+        pass.block_count = WORKER_POOL_MAX_WORKER_COUNT;
+    }
+
+    for (pass.shift = 0; pass.shift < 64; pass.shift += 8)
+    {
+        if (pass.block_count > 1)
+        {
+            WorkerPool_Run(workers, pass.block_count, CountBlock, &pass);
+        }
+        else
+        {
+            CountBlock(0, &pass);
+        }
+
+        // keys of each digit go after every smaller digit, and within a digit block after block, which keeps it stable
+        uint32_t offset = 0;
+        bool skipped    = false;
+        for (uint32_t digit = 0; digit < RADIX_SORT_DIGIT_COUNT; digit++)
+        {
+            const uint32_t digit_start = offset;
+            for (uint32_t block = 0; block < pass.block_count; block++)
+            {
+                const uint32_t digit_count = pass.offsets[block][digit];
+                pass.offsets[block][digit] = offset;
+                offset += digit_count;
+            }
+            skipped = skipped || offset - digit_start == count;
+        }
+        if (skipped)
+        {
+            continue;
+        }
+
+        if (pass.block_count > 1)
+        {
+            WorkerPool_Run(workers, pass.block_count, ScatterBlock, &pass);
+        }
+        else
+        {
+            ScatterBlock(0, &pass);
+        }
+
+        uint64_t* const source_keys   = pass.source_keys;
+        uint32_t* const source_values = pass.source_values;
+        pass.source_keys              = pass.destination_keys;
+        pass.source_values            = pass.destination_values;
+        pass.destination_keys         = source_keys;
+        pass.destination_values       = source_values;
+    }
+
+    if (pass.source_keys != keys)
+    {
+        memcpy(keys, pass.source_keys, sizeof(uint64_t) * count);
+        memcpy(values, pass.source_values, sizeof(uint32_t) * count);
+    }
+}
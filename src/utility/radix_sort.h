@@ -0,0 +1,23 @@
+#ifndef ROSINA_UTILITY_RADIX_SORT_H
+#define ROSINA_UTILITY_RADIX_SORT_H
+
+#include <stdint.h>
+
+#include <utility/worker_pool.h>
+
+// fewer keys than this per block cost more to hand to a worker than to sort
+#define RADIX_SORT_MIN_BLOCK_SIZE 4096
+
+/**
+ * Sorts keys in ascending order, moving each value with its key, with a stable least significant digit radix sort of
+ * 8 bits per pass. A pass is skipped when every key has the same digit, so keys that only use their top bits take few
+ * passes. With workers, each pass counts and scatters one block of keys per worker.
+ *
+ * @param key_scratch Room for count keys.
+ * @param value_scratch Room for count values.
+ * @param workers NULL to sort on the calling thread.
+ */
+void RadixSort64(uint64_t* const keys, uint32_t* const values, uint64_t* const key_scratch, uint32_t* const value_scratch, const uint32_t count,
+                 WorkerPool* const workers);
+
+#endif
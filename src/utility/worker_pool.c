@@ -0,0 +1,179 @@
+#include <utility/worker_pool.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <utility/log.h>
+
+struct WorkerPoolState
+{
+    pthread_mutex_t mutex;
+    // signaled when a run starts or the pool stops
+    pthread_cond_t start;
+    // signaled when the last task of a run finishes
+    pthread_cond_t done;
+    uint32_t thread_count;
+    pthread_t threads[WORKER_POOL_MAX_WORKER_COUNT];
+
+    WorkerTask task;
+    void* user_data;
+    uint32_t task_count;
+    uint32_t next_task;
+    uint32_t finished_count;
+    // counts the runs, so a worker knows a run is new
+    uint64_t generation;
+    bool stopping;
+};
+
+/**
+ * Runs tasks of the current run until none are left. Called and returns with the mutex locked.
+ */
+static void RunTasks(WorkerPoolState state[static 1])
+{
+    while (state->next_task < state->task_count)
+    {
+        const uint32_t task_index = state->next_task++;
+        pthread_mutex_unlock(&state->mutex);
+        state->task(task_index, state->user_data);
+        pthread_mutex_lock(&state->mutex);
+
+        if (++state->finished_count == state->task_count)
+        {
+            pthread_cond_signal(&state->done);
+        }
+    }
+}
+
+static void* Worker(void* const argument)
+{
+    WorkerPoolState* const state = argument;
+    uint64_t generation          = 0;
+
+    pthread_mutex_lock(&state->mutex);
+    while (true)
+    {
+        while (state->generation == generation && !state->stopping)
+        {
+            pthread_cond_wait(&state->start, &state->mutex);
+        }
+        if (state->stopping)
+        {
+            break;
+        }
+        generation = state->generation;
+        RunTasks(state);
+    }
+    pthread_mutex_unlock(&state->mutex);
+
+    return NULL;
+}
+
+WorkerPool WorkerPool_Create(const uint32_t worker_count)
+{
+    WorkerPool pool = {.worker_count = 1, .state = NULL};
+
+    const uint32_t thread_count = (worker_count < WORKER_POOL_MAX_WORKER_COUNT ? worker_count : WORKER_POOL_MAX_WORKER_COUNT) - 1;
+    if (worker_count == 0 || thread_count == 0)
+    {
+        return pool;
+    }
+
+    WorkerPoolState* const state = calloc(1, sizeof(WorkerPoolState));
+    if (state == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate worker pool, running tasks on one thread");
+        return pool;
+    }
+    if (pthread_mutex_init(&state->mutex, NULL) != 0)
+    {
+        ROSINA_LOG_ERROR("Failed to create worker pool mutex, running tasks on one thread");
+        free(state);
+        return pool;
+    }
+    if (pthread_cond_init(&state->start, NULL) != 0 || pthread_cond_init(&state->done, NULL) != 0)
+    {
+        ROSINA_LOG_ERROR("Failed to create worker pool conditions, running tasks on one thread");
+        pthread_mutex_destroy(&state->mutex);
+        free(state);
+        return pool;
+    }
+
+    for (uint32_t i = 0; i < thread_count; i++)
+    {
+        if (pthread_create(&state->threads[state->thread_count], NULL, Worker, state) != 0)
+        {
+            ROSINA_LOG_ERROR("Failed to start worker %u of %u", i + 1, thread_count);
+            break;
+        }
+        state->thread_count++;
+    }
+
+    pool.worker_count = state->thread_count + 1;
+    pool.state        = state;
+    if (state->thread_count == 0)
+    {
+        WorkerPool_Cleanup(&pool);
+    }
+    return pool;
+}
+
+void WorkerPool_Cleanup(WorkerPool pool[static 1])
+{
+    WorkerPoolState* const state = pool->state;
+    if (state != NULL)
+    {
+        pthread_mutex_lock(&state->mutex);
+        state->stopping = true;
+        pthread_cond_broadcast(&state->start);
+        pthread_mutex_unlock(&state->mutex);
+
+        for (uint32_t i = 0; i < state->thread_count; i++)
+        {
+            pthread_join(state->threads[i], NULL);
+        }
+
+        pthread_cond_destroy(&state->done);
+        pthread_cond_destroy(&state->start);
+        pthread_mutex_destroy(&state->mutex);
+        free(state);
+    }
+
+    pool->worker_count = 1;
+    pool->state        = NULL;
+}
+
+void WorkerPool_Run(WorkerPool pool[static 1], const uint32_t task_count, const WorkerTask task, void* const user_data)
+{
+    WorkerPoolState* const state = pool->state;
+    if (state == NULL || task_count <= 1)
+    {
+        for (uint32_t i = 0; i < task_count; i++)
+        {
+            task(i, user_data);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&state->mutex);
+    state->task           = task;
+    state->user_data      = user_data;
+    state->task_count     = task_count;
+    state->next_task      = 0;
+    state->finished_count = 0;
+    state->generation++;
+    pthread_cond_broadcast(&state->start);
+
+    RunTasks(state);
+    while (state->finished_count < state->task_count)
+    {
+        pthread_cond_wait(&state->done, &state->mutex);
+    }
+    pthread_mutex_unlock(&state->mutex);
+}
+
+uint32_t WorkerPool_GetProcessorCount(void)
+{
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t)count : 1;
+}
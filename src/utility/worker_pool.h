@@ -0,0 +1,46 @@
+#ifndef ROSINA_UTILITY_WORKER_POOL_H
+#define ROSINA_UTILITY_WORKER_POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define WORKER_POOL_MAX_WORKER_COUNT 16
+
+/**
+ * @param task_index From 0 to the task count given to WorkerPool_Run.
+ */
+typedef void (*WorkerTask)(const uint32_t task_index, void* const user_data);
+
+typedef struct WorkerPoolState WorkerPoolState;
+
+/**
+ * Threads that run the tasks of one WorkerPool_Run at a time. The thread calling WorkerPool_Run is one of the workers.
+ */
+typedef struct WorkerPool
+{
+    // including the calling thread
+    uint32_t worker_count;
+    // NULL when every task runs on the calling thread
+    WorkerPoolState* state;
+} WorkerPool;
+
+/**
+ * Starts worker_count - 1 threads, at most WORKER_POOL_MAX_WORKER_COUNT - 1. On error, or when worker_count is 1,
+ * state is NULL and WorkerPool_Run runs every task on the calling thread.
+ */
+WorkerPool WorkerPool_Create(const uint32_t worker_count);
+
+void WorkerPool_Cleanup(WorkerPool pool[static 1]);
+
+/**
+ * Runs task once for every index below task_count, spread over the workers, and returns once all of them finished.
+ * Tasks must not call WorkerPool_Run.
+ */
+void WorkerPool_Run(WorkerPool pool[static 1], const uint32_t task_count, const WorkerTask task, void* const user_data);
+
+/**
+ * @return The number of processors online, at least 1.
+ */
+uint32_t WorkerPool_GetProcessorCount(void);
+
+#endif
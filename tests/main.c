@@ -0,0 +1,405 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <utility/log.h>
+#include <utility/mesh.h>
+#include <utility/mesh_file.h>
+#include <utility/mesh_lod.h>
+#include <utility/mesh_optimizer.h>
+#include <utility/meshlet.h>
+#include <utility/offset_allocator.h>
+#include <utility/radix_sort.h>
+#include <utility/worker_pool.h>
+
+// quads per side of the grid the mesh tests run on
+#define TEST_GRID_SIZE 64
+#define TEST_MESH_FILE_PATH "utility_tests.rmesh"
+
+static uint32_t failure_count;
+
+#define TEST_CHECK(condition)                                        \
+    do                                                               \
+    {                                                                \
+        if (!(condition))                                            \
+        {                                                            \
+            ROSINA_LOG_ERROR("Check failed: %s", #condition);        \
+            failure_count++;                                         \
+        }                                                            \
+    } while (0)
+
+static uint32_t NextRandom(uint32_t state[static 1])
+{
+    // xorshift32, so every run checks the same cases
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+/**
+ * A flat grid of TEST_GRID_SIZE by TEST_GRID_SIZE quads whose triangles are shuffled, which is about the worst order
+ * for the vertex cache.
+ *
+ * @return true on error.
+ */
+static bool CreateShuffledGrid(Mesh mesh[static 1])
+{
+    const uint32_t side         = TEST_GRID_SIZE + 1;
+    const uint32_t vertex_count = side * side;
+    const uint32_t index_count  = TEST_GRID_SIZE * TEST_GRID_SIZE * 6;
+    Vertex* const vertices      = malloc(sizeof(Vertex) * vertex_count);
+    uint32_t* const indices     = malloc(sizeof(uint32_t) * index_count);
+    if (vertices == NULL || indices == NULL)
+    {
+        free(vertices);
+        free(indices);
+        return true;
+    }
+
+    for (uint32_t y = 0; y < side; y++)
+    {
+        for (uint32_t x = 0; x < side; x++)
+        {
+            const float u            = (float)x / (float)TEST_GRID_SIZE;
+            const float v            = (float)y / (float)TEST_GRID_SIZE;
+            vertices[(y * side) + x] = (Vertex){
+                .position = {{u, 0.0f, v}},
+                .uv       = {{u, v}},
+                .normal   = {{0.0f, 1.0f, 0.0f}},
+                .tangent  = {{1.0f, 0.0f, 0.0f, 1.0f}},
+            };
+        }
+    }
+
+    uint32_t* index = indices;
+    for (uint32_t y = 0; y < TEST_GRID_SIZE; y++)
+    {
+        for (uint32_t x = 0; x < TEST_GRID_SIZE; x++)
+        {
+            const uint32_t corner  = (y * side) + x;
+            const uint32_t quad[6] = {corner, corner + side, corner + 1, corner + 1, corner + side, corner + side + 1};
+            memcpy(index, quad, sizeof(quad));
+            index += 6;
+        }
+    }
+
+    uint32_t state = 1;
+    for (uint32_t i = (index_count / 3) - 1; i > 0; i--)
+    {
+        const uint32_t j = NextRandom(&state) % (i + 1);
+        uint32_t triangle[3];
+        memcpy(triangle, indices + (i * 3), sizeof(triangle));
+        memcpy(indices + (i * 3), indices + (j * 3), sizeof(triangle));
+        memcpy(indices + (j * 3), triangle, sizeof(triangle));
+    }
+
+    const bool failed = Mesh_Create(vertices, vertex_count, indices, index_count, mesh);
+    free(vertices);
+    free(indices);
+    return failed;
+}
+
+static void TestMeshOptimize(Mesh mesh[static 1])
+{
+    const MeshVertexCacheStats before = Mesh_AnalyzeVertexCache(mesh, MESH_OPTIMIZER_ANALYZE_CACHE_SIZE);
+    const uint32_t index_count        = mesh->index_count;
+    TEST_CHECK(!Mesh_Optimize(mesh));
+    const MeshVertexCacheStats after = Mesh_AnalyzeVertexCache(mesh, MESH_OPTIMIZER_ANALYZE_CACHE_SIZE);
+    ROSINA_LOG_INFO("Shuffled grid: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", before.acmr, after.acmr, before.atvr, after.atvr);
+
+    TEST_CHECK(mesh->index_count == index_count);
+    TEST_CHECK(after.acmr < before.acmr);
+    TEST_CHECK(after.atvr < before.atvr);
+    // a regular grid reaches about 0.6 with a 16 vertex FIFO, a shuffled one stays close to 3
+    TEST_CHECK(after.acmr < 1.0f);
+    for (uint32_t i = 0; i < mesh->index_count; i++)
+    {
+        TEST_CHECK(mesh->indices[i] < mesh->vertex_count);
+    }
+}
+
+static void TestMeshlets(const Mesh mesh[static 1])
+{
+    Meshlets meshlets;
+    TEST_CHECK(!Meshlets_Build(mesh, &meshlets));
+
+    uint32_t triangle_count = 0;
+    for (uint32_t m = 0; m < meshlets.meshlet_count; m++)
+    {
+        const Meshlet* const meshlet = &meshlets.meshlets[m];
+        TEST_CHECK(meshlet->vertex_count > 0 && meshlet->vertex_count <= MESHLET_MAX_VERTICES);
+        TEST_CHECK(meshlet->triangle_count > 0 && meshlet->triangle_count <= MESHLET_MAX_TRIANGLES);
+        TEST_CHECK(meshlet->triangle_offset == triangle_count);
+        TEST_CHECK(meshlet->vertex_offset + meshlet->vertex_count <= meshlets.vertex_count);
+
+        // each meshlet is the range of the index buffer it was built from
+        for (uint32_t t = 0; t < meshlet->triangle_count * 3; t++)
+        {
+            const uint8_t local = meshlets.triangles[(meshlet->triangle_offset * 3) + t];
+            TEST_CHECK(local < meshlet->vertex_count);
+            TEST_CHECK(meshlets.vertices[meshlet->vertex_offset + local] == mesh->indices[(meshlet->triangle_offset * 3) + t]);
+        }
+        triangle_count += meshlet->triangle_count;
+    }
+    TEST_CHECK(triangle_count == mesh->index_count / 3);
+    TEST_CHECK(meshlets.triangle_count == triangle_count);
+
+    Meshlets_Cleanup(&meshlets);
+}
+
+static void TestMeshLods(Mesh mesh[static 1], MeshLod lods[static MESH_LOD_MAX_COUNT], uint32_t lod_count[static 1])
+{
+    const MeshLodCreateInfo info = {
+        .max_lod_count      = MESH_LOD_MAX_COUNT,
+        .reduction          = MESH_LOD_DEFAULT_REDUCTION,
+        .min_triangle_count = MESH_LOD_DEFAULT_MIN_TRIANGLE_COUNT,
+        .max_error          = MESH_LOD_DEFAULT_MAX_ERROR,
+    };
+    TEST_CHECK(!Mesh_GenerateLods(mesh, &info, lods, lod_count));
+    ROSINA_LOG_INFO("Flat grid simplified into %u levels", *lod_count);
+
+    // a flat grid simplifies without error, so there is always more than the full mesh
+    TEST_CHECK(*lod_count > 1);
+    TEST_CHECK(lods[0].first_index == 0 && lods[0].error == 0.0f);
+    for (uint32_t l = 1; l < *lod_count; l++)
+    {
+        TEST_CHECK(lods[l].index_count > 0 && lods[l].index_count % 3 == 0);
+        TEST_CHECK(lods[l].index_count < lods[l - 1].index_count);
+        TEST_CHECK(lods[l].first_index == lods[l - 1].first_index + lods[l - 1].index_count);
+        TEST_CHECK(lods[l].error >= lods[l - 1].error && lods[l].error <= MESH_LOD_DEFAULT_MAX_ERROR * mesh->bounds.radius);
+    }
+    TEST_CHECK(lods[*lod_count - 1].first_index + lods[*lod_count - 1].index_count == mesh->index_count);
+    for (uint32_t i = 0; i < mesh->index_count; i++)
+    {
+        TEST_CHECK(mesh->indices[i] < mesh->vertex_count);
+    }
+}
+
+static void TestMeshFileRoundTrip(const Mesh mesh[static 1], const MeshLod lods[static MESH_LOD_MAX_COUNT], const uint32_t lod_count,
+                                  const bool compress_indices)
+{
+    // like mesh_baker, the meshlets cover the full mesh and the coarser levels are drawn whole
+    Mesh full_mesh        = *mesh;
+    full_mesh.index_count = lods[0].index_count;
+    Meshlets meshlets;
+    TEST_CHECK(!Meshlets_Build(&full_mesh, &meshlets));
+
+    // the file does not interpret the vertices, so the full precision ones are written as they are
+    MeshFileWriteInfo write_info = {
+        .vertex_encodings = {},
+        .vertex_stride    = sizeof(Vertex),
+        .vertex_count     = mesh->vertex_count,
+        .vertices         = mesh->vertices,
+        .index_size       = mesh->vertex_count > UINT16_MAX ? 4 : 2,
+        .index_count      = mesh->index_count,
+        .indices          = mesh->indices,
+        .compress_indices = compress_indices,
+        .bounds           = mesh->bounds,
+        .lod_count        = lod_count,
+        .lods             = {},
+        .meshlets         = &meshlets,
+    };
+    memcpy(write_info.lods, lods, sizeof(MeshLod) * lod_count);
+    TEST_CHECK(!MeshFile_Write(TEST_MESH_FILE_PATH, &write_info));
+
+    MeshFileInfo info;
+    TEST_CHECK(MeshFile_Is(TEST_MESH_FILE_PATH));
+    TEST_CHECK(!MeshFile_ReadInfo(TEST_MESH_FILE_PATH, &info));
+    TEST_CHECK(info.vertex_count == mesh->vertex_count && info.vertex_stride == sizeof(Vertex));
+    TEST_CHECK(info.index_count == mesh->index_count && info.index_size == write_info.index_size);
+    TEST_CHECK(((info.flags & MESH_FILE_FLAG_COMPRESSED_INDICES) != 0) == compress_indices);
+    TEST_CHECK(memcmp(&info.bounds, &mesh->bounds, sizeof(MeshBounds)) == 0);
+    TEST_CHECK(info.lod_count == lod_count && memcmp(info.lods, lods, sizeof(MeshLod) * lod_count) == 0);
+
+    void* const vertices   = malloc(info.vertex_data_size);
+    uint8_t* const indices = malloc((size_t)info.index_count * info.index_size);
+    if (vertices != NULL && indices != NULL)
+    {
+        TEST_CHECK(!MeshFile_ReadVertices(TEST_MESH_FILE_PATH, &info, vertices));
+        TEST_CHECK(memcmp(vertices, mesh->vertices, sizeof(Vertex) * mesh->vertex_count) == 0);
+
+        TEST_CHECK(!MeshFile_ReadIndices(TEST_MESH_FILE_PATH, &info, indices));
+        for (uint32_t i = 0; i < info.index_count; i++)
+        {
+            uint32_t index = 0;
+            memcpy(&index, indices + ((size_t)i * info.index_size), info.index_size);
+            TEST_CHECK(index == mesh->indices[i]);
+        }
+    }
+    else
+    {
+        ROSINA_LOG_ERROR("Failed to allocate the mesh file streams");
+        failure_count++;
+    }
+    free(vertices);
+    free(indices);
+
+    Meshlets read_meshlets;
+    TEST_CHECK(!MeshFile_ReadMeshlets(TEST_MESH_FILE_PATH, &info, &read_meshlets));
+    TEST_CHECK(read_meshlets.meshlet_count == meshlets.meshlet_count && read_meshlets.vertex_count == meshlets.vertex_count &&
+               read_meshlets.triangle_count == meshlets.triangle_count);
+    if (read_meshlets.meshlet_count == meshlets.meshlet_count && read_meshlets.vertex_count == meshlets.vertex_count &&
+        read_meshlets.triangle_count == meshlets.triangle_count)
+    {
+        TEST_CHECK(memcmp(read_meshlets.meshlets, meshlets.meshlets, sizeof(Meshlet) * meshlets.meshlet_count) == 0);
+        TEST_CHECK(memcmp(read_meshlets.bounds, meshlets.bounds, sizeof(MeshletBounds) * meshlets.meshlet_count) == 0);
+        TEST_CHECK(memcmp(read_meshlets.vertices, meshlets.vertices, sizeof(uint32_t) * meshlets.vertex_count) == 0);
+        TEST_CHECK(memcmp(read_meshlets.triangles, meshlets.triangles, (size_t)meshlets.triangle_count * 3) == 0);
+    }
+
+    Meshlets_Cleanup(&read_meshlets);
+    Meshlets_Cleanup(&meshlets);
+    remove(TEST_MESH_FILE_PATH);
+}
+
+static int CompareAllocationOffsets(const void* a, const void* b)
+{
+    const uint32_t oa = ((const OffsetAllocation*)a)->offset;
+    const uint32_t ob = ((const OffsetAllocation*)b)->offset;
+    return oa < ob ? -1 : (oa > ob ? 1 : 0);
+}
+
+static void TestOffsetAllocator(void)
+{
+    const uint32_t size                 = 1 << 20;
+    const uint32_t max_allocation_count = 256;
+    OffsetAllocator allocator           = OffsetAllocator_Create(size, max_allocation_count);
+    TEST_CHECK(allocator.nodes != NULL);
+    if (allocator.nodes == NULL)
+    {
+        return;
+    }
+
+    OffsetAllocation allocations[256];
+    uint32_t sizes[256];
+    uint32_t allocation_count = 0;
+    uint32_t state            = 7;
+    for (uint32_t step = 0; step < 20000; step++)
+    {
+        if (allocation_count < max_allocation_count && (allocation_count == 0 || NextRandom(&state) % 3 != 0))
+        {
+            const uint32_t allocation_size    = 1 + (NextRandom(&state) % 8192);
+            const OffsetAllocation allocation = OffsetAllocator_Allocate(&allocator, allocation_size);
+            if (allocation.node != OFFSET_ALLOCATOR_NONE)
+            {
+                TEST_CHECK(allocation.offset + allocation_size <= size);
+                allocations[allocation_count] = allocation;
+                sizes[allocation_count]       = allocation_size;
+                allocation_count++;
+            }
+        }
+        else
+        {
+            const uint32_t i = NextRandom(&state) % allocation_count;
+            OffsetAllocator_Free(&allocator, allocations[i]);
+            allocation_count--;
+            allocations[i] = allocations[allocation_count];
+            sizes[i]       = sizes[allocation_count];
+        }
+
+        if (step % 64 == 0)
+        {
+            // sorted by offset, each allocation must end before the next one starts
+            OffsetAllocation sorted[256];
+            uint32_t sorted_sizes[256];
+            memcpy(sorted, allocations, sizeof(OffsetAllocation) * allocation_count);
+            qsort(sorted, allocation_count, sizeof(OffsetAllocation), CompareAllocationOffsets);
+            for (uint32_t i = 0; i < allocation_count; i++)
+            {
+                for (uint32_t j = 0; j < allocation_count; j++)
+                {
+                    if (allocations[j].node == sorted[i].node) sorted_sizes[i] = sizes[j];
+                }
+            }
+            for (uint32_t i = 1; i < allocation_count; i++)
+            {
+                TEST_CHECK(sorted[i - 1].offset + sorted_sizes[i - 1] <= sorted[i].offset);
+            }
+            TEST_CHECK(OffsetAllocator_GetStats(&allocator).allocation_count == allocation_count);
+        }
+    }
+
+    while (allocation_count > 0)
+    {
+        OffsetAllocator_Free(&allocator, allocations[--allocation_count]);
+    }
+    const OffsetAllocatorStats stats = OffsetAllocator_GetStats(&allocator);
+    TEST_CHECK(stats.allocation_count == 0);
+    TEST_CHECK(stats.free_size == size);
+    TEST_CHECK(stats.largest_free_size == size);
+    TEST_CHECK(stats.free_range_count == 1);
+
+    OffsetAllocator_Cleanup(&allocator);
+}
+
+static void TestRadixSort(WorkerPool* const workers)
+{
+    const uint32_t count          = RADIX_SORT_MIN_BLOCK_SIZE * 8 + 123;
+    uint64_t* const keys          = malloc(sizeof(uint64_t) * count);
+    uint32_t* const values        = malloc(sizeof(uint32_t) * count);
+    uint64_t* const key_scratch   = malloc(sizeof(uint64_t) * count);
+    uint32_t* const value_scratch = malloc(sizeof(uint32_t) * count);
+    if (keys == NULL || values == NULL || key_scratch == NULL || value_scratch == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate the keys to sort");
+        failure_count++;
+    }
+    else
+    {
+        // few distinct keys, so equal keys show whether the sort is stable
+        uint32_t state = 3;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            keys[i]   = ((uint64_t)(NextRandom(&state) % 512) << 40) | (NextRandom(&state) % 4);
+            values[i] = i;
+        }
+        RadixSort64(keys, values, key_scratch, value_scratch, count, workers);
+
+        for (uint32_t i = 1; i < count; i++)
+        {
+            TEST_CHECK(keys[i - 1] < keys[i] || (keys[i - 1] == keys[i] && values[i - 1] < values[i]));
+        }
+    }
+
+    free(keys);
+    free(values);
+    free(key_scratch);
+    free(value_scratch);
+}
+
+int main(void)
+{
+    Mesh mesh;
+    if (CreateShuffledGrid(&mesh))
+    {
+        ROSINA_LOG_ERROR("Failed to create the test mesh");
+        return 1;
+    }
+    TestMeshOptimize(&mesh);
+    TestMeshlets(&mesh);
+
+    MeshLod lods[MESH_LOD_MAX_COUNT];
+    uint32_t lod_count = 0;
+    TestMeshLods(&mesh, lods, &lod_count);
+    TestMeshFileRoundTrip(&mesh, lods, lod_count, false);
+    TestMeshFileRoundTrip(&mesh, lods, lod_count, true);
+    Mesh_Cleanup(&mesh);
+
+    TestOffsetAllocator();
+
+    TestRadixSort(NULL);
+    WorkerPool workers = WorkerPool_Create(4);
+    TestRadixSort(&workers);
+    WorkerPool_Cleanup(&workers);
+
+    if (failure_count > 0)
+    {
+        ROSINA_LOG_ERROR("%u checks failed", failure_count);
+        return 1;
+    }
+    ROSINA_LOG_INFO("All checks passed");
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <engine/graphics/vertex_format.h>
+#include <utility/log.h>
+#include <utility/mesh_file.h>
+#include <utility/mesh_lod.h>
+#include <utility/mesh_optimizer.h>
+#include <utility/meshlet.h>
+
+static void PrintUsage(void)
+{
+    printf("usage: mesh_baker <input .obj|.gltf|.glb> <output.rmesh> [--full-precision] [--compress-indices] [--no-optimize] [--no-meshlets] [--lods <count>]\n");
+    printf("  --full-precision    32 bit positions, uvs, normals and tangents instead of the quantized format\n");
+    printf("  --compress-indices  store the indices as varint deltas, decoded on load\n");
+    printf("  --no-optimize       keep the vertex and triangle order of the input\n");
+    printf("  --no-meshlets       leave out the meshlets used for cluster culling\n");
+    printf("  --lods <count>      levels of detail including the full mesh, 1 to %u, %u by default\n", MESH_LOD_MAX_COUNT, MESH_LOD_MAX_COUNT);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const char* const input_path  = argv[1];
+    const char* const output_path = argv[2];
+    bool full_precision           = false;
+    bool compress_indices         = false;
+    bool optimize                 = true;
+    bool build_meshlets           = true;
+    uint32_t max_lod_count        = MESH_LOD_MAX_COUNT;
+
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--full-precision") == 0)
+        {
+            full_precision = true;
+        }
+        else if (strcmp(argv[i], "--compress-indices") == 0)
+        {
+            compress_indices = true;
+        }
+        else if (strcmp(argv[i], "--no-optimize") == 0)
+        {
+            optimize = false;
+        }
+        else if (strcmp(argv[i], "--no-meshlets") == 0)
+        {
+            build_meshlets = false;
+        }
+        else if (strcmp(argv[i], "--lods") == 0 && i + 1 < argc)
+        {
+            max_lod_count = (uint32_t)strtoul(argv[++i], NULL, 10);
+            if (max_lod_count == 0 || max_lod_count > MESH_LOD_MAX_COUNT)
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    Mesh mesh;
+    if (Mesh_Load(input_path, &mesh))
+    {
+        ROSINA_LOG_ERROR("Failed to load \"%s\"", input_path);
+        return 1;
+    }
+    if (optimize && Mesh_Optimize(&mesh))
+    {
+        Mesh_Cleanup(&mesh);
+        return 1;
+    }
+
+    const MeshLodCreateInfo lod_info = {
+        .max_lod_count      = max_lod_count,
+        .reduction          = MESH_LOD_DEFAULT_REDUCTION,
+        .min_triangle_count = MESH_LOD_DEFAULT_MIN_TRIANGLE_COUNT,
+        .max_error          = MESH_LOD_DEFAULT_MAX_ERROR,
+    };
+    MeshLod lods[MESH_LOD_MAX_COUNT];
+    uint32_t lod_count = 0;
+    if (Mesh_GenerateLods(&mesh, &lod_info, lods, &lod_count))
+    {
+        Mesh_Cleanup(&mesh);
+        return 1;
+    }
+
+    // the meshlets cover the full mesh, the coarser levels are drawn whole
+    Mesh full_mesh        = mesh;
+    full_mesh.index_count = lods[0].index_count;
+    Meshlets meshlets     = {};
+    if (build_meshlets && Meshlets_Build(&full_mesh, &meshlets))
+    {
+        Mesh_Cleanup(&mesh);
+        return 1;
+    }
+
+    // the full precision preset leaves out normals and tangents, a baked mesh keeps them
+    static const VertexEncoding full_precision_encodings[VERTEX_ATTRIBUTE_COUNT] = {
+        [VERTEX_ATTRIBUTE_POSITION] = VERTEX_ENCODING_FLOAT32,
+        [VERTEX_ATTRIBUTE_UV]       = VERTEX_ENCODING_FLOAT32,
+        [VERTEX_ATTRIBUTE_NORMAL]   = VERTEX_ENCODING_FLOAT32,
+        [VERTEX_ATTRIBUTE_TANGENT]  = VERTEX_ENCODING_FLOAT32,
+    };
+    VertexEncoding encodings[VERTEX_ATTRIBUTE_COUNT];
+    VertexFormat_Fit(full_precision ? full_precision_encodings : VERTEX_FORMAT_QUANTIZED, mesh.vertices, mesh.vertex_count, &mesh.bounds, encodings);
+    const VertexFormat format = VertexFormat_Create(encodings);
+    uint8_t* const vertices   = malloc((size_t)format.stride * (mesh.vertex_count > 0 ? mesh.vertex_count : 1));
+    if (format.stride == 0 || vertices == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to encode \"%s\"", input_path);
+        free(vertices);
+        Meshlets_Cleanup(&meshlets);
+        Mesh_Cleanup(&mesh);
+        return 1;
+    }
+    VertexFormat_Encode(&format, mesh.vertices, mesh.vertex_count, vertices);
+
+    MeshFileWriteInfo write_info = {
+        .vertex_encodings = {},
+        .vertex_stride    = format.stride,
+        .vertex_count     = mesh.vertex_count,
+        .vertices         = vertices,
+        .index_size       = VertexFormat_GetIndexSize(VertexFormat_GetIndexType(mesh.vertex_count)),
+        .index_count      = mesh.index_count,
+        .indices          = mesh.indices,
+        .compress_indices = compress_indices,
+        .bounds           = mesh.bounds,
+        .lod_count        = lod_count,
+        .lods             = {},
+        .meshlets         = &meshlets,
+    };
+    for (uint32_t i = 0; i < VERTEX_ATTRIBUTE_COUNT; i++)
+    {
+        write_info.vertex_encodings[i] = encodings[i];
+    }
+    for (uint32_t i = 0; i < lod_count; i++)
+    {
+        write_info.lods[i] = lods[i];
+    }
+
+    bool failed = MeshFile_Write(output_path, &write_info);
+    if (!failed)
+    {
+        // read back, so a file the engine would reject fails the bake
+        MeshFileInfo info;
+        failed = MeshFile_ReadInfo(output_path, &info);
+        if (failed)
+        {
+            ROSINA_LOG_ERROR("Baked \"%s\" does not read back", output_path);
+        }
+        else
+        {
+            ROSINA_LOG_INFO("Baked \"%s\" (%u vertices of %u bytes, %u indices in %llu bytes, %u LODs, %u meshlets)", output_path, info.vertex_count,
+                            info.vertex_stride, info.index_count, (unsigned long long)info.index_data_size, info.lod_count,
+                            info.meshlet_count);
+        }
+    }
+
+    free(vertices);
+    Meshlets_Cleanup(&meshlets);
+    Mesh_Cleanup(&mesh);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,245 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <utility/log.h>
+#include <utility/pixel_convert.h>
+
+#define BENCH_RUN_COUNT 5
+
+typedef struct BenchBuffers
+{
+    uint64_t pixel_count;
+    uint8_t* rgba8;
+    float* rgba32f;
+    uint16_t* rgba16;
+    uint16_t* rgba16f;
+    // written by the scalar run and then by the vector run, and compared afterwards
+    void* scalar_dest;
+    void* vector_dest;
+} BenchBuffers;
+
+typedef enum BenchKernel
+{
+    BENCH_KERNEL_RGB8_TO_RGBA8,
+    BENCH_KERNEL_SWAP_RED_BLUE,
+    BENCH_KERNEL_PREMULTIPLY_ALPHA,
+    BENCH_KERNEL_PREMULTIPLY_ALPHA_SRGB,
+    BENCH_KERNEL_PREMULTIPLY_ALPHA_F32,
+    BENCH_KERNEL_PREMULTIPLY_ALPHA_UNORM16,
+    BENCH_KERNEL_RGBA8_TO_RGBA32F,
+    BENCH_KERNEL_SRGBA8_TO_RGBA32F,
+    BENCH_KERNEL_RGBA32F_TO_RGBA8,
+    BENCH_KERNEL_RGBA32F_TO_SRGBA8,
+    BENCH_KERNEL_F32_TO_F16,
+    BENCH_KERNEL_F16_TO_F32,
+    BENCH_KERNEL_UNORM16_TO_F16,
+    BENCH_KERNEL_COUNT
+} BenchKernel;
+
+static const char* const kernel_names[BENCH_KERNEL_COUNT]                     = {
+    [BENCH_KERNEL_RGB8_TO_RGBA8]             = "Rgb8ToRgba8",
+    [BENCH_KERNEL_SWAP_RED_BLUE]             = "SwapRedBlue",
+    [BENCH_KERNEL_PREMULTIPLY_ALPHA]         = "PremultiplyAlpha",
+    [BENCH_KERNEL_PREMULTIPLY_ALPHA_SRGB]    = "PremultiplyAlpha sRGB",
+    [BENCH_KERNEL_PREMULTIPLY_ALPHA_F32]     = "PremultiplyAlphaF32",
+    [BENCH_KERNEL_PREMULTIPLY_ALPHA_UNORM16] = "PremultiplyAlphaUnorm16",
+    [BENCH_KERNEL_RGBA8_TO_RGBA32F]          = "Rgba8ToRgba32f",
+    [BENCH_KERNEL_SRGBA8_TO_RGBA32F]         = "Rgba8ToRgba32f sRGB",
+    [BENCH_KERNEL_RGBA32F_TO_RGBA8]          = "Rgba32fToRgba8",
+    [BENCH_KERNEL_RGBA32F_TO_SRGBA8]         = "Rgba32fToRgba8 sRGB",
+    [BENCH_KERNEL_F32_TO_F16]                = "F32ToF16",
+    [BENCH_KERNEL_F16_TO_F32]                = "F16ToF32",
+    [BENCH_KERNEL_UNORM16_TO_F16]            = "Unorm16ToF16",
+};
+
+// bytes read per RGBA pixel
+static const uint64_t source_sizes[BENCH_KERNEL_COUNT] = {
+    [BENCH_KERNEL_RGB8_TO_RGBA8]             = 3,
+    [BENCH_KERNEL_SWAP_RED_BLUE]             = 4,
+    [BENCH_KERNEL_PREMULTIPLY_ALPHA]         = 4,
+    [BENCH_KERNEL_PREMULTIPLY_ALPHA_SRGB]    = 4,
+    [BENCH_KERNEL_PREMULTIPLY_ALPHA_F32]     = 16,
+    [BENCH_KERNEL_PREMULTIPLY_ALPHA_UNORM16] = 8,
+    [BENCH_KERNEL_RGBA8_TO_RGBA32F]          = 4,
+    [BENCH_KERNEL_SRGBA8_TO_RGBA32F]         = 4,
+    [BENCH_KERNEL_RGBA32F_TO_RGBA8]          = 16,
+    [BENCH_KERNEL_RGBA32F_TO_SRGBA8]         = 16,
+    [BENCH_KERNEL_F32_TO_F16]                = 16,
+    [BENCH_KERNEL_F16_TO_F32]                = 8,
+    [BENCH_KERNEL_UNORM16_TO_F16]            = 8,
+};
+
+static void PrintUsage(void)
+{
+    printf("usage: pixel_convert_bench [megapixels]\n");
+    printf("  times every pixel conversion with the scalar reference loops and with the vector kernels, %u megapixels by default\n", 16);
+}
+
+static double GetSeconds(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + ((double)time.tv_nsec * 1e-9);
+}
+
+/**
+ * @return The number of bytes the kernel writes.
+ */
+static uint64_t RunKernel(const BenchKernel kernel, const BenchBuffers buffers[static 1], void* const dest)
+{
+    const uint64_t n = buffers->pixel_count;
+    switch (kernel)
+    {
+        case BENCH_KERNEL_RGB8_TO_RGBA8:
+            PixelConvert_Rgb8ToRgba8(dest, buffers->rgba8, n);
+            return n * 4;
+        case BENCH_KERNEL_SWAP_RED_BLUE:
+            PixelConvert_SwapRedBlue(dest, buffers->rgba8, n);
+            return n * 4;
+        case BENCH_KERNEL_PREMULTIPLY_ALPHA:
+            PixelConvert_PremultiplyAlpha(dest, buffers->rgba8, n, false);
+            return n * 4;
+        case BENCH_KERNEL_PREMULTIPLY_ALPHA_SRGB:
+            PixelConvert_PremultiplyAlpha(dest, buffers->rgba8, n, true);
+            return n * 4;
+        case BENCH_KERNEL_PREMULTIPLY_ALPHA_F32:
+            PixelConvert_PremultiplyAlphaF32(dest, buffers->rgba32f, n);
+            return n * 16;
+        case BENCH_KERNEL_PREMULTIPLY_ALPHA_UNORM16:
+            PixelConvert_PremultiplyAlphaUnorm16(dest, buffers->rgba16, n);
+            return n * 8;
+        case BENCH_KERNEL_RGBA8_TO_RGBA32F:
+            PixelConvert_Rgba8ToRgba32f(dest, buffers->rgba8, n, false);
+            return n * 16;
+        case BENCH_KERNEL_SRGBA8_TO_RGBA32F:
+            PixelConvert_Rgba8ToRgba32f(dest, buffers->rgba8, n, true);
+            return n * 16;
+        case BENCH_KERNEL_RGBA32F_TO_RGBA8:
+            PixelConvert_Rgba32fToRgba8(dest, buffers->rgba32f, n, false);
+            return n * 4;
+        case BENCH_KERNEL_RGBA32F_TO_SRGBA8:
+            PixelConvert_Rgba32fToRgba8(dest, buffers->rgba32f, n, true);
+            return n * 4;
+        case BENCH_KERNEL_F32_TO_F16:
+            PixelConvert_F32ToF16(dest, buffers->rgba32f, n * 4);
+            return n * 8;
+        case BENCH_KERNEL_F16_TO_F32:
+            PixelConvert_F16ToF32(dest, buffers->rgba16f, n * 4);
+            return n * 16;
+        case BENCH_KERNEL_UNORM16_TO_F16:
+            PixelConvert_Unorm16ToF16(dest, buffers->rgba16, n * 4);
+            return n * 8;
+        default:
+            ROSINA_LOG_ERROR("Unknown kernel %d", kernel);
+            return 0;
+    }
+}
+
+/**
+ * @return The fastest of BENCH_RUN_COUNT runs in seconds.
+ */
+static double TimeKernel(const BenchKernel kernel, const BenchBuffers buffers[static 1], void* const dest, uint64_t size[static 1])
+{
+    double best = 0.0;
+    for (uint32_t i = 0; i < BENCH_RUN_COUNT; i++)
+    {
+        const double start   = GetSeconds();
+        *size                = RunKernel(kernel, buffers, dest);
+        const double elapsed = GetSeconds() - start;
+        best                 = i == 0 || elapsed < best ? elapsed : best;
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+    const uint64_t megapixels = argc == 2 ? strtoull(argv[1], NULL, 10) : 16;
+    if (megapixels == 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const uint64_t pixel_count = megapixels * 1024 * 1024;
+    BenchBuffers buffers       = {
+              .pixel_count = pixel_count,
+              .rgba8       = malloc(pixel_count * 4),
+              .rgba32f     = malloc(pixel_count * 16),
+              .rgba16      = malloc(pixel_count * 8),
+              .rgba16f     = malloc(pixel_count * 8),
+              .scalar_dest = malloc(pixel_count * 16),
+              .vector_dest = malloc(pixel_count * 16),
+    };
+    if (buffers.rgba8 == NULL || buffers.rgba32f == NULL || buffers.rgba16 == NULL || buffers.rgba16f == NULL || buffers.scalar_dest == NULL ||
+        buffers.vector_dest == NULL)
+    {
+        ROSINA_LOG_ERROR("Failed to allocate %llu megapixels", (unsigned long long)megapixels);
+        return 1;
+    }
+
+    // floats run a little outside of [0, 1] so the clamping is covered too
+    srand(1);
+    for (uint64_t i = 0; i < pixel_count * 4; i++)
+    {
+        buffers.rgba8[i]   = (uint8_t)rand();
+        buffers.rgba32f[i] = ((float)rand() / (float)RAND_MAX * 1.2f) - 0.1f;
+        buffers.rgba16[i]  = (uint16_t)rand();
+    }
+    PixelConvert_F32ToF16(buffers.rgba16f, buffers.rgba32f, pixel_count * 4);
+
+    // the memcpy of the largest buffer is what the conversions would take if they were bound by memory bandwidth, the
+    // first copy also faults in the destination pages
+    double copy_time = 0.0;
+    for (uint32_t i = 0; i <= BENCH_RUN_COUNT; i++)
+    {
+        const double start   = GetSeconds();
+        memcpy(buffers.scalar_dest, buffers.rgba32f, pixel_count * 16);
+        const double elapsed = GetSeconds() - start;
+        copy_time            = i <= 1 || elapsed < copy_time ? elapsed : copy_time;
+    }
+    memcpy(buffers.vector_dest, buffers.rgba32f, pixel_count * 16);
+    // like the kernels, counted as the bytes read plus the bytes written
+    printf("memcpy: %.2f GB/s\n\n", (double)(pixel_count * 32) / copy_time * 1e-9);
+
+    printf("%-26s %14s %14s %9s %11s\n", "kernel", "scalar ms/MP", "vector ms/MP", "speedup", "vector GB/s");
+    bool mismatch = false;
+    for (uint32_t kernel = 0; kernel < BENCH_KERNEL_COUNT; kernel++)
+    {
+        uint64_t size = 0;
+        PixelConvert_SetScalarOnly(true);
+        const double scalar_time = TimeKernel(kernel, &buffers, buffers.scalar_dest, &size);
+        PixelConvert_SetScalarOnly(false);
+        const double vector_time = TimeKernel(kernel, &buffers, buffers.vector_dest, &size);
+
+        const bool same = memcmp(buffers.scalar_dest, buffers.vector_dest, size) == 0;
+        mismatch        = mismatch || !same;
+        const double bytes = (double)((source_sizes[kernel] * pixel_count) + size);
+        printf("%-26s %14.3f %14.3f %8.1fx %11.2f%s\n", kernel_names[kernel], scalar_time * 1e3 / (double)megapixels,
+               vector_time * 1e3 / (double)megapixels, scalar_time / vector_time, bytes / vector_time * 1e-9, same ? "" : "  MISMATCH");
+    }
+
+    free(buffers.rgba8);
+    free(buffers.rgba32f);
+    free(buffers.rgba16);
+    free(buffers.rgba16f);
+    free(buffers.scalar_dest);
+    free(buffers.vector_dest);
+
+    if (mismatch)
+    {
+        ROSINA_LOG_ERROR("The vector kernels do not match the scalar reference loops");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,208 @@
+#include "bc7_encoder.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+// https://learn.microsoft.com/en-us/windows/win32/direct3d11/bc7-format-mode-reference#mode-6
+static const uint32_t BC7_WEIGHTS_4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+typedef struct Bc7Endpoints
+{
+    uint8_t quantized[2][4];  // 7 bit values
+    uint8_t p_bits[2];
+} Bc7Endpoints;
+
+static inline void QuantizeEndpoint(const float endpoint[static 4], uint8_t quantized[static 4], uint8_t p_bit[static 1])
+{
+    float best_error = FLT_MAX;
+    for (uint8_t p = 0; p < 2; p++)
+    {
+        uint8_t q[4];
+        float error = 0.0f;
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            float v = roundf((endpoint[c] - (float)p) / 2.0f);
+            v       = v < 0.0f ? 0.0f : (v > 127.0f ? 127.0f : v);
+            q[c]    = (uint8_t)v;
+
+            const float d = (float)(((uint32_t)q[c] << 1) | p) - endpoint[c];
+            error += d * d;
+        }
+        if (error < best_error)
+        {
+            best_error = error;
+            memcpy(quantized, q, 4);
+            *p_bit = p;
+        }
+    }
+}
+
+static inline float AssignIndices(const Bc7Endpoints endpoints[static 1], const uint8_t rgba[static 64], uint8_t indices[static 16])
+{
+    uint32_t palette[16][4];
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        const uint32_t e0 = ((uint32_t)endpoints->quantized[0][c] << 1) | endpoints->p_bits[0];
+        const uint32_t e1 = ((uint32_t)endpoints->quantized[1][c] << 1) | endpoints->p_bits[1];
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            palette[i][c] = (((64 - BC7_WEIGHTS_4[i]) * e0) + (BC7_WEIGHTS_4[i] * e1) + 32) >> 6;
+        }
+    }
+
+    float total_error = 0.0f;
+    for (uint32_t t = 0; t < 16; t++)
+    {
+        uint32_t best_error = UINT32_MAX;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            uint32_t error = 0;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                const int32_t d = (int32_t)palette[i][c] - (int32_t)rgba[(t * 4) + c];
+                error += (uint32_t)(d * d);
+            }
+            if (error < best_error)
+            {
+                best_error = error;
+                indices[t] = (uint8_t)i;
+            }
+        }
+        total_error += (float)best_error;
+    }
+
+    return total_error;
+}
+
+static inline void FitPrincipalAxis(const uint8_t rgba[static 64], float e0[static 4], float e1[static 4])
+{
+    float mean[4] = {};
+    for (uint32_t t = 0; t < 16; t++)
+    {
+        for (uint32_t c = 0; c < 4; c++) mean[c] += (float)rgba[(t * 4) + c] / 16.0f;
+    }
+
+    float covariance[4][4] = {};
+    for (uint32_t t = 0; t < 16; t++)
+    {
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            for (uint32_t j = 0; j < 4; j++)
+            {
+                covariance[i][j] += ((float)rgba[(t * 4) + i] - mean[i]) * ((float)rgba[(t * 4) + j] - mean[j]);
+            }
+        }
+    }
+
+    // power iteration
+    float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (uint32_t iteration = 0; iteration < 8; iteration++)
+    {
+        float next[4] = {};
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            for (uint32_t j = 0; j < 4; j++) next[i] += covariance[i][j] * axis[j];
+        }
+
+        const float length = sqrtf((next[0] * next[0]) + (next[1] * next[1]) + (next[2] * next[2]) + (next[3] * next[3]));
+        if (length < FLT_EPSILON) break;
+        for (uint32_t i = 0; i < 4; i++) axis[i] = next[i] / length;
+    }
+
+    float t_min = FLT_MAX;
+    float t_max = -FLT_MAX;
+    for (uint32_t t = 0; t < 16; t++)
+    {
+        float d = 0.0f;
+        for (uint32_t c = 0; c < 4; c++) d += ((float)rgba[(t * 4) + c] - mean[c]) * axis[c];
+        t_min = d < t_min ? d : t_min;
+        t_max = d > t_max ? d : t_max;
+    }
+
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        e0[c] = fminf(fmaxf(mean[c] + (axis[c] * t_min), 0.0f), 255.0f);
+        e1[c] = fminf(fmaxf(mean[c] + (axis[c] * t_max), 0.0f), 255.0f);
+    }
+}
+
+static inline void WriteBits(uint8_t block[static 16], uint32_t position[static 1], const uint32_t value, const uint32_t bit_count)
+{
+    for (uint32_t i = 0; i < bit_count; i++)
+    {
+        const uint32_t bit = (value >> i) & 1;
+        block[*position >> 3] |= (uint8_t)(bit << (*position & 7));
+        (*position)++;
+    }
+}
+
+void CompressBc7Block(uint8_t dest[static 16], const uint8_t rgba[static 64])
+{
+    float candidates[2][2][4];
+
+    FitPrincipalAxis(rgba, candidates[0][0], candidates[0][1]);
+
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        candidates[1][0][c] = 255.0f;
+        candidates[1][1][c] = 0.0f;
+    }
+    for (uint32_t t = 0; t < 16; t++)
+    {
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            candidates[1][0][c] = fminf(candidates[1][0][c], (float)rgba[(t * 4) + c]);
+            candidates[1][1][c] = fmaxf(candidates[1][1][c], (float)rgba[(t * 4) + c]);
+        }
+    }
+
+    Bc7Endpoints best_endpoints = {};
+    uint8_t best_indices[16]    = {};
+    float best_error            = FLT_MAX;
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        Bc7Endpoints endpoints;
+        QuantizeEndpoint(candidates[i][0], endpoints.quantized[0], &endpoints.p_bits[0]);
+        QuantizeEndpoint(candidates[i][1], endpoints.quantized[1], &endpoints.p_bits[1]);
+
+        uint8_t indices[16];
+        const float error = AssignIndices(&endpoints, rgba, indices);
+        if (error < best_error)
+        {
+            best_error     = error;
+            best_endpoints = endpoints;
+            memcpy(best_indices, indices, sizeof(indices));
+        }
+    }
+
+    // the most significant bit of the anchor index is implicit and must be 0.
+    if (best_indices[0] >= 8)
+    {
+        Bc7Endpoints swapped = {
+            .quantized = {},
+            .p_bits    = {best_endpoints.p_bits[1], best_endpoints.p_bits[0]},
+        };
+        memcpy(swapped.quantized[0], best_endpoints.quantized[1], 4);
+        memcpy(swapped.quantized[1], best_endpoints.quantized[0], 4);
+        best_endpoints = swapped;
+
+        for (uint32_t t = 0; t < 16; t++) best_indices[t] = 15 - best_indices[t];
+    }
+
+    memset(dest, 0, 16);
+    uint32_t position = 0;
+    WriteBits(dest, &position, 1 << 6, 7);  // mode 6
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        WriteBits(dest, &position, best_endpoints.quantized[0][c], 7);
+        WriteBits(dest, &position, best_endpoints.quantized[1][c], 7);
+    }
+    WriteBits(dest, &position, best_endpoints.p_bits[0], 1);
+    WriteBits(dest, &position, best_endpoints.p_bits[1], 1);
+    WriteBits(dest, &position, best_indices[0], 3);
+    for (uint32_t t = 1; t < 16; t++)
+    {
+        WriteBits(dest, &position, best_indices[t], 4);
+    }
+}
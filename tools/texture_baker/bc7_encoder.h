@@ -0,0 +1,15 @@
+#ifndef ROSINA_TOOLS_BC7_ENCODER_H
+#define ROSINA_TOOLS_BC7_ENCODER_H
+
+#include <stdint.h>
+
+/**
+ * Encodes one 4x4 block using BC7 mode 6 (a single RGBA subset with 7 bit endpoints, per-endpoint p-bits and
+ * 4 bit indices). The endpoints are fit along the principal axis of the block and compared against the bounding box.
+ *
+ * @param dest The 16 byte BC7 block.
+ * @param rgba 16 RGBA8 texels in row major order.
+ */
+void CompressBc7Block(uint8_t dest[static 16], const uint8_t rgba[static 64]);
+
+#endif
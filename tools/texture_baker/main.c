@@ -0,0 +1,280 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <utility/ktx2.h>
+#include <utility/log.h>
+#include <vulkan/vulkan_core.h>
+
+#include "bc7_encoder.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#define STB_DXT_IMPLEMENTATION
+#include "stb_dxt.h"
+
+typedef enum TextureBakerFormat
+{
+    TEXTURE_BAKER_FORMAT_RGBA8,
+    TEXTURE_BAKER_FORMAT_BC1,
+    TEXTURE_BAKER_FORMAT_BC3,
+    TEXTURE_BAKER_FORMAT_BC7,
+} TextureBakerFormat;
+
+typedef struct TextureBakerLevel
+{
+    uint32_t width;
+    uint32_t height;
+    uint8_t* rgba;
+} TextureBakerLevel;
+
+static float srgb_to_linear[256];
+
+static inline uint8_t LinearToSrgb(const float linear)
+{
+    const float srgb = linear <= 0.0031308f ? linear * 12.92f : (1.055f * powf(linear, 1.0f / 2.4f)) - 0.055f;
+    return (uint8_t)fminf(fmaxf((srgb * 255.0f) + 0.5f, 0.0f), 255.0f);
+}
+
+/**
+ * 2x2 box filter. Color channels are averaged in linear space when the texture is sRGB. Odd edges are clamped.
+ */
+static TextureBakerLevel Downsample(const TextureBakerLevel source[static 1], const bool srgb)
+{
+    TextureBakerLevel level = {
+        .width  = source->width > 1 ? source->width / 2 : 1,
+        .height = source->height > 1 ? source->height / 2 : 1,
+        .rgba   = NULL,
+    };
+    level.rgba = malloc((size_t)level.width * level.height * 4);
+
+    for (uint32_t y = 0; y < level.height; y++)
+    {
+        const uint32_t y0 = y * 2 < source->height ? y * 2 : source->height - 1;
+        const uint32_t y1 = (y * 2) + 1 < source->height ? (y * 2) + 1 : y0;
+        for (uint32_t x = 0; x < level.width; x++)
+        {
+            const uint32_t x0 = x * 2 < source->width ? x * 2 : source->width - 1;
+            const uint32_t x1 = (x * 2) + 1 < source->width ? (x * 2) + 1 : x0;
+
+            const uint8_t* const taps[4] = {
+                source->rgba + (((size_t)y0 * source->width) + x0) * 4,
+                source->rgba + (((size_t)y0 * source->width) + x1) * 4,
+                source->rgba + (((size_t)y1 * source->width) + x0) * 4,
+                source->rgba + (((size_t)y1 * source->width) + x1) * 4,
+            };
+            uint8_t* const dest = level.rgba + (((size_t)y * level.width) + x) * 4;
+
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                if (srgb)
+                {
+                    const float sum = srgb_to_linear[taps[0][c]] + srgb_to_linear[taps[1][c]] + srgb_to_linear[taps[2][c]] + srgb_to_linear[taps[3][c]];
+                    dest[c]         = LinearToSrgb(sum * 0.25f);
+                }
+                else
+                {
+                    dest[c] = (uint8_t)(((uint32_t)taps[0][c] + taps[1][c] + taps[2][c] + taps[3][c] + 2) / 4);
+                }
+            }
+            dest[3] = (uint8_t)(((uint32_t)taps[0][3] + taps[1][3] + taps[2][3] + taps[3][3] + 2) / 4);
+        }
+    }
+
+    return level;
+}
+
+static inline uint32_t GetBlockByteCount(const TextureBakerFormat format)
+{
+    switch (format)
+    {
+        case TEXTURE_BAKER_FORMAT_BC1: return 8;
+        case TEXTURE_BAKER_FORMAT_BC3: return 16;
+        case TEXTURE_BAKER_FORMAT_BC7: return 16;
+        default: return 0;
+    }
+}
+
+static inline uint32_t GetVkFormat(const TextureBakerFormat format, const bool srgb)
+{
+    switch (format)
+    {
+        case TEXTURE_BAKER_FORMAT_RGBA8: return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+        case TEXTURE_BAKER_FORMAT_BC1: return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        case TEXTURE_BAKER_FORMAT_BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+        case TEXTURE_BAKER_FORMAT_BC7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+        default: return VK_FORMAT_UNDEFINED;
+    }
+}
+
+/**
+ * @param level The level to compress.
+ * @param format The block format.
+ * @param size Set to the size of the returned buffer.
+ * @return The compressed blocks in row major order. The caller frees it.
+ */
+static uint8_t* CompressLevel(const TextureBakerLevel level[static 1], const TextureBakerFormat format, uint64_t size[static 1])
+{
+    const uint32_t block_byte_count = GetBlockByteCount(format);
+    const uint32_t blocks_x         = (level->width + 3) / 4;
+    const uint32_t blocks_y         = (level->height + 3) / 4;
+
+    *size               = (uint64_t)blocks_x * blocks_y * block_byte_count;
+    uint8_t* const data = malloc(*size);
+    uint8_t* block_dest = data;
+
+    for (uint32_t by = 0; by < blocks_y; by++)
+    {
+        for (uint32_t bx = 0; bx < blocks_x; bx++)
+        {
+            // texels outside of the level repeat the edge
+            uint8_t block[64];
+            for (uint32_t y = 0; y < 4; y++)
+            {
+                const uint32_t sy = (by * 4) + y < level->height ? (by * 4) + y : level->height - 1;
+                for (uint32_t x = 0; x < 4; x++)
+                {
+                    const uint32_t sx = (bx * 4) + x < level->width ? (bx * 4) + x : level->width - 1;
+                    memcpy(block + (((y * 4) + x) * 4), level->rgba + (((size_t)sy * level->width) + sx) * 4, 4);
+                }
+            }
+
+            switch (format)
+            {
+                case TEXTURE_BAKER_FORMAT_BC1:
+                    stb_compress_dxt_block(block_dest, block, 0, STB_DXT_HIGHQUAL);
+                    break;
+                case TEXTURE_BAKER_FORMAT_BC3:
+                    stb_compress_dxt_block(block_dest, block, 1, STB_DXT_HIGHQUAL);
+                    break;
+                case TEXTURE_BAKER_FORMAT_BC7:
+                    CompressBc7Block(block_dest, block);
+                    break;
+                default:
+                    break;
+            }
+            block_dest += block_byte_count;
+        }
+    }
+
+    return data;
+}
+
+static void PrintUsage(void)
+{
+    printf("usage: texture_baker <input image> <output.ktx2> [--format rgba8|bc1|bc3|bc7] [--linear] [--no-mips]\n");
+    printf("  --format   block format of the output, bc7 by default\n");
+    printf("  --linear   treat the input as linear data (normal maps, masks) instead of sRGB color\n");
+    printf("  --no-mips  only write the top level\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const char* const input_path  = argv[1];
+    const char* const output_path = argv[2];
+    TextureBakerFormat format     = TEXTURE_BAKER_FORMAT_BC7;
+    bool srgb                     = true;
+    bool mips                     = true;
+
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--linear") == 0)
+        {
+            srgb = false;
+        }
+        else if (strcmp(argv[i], "--no-mips") == 0)
+        {
+            mips = false;
+        }
+        else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            const char* const name = argv[++i];
+            if (strcmp(name, "rgba8") == 0) format = TEXTURE_BAKER_FORMAT_RGBA8;
+            else if (strcmp(name, "bc1") == 0) format = TEXTURE_BAKER_FORMAT_BC1;
+            else if (strcmp(name, "bc3") == 0) format = TEXTURE_BAKER_FORMAT_BC3;
+            else if (strcmp(name, "bc7") == 0) format = TEXTURE_BAKER_FORMAT_BC7;
+            else
+            {
+                ROSINA_LOG_ERROR("Unknown format \"%s\"", name);
+                return 1;
+            }
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        const float c     = (float)i / 255.0f;
+        srgb_to_linear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    TextureBakerLevel levels[KTX2_MAX_LEVEL_COUNT] = {};
+    uint32_t level_count                           = 0;
+    {
+        int w = 0, h = 0, d = 0;
+        levels[0].rgba = stbi_load(input_path, &w, &h, &d, 4);
+        if (levels[0].rgba == NULL)
+        {
+            ROSINA_LOG_ERROR("Failed to load \"%s\": %s", input_path, stbi_failure_reason());
+            return 1;
+        }
+        levels[0].width  = (uint32_t)w;
+        levels[0].height = (uint32_t)h;
+        level_count      = 1;
+    }
+
+    while (mips && level_count < KTX2_MAX_LEVEL_COUNT && (levels[level_count - 1].width > 1 || levels[level_count - 1].height > 1))
+    {
+        levels[level_count] = Downsample(&levels[level_count - 1], srgb);
+        level_count++;
+    }
+
+    Ktx2WriteInfo write_info = {
+        .vk_format   = GetVkFormat(format, srgb),
+        .width       = levels[0].width,
+        .height      = levels[0].height,
+        .level_count = level_count,
+        .level_data  = {},
+        .level_sizes = {},
+    };
+    uint8_t* compressed[KTX2_MAX_LEVEL_COUNT] = {};
+    for (uint32_t i = 0; i < level_count; i++)
+    {
+        if (format == TEXTURE_BAKER_FORMAT_RGBA8)
+        {
+            write_info.level_data[i]  = levels[i].rgba;
+            write_info.level_sizes[i] = (uint64_t)levels[i].width * levels[i].height * 4;
+            continue;
+        }
+
+        compressed[i]            = CompressLevel(&levels[i], format, &write_info.level_sizes[i]);
+        write_info.level_data[i] = compressed[i];
+    }
+
+    const bool failed = Ktx2File_Write(output_path, &write_info);
+    if (!failed)
+    {
+        uint64_t total_size = 0;
+        for (uint32_t i = 0; i < level_count; i++) total_size += write_info.level_sizes[i];
+        ROSINA_LOG_INFO("Baked \"%s\" (%ux%u, %u levels, %llu bytes)", output_path, levels[0].width, levels[0].height, level_count, (unsigned long long)total_size);
+    }
+
+    stbi_image_free(levels[0].rgba);
+    for (uint32_t i = 1; i < level_count; i++) free(levels[i].rgba);
+    for (uint32_t i = 0; i < level_count; i++) free(compressed[i]);
+
+    return failed ? 1 : 0;
+}